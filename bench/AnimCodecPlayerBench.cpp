@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "bench/Benchmark.h"
+#include "include/codec/SkCodec.h"
+#include "include/core/SkData.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkImage.h"
+#include "include/utils/SkAnimCodecPlayer.h"
+#include "include/utils/SkRandom.h"
+#include "src/utils/SkOSPath.h"
+#include "tools/Resources.h"
+
+// Times SkAnimCodecPlayer::seek() + getFrame() over an animation, either playing it in order
+// or scrubbing to random times, with various frame cache settings.  Each loop is one frame.
+class AnimCodecPlayerBench : public Benchmark {
+public:
+    AnimCodecPlayerBench(const char* path, bool scrub, int maxCachedFrames, int decodeAhead)
+        : fPath(path)
+        , fScrub(scrub)
+        , fMaxCachedFrames(maxCachedFrames)
+        , fDecodeAhead(decodeAhead) {
+        fName.printf("AnimCodecPlayer_%s_%s", SkOSPath::Basename(path).c_str(),
+                     scrub ? "scrub" : "play");
+        if (maxCachedFrames > 0) {
+            fName.appendf("_cache%d", maxCachedFrames);
+        }
+        if (decodeAhead > 0) {
+            fName.appendf("_ahead%d", decodeAhead);
+        }
+    }
+
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+protected:
+    const char* onGetName() override { return fName.c_str(); }
+
+    void onDelayedSetup() override {
+        fData = GetResourceAsData(fPath);
+        if (fDecodeAhead > 0) {
+            fExecutor = SkExecutor::MakeFIFOThreadPool(1);
+        }
+    }
+
+    void onPreDraw(SkCanvas*) override {
+        SkAnimCodecPlayer::CacheOptions options;
+        options.fMaxCachedFrames = fMaxCachedFrames;
+        options.fExecutor = fExecutor.get();
+        options.fDecodeAhead = fDecodeAhead;
+        fPlayer.reset(new SkAnimCodecPlayer(SkCodec::MakeFromData(fData), options));
+        fTime = 0;
+    }
+
+    void onPostDraw(SkCanvas*) override {
+        fPlayer.reset();
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        const uint32_t duration = fPlayer->duration();
+        for (int i = 0; i < loops; ++i) {
+            // Frames are typically 100ms or so; advancing 60ms steps through every frame.
+            fTime = fScrub ? fRand.nextULessThan(duration) : fTime + 60;
+            fPlayer->seek(fTime);
+            sk_sp<SkImage> frame = fPlayer->getFrame();
+            SkASSERT(frame);
+        }
+    }
+
+private:
+    const char*                        fPath;
+    const bool                         fScrub;
+    const int                          fMaxCachedFrames;
+    const int                          fDecodeAhead;
+    SkString                           fName;
+    sk_sp<SkData>                      fData;
+    std::unique_ptr<SkExecutor>        fExecutor;
+    std::unique_ptr<SkAnimCodecPlayer> fPlayer;
+    uint32_t                           fTime = 0;
+    SkRandom                           fRand;
+};
+
+#define ANIM_BENCHES(path)                                                         \
+    DEF_BENCH(return new AnimCodecPlayerBench(path, false,  0, 0);)                \
+    DEF_BENCH(return new AnimCodecPlayerBench(path, false,  8, 0);)                \
+    DEF_BENCH(return new AnimCodecPlayerBench(path, false,  8, 4);)                \
+    DEF_BENCH(return new AnimCodecPlayerBench(path,  true,  0, 0);)                \
+    DEF_BENCH(return new AnimCodecPlayerBench(path,  true,  8, 0);)                \
+    DEF_BENCH(return new AnimCodecPlayerBench(path,  true,  8, 4);)
+
+ANIM_BENCHES("images/flightAnim.gif")
+ANIM_BENCHES("images/alphabetAnim.gif")
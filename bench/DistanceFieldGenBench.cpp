@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "bench/Benchmark.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkFont.h"
+#include "src/core/SkDistanceFieldGen.h"
+#include "tools/ToolUtils.h"
+
+#include <vector>
+
+// Generates the distance fields for a batch of A8 glyph masks, such as GrSDFMaskFilter makes
+// for a run of text drawn with distance field text. With more than one thread, the batch is
+// spread across an executor.
+class SkDistanceFieldGenBench : public Benchmark {
+public:
+    SkDistanceFieldGenBench(int glyphSize, int threads)
+            : fGlyphSize(glyphSize), fThreads(threads) {
+        fName.printf("SkDistanceFieldGen_%d_%d", glyphSize, threads);
+    }
+
+protected:
+    const char* onGetName() override { return fName.c_str(); }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        if (fThreads > 1) {
+            fExecutor = SkExecutor::MakeFIFOThreadPool(fThreads);
+        }
+        SkFont font(ToolUtils::create_portable_typeface(), fGlyphSize * 0.8f);
+        font.setEdging(SkFont::Edging::kAntiAlias);
+        SkPaint paint;
+
+        fMasks.resize(kGlyphCount);
+        fDistanceFields.resize(kGlyphCount);
+        for (int i = 0; i < kGlyphCount; i++) {
+            SkBitmap& mask = fMasks[i];
+            mask.allocPixels(SkImageInfo::MakeA8(fGlyphSize, fGlyphSize));
+            mask.eraseColor(SK_ColorTRANSPARENT);
+            SkCanvas canvas(mask);
+            char c = 'A' + i % 58;
+            canvas.drawSimpleText(&c, 1, SkTextEncoding::kUTF8,
+                                  fGlyphSize * 0.1f, fGlyphSize * 0.8f, font, paint);
+
+            fDistanceFields[i].resize(SkComputeDistanceFieldSize(fGlyphSize, fGlyphSize));
+            fJobs.push_back({fDistanceFields[i].data(), mask.getAddr8(0, 0),
+                             fGlyphSize, fGlyphSize, mask.rowBytes(), SkMask::kA8_Format});
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int i = 0; i < loops; i++) {
+            SkGenerateDistanceFields(SkMakeSpan(fJobs), fExecutor.get());
+        }
+    }
+
+private:
+    static constexpr int kGlyphCount = 64;
+
+    const int fGlyphSize;
+    const int fThreads;
+    SkString fName;
+    std::unique_ptr<SkExecutor> fExecutor;
+    std::vector<SkBitmap> fMasks;
+    std::vector<std::vector<unsigned char>> fDistanceFields;
+    std::vector<SkDistanceFieldJob> fJobs;
+
+    typedef Benchmark INHERITED;
+};
+
+DEF_BENCH( return new SkDistanceFieldGenBench(32, 1); )
+DEF_BENCH( return new SkDistanceFieldGenBench(32, 4); )
+DEF_BENCH( return new SkDistanceFieldGenBench(128, 1); )
+DEF_BENCH( return new SkDistanceFieldGenBench(128, 4); )
@@ -6,11 +6,13 @@
  */
 
 #include "bench/Benchmark.h"
+#include "include/codec/SkCodec.h"
 #include "include/core/SkBitmap.h"
 #include "include/core/SkStream.h"
 #include "include/encode/SkJpegEncoder.h"
 #include "include/encode/SkPngEncoder.h"
 #include "include/encode/SkWebpEncoder.h"
+#include "src/core/SkAutoMalloc.h"
 #include "tools/Resources.h"
 
 // Like other Benchmark subclasses, Encoder benchmarks are run by:
@@ -52,6 +54,45 @@ private:
     SkBitmap    fBitmap;
 };
 
+// Encodes the YUV planes decoded from a jpeg straight back to a jpeg.  Compare with
+// Encode_<file>_JPEG, which encodes the same image from RGB pixels.
+class EncodeYUVBench : public Benchmark {
+public:
+    EncodeYUVBench(const char* filename)
+        : fSourceFilename(filename)
+        , fName(SkStringPrintf("Encode_%s_JPEG_YUV", filename)) {}
+
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+    const char* onGetName() override { return fName.c_str(); }
+
+    void onDelayedSetup() override {
+        std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(GetResourceAsData(fSourceFilename));
+        SkAssertResult(codec && codec->queryYUV8(&fSizeInfo, &fColorSpace));
+        fStorage.reset(fSizeInfo.computeTotalBytes());
+        fSizeInfo.computePlanes(fStorage.get(), fPlanes);
+        SkAssertResult(SkCodec::kSuccess == codec->getYUV8Planes(fSizeInfo, fPlanes));
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkJpegEncoder::Options opts;
+        opts.fQuality = 90;
+        while (loops-- > 0) {
+            SkNullWStream dst;
+            SkAssertResult(SkJpegEncoder::EncodeYUV(&dst, fSizeInfo, fPlanes, fColorSpace, opts));
+            SkASSERT(dst.bytesWritten() > 0);
+        }
+    }
+
+private:
+    const char*     fSourceFilename;
+    SkString        fName;
+    SkYUVASizeInfo  fSizeInfo;
+    SkYUVColorSpace fColorSpace;
+    SkAutoMalloc    fStorage;
+    void*           fPlanes[SkYUVASizeInfo::kMaxCount];
+};
+
 static bool encode_jpeg(SkWStream* dst, const SkPixmap& src) {
     SkJpegEncoder::Options opts;
     opts.fQuality = 90;
@@ -91,6 +132,12 @@ static const char* srcs[2] = {"images/mandrill_512.png", "images/color_wheel.jpg
 DEF_BENCH(return new EncodeBench(srcs[0], &encode_jpeg, "JPEG"));
 DEF_BENCH(return new EncodeBench(srcs[1], &encode_jpeg, "JPEG"));
 
+// Transcoding a jpeg from its YUV planes versus from RGB pixels.
+static const char* yuvSrc = "images/mandrill_512_q075.jpg";
+DEF_BENCH(return new EncodeBench(yuvSrc, &encode_jpeg, "JPEG"));
+DEF_BENCH(return new EncodeYUVBench(yuvSrc));
+DEF_BENCH(return new EncodeYUVBench(srcs[1]));
+
 // TODO: What is the appropriate quality to use to benchmark WEBP encodes?
 DEF_BENCH(return new EncodeBench(srcs[0], encode_webp_lossy, "WEBP"));
 DEF_BENCH(return new EncodeBench(srcs[1], encode_webp_lossy, "WEBP"));
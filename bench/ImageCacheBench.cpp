@@ -6,7 +6,10 @@
  */
 
 #include "bench/Benchmark.h"
+#include "include/core/SkExecutor.h"
+#include "include/private/SkMutex.h"
 #include "src/core/SkResourceCache.h"
+#include "src/core/SkTaskGroup.h"
 
 namespace {
 static void* gGlobalAddress;
@@ -32,6 +35,11 @@ struct TestRec : public SkResourceCache::Rec {
     static bool Visitor(const SkResourceCache::Rec&, void*) {
         return true;
     }
+
+    static bool ValueVisitor(const SkResourceCache::Rec& rec, void* context) {
+        *(intptr_t*)context = static_cast<const TestRec&>(rec).fValue;
+        return true;
+    }
 };
 }
 
@@ -72,6 +80,77 @@ private:
     typedef Benchmark INHERITED;
 };
 
+// Looks up cached recs from many threads at once, either in one SkResourceCache behind a
+// mutex (as the global cache used to be) or in an SkShardedResourceCache.
+class ImageCacheMTBench : public Benchmark {
+    enum {
+        CACHE_COUNT = 500,
+        THREAD_COUNT = 16,
+    };
+
+    const bool                              fSharded;
+    SkMutex                                 fMutex;
+    std::unique_ptr<SkResourceCache>        fLockedCache;
+    std::unique_ptr<SkShardedResourceCache> fShardedCache;
+    std::unique_ptr<SkExecutor>             fExecutor;
+
+public:
+    explicit ImageCacheMTBench(bool sharded) : fSharded(sharded) {}
+
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+protected:
+    const char* onGetName() override {
+        return fSharded ? "imagecache_mt_sharded" : "imagecache_mt_locked";
+    }
+
+    void onDelayedSetup() override {
+        if (fSharded) {
+            fShardedCache.reset(new SkShardedResourceCache(CACHE_COUNT * 100));
+        } else {
+            fLockedCache.reset(new SkResourceCache(CACHE_COUNT * 100));
+        }
+        for (int i = 0; i < CACHE_COUNT; ++i) {
+            this->add(new TestRec(TestKey(i), i));
+        }
+        fExecutor = SkExecutor::MakeFIFOThreadPool(THREAD_COUNT);
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        // Each thread does all the loops, so this times THREAD_COUNT concurrent lookups.
+        SkTaskGroup(*fExecutor).batch(THREAD_COUNT, [&](int thread) {
+            for (int i = 0; i < loops; ++i) {
+                const intptr_t value = (i * 7 + thread * 31) % CACHE_COUNT;
+                intptr_t found = -1;
+                SkAssertResult(this->find(TestKey(value), &found));
+                SkASSERT(found == value);
+            }
+        });
+    }
+
+private:
+    void add(TestRec* rec) {
+        if (fSharded) {
+            fShardedCache->add(rec);
+        } else {
+            SkAutoMutexExclusive lock(fMutex);
+            fLockedCache->add(rec);
+        }
+    }
+
+    bool find(const TestKey& key, intptr_t* value) {
+        if (fSharded) {
+            return fShardedCache->find(key, TestRec::ValueVisitor, value);
+        }
+        SkAutoMutexExclusive lock(fMutex);
+        return fLockedCache->find(key, TestRec::ValueVisitor, value);
+    }
+
+    typedef Benchmark INHERITED;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DEF_BENCH( return new ImageCacheBench(); )
+DEF_BENCH( return new ImageCacheMTBench(false); )
+DEF_BENCH( return new ImageCacheMTBench(true); )
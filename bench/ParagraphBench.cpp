@@ -12,7 +12,9 @@
 #include "tools/Resources.h"
 
 #include <cfloat>
+#include "include/core/SkExecutor.h"
 #include "include/core/SkPictureRecorder.h"
+#include "src/core/SkTaskGroup.h"
 #include "modules/skparagraph/utils/TestFontCollection.h"
 
 using namespace skia::textlayout;
@@ -46,10 +48,111 @@ struct ParagraphBench : public Benchmark {
         SkCanvas* canvas = rec.beginRecording({0,0, 2000,3000});
         while (loops-- > 0) {
             paragraph->layout(fWidth);
-            auto impl = static_cast<ParagraphImpl*>(paragraph.get());
             paragraph->paint(canvas, 0, 0);
             paragraph->markDirty();
-            impl->resetCache();
+            fontCollection->getParagraphCache()->reset();
+        }
+    }
+};
+
+// Lays out the sentences of a text as separate paragraphs on several threads at once. The
+// threads share one FontCollection, so after the first loop every paragraph is found in its
+// ParagraphCache.
+struct ParagraphCacheBench : public Benchmark {
+    ParagraphCacheBench(int threads, const char* r, const char* n)
+            : fResource(r), fThreads(threads) {
+        fName.printf("%s_%d_threads", n, threads);
+    }
+    const char* fResource;
+    const int fThreads;
+    SkString fName;
+    std::unique_ptr<SkExecutor> fExecutor;
+    sk_sp<FontCollection> fFontCollection;
+    std::vector<std::vector<std::unique_ptr<Paragraph>>> fParagraphs;  // for each thread
+
+    const char* onGetName() override { return fName.c_str(); }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+    void onDelayedSetup() override {
+        sk_sp<SkData> data = GetResourceAsData(fResource);
+        if (!data) {
+            return;
+        }
+        if (fThreads > 1) {
+            fExecutor = SkExecutor::MakeFIFOThreadPool(fThreads);
+        }
+        fFontCollection = sk_make_sp<FontCollection>();
+        fFontCollection->setDefaultFontManager(SkFontMgr::RefDefault());
+        ParagraphStyle paragraph_style;
+        paragraph_style.turnHintingOff();
+
+        std::string text((const char*)data->data(), data->size());
+        fParagraphs.resize(fThreads);
+        for (auto& paragraphs : fParagraphs) {
+            for (size_t start = 0; start < text.size();) {
+                size_t end = std::min(text.find(". ", start), text.size());
+                ParagraphBuilderImpl builder(paragraph_style, fFontCollection);
+                builder.addText(text.substr(start, end - start).c_str());
+                paragraphs.push_back(builder.Build());
+                start = end + 2;
+            }
+        }
+    }
+    void onDraw(int loops, SkCanvas*) override {
+        if (fParagraphs.empty()) {
+            return;
+        }
+        auto layout = [&](int thread) {
+            for (int i = 0; i < loops; i++) {
+                for (auto& paragraph : fParagraphs[thread]) {
+                    paragraph->markDirty();
+                    paragraph->layout(300);
+                }
+            }
+        };
+        if (fExecutor) {
+            SkTaskGroup(*fExecutor).batch(fThreads, layout);
+        } else {
+            layout(0);
+        }
+    }
+};
+
+// Lays out one long paragraph (the text repeated many times) at 100 different widths, as when a
+// window is resized. Only the line breaking changes, so the paragraph keeps its shaped text.
+struct ParagraphResizeBench : public Benchmark {
+    ParagraphResizeBench(const char* r, const char* n) : fResource(r), fName(n) {}
+    const char* fResource;
+    const char* fName;
+    sk_sp<FontCollection> fFontCollection;
+    std::unique_ptr<Paragraph> fParagraph;
+
+    const char* onGetName() override { return fName; }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+    void onDelayedSetup() override {
+        sk_sp<SkData> data = GetResourceAsData(fResource);
+        if (!data) {
+            return;
+        }
+        fFontCollection = sk_make_sp<FontCollection>();
+        fFontCollection->setDefaultFontManager(SkFontMgr::RefDefault());
+        ParagraphStyle paragraph_style;
+        paragraph_style.turnHintingOff();
+        ParagraphBuilderImpl builder(paragraph_style, fFontCollection);
+        std::string text((const char*)data->data(), data->size());
+        for (int i = 0; i < 20; i++) {
+            builder.addText(text.c_str());
+        }
+        fParagraph = builder.Build();
+        fParagraph->layout(1000);
+    }
+    void onDraw(int loops, SkCanvas*) override {
+        if (!fParagraph) {
+            return;
+        }
+        while (loops-- > 0) {
+            for (int i = 0; i < 100; i++) {
+                fParagraph->layout(200 + i * 10);
+            }
         }
     }
 };
@@ -61,4 +164,9 @@ struct ParagraphBench : public Benchmark {
 PARAGRAPH_BENCH(english)
 #undef PARAGRAPH_BENCH
 
+DEF_BENCH(return new ParagraphCacheBench(1, "text/english.txt", "paragraph_cache_english");)
+DEF_BENCH(return new ParagraphCacheBench(4, "text/english.txt", "paragraph_cache_english");)
+
+DEF_BENCH(return new ParagraphResizeBench("text/english.txt", "paragraph_resize_english");)
+
 #endif  // !defined(SK_BUILD_FOR_ANDROID_FRAMEWORK) && !defined(SK_BUILD_FOR_GOOGLE3)
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "bench/Benchmark.h"
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkFont.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkTextBlob.h"
+#include "include/utils/SkRandom.h"
+#include "src/utils/SkPictureDelta.h"
+
+#include <vector>
+
+// Streams the frames of an animation of 2000 rects, paths, text blobs and images, 5% of which
+// move each frame. The frames are either delta encoded, or serialized one by one.
+class PictureDeltaBench : public Benchmark {
+public:
+    enum class Mode { kEncode, kDecode, kSerialize, kDeserialize };
+
+    explicit PictureDeltaBench(Mode mode) : fMode(mode) {}
+
+private:
+    static constexpr int kItems = 2000;
+    static constexpr int kFrames = 60;
+
+    const char* onGetName() override {
+        switch (fMode) {
+            case Mode::kEncode:      return "picture_delta_encode";
+            case Mode::kDecode:      return "picture_delta_decode";
+            case Mode::kSerialize:   return "picture_delta_baseline_serialize";
+            case Mode::kDeserialize: return "picture_delta_baseline_deserialize";
+        }
+        return nullptr;
+    }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+    void onDelayedSetup() override {
+        SkRandom rand;
+        std::vector<sk_sp<SkImage>> images;
+        for (int i = 0; i < 4; i++) {
+            SkBitmap bitmap;
+            bitmap.allocN32Pixels(32, 32);
+            bitmap.eraseColor(rand.nextU() | 0xFF000000);
+            images.push_back(SkImage::MakeFromBitmap(bitmap));
+        }
+        SkPath path;
+        path.addCircle(10, 10, 10);
+        path.lineTo(30, 5);
+        sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString("Frame by frame", SkFont());
+
+        std::vector<SkPoint> positions;
+        for (int i = 0; i < kItems; i++) {
+            positions.push_back({rand.nextRangeF(0, 1000), rand.nextRangeF(0, 1000)});
+        }
+
+        for (int frame = 0; frame < kFrames; frame++) {
+            for (int i = frame % 20; i < kItems; i += 20) {
+                positions[i].offset(2, 1);
+            }
+
+            SkPictureRecorder recorder;
+            SkCanvas* canvas = recorder.beginRecording(1024, 1024);
+            for (int i = 0; i < kItems; i++) {
+                SkPaint paint;
+                paint.setColor(0xFF000000 | i * 0x10204);
+                SkPoint p = positions[i];
+                switch (i % 4) {
+                    case 0: canvas->drawRect(SkRect::MakeXYWH(p.x(), p.y(), 20, 10), paint);
+                            break;
+                    case 1: canvas->save();
+                            canvas->translate(p.x(), p.y());
+                            canvas->drawPath(path, paint);
+                            canvas->restore();
+                            break;
+                    case 2: canvas->drawTextBlob(blob, p.x(), p.y(), paint); break;
+                    case 3: canvas->drawImage(images[i / 4 % 4], p.x(), p.y()); break;
+                }
+            }
+            fPictures.push_back(recorder.finishRecordingAsPicture());
+        }
+
+        SkPictureDeltaEncoder encoder;
+        for (const auto& picture : fPictures) {
+            fDeltas.push_back(encoder.encode(picture.get()));
+            fSerialized.push_back(picture->serialize());
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int i = 0; i < loops; i++) {
+            // Each pass over the frames starts with a key frame.
+            SkPictureDeltaEncoder encoder;
+            SkPictureDeltaDecoder decoder;
+            for (int frame = 0; frame < kFrames; frame++) {
+                switch (fMode) {
+                    case Mode::kEncode:
+                        (void)encoder.encode(fPictures[frame].get());
+                        break;
+                    case Mode::kDecode:
+                        (void)decoder.decode(fDeltas[frame].get());
+                        break;
+                    case Mode::kSerialize:
+                        (void)fPictures[frame]->serialize();
+                        break;
+                    case Mode::kDeserialize:
+                        (void)SkPicture::MakeFromData(fSerialized[frame].get());
+                        break;
+                }
+            }
+        }
+    }
+
+    Mode                          fMode;
+    std::vector<sk_sp<SkPicture>> fPictures;
+    std::vector<sk_sp<SkData>>    fDeltas;
+    std::vector<sk_sp<SkData>>    fSerialized;
+};
+
+DEF_BENCH(return new PictureDeltaBench(PictureDeltaBench::Mode::kEncode);)
+DEF_BENCH(return new PictureDeltaBench(PictureDeltaBench::Mode::kDecode);)
+DEF_BENCH(return new PictureDeltaBench(PictureDeltaBench::Mode::kSerialize);)
+DEF_BENCH(return new PictureDeltaBench(PictureDeltaBench::Mode::kDeserialize);)
@@ -9,6 +9,12 @@
 #include "include/core/SkCanvas.h"
 #include "include/core/SkPictureRecorder.h"
 #include "include/core/SkRRect.h"
+#include "include/core/SkSurface.h"
+#include "include/utils/SkRandom.h"
+#include "src/core/SkRecord.h"
+#include "src/core/SkRecordDraw.h"
+#include "src/core/SkRecordOpts.h"
+#include "src/core/SkRecorder.h"
 
 class ClipOverheadRecordingBench : public Benchmark {
 public:
@@ -40,3 +46,95 @@ private:
     }
 };
 DEF_BENCH( return new ClipOverheadRecordingBench; )
+
+// Draws 200 translucent layers without bounds, each around a few small draws that don't touch,
+// as it was recorded, with the layers' bounds tightened, or with their alpha folded into the
+// draws.
+class LayerOverheadPlaybackBench : public Benchmark {
+public:
+    enum Opt { kNone, kTighten, kFold };
+
+    explicit LayerOverheadPlaybackBench(Opt opt) : fOpt(opt) {}
+
+private:
+    static constexpr int kLayers = 200;
+
+    const char* onGetName() override {
+        switch (fOpt) {
+            case kNone:    return "layer_overhead_playback";
+            case kTighten: return "layer_overhead_playback_tighten";
+            case kFold:    return "layer_overhead_playback_fold";
+        }
+        return nullptr;
+    }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+    void onDelayedSetup() override {
+        fSurface = SkSurface::MakeRasterN32Premul(1000, 1000);
+
+        SkRandom rand;
+        SkRecorder recorder(&fRecord, 1000, 1000);
+        SkPaint layerPaint, paint;
+        layerPaint.setAlpha(0x80);
+        paint.setAntiAlias(true);
+        for (int i = 0; i < kLayers; i++) {
+            const SkScalar x = rand.nextRangeF(0, 900),
+                           y = rand.nextRangeF(0, 900);
+            recorder.saveLayer(nullptr, &layerPaint);
+            for (int j = 0; j < 3; j++) {
+                paint.setColor(rand.nextU() | 0xFF000000);
+                recorder.drawOval(SkRect::MakeXYWH(x + 30 * j, y, 25, 25), paint);
+            }
+            recorder.restore();
+        }
+
+        switch (fOpt) {
+            case kNone:    break;
+            case kTighten: SkRecordTightenLayerBounds(&fRecord); break;
+            case kFold:    SkRecordFoldLayerAlpha(&fRecord); break;
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int i = 0; i < loops; i++) {
+            SkRecordDraw(fRecord, fSurface->getCanvas(), nullptr, nullptr, 0, nullptr, nullptr);
+        }
+    }
+
+    Opt              fOpt;
+    SkRecord         fRecord;
+    sk_sp<SkSurface> fSurface;
+};
+DEF_BENCH( return new LayerOverheadPlaybackBench(LayerOverheadPlaybackBench::kNone); )
+DEF_BENCH( return new LayerOverheadPlaybackBench(LayerOverheadPlaybackBench::kTighten); )
+DEF_BENCH( return new LayerOverheadPlaybackBench(LayerOverheadPlaybackBench::kFold); )
+
+// What recording those layers costs, now that pictures tighten their bounds when finished.
+class LayerOverheadRecordingBench : public Benchmark {
+public:
+    LayerOverheadRecordingBench() {}
+
+private:
+    const char* onGetName() override { return "layer_overhead_recording"; }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkPictureRecorder rec;
+
+        for (int i = 0; i < loops; i++) {
+            SkCanvas* canvas = rec.beginRecording({0,0, 2000,3000});
+
+            SkPaint layerPaint, paint;
+            layerPaint.setAlpha(0x80);
+            for (int i = 0; i < 1000; i++) {
+                canvas->saveLayer(nullptr, &layerPaint);
+                    canvas->drawRect({10,10, 100, 100}, paint);
+                    canvas->drawRect({110,10, 200, 100}, paint);
+                canvas->restore();
+            }
+
+            (void)rec.finishRecordingAsPicture();
+        }
+    }
+};
+DEF_BENCH( return new LayerOverheadRecordingBench; )
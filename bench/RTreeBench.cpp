@@ -9,6 +9,7 @@
 #include "include/core/SkCanvas.h"
 #include "include/core/SkString.h"
 #include "include/utils/SkRandom.h"
+#include "src/core/SkDynamicBBH.h"
 #include "src/core/SkRTree.h"
 
 // confine rectangles to a smallish area, so queries generally hit something, and overlap occurs:
@@ -17,13 +18,21 @@ static const int NUM_BUILD_RECTS = 500;
 static const int NUM_QUERY_RECTS = 5000;
 static const int GRID_WIDTH = 100;
 
+static const int TILE_SIZE = 128;
+
 typedef SkRect (*MakeRectProc)(SkRandom&, int, int);
 
+static const char* packing_suffix(SkRTree::Packing packing) {
+    return packing == SkRTree::Packing::kSortTileRecursive ? "_str" : "";
+}
+
 // Time how long it takes to build an R-Tree.
 class RTreeBuildBench : public Benchmark {
 public:
-    RTreeBuildBench(const char* name, MakeRectProc proc) : fProc(proc) {
-        fName.printf("rtree_%s_build", name);
+    RTreeBuildBench(const char* name, MakeRectProc proc,
+                    SkRTree::Packing packing = SkRTree::Packing::kInsertionOrder)
+            : fProc(proc), fPacking(packing) {
+        fName.printf("rtree_%s%s_build", name, packing_suffix(packing));
     }
 
     bool isSuitableFor(Backend backend) override {
@@ -42,13 +51,14 @@ protected:
         }
 
         for (int i = 0; i < loops; ++i) {
-            SkRTree tree;
+            SkRTree tree(fPacking);
             tree.insert(rects.get(), NUM_BUILD_RECTS);
             SkASSERT(rects != nullptr);  // It'd break this bench if the tree took ownership of rects.
         }
     }
 private:
     MakeRectProc fProc;
+    SkRTree::Packing fPacking;
     SkString fName;
     typedef Benchmark INHERITED;
 };
@@ -56,8 +66,10 @@ private:
 // Time how long it takes to perform queries on an R-Tree.
 class RTreeQueryBench : public Benchmark {
 public:
-    RTreeQueryBench(const char* name, MakeRectProc proc) : fProc(proc) {
-        fName.printf("rtree_%s_query", name);
+    RTreeQueryBench(const char* name, MakeRectProc proc,
+                    SkRTree::Packing packing = SkRTree::Packing::kInsertionOrder)
+            : fTree(packing), fProc(proc) {
+        fName.printf("rtree_%s%s_query", name, packing_suffix(packing));
     }
 
     bool isSuitableFor(Backend backend) override {
@@ -95,6 +107,50 @@ private:
     typedef Benchmark INHERITED;
 };
 
+// Time how long it takes to find the rects in each tile of a grid covering them, like tiled
+// playback of a picture does.
+class RTreeTileQueryBench : public Benchmark {
+public:
+    RTreeTileQueryBench(const char* name, MakeRectProc proc,
+                        SkRTree::Packing packing = SkRTree::Packing::kInsertionOrder)
+            : fTree(packing), fProc(proc) {
+        fName.printf("rtree_%s%s_tiles", name, packing_suffix(packing));
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+protected:
+    const char* onGetName() override {
+        return fName.c_str();
+    }
+    void onDelayedSetup() override {
+        SkRandom rand;
+        SkAutoTMalloc<SkRect> rects(NUM_QUERY_RECTS);
+        for (int i = 0; i < NUM_QUERY_RECTS; ++i) {
+            rects[i] = fProc(rand, i, NUM_QUERY_RECTS);
+        }
+        fTree.insert(rects.get(), NUM_QUERY_RECTS);
+    }
+
+    void onDraw(int loops, SkCanvas* canvas) override {
+        std::vector<int> hits;
+        for (int i = 0; i < loops; ++i) {
+            for (int y = 0; y < GENERATE_EXTENTS; y += TILE_SIZE) {
+                for (int x = 0; x < GENERATE_EXTENTS; x += TILE_SIZE) {
+                    hits.clear();
+                    fTree.search(SkRect::MakeXYWH(x, y, TILE_SIZE, TILE_SIZE), &hits);
+                }
+            }
+        }
+    }
+private:
+    SkRTree fTree;
+    MakeRectProc fProc;
+    SkString fName;
+    typedef Benchmark INHERITED;
+};
+
 static inline SkRect make_XYordered_rects(SkRandom& rand, int index, int numRects) {
     SkRect out;
     out.fLeft   = SkIntToScalar(index % GRID_WIDTH);
@@ -112,6 +168,13 @@ static inline SkRect make_YXordered_rects(SkRandom& rand, int index, int numRect
     return out;
 }
 
+// The XY ordered rects, but in a random order, as a picture recorded from a scene graph may
+// give them.
+static inline SkRect make_shuffled_rects(SkRandom& rand, int index, int numRects) {
+    // 7919 is a prime, so this visits each index once.
+    return make_XYordered_rects(rand, (int)(index * 7919LL % numRects), numRects);
+}
+
 static inline SkRect make_random_rects(SkRandom& rand, int index, int numRects) {
     SkRect out;
     out.fLeft   = rand.nextRangeF(0, GENERATE_EXTENTS);
@@ -136,3 +199,86 @@ DEF_BENCH(return new RTreeQueryBench("XY", &make_XYordered_rects));
 DEF_BENCH(return new RTreeQueryBench("YX", &make_YXordered_rects));
 DEF_BENCH(return new RTreeQueryBench("random", &make_random_rects));
 DEF_BENCH(return new RTreeQueryBench("concentric", &make_concentric_rects));
+
+static constexpr SkRTree::Packing kSTR = SkRTree::Packing::kSortTileRecursive;
+
+DEF_BENCH(return new RTreeBuildBench("XY", &make_XYordered_rects, kSTR));
+DEF_BENCH(return new RTreeBuildBench("shuffled", &make_shuffled_rects));
+DEF_BENCH(return new RTreeBuildBench("shuffled", &make_shuffled_rects, kSTR));
+DEF_BENCH(return new RTreeBuildBench("random", &make_random_rects, kSTR));
+
+DEF_BENCH(return new RTreeQueryBench("XY", &make_XYordered_rects, kSTR));
+DEF_BENCH(return new RTreeQueryBench("shuffled", &make_shuffled_rects));
+DEF_BENCH(return new RTreeQueryBench("shuffled", &make_shuffled_rects, kSTR));
+DEF_BENCH(return new RTreeQueryBench("random", &make_random_rects, kSTR));
+
+DEF_BENCH(return new RTreeTileQueryBench("XY", &make_XYordered_rects));
+DEF_BENCH(return new RTreeTileQueryBench("XY", &make_XYordered_rects, kSTR));
+DEF_BENCH(return new RTreeTileQueryBench("shuffled", &make_shuffled_rects));
+DEF_BENCH(return new RTreeTileQueryBench("shuffled", &make_shuffled_rects, kSTR));
+DEF_BENCH(return new RTreeTileQueryBench("random", &make_random_rects));
+DEF_BENCH(return new RTreeTileQueryBench("random", &make_random_rects, kSTR));
+
+// Time a frame of a retained scene of 100k boxes, in which 1% of them move: either the moved
+// boxes are updated in an SkDynamicBBH, or an SkRTree is rebuilt from all of them. Each frame
+// then finds the boxes in one tile, as drawing a damaged area would.
+class BBHUpdateBench : public Benchmark {
+public:
+    explicit BBHUpdateBench(bool dynamic) : fDynamic(dynamic) {
+        fName.printf("bbh_update_1pct_of_100k_%s", dynamic ? "dynamic" : "rtree_rebuild");
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+protected:
+    static constexpr int kCount = 100000;
+    static constexpr SkScalar kExtent = 10000;
+
+    const char* onGetName() override {
+        return fName.c_str();
+    }
+    void onDelayedSetup() override {
+        SkRandom rand;
+        fRects.resize(kCount);
+        for (SkRect& rect : fRects) {
+            rect = SkRect::MakeXYWH(rand.nextRangeF(0, kExtent), rand.nextRangeF(0, kExtent),
+                                    1 + rand.nextRangeF(0, 50), 1 + rand.nextRangeF(0, 50));
+        }
+        fBBH.insert(fRects.data(), kCount);
+    }
+
+    void onDraw(int loops, SkCanvas* canvas) override {
+        std::vector<int> hits;
+        for (int i = 0; i < loops; ++i) {
+            for (int j = 0; j < kCount / 100; j++) {
+                int index = fRand.nextULessThan(kCount);
+                fRects[index].offset(fRand.nextRangeF(-10, 10), fRand.nextRangeF(-10, 10));
+                if (fDynamic) {
+                    fBBH.update(index, fRects[index]);
+                }
+            }
+            hits.clear();
+            SkRect tile = SkRect::MakeXYWH(fRand.nextRangeF(0, kExtent - TILE_SIZE),
+                                           fRand.nextRangeF(0, kExtent - TILE_SIZE),
+                                           TILE_SIZE, TILE_SIZE);
+            if (fDynamic) {
+                fBBH.search(tile, &hits);
+            } else {
+                SkRTree tree;
+                tree.insert(fRects.data(), kCount);
+                tree.search(tile, &hits);
+            }
+        }
+    }
+private:
+    bool fDynamic;
+    SkString fName;
+    SkRandom fRand;
+    std::vector<SkRect> fRects;
+    SkDynamicBBH fBBH;
+    typedef Benchmark INHERITED;
+};
+
+DEF_BENCH(return new BBHUpdateBench(true));
+DEF_BENCH(return new BBHUpdateBench(false));
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "bench/Benchmark.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkSurface.h"
+#include "include/utils/SkRandom.h"
+
+// Renders frames of 500 antialiased paths each, with some work on the app's side between them,
+// into a raster surface that either draws right away, or defers its drawing to a worker thread
+// so it overlaps with the app's work.
+class RasterDeferredBench : public Benchmark {
+public:
+    explicit RasterDeferredBench(bool deferred) : fDeferred(deferred) {}
+
+private:
+    static constexpr int kFrames = 10;
+    static constexpr int kPaths = 500;
+
+    const char* onGetName() override {
+        return fDeferred ? "raster_deferred_frames" : "raster_deferred_baseline_frames";
+    }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+
+    void onDelayedSetup() override {
+        const SkImageInfo info = SkImageInfo::MakeN32Premul(512, 512);
+        fSurface = fDeferred ? SkSurface::MakeRasterDeferred(info) : SkSurface::MakeRaster(info);
+        fPath.addCircle(0, 0, 24);
+        fPath.addRect(SkRect::MakeXYWH(-10, -30, 20, 60));
+    }
+
+    // Stands in for the app's work on a frame, such as layout.
+    static float app_work(SkRandom* rand) {
+        float sum = 0;
+        for (int i = 0; i < 1000000; i++) {
+            sum += rand->nextF() * rand->nextF();
+        }
+        return sum;
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkRandom rand;
+        SkCanvas* canvas = fSurface->getCanvas();
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        for (int i = 0; i < loops; i++) {
+            for (int frame = 0; frame < kFrames; frame++) {
+                fSum += app_work(&rand);
+                canvas->clear(SK_ColorWHITE);
+                for (int p = 0; p < kPaths; p++) {
+                    paint.setColor(rand.nextU() | 0xFF000000);
+                    canvas->save();
+                    canvas->translate(rand.nextRangeF(0, 512), rand.nextRangeF(0, 512));
+                    canvas->drawPath(fPath, paint);
+                    canvas->restore();
+                }
+                fSurface->flush();
+            }
+            // Wait for the last frame.
+            SkPixmap pixmap;
+            fSurface->peekPixels(&pixmap);
+        }
+    }
+
+    bool             fDeferred;
+    sk_sp<SkSurface> fSurface;
+    SkPath           fPath;
+    float            fSum = 0;
+};
+
+DEF_BENCH(return new RasterDeferredBench(true);)
+DEF_BENCH(return new RasterDeferredBench(false);)
@@ -71,3 +71,37 @@ void DeserializePictureBench::onDraw(int loops, SkCanvas*) {
         SkPicture::MakeFromData(fEncodedPicture.get());
     }
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#include "include/core/SkStream.h"
+
+LoadPictureBench::LoadPictureBench(const char* name, const char* path, bool mapped)
+    : fName(SkStringPrintf("%s_%s", name, mapped ? "mapped" : "stream"))
+    , fPath(path)
+    , fMapped(mapped)
+{}
+
+const char* LoadPictureBench::onGetName() {
+    return fName.c_str();
+}
+
+bool LoadPictureBench::isSuitableFor(Backend backend) {
+    return backend == kNonRendering_Backend;
+}
+
+SkIPoint LoadPictureBench::onGetSize() {
+    return SkIPoint::Make(128, 128);
+}
+
+void LoadPictureBench::onDraw(int loops, SkCanvas*) {
+    for (int i = 0; i < loops; ++i) {
+        fPicture = nullptr;
+        if (fMapped) {
+            sk_sp<SkData> data = SkData::MakeFromFileName(fPath.c_str());
+            fPicture = SkPicture::MakeFromSharedData(std::move(data));
+        } else {
+            SkFILEStream stream(fPath.c_str());
+            fPicture = SkPicture::MakeFromStream(&stream);
+        }
+    }
+}
@@ -57,4 +57,25 @@ private:
     typedef Benchmark INHERITED;
 };
 
+// Loads a picture from a file, either by mapping it and sharing the mapped data, or by reading
+// it through a stream. The last picture loaded is kept, so nanobench's current RSS reflects it.
+class LoadPictureBench : public Benchmark {
+public:
+    LoadPictureBench(const char* name, const char* path, bool mapped);
+
+protected:
+    const char* onGetName() override;
+    bool isSuitableFor(Backend) override;
+    SkIPoint onGetSize() override;
+    void onDraw(int loops, SkCanvas*) override;
+
+private:
+    SkString         fName;
+    SkString         fPath;
+    bool             fMapped;
+    sk_sp<SkPicture> fPicture;
+
+    typedef Benchmark INHERITED;
+};
+
 #endif//RecordingBench_DEFINED
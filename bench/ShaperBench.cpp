@@ -9,6 +9,7 @@
 #include "tools/Resources.h"
 
 #include <cfloat>
+#include <cstring>
 
 namespace {
 struct ShaperBench : public Benchmark {
@@ -35,8 +36,45 @@ struct ShaperBench : public Benchmark {
         }
     }
 };
+
+// Shapes the same few short strings again and again, like the labels and numbers of a UI.
+struct ShaperLabelsBench : public Benchmark {
+    ShaperLabelsBench(bool cached) : fCached(cached) {}
+    const bool fCached;
+    std::unique_ptr<SkShaper> fShaper;
+    const char* onGetName() override {
+        return fCached ? "shaper_labels_cached" : "shaper_labels";
+    }
+    bool isSuitableFor(Backend backend) override { return backend == kNonRendering_Backend; }
+    void onDelayedSetup() override {
+        fShaper = SkShaper::Make();
+        if (fCached) {
+            fShaper = SkShaper::MakeCaching(std::move(fShaper), SkShaperCache::Make());
+        }
+    }
+    void onDraw(int loops, SkCanvas*) override {
+        if (!fShaper) { return; }
+        static const char* kLabels[] = {
+            "OK", "Cancel", "Apply", "File", "Edit", "View", "Help", "Open...", "Save As...",
+            "Close Window", "Preferences", "0", "1", "42", "100%", "3.14159", "12:30 PM",
+        };
+        SkFont font;
+        while (loops-- > 0) {
+            for (int i = 0; i < 10; i++) {
+                for (const char* label : kLabels) {
+                    SkTextBlobBuilderRunHandler rh(label, {0, 0});
+                    fShaper->shape(label, strlen(label), font, true, FLT_MAX, &rh);
+                    (void)rh.makeBlob();
+                }
+            }
+        }
+    }
+};
 }  // namespace
 
+DEF_BENCH(return new ShaperLabelsBench(false);)
+DEF_BENCH(return new ShaperLabelsBench(true);)
+
 #define SHAPER_BENCH(X) DEF_BENCH(return new ShaperBench("text/" #X ".txt", "shaper_" #X);)
 SHAPER_BENCH(arabic)
 SHAPER_BENCH(armenian)
@@ -9,8 +9,12 @@
 
 #include "bench/Benchmark.h"
 #include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkFontMgr.h"
 #include "include/core/SkGraphics.h"
+#include "include/core/SkSurface.h"
 #include "include/core/SkTypeface.h"
+#include "src/core/SkPersistentStrikeCache.h"
 #include "src/core/SkRemoteGlyphCache.h"
 #include "src/core/SkStrikeCache.h"
 #include "src/core/SkStrikeSpec.h"
@@ -112,10 +116,330 @@ private:
     SkString fName;
 };
 
+// Every loop starts with an empty glyph cache, so each thread has to rasterize its glyphs with
+// the scaler context (here FreeType, or whatever backs the default font manager). Threads use
+// different typefaces and sizes, so they should not have to wait for each other.
+class SkGlyphCacheColdMultiThreaded : public Benchmark {
+public:
+    SkGlyphCacheColdMultiThreaded() {}
+
+protected:
+    const char* onGetName() override { return "SkGlyphCacheColdMultiThreaded"; }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        fTypefaces[0] = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+        fTypefaces[1] = MakeResourceAsTypeface("fonts/Roboto2-Regular_NoEmbed.ttf");
+        fTypefaces[2] = MakeResourceAsTypeface("fonts/Distortable.ttf");
+        for (sk_sp<SkTypeface>& typeface : fTypefaces) {
+            if (!typeface) {
+                typeface = ToolUtils::create_portable_typeface();
+            }
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int work = 0; work < loops; work++) {
+            SkGraphics::PurgeFontCache();
+            SkTaskGroup().batch(16, [&](int threadIndex) {
+                SkFont font;
+                font.setEdging(SkFont::Edging::kAntiAlias);
+                font.setTypeface(fTypefaces[threadIndex % SK_ARRAY_COUNT(fTypefaces)]);
+                font.setSize(10 + threadIndex);
+
+                SkPaint defaultPaint;
+                auto strikeSpec = SkStrikeSpec::MakeMask(
+                        font, defaultPaint, SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                        SkScalerContextFlags::kNone, SkMatrix::I());
+                SkPackedGlyphID glyphs['z'];
+                for (int c = ' '; c < 'z'; c++) {
+                    glyphs[c] = SkPackedGlyphID{font.unicharToGlyph(c)};
+                }
+                constexpr size_t glyphCount = 'z' - ' ';
+                SkSpan<const SkPackedGlyphID> glyphIDs{&glyphs[SkTo<int>(' ')], glyphCount};
+                SkBulkGlyphMetricsAndImages images{strikeSpec};
+                (void)images.glyphs(glyphIDs);
+            });
+        }
+    }
+
+private:
+    sk_sp<SkTypeface> fTypefaces[3];
+
+    typedef Benchmark INHERITED;
+};
+
+// Every strike is already in the cache, so this measures how well threads can find strikes at
+// the same time. Run with increasing thread counts to see how lookups scale.
+class SkGlyphCacheWarmMultiThreaded : public Benchmark {
+public:
+    explicit SkGlyphCacheWarmMultiThreaded(int threads) : fThreads(threads) {
+        fName.printf("SkGlyphCacheWarmMultiThreaded_%d", threads);
+    }
+
+protected:
+    const char* onGetName() override { return fName.c_str(); }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        fExecutor = SkExecutor::MakeFIFOThreadPool(fThreads);
+        sk_sp<SkTypeface> typefaces[] = {
+                ToolUtils::create_portable_typeface("serif", SkFontStyle()),
+                ToolUtils::create_portable_typeface("sans-serif", SkFontStyle()),
+                ToolUtils::create_portable_typeface("monospace", SkFontStyle())};
+        for (const sk_sp<SkTypeface>& typeface : typefaces) {
+            for (int size = 8; size < 40; size++) {
+                SkFont font(typeface, size);
+                font.setEdging(SkFont::Edging::kAntiAlias);
+                fStrikeSpecs.push_back(SkStrikeSpec::MakeMask(
+                        font, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                        SkScalerContextFlags::kNone, SkMatrix::I()));
+            }
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        const int strikeCount = SkToInt(fStrikeSpecs.size());
+        for (const SkStrikeSpec& strikeSpec : fStrikeSpecs) {
+            (void)strikeSpec.findOrCreateExclusiveStrike();
+        }
+        for (int work = 0; work < loops; work++) {
+            SkTaskGroup(*fExecutor).batch(fThreads, [&](int threadIndex) {
+                for (int i = 0; i < kLookupsPerThread; i++) {
+                    const SkStrikeSpec& strikeSpec =
+                            fStrikeSpecs[(threadIndex * 7 + i) % strikeCount];
+                    (void)strikeSpec.findOrCreateExclusiveStrike();
+                }
+            });
+        }
+    }
+
+private:
+    static constexpr int kLookupsPerThread = 1000;
+
+    const int fThreads;
+    SkString fName;
+    std::unique_ptr<SkExecutor> fExecutor;
+    std::vector<SkStrikeSpec> fStrikeSpecs;
+
+    typedef Benchmark INHERITED;
+};
+
+// Draws a first frame of text with an empty glyph cache, as a new process would. With a
+// persistent cache, the strikes start with the glyphs saved from an earlier frame instead of
+// asking the scaler context for them.
+class SkGlyphCacheFirstFrame : public Benchmark {
+public:
+    explicit SkGlyphCacheFirstFrame(bool usePersistentCache)
+            : fUsePersistentCache(usePersistentCache) {}
+
+protected:
+    const char* onGetName() override {
+        return fUsePersistentCache ? "SkGlyphCacheFirstFrame_persistent"
+                                   : "SkGlyphCacheFirstFrame";
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        fSurface = SkSurface::MakeRasterN32Premul(640, 480);
+        fTypeface = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+        if (!fTypeface) {
+            fTypeface = ToolUtils::create_portable_typeface();
+        }
+        if (fUsePersistentCache) {
+            SkGraphics::PurgeFontCache();
+            this->drawFrame();
+            fPersistentCache = SkPersistentStrikeCache::Make(
+                    SkPersistentStrikeCache::Serialize(SkStrikeCache::GlobalStrikeCache()));
+        }
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkStrikeCache* cache = SkStrikeCache::GlobalStrikeCache();
+        for (int work = 0; work < loops; work++) {
+            SkGraphics::PurgeFontCache();
+            cache->setPersistentCache(fPersistentCache);
+            this->drawFrame();
+        }
+        cache->setPersistentCache(nullptr);
+    }
+
+private:
+    void drawFrame() {
+        static constexpr char kText[] = "The quick brown fox jumps over the lazy dog. 0123456789";
+        SkCanvas* canvas = fSurface->getCanvas();
+        SkPaint paint;
+        SkFont font(fTypeface);
+        font.setEdging(SkFont::Edging::kAntiAlias);
+        SkScalar y = 0;
+        for (SkScalar size : {10, 12, 14, 16, 20, 24, 32, 48}) {
+            font.setSize(size);
+            y += size * 1.2f;
+            canvas->drawSimpleText(kText, sizeof(kText) - 1, SkTextEncoding::kUTF8, 10, y,
+                                   font, paint);
+        }
+    }
+
+    const bool fUsePersistentCache;
+    sk_sp<SkSurface> fSurface;
+    sk_sp<SkTypeface> fTypeface;
+    sk_sp<SkPersistentStrikeCache> fPersistentCache;
+
+    typedef Benchmark INHERITED;
+};
+
+// Prepares the images for a paragraph of new CJK text at a new size, so every glyph is measured
+// and rasterized. With an executor, the strike does that on several threads. Without a CJK
+// font, this falls back to the glyphs of Roboto.
+class SkGlyphCacheColdCJKParagraph : public Benchmark {
+public:
+    explicit SkGlyphCacheColdCJKParagraph(int threads) : fThreads(threads) {
+        fName.printf("SkGlyphCacheColdCJKParagraph_%d", threads);
+    }
+
+protected:
+    const char* onGetName() override { return fName.c_str(); }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        if (fThreads > 1) {
+            fExecutor = SkExecutor::MakeFIFOThreadPool(fThreads);
+        }
+        const char* bcp47[] = {"zh-Hans"};
+        sk_sp<SkTypeface> typeface(SkFontMgr::RefDefault()->matchFamilyStyleCharacter(
+                nullptr, SkFontStyle(), bcp47, SK_ARRAY_COUNT(bcp47), 0x4E2D));
+        if (!typeface) {
+            typeface = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+        }
+        if (!typeface) {
+            typeface = ToolUtils::create_portable_typeface();
+        }
+        SkFont font(typeface, 21);
+        font.setEdging(SkFont::Edging::kAntiAlias);
+        fStrikeSpec = SkStrikeSpec::MakeMask(
+                font, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                SkScalerContextFlags::kNone, SkMatrix::I());
+
+        // A paragraph of CJK text has few repeated glyphs, so just take the first ones.
+        int glyphCount = std::min(typeface->countGlyphs() - 1, kParagraphGlyphs);
+        for (int i = 0; i < glyphCount; i++) {
+            fGlyphIDs.push_back(SkPackedGlyphID{SkTo<SkGlyphID>(i + 1)});
+        }
+        fGlyphs.resize(fGlyphIDs.size());
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        for (int work = 0; work < loops; work++) {
+            SkStrikeCache cache;
+            cache.setRasterExecutor(fExecutor.get());
+            SkExclusiveStrikePtr strike = fStrikeSpec.findOrCreateExclusiveStrike(&cache);
+            strike->prepareImages(SkMakeSpan(fGlyphIDs), fGlyphs.data());
+        }
+    }
+
+private:
+    static constexpr int kParagraphGlyphs = 300;
+
+    const int fThreads;
+    SkString fName;
+    std::unique_ptr<SkExecutor> fExecutor;
+    SkStrikeSpec fStrikeSpec;
+    std::vector<SkPackedGlyphID> fGlyphIDs;
+    std::vector<const SkGlyph*> fGlyphs;
+
+    typedef Benchmark INHERITED;
+};
+
+// Zooms a paragraph of unhinted text, so every frame asks for glyphs at a size no strike has
+// seen. Either only gets the glyph paths at that size, or draws the text stroked, which makes
+// its masks from the paths.
+class SkGlyphCacheZoom : public Benchmark {
+public:
+    explicit SkGlyphCacheZoom(bool stroke) : fStroke(stroke) {}
+
+protected:
+    const char* onGetName() override {
+        return fStroke ? "SkGlyphCacheZoom_stroke" : "SkGlyphCacheZoom_paths";
+    }
+
+    bool isSuitableFor(Backend backend) override {
+        return backend == kNonRendering_Backend;
+    }
+
+    void onDelayedSetup() override {
+        fSurface = SkSurface::MakeRasterN32Premul(640, 480);
+        fFont.setTypeface(MakeResourceAsTypeface("fonts/Roboto-Regular.ttf"));
+        if (!fFont.getTypeface()) {
+            fFont.setTypeface(ToolUtils::create_portable_typeface());
+        }
+        fFont.setHinting(SkFontHinting::kNone);
+        fFont.setEdging(SkFont::Edging::kAntiAlias);
+        fFont.setSubpixel(true);
+        static constexpr char kText[] = "Sphinx of black quartz, judge my vow. "
+                                        "Pack my box with five dozen liquor jugs!";
+        fGlyphs.resize(fFont.countText(kText, sizeof(kText) - 1, SkTextEncoding::kUTF8));
+        fFont.textToGlyphs(kText, sizeof(kText) - 1, SkTextEncoding::kUTF8,
+                           fGlyphs.data(), SkToInt(fGlyphs.size()));
+    }
+
+    void onDraw(int loops, SkCanvas*) override {
+        SkPaint paint;
+        paint.setStyle(SkPaint::kStroke_Style);
+        paint.setStrokeWidth(1);
+        for (int work = 0; work < loops; work++) {
+            SkGraphics::PurgeFontCache();
+            fFont.setSize(12 + (fFrame++ % 720) * 0.05f);
+            if (fStroke) {
+                SkCanvas* canvas = fSurface->getCanvas();
+                canvas->drawSimpleText(fGlyphs.data(), fGlyphs.size() * sizeof(SkGlyphID),
+                                       SkTextEncoding::kGlyphID, 10, 60, fFont, paint);
+            } else {
+                SkStrikeSpec strikeSpec = SkStrikeSpec::MakeMask(
+                        fFont, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                        SkScalerContextFlags::kNone, SkMatrix::I());
+                SkBulkGlyphMetricsAndPaths paths{strikeSpec};
+                (void)paths.glyphs(SkMakeSpan(fGlyphs));
+            }
+        }
+    }
+
+private:
+    const bool fStroke;
+    int fFrame = 0;
+    SkFont fFont;
+    sk_sp<SkSurface> fSurface;
+    std::vector<SkGlyphID> fGlyphs;
+
+    typedef Benchmark INHERITED;
+};
+
 DEF_BENCH( return new SkGlyphCacheBasic(256 * 1024); )
 DEF_BENCH( return new SkGlyphCacheBasic(32 * 1024 * 1024); )
 DEF_BENCH( return new SkGlyphCacheStressTest(256 * 1024); )
 DEF_BENCH( return new SkGlyphCacheStressTest(32 * 1024 * 1024); )
+DEF_BENCH( return new SkGlyphCacheColdMultiThreaded(); )
+DEF_BENCH( return new SkGlyphCacheWarmMultiThreaded(1); )
+DEF_BENCH( return new SkGlyphCacheWarmMultiThreaded(2); )
+DEF_BENCH( return new SkGlyphCacheWarmMultiThreaded(4); )
+DEF_BENCH( return new SkGlyphCacheWarmMultiThreaded(8); )
+DEF_BENCH( return new SkGlyphCacheFirstFrame(false); )
+DEF_BENCH( return new SkGlyphCacheFirstFrame(true); )
+DEF_BENCH( return new SkGlyphCacheColdCJKParagraph(1); )
+DEF_BENCH( return new SkGlyphCacheColdCJKParagraph(4); )
+DEF_BENCH( return new SkGlyphCacheZoom(false); )
+DEF_BENCH( return new SkGlyphCacheZoom(true); )
 
 namespace {
 class DiscardableManager : public SkStrikeServer::DiscardableHandleManager,
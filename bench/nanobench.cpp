@@ -34,6 +34,7 @@
 #include "src/core/SkColorSpacePriv.h"
 #include "src/core/SkLeanWindows.h"
 #include "src/core/SkOSFile.h"
+#include "src/core/SkPictureProfile.h"
 #include "src/core/SkTaskGroup.h"
 #include "src/core/SkTraceEvent.h"
 #include "src/utils/SkJSONWriter.h"
@@ -117,6 +118,9 @@ static DEFINE_string(zoom, "1.0,0",
 static DEFINE_bool(bbh, true, "Build a BBH for SKPs?");
 static DEFINE_bool(mpd, true, "Use MultiPictureDraw for the SKPs?");
 static DEFINE_bool(loopSKP, true, "Loop SKPs like we do for micro benches?");
+static DEFINE_int(profileSKPs, 0,
+                  "If >0, also play each SKP back op by op on a raster canvas at each scale, "
+                  "and print the N kinds of ops that cost the most time.");
 static DEFINE_int(flushEvery, 10, "Flush --outResultsFile every Nth run.");
 static DEFINE_bool(gpuStats, false, "Print GPU stats after each gpu benchmark?");
 static DEFINE_bool(gpuStatsDump, false, "Dump GPU states after each benchmark to json");
@@ -607,6 +611,25 @@ static bool valid_brd_bench(sk_sp<SkData> encoded, SkColorType colorType, uint32
     return true;
 }
 
+// Plays the picture back as the playback benches see it, once to warm up caches and then once op
+// by op, and prints the ops that cost the most.
+static void profile_skp(const char* name, const SkPicture* pic, const SkIRect& clip,
+                        SkScalar scale) {
+    sk_sp<SkSurface> surface = SkSurface::MakeRasterN32Premul(clip.width(), clip.height());
+    if (!surface) {
+        return;
+    }
+    SkCanvas* canvas = surface->getCanvas();
+    canvas->translate(-clip.fLeft, -clip.fTop);
+    canvas->scale(scale, scale);
+    pic->playback(canvas);
+
+    SkPictureProfile profile;
+    profile.playback(pic, canvas);
+    SkDebugf("%s at scale %g, %d ops:\n%s", name, scale, pic->approximateOpCount(),
+             profile.report(FLAGS_profileSKPs).c_str());
+}
+
 static void cleanup_run(Target* target) {
     delete target;
 }
@@ -793,6 +816,18 @@ public:
             return new DeserializePictureBench(name.c_str(), std::move(data));
         }
 
+        // Add all .skps as LoadPictureBenches, once mapped and once read through a stream.
+        while (fCurrentLoadPicture < 2 * fSKPs.count()) {
+            const SkString& path = fSKPs[fCurrentLoadPicture / 2];
+            bool mapped = fCurrentLoadPicture++ % 2 == 0;
+            SkString name = SkOSPath::Basename(path.c_str());
+            fSourceType = "skp";
+            fBenchType  = "load";
+            fSKPBytes = 0;
+            fSKPOps   = 0;
+            return new LoadPictureBench(name.c_str(), path.c_str(), mapped);
+        }
+
         // Then once each for each scale as SKPBenches (playback).
         while (fCurrentScale < fScales.count()) {
             while (fCurrentSKP < fSKPs.count()) {
@@ -815,6 +850,9 @@ public:
                         pic = recorder.finishRecordingAsPicture();
                     }
                     SkString name = SkOSPath::Basename(path.c_str());
+                    if (FLAGS_profileSKPs > 0 && fCurrentUseMPD == 0) {
+                        profile_skp(name.c_str(), pic.get(), fClip, fScales[fCurrentScale]);
+                    }
                     fSourceType = "skp";
                     fBenchType = "playback";
                     return new SKPBench(name.c_str(), pic.get(), fClip, fScales[fCurrentScale],
@@ -1109,6 +1147,7 @@ private:
     const char* fBenchType;   // How we bench it: micro, recording, playback, ...
     int fCurrentRecording = 0;
     int fCurrentDeserialPicture = 0;
+    int fCurrentLoadPicture = 0;
     int fCurrentScale = 0;
     int fCurrentSKP = 0;
     int fCurrentSVG = 0;
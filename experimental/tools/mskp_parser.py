@@ -30,7 +30,7 @@ if magic != magic_constant:
 version, page_count = struct.unpack('II', src.read(8))[:2]
 print('MSKP version: ', version)
 print('page count: ', page_count)
-if version > 2 or version < 1:
+if version > 3 or version < 1:
   #TODO(halcanary): Remove support for version 1.
   sys.stderr.write('unsupported mskp version\n')
   exit(3)
@@ -41,10 +41,31 @@ for page in range(page_count):
     offset, size_x, size_y =struct.unpack('Qff', src.read(16))
     print('offset = %-7d\t' % offset, end='')
     offsets.append(offset)
-  elif version == 2:
+  else:
     size_x, size_y =struct.unpack('ff', src.read(8))
   print('size = (%r,%r)' % (size_x, size_y))
 
+if version == 3:
+  # Version 3 indexes the typefaces and images the pages share, then the pages, each a
+  # flattened picture that refers to those by index.
+  typeface_count, image_count = struct.unpack('II', src.read(8))
+  print('typeface count: ', typeface_count)
+  print('image count: ', image_count)
+  serializers = struct.unpack('%dI' % typeface_count, src.read(4 * typeface_count))
+  for typeface, serializer in enumerate(serializers):
+    print('typeface %3d\twritten by %s' %
+          (typeface, 'SkSerialProcs' if serializer == 1 else 'SkTypeface::serialize()'))
+  kinds = (['typeface'] * typeface_count + ['image'] * image_count +
+           ['page'] * page_count)
+  counts = {}
+  for kind in kinds:
+    offset, size = struct.unpack('QQ', src.read(16))
+    print('%-8s %3d\toffset = %-7d\tsize = %d' % (kind, counts.get(kind, 0), offset, size))
+    counts[kind] = counts.get(kind, 0) + 1
+  if len(sys.argv) >= 3:
+    sys.stderr.write('mskp version 3 has no single skp to extract\n')
+    exit(4)
+
 if len(sys.argv) >= 3:
   with open(sys.argv[2], 'wb') as o:
     if version == 2 or len(offsets) < 2:
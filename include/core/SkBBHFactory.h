@@ -45,7 +45,27 @@ public:
 
 class SK_API SkRTreeFactory : public SkBBHFactory {
 public:
+    /** How the R-tree groups the bounding boxes into nodes. */
+    enum class Packing {
+        /**
+         *  In the order they are inserted. This is the fastest to build, and searches well when
+         *  nearby boxes are inserted together, as they are when recording web pages.
+         */
+        kInsertionOrder,
+        /**
+         *  Sorted into tiles first (Sort-Tile-Recursive). This is slower to build, but searches
+         *  much faster when the boxes are inserted in no particular order.
+         */
+        kSortTileRecursive,
+    };
+
+    SkRTreeFactory() = default;
+    explicit SkRTreeFactory(Packing packing) : fPacking(packing) {}
+
     sk_sp<SkBBoxHierarchy> operator()() const override;
+
+private:
+    Packing fPacking = Packing::kInsertionOrder;
 };
 
 #endif
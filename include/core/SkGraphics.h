@@ -11,6 +11,7 @@
 #include "include/core/SkRefCnt.h"
 
 class SkData;
+class SkExecutor;
 class SkImageGenerator;
 class SkTraceMemoryDump;
 
@@ -97,6 +98,29 @@ public:
      */
     static void PurgeFontCache();
 
+    /**
+     *  Memory map a file written by WriteFontCacheFile(), possibly by an earlier run of the
+     *  process. From then on, new font cache entries start with the glyph metrics, images and
+     *  paths stored for them in the file, rather than asking the font to make them again.
+     *
+     *  Returns false, and stops using any previous file, if the file is missing or was written
+     *  by a different version of Skia. Pass nullptr to stop using a file.
+     */
+    static bool SetFontCacheFile(const char path[]);
+
+    /**
+     *  Write the glyphs in the font cache to a file for SetFontCacheFile(). It is safe to write
+     *  to the file currently passed to SetFontCacheFile().
+     */
+    static bool WriteFontCacheFile(const char path[]);
+
+    /**
+     *  When text needs many glyphs that are not in the font cache yet, such as a paragraph at a
+     *  new size, measure and rasterize them in parallel on executor. The executor must outlive
+     *  its use; pass nullptr, the default, to rasterize them one by one on the drawing thread.
+     */
+    static void SetFontCacheExecutor(SkExecutor* executor);
+
     /**
      *  Scaling bitmaps with the kHigh_SkFilterQuality setting is
      *  expensive, so the result is saved in the global Scaled Image
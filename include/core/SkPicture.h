@@ -70,6 +70,23 @@ public:
     static sk_sp<SkPicture> MakeFromData(const SkData* data,
                                          const SkDeserialProcs* procs = nullptr);
 
+    /** Like MakeFromData(const SkData*, const SkDeserialProcs*), but encoded images, and op
+        data that happens to be 4-byte aligned, share the bytes of data instead of being
+        copied. The op data of the top-level SkPicture starts 37 bytes into data, so it is
+        copied whenever data itself is aligned.
+
+        The returned SkPicture may keep a reference to data, and read its bytes, for as long as
+        the SkPicture lives. If data was made with SkData::MakeWithoutCopy(), or maps a file,
+        those bytes must stay valid and unchanged for that long. This makes loading from
+        SkData::MakeFromFD() cheap.
+
+        @param data   container for serial data
+        @param procs  custom serial data decoders; may be nullptr
+        @return       SkPicture constructed from data
+    */
+    static sk_sp<SkPicture> MakeFromSharedData(sk_sp<SkData> data,
+                                               const SkDeserialProcs* procs = nullptr);
+
     /**
 
         @param data   pointer to serial data
@@ -240,7 +257,8 @@ private:
     void serialize(SkWStream*, const SkSerialProcs*, class SkRefCntSet* typefaces,
         bool textBlobsOnly=false) const;
     static sk_sp<SkPicture> MakeFromStream(SkStream*, const SkDeserialProcs*,
-                                           class SkTypefacePlayback*);
+                                           class SkTypefacePlayback*,
+                                           const SkData* backing = nullptr);
     friend class SkPictureData;
 
     /** Return true if the SkStream/Buffer represents a serialized picture, and
@@ -38,6 +38,12 @@ public:
     };
 
     enum FinishFlags {
+        // Makes the recorded ops share the paths and paint effects (shaders, filters and path
+        // effects) that are equal, to save heap memory in pictures that are kept for a long
+        // time. Each op still keeps its own paint, and the ops are not repacked, so
+        // SkPicture::approximateBytesUsed() does not change. This costs time when recording
+        // finishes, but does not change how the picture draws.
+        kCompact_FinishFlag = 1 << 0,
     };
 
     /** Returns the canvas that records the drawing commands.
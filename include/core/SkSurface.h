@@ -24,6 +24,7 @@
 
 class SkCanvas;
 class SkDeferredDisplayList;
+class SkExecutor;
 class SkPaint;
 class SkSurfaceCharacterization;
 class GrBackendRenderTarget;
@@ -163,6 +164,36 @@ public:
     static sk_sp<SkSurface> MakeRasterN32Premul(int width, int height,
                                                 const SkSurfaceProps* surfaceProps = nullptr);
 
+    /** Allocates raster SkSurface whose SkCanvas records draws, rather than drawing them into
+        pixels as they are made. flush() hands the draws recorded since the last flush to a
+        worker thread, which draws them into the pixels, and returns without waiting for it.
+        The caller can record the next frame while the worker draws the last one; a flush while
+        the worker is still drawing waits for it to finish first.
+
+        makeImageSnapshot(), peekPixels(), readPixels(), writePixels(), draw() and
+        generationID() flush and wait for the worker to finish, so they see every draw made
+        before them. flush() with kSyncCpu_GrFlushFlag also waits. The GrFlushInfo finished proc,
+        if any, is called on the worker once the flushed draws are in the pixels.
+
+        The canvas has no pixels of its own: SkCanvas::peekPixels() and SkCanvas::readPixels()
+        on it fail, so read through SkSurface instead. Objects drawn, such as SkImage and
+        SkShader, are referenced until the worker has drawn them, and must be safe to use from
+        another thread. Draws not flushed when SkSurface is deleted are dropped.
+
+        SkSurface is returned if MakeRaster() would return one for imageInfo and props.
+
+        @param imageInfo  width, height, SkColorType, SkAlphaType, SkColorSpace,
+                          of raster surface; width and height must be greater than zero
+        @param executor   runs the worker's drawing; if nullptr, SkSurface creates a thread
+                          of its own
+        @param props      LCD striping orientation and setting for device independent fonts;
+                          may be nullptr
+        @return           SkSurface if all parameters are valid; otherwise, nullptr
+    */
+    static sk_sp<SkSurface> MakeRasterDeferred(const SkImageInfo& imageInfo,
+                                               SkExecutor* executor = nullptr,
+                                               const SkSurfaceProps* props = nullptr);
+
     /** Caller data passed to RenderTarget/TextureReleaseProc; may be nullptr. */
     typedef void* ReleaseContext;
 
@@ -19,15 +19,39 @@ public:
      *  Encode |numRows| rows of input.  If the caller requests more rows than are remaining
      *  in the src, this will encode all of the remaining rows.  |numRows| must be greater
      *  than zero.
+     *
+     *  Returns false if the src has no pixels.
      */
     bool encodeRows(int numRows);
 
+    /**
+     *  Encode all of the rows of |rows| as the next rows of input, reading them from |rows|
+     *  rather than from the src this encoder was created with.  This allows the image to be
+     *  produced and encoded in bands, without ever holding all of its pixels in memory.
+     *
+     *  |rows| must have the same width, color type and alpha type as the src, and is
+     *  interpreted in the src's color space.  If |rows| is taller than the number of rows
+     *  remaining in the src, only the remaining rows are encoded.
+     *
+     *  Returns false if all rows have already been encoded, or if this encoder does not
+     *  support reading rows from a separate pixmap.
+     */
+    bool encodeRows(const SkPixmap& rows);
+
     virtual ~SkEncoder() {}
 
 protected:
 
     virtual bool onEncodeRows(int numRows) = 0;
 
+    /**
+     *  Called by encodeRows(const SkPixmap&) with the pixmap holding rows
+     *  [fCurrRow, fCurrRow + rows->height()) before they are encoded, and with nullptr once
+     *  they have been.  Subclasses that support this must read those rows from |rows| rather
+     *  than from fSrc.  Returns false if reading rows from a separate pixmap is not supported.
+     */
+    virtual bool onSetRows(const SkPixmap* rows) { return false; }
+
     SkEncoder(const SkPixmap& src, size_t storageBytes)
         : fSrc(src)
         , fCurrRow(0)
@@ -37,6 +61,9 @@ protected:
     const SkPixmap&        fSrc;
     int                    fCurrRow;
     SkAutoTMalloc<uint8_t> fStorage;
+
+private:
+    bool encodeRemainingRows(int numRows);
 };
 
 #endif
@@ -8,6 +8,8 @@
 #ifndef SkJpegEncoder_DEFINED
 #define SkJpegEncoder_DEFINED
 
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkYUVASizeInfo.h"
 #include "include/encode/SkEncoder.h"
 
 class SkJpegEncoderMgr;
@@ -77,15 +79,36 @@ public:
      *
      *  |dst| is unowned but must remain valid for the lifetime of the object.
      *
+     *  |src| may have no pixels (a null address) if every row will be passed to
+     *  encodeRows(const SkPixmap&).
+     *
      *  This returns nullptr on an invalid or unsupported |src|.
      */
     static std::unique_ptr<SkEncoder> Make(SkWStream* dst, const SkPixmap& src,
                                            const Options& options);
 
+    /**
+     *  Encode the Y, U and V |planes| described by |sizeInfo| directly to the |dst| stream,
+     *  without converting through RGB.  The planes are passed to libjpeg-turbo as raw
+     *  downsampled data, matching the layout produced by SkCodec::getYUV8Planes().
+     *
+     *  |colorSpace| must be kJPEG_SkYUVColorSpace, since that is the only YUV encoding that
+     *  can be stored in a jpeg.  The U and V planes must have the same size, and that size
+     *  must correspond to a 4:2:0, 4:2:2 or 4:4:4 downsampling of the Y plane.  The
+     *  downsampling is inferred from the plane sizes, so |options|.fDownsample is ignored,
+     *  as is |options|.fAlphaOption.  An A plane, if present, is ignored.
+     *
+     *  Returns true on success.  Returns false on invalid or unsupported planes.
+     */
+    static bool EncodeYUV(SkWStream* dst, const SkYUVASizeInfo& sizeInfo,
+                          const void* const planes[SkYUVASizeInfo::kMaxCount],
+                          SkYUVColorSpace colorSpace, const Options& options);
+
     ~SkJpegEncoder() override;
 
 protected:
     bool onEncodeRows(int numRows) override;
+    bool onSetRows(const SkPixmap* rows) override;
 
 private:
     SkJpegEncoder(std::unique_ptr<SkJpegEncoderMgr>, const SkPixmap& src);
@@ -75,6 +75,9 @@ public:
      *
      *  |dst| is unowned but must remain valid for the lifetime of the object.
      *
+     *  |src| may have no pixels (a null address) if every row will be passed to
+     *  encodeRows(const SkPixmap&).
+     *
      *  This returns nullptr on an invalid or unsupported |src|.
      */
     static std::unique_ptr<SkEncoder> Make(SkWStream* dst, const SkPixmap& src,
@@ -84,6 +87,7 @@ public:
 
 protected:
     bool onEncodeRows(int numRows) override;
+    bool onSetRows(const SkPixmap* rows) override;
 
     SkPngEncoder(std::unique_ptr<SkPngEncoderMgr>, const SkPixmap& src);
 
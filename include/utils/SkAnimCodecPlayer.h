@@ -9,12 +9,36 @@
 #define SkAnimCodecPlayer_DEFINED
 
 #include "include/codec/SkCodec.h"
+#include "include/private/SkMutex.h"
 
+#include <atomic>
+#include <vector>
+
+class SkExecutor;
 class SkImage;
+class SkTaskGroup;
 
 class SkAnimCodecPlayer {
 public:
+    struct CacheOptions {
+        /**
+         *  The most decoded frames to keep. When full, the least recently used frame is dropped,
+         *  preferring frames that are not keyframes (frames with no required frame) since those
+         *  are the cheapest places to resume decoding after a seek. 0 means keep every frame.
+         */
+        int         fMaxCachedFrames = 0;
+
+        /**
+         *  If non-null, after a new current frame is requested, the following fDecodeAhead
+         *  frames (wrapping around at the end) are decoded on this executor so that playback
+         *  finds them ready. The executor must outlive the player.
+         */
+        SkExecutor* fExecutor = nullptr;
+        int         fDecodeAhead = 0;
+    };
+
     SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec);
+    SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec, const CacheOptions& options);
     ~SkAnimCodecPlayer();
 
     /**
@@ -44,6 +68,10 @@ public:
      */
     bool seek(uint32_t msec);
 
+    /**
+     *  Returns the number of decoded frames currently held by the player.
+     */
+    int cachedFrameCount();
 
 private:
     std::unique_ptr<SkCodec>        fCodec;
@@ -52,8 +80,23 @@ private:
     std::vector<sk_sp<SkImage> >    fImages;
     int                             fCurrIndex = 0;
     uint32_t                        fTotalDuration;
+    const CacheOptions              fOptions;
+
+    // Guards fCodec and the frame cache, which are shared with decode-ahead tasks.
+    SkMutex                         fMutex;
+    std::vector<uint32_t>           fLastUsed;
+    uint32_t                        fUseCount = 0;
+    int                             fCachedCount = 0;
+
+    // Decode-ahead tasks stop when this no longer matches the frame they were started for.
+    std::atomic<int>                fAheadFrom{-1};
+    std::unique_ptr<SkTaskGroup>    fAheadTasks;
 
     sk_sp<SkImage> getFrameAt(int index);
+    sk_sp<SkImage> decodeFrame(int index, const sk_sp<SkImage>& prior);
+    void cacheFrame(int index, sk_sp<SkImage> image);
+    bool isProtected(int index) const;
+    void decodeAhead(int from);
 };
 
 #endif
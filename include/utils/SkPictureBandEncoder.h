@@ -0,0 +1,74 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureBandEncoder_DEFINED
+#define SkPictureBandEncoder_DEFINED
+
+#include "include/core/SkEncodedImageFormat.h"
+#include "include/core/SkImageInfo.h"
+#include "include/encode/SkEncoder.h"
+
+#include <functional>
+#include <memory>
+
+class SkExecutor;
+class SkPicture;
+class SkWStream;
+
+/**
+ *  Renders an SkPicture straight into an encoded image, a horizontal band at a time.
+ *
+ *  Each band is drawn into a reusable strip and its rows are handed to the encoder with
+ *  SkEncoder::encodeRows(const SkPixmap&), so peak memory is bounded by the band height
+ *  rather than by the size of the image.  This makes it practical to export images far
+ *  larger than could be rasterized into a single SkBitmap.
+ */
+class SK_API SkPictureBandEncoder {
+public:
+    /**
+     *  Creates an encoder that writes to |dst|.  |src| describes the whole image but has no
+     *  pixels (a null address), since all rows are supplied a band at a time with
+     *  SkEncoder::encodeRows(const SkPixmap&).
+     */
+    using MakeEncoderProc =
+            std::function<std::unique_ptr<SkEncoder>(SkWStream* dst, const SkPixmap& src)>;
+
+    struct Options {
+        /**
+         *  The number of rows rendered and encoded at a time.  Must be greater than zero.
+         */
+        int fBandHeight = 256;
+
+        /**
+         *  If non-null, the next band is rendered on |fExecutor| while the current band is
+         *  encoded.  This doubles the strip memory, but overlaps rasterization and encoding.
+         */
+        SkExecutor* fExecutor = nullptr;
+    };
+
+    /**
+     *  Renders |picture| into an image described by |info| and encodes it to |dst| in
+     *  |format|, which must be kPNG or kJPEG.  |quality| is as for SkEncodeImage().
+     *
+     *  The picture is drawn with its origin at the top left of the image, over a transparent
+     *  background.
+     *
+     *  Returns true on success.
+     */
+    static bool Encode(SkWStream* dst, const SkPicture* picture, const SkImageInfo& info,
+                       SkEncodedImageFormat format, int quality,
+                       const Options& options);
+
+    /**
+     *  As above, but uses |makeEncoder| to create the encoder, so that any encoder and any
+     *  encoder options may be used.
+     */
+    static bool Encode(SkWStream* dst, const SkPicture* picture, const SkImageInfo& info,
+                       const MakeEncoderProc& makeEncoder, const Options& options);
+};
+
+#endif
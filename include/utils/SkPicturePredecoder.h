@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPicturePredecoder_DEFINED
+#define SkPicturePredecoder_DEFINED
+
+#include "include/core/SkImage.h"
+#include "include/core/SkMatrix.h"
+#include "include/core/SkRect.h"
+#include "include/private/SkTo.h"
+
+#include <memory>
+#include <vector>
+
+class SkExecutor;
+class SkPicture;
+class SkTaskGroup;
+
+/**
+ *  Lazily generated images in an SkPicture are decoded the first time they are drawn, on the
+ *  thread drawing the picture.  SkPicturePredecoder finds the images that a raster playback
+ *  of a picture will need, so that they can be decoded ahead of time (optionally on an
+ *  SkExecutor) into the resource cache.  Playback then finds them already decoded.
+ */
+class SK_API SkPicturePredecoder {
+public:
+    /**
+     *  Collects the lazily generated images that drawing |picture| with |matrix| will decode
+     *  within |deviceClip|.  If the picture has a bounding box hierarchy, only the parts of it
+     *  that intersect the clip are visited.  Images already in the resource cache are skipped.
+     */
+    SkPicturePredecoder(const SkPicture* picture, const SkMatrix& matrix,
+                        const SkIRect& deviceClip);
+
+    /**
+     *  Waits for any decodes started by decode() to finish.
+     */
+    ~SkPicturePredecoder();
+
+    /**
+     *  The number of images that need to be decoded.
+     */
+    int imageCount() const { return SkToInt(fImages.size()); }
+
+    /**
+     *  An estimate of the bytes of cache that decoding the images will use, including any
+     *  mipmaps that playback will need because an image is drawn scaled down.
+     */
+    size_t bytesToDecode() const { return fBytesToDecode; }
+
+    /**
+     *  Decodes the images into the resource cache.  If |executor| is non-null, each image is
+     *  decoded as a separate task on it and this returns immediately; call wait() to block
+     *  until they are done.  Otherwise the images are decoded before this returns.
+     *
+     *  This should only be called once.
+     */
+    void decode(SkExecutor* executor);
+
+    /**
+     *  Blocks until all decodes started by decode() have finished.
+     */
+    void wait();
+
+private:
+    struct Image {
+        sk_sp<SkImage> fImage;
+        bool           fNeedsMips;
+    };
+
+    std::vector<Image>           fImages;
+    size_t                       fBytesToDecode = 0;
+    std::unique_ptr<SkTaskGroup> fTasks;
+};
+
+#endif
@@ -4,10 +4,9 @@
 
 #include "include/private/SkMutex.h"
 #include "src/core/SkLRUCache.h"
+#include <atomic>
 #include <functional>  // std::function
 
-#define PARAGRAPH_CACHE_STATS
-
 namespace skia {
 namespace textlayout {
 
@@ -27,6 +26,13 @@ class ParagraphCacheValue;
 
 bool operator==(const ParagraphCacheKey& a, const ParagraphCacheKey& b);
 
+/**
+ *  Caches the shaped runs of paragraphs, keyed by their text and styles.
+ *
+ *  The cache may be used by several threads at once, such as layout threads sharing a
+ *  FontCollection. It holds at most getByteLimit() bytes of paragraphs, dropping the least
+ *  recently used ones to make room.
+ */
 class ParagraphCache {
 public:
     ParagraphCache();
@@ -37,24 +43,41 @@ public:
     bool updateParagraph(ParagraphImpl* paragraph);
     bool findParagraph(ParagraphImpl* paragraph);
 
+    /** Sets the most memory the cached paragraphs may use, dropping paragraphs as needed. */
+    void setByteLimit(size_t byteLimit);
+    size_t getByteLimit() const;
+
+    /** Counts since the cache was made or last reset(). */
+    struct Stats {
+        int    fRequests  = 0;  // calls to findParagraph()
+        int    fHits      = 0;  // requests that found the paragraph
+        int    fMisses    = 0;  // requests that did not
+        int    fAdded     = 0;  // paragraphs added by updateParagraph()
+        int    fEvicted   = 0;  // paragraphs dropped to stay under the byte limit
+        int    fCount     = 0;  // paragraphs in the cache now
+        size_t fBytesUsed = 0;  // their estimated size in memory
+        size_t fByteLimit = 0;
+    };
+    Stats getStats() const;
+
     // For testing
     void setChecker(std::function<void(ParagraphImpl* impl, const char*, bool)> checker) {
         fChecker = std::move(checker);
     }
-    void printStatistics();
     void turnOn(bool value) { fCacheIsOn = value; }
-    int count() { return fLRUCacheMap.count(); }
+    int count();
 
  private:
 
     struct Entry;
     void updateFrom(const ParagraphImpl* paragraph, Entry* entry);
     void updateTo(ParagraphImpl* paragraph, const Entry* entry);
+    void purgeAsNeeded();
 
      mutable SkMutex fParagraphMutex;
      std::function<void(ParagraphImpl* impl, const char*, bool)> fChecker;
 
-    static const int kMaxEntries = 128;
+    static constexpr size_t kDefaultByteLimit = 4 * 1024 * 1024;
 
     struct KeyHash {
         uint32_t mix(uint32_t hash, uint32_t data) const;
@@ -62,13 +85,9 @@ public:
     };
 
     SkLRUCache<ParagraphCacheKey, std::unique_ptr<Entry>, KeyHash> fLRUCacheMap;
-    bool fCacheIsOn;
+    std::atomic<bool> fCacheIsOn;
 
-#ifdef PARAGRAPH_CACHE_STATS
-    int fTotalRequests;
-    int fCacheMisses;
-    int fHashMisses; // cache hit but hash table missed
-#endif
+    Stats fStats;
 };
 
 }  // namespace textlayout
@@ -2,6 +2,8 @@
 #include "modules/skparagraph/include/ParagraphCache.h"
 #include "modules/skparagraph/src/ParagraphImpl.h"
 
+#include <limits>
+
 namespace skia {
 namespace textlayout {
 
@@ -42,6 +44,24 @@ public:
 
     // Shaped results
     SkTArray<Run, false> fRuns;
+
+    // An estimate of the memory used by the key and the runs. A run stores up to 128 glyphs
+    // inline; longer runs allocate their glyph data.
+    size_t sizeInBytes() const {
+        static constexpr size_t kInlineGlyphs = 128;
+        static constexpr size_t kBytesPerGlyph = sizeof(SkGlyphID) + 2 * sizeof(SkPoint) +
+                                                 sizeof(uint32_t) + sizeof(SkRect) +
+                                                 sizeof(SkScalar);
+        size_t bytes = sizeof(ParagraphCacheValue) + fKey.fText.size() +
+                       fKey.fPlaceholders.size() * sizeof(Placeholder) +
+                       fKey.fTextStyles.size() * sizeof(Block) + fRuns.size() * sizeof(Run);
+        for (const Run& run : fRuns) {
+            if (run.size() > kInlineGlyphs) {
+                bytes += run.size() * kBytesPerGlyph;
+            }
+        }
+        return bytes;
+    }
 };
 
 uint32_t ParagraphCache::KeyHash::mix(uint32_t hash, uint32_t data) const {
@@ -172,20 +192,17 @@ bool operator==(const ParagraphCacheKey& a, const ParagraphCacheKey& b) {
 
 struct ParagraphCache::Entry {
 
-    Entry(ParagraphCacheValue* value) : fValue(value) {}
+    Entry(ParagraphCacheValue* value) : fValue(value), fSizeInBytes(value->sizeInBytes()) {}
     std::unique_ptr<ParagraphCacheValue> fValue;
+    size_t fSizeInBytes;
 };
 
 ParagraphCache::ParagraphCache()
     : fChecker([](ParagraphImpl* impl, const char*, bool){ })
-    , fLRUCacheMap(kMaxEntries)
-    , fCacheIsOn(true)
-#ifdef PARAGRAPH_CACHE_STATS
-    , fTotalRequests(0)
-    , fCacheMisses(0)
-    , fHashMisses(0)
-#endif
-{ }
+    , fLRUCacheMap(std::numeric_limits<int>::max())
+    , fCacheIsOn(true) {
+    fStats.fByteLimit = kDefaultByteLimit;
+}
 
 ParagraphCache::~ParagraphCache() { }
 
@@ -208,31 +225,48 @@ void ParagraphCache::updateTo(ParagraphImpl* paragraph, const Entry* entry) {
     }
 }
 
-void ParagraphCache::printStatistics() {
-    SkDebugf("--- Paragraph Cache ---\n");
-    SkDebugf("Total requests: %d\n", fTotalRequests);
-    SkDebugf("Cache misses: %d\n", fCacheMisses);
-    SkDebugf("Cache miss %%: %f\n", (fTotalRequests > 0) ? 100.f * fCacheMisses / fTotalRequests : 0.f);
-    int cacheHits = fTotalRequests - fCacheMisses;
-    SkDebugf("Hash miss %%: %f\n", (cacheHits > 0) ? 100.f * fHashMisses / cacheHits : 0.f);
-    SkDebugf("---------------------\n");
+void ParagraphCache::purgeAsNeeded() {
+    while (fStats.fBytesUsed > fStats.fByteLimit) {
+        std::unique_ptr<Entry>* entry = fLRUCacheMap.peekLRU();
+        SkASSERT(entry);
+        fStats.fBytesUsed -= (*entry)->fSizeInBytes;
+        fStats.fEvicted++;
+        fLRUCacheMap.removeLRU();
+    }
+}
+
+void ParagraphCache::setByteLimit(size_t byteLimit) {
+    SkAutoMutexExclusive lock(fParagraphMutex);
+    fStats.fByteLimit = byteLimit;
+    this->purgeAsNeeded();
 }
 
-void ParagraphCache::abandon() {
+size_t ParagraphCache::getByteLimit() const {
+    SkAutoMutexExclusive lock(fParagraphMutex);
+    return fStats.fByteLimit;
+}
+
+ParagraphCache::Stats ParagraphCache::getStats() const {
+    SkAutoMutexExclusive lock(fParagraphMutex);
+    Stats stats = fStats;
+    stats.fCount = fLRUCacheMap.count();
+    return stats;
+}
+
+int ParagraphCache::count() {
     SkAutoMutexExclusive lock(fParagraphMutex);
-    fLRUCacheMap.foreach([](ParagraphCacheKey*, std::unique_ptr<Entry>* e) {
-    });
+    return fLRUCacheMap.count();
+}
 
+void ParagraphCache::abandon() {
     this->reset();
 }
 
 void ParagraphCache::reset() {
     SkAutoMutexExclusive lock(fParagraphMutex);
-#ifdef PARAGRAPH_CACHE_STATS
-    fTotalRequests = 0;
-    fCacheMisses = 0;
-    fHashMisses = 0;
-#endif
+    size_t byteLimit = fStats.fByteLimit;
+    fStats = Stats();
+    fStats.fByteLimit = byteLimit;
     fLRUCacheMap.reset();
 }
 
@@ -240,21 +274,18 @@ bool ParagraphCache::findParagraph(ParagraphImpl* paragraph) {
     if (!fCacheIsOn) {
         return false;
     }
-#ifdef PARAGRAPH_CACHE_STATS
-    ++fTotalRequests;
-#endif
-    SkAutoMutexExclusive lock(fParagraphMutex);
     ParagraphCacheKey key(paragraph);
+    SkAutoMutexExclusive lock(fParagraphMutex);
+    ++fStats.fRequests;
     std::unique_ptr<Entry>* entry = fLRUCacheMap.find(key);
 
     if (!entry) {
         // We have a cache miss
-#ifdef PARAGRAPH_CACHE_STATS
-        ++fCacheMisses;
-#endif
+        ++fStats.fMisses;
         fChecker(paragraph, "missingParagraph", true);
         return false;
     }
+    ++fStats.fHits;
     updateTo(paragraph, entry->get());
     fChecker(paragraph, "foundParagraph", true);
     return true;
@@ -264,19 +295,29 @@ bool ParagraphCache::updateParagraph(ParagraphImpl* paragraph) {
     if (!fCacheIsOn) {
         return false;
     }
-#ifdef PARAGRAPH_CACHE_STATS
-    ++fTotalRequests;
-#endif
-    SkAutoMutexExclusive lock(fParagraphMutex);
     ParagraphCacheKey key(paragraph);
+    SkAutoMutexExclusive lock(fParagraphMutex);
     std::unique_ptr<Entry>* entry = fLRUCacheMap.find(key);
     if (!entry) {
         ParagraphCacheValue* value = new ParagraphCacheValue(paragraph);
-        fLRUCacheMap.insert(key, std::unique_ptr<Entry>(new Entry(value)));
+        std::unique_ptr<Entry> newEntry(new Entry(value));
+        if (newEntry->fSizeInBytes > fStats.fByteLimit) {
+            // Don't empty the whole cache for a paragraph that would not fit anyway.
+            return false;
+        }
+        fStats.fBytesUsed += newEntry->fSizeInBytes;
+        ++fStats.fAdded;
+        fLRUCacheMap.insert(key, std::move(newEntry));
+        this->purgeAsNeeded();
         fChecker(paragraph, "addedParagraph", true);
         return true;
     } else {
-        updateFrom(paragraph, entry->get());
+        Entry* existing = entry->get();
+        updateFrom(paragraph, existing);
+        size_t sizeInBytes = existing->fValue->sizeInBytes();
+        fStats.fBytesUsed = fStats.fBytesUsed - existing->fSizeInBytes + sizeInBytes;
+        existing->fSizeInBytes = sizeInBytes;
+        this->purgeAsNeeded();
         fChecker(paragraph, "updatedParagraph", true);
         return false;
     }
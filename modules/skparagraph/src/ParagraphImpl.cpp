@@ -131,10 +131,10 @@ void ParagraphImpl::layout(SkScalar rawWidth) {
         this->fRunShifts.reset();
         this->fClusters.reset();
     } else if (fState >= kLineBroken && (fOldWidth != floorWidth || fOldHeight != fHeight)) {
-        // We can use the results from SkShaper but have to do EVERYTHING ELSE again
-        this->fClusters.reset();
-        this->resetRunShifts();
-        fState = kShaped;
+        // Only the line breaking depends on the width: we keep the shaped runs, the clusters
+        // with their break marks and the letter/word spacing, and redo the lines
+        this->resetJustificationShifts();
+        fState = kMarked;
     }
 
     if (fState < kShaped) {
@@ -1093,6 +1093,14 @@ void ParagraphImpl::resetRunShifts() {
     }
 }
 
+void ParagraphImpl::resetJustificationShifts() {
+    for (auto& shifts : fRunShifts) {
+        for (auto& shift : shifts.fShifts) {
+            shift = 0;
+        }
+    }
+}
+
 void ParagraphImpl::setState(InternalState state) {
     if (fState <= state) {
         fState = state;
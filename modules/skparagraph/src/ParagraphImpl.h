@@ -180,6 +180,7 @@ public:
     void resetContext();
     void resolveStrut();
     void resetRunShifts();
+    void resetJustificationShifts();
     void buildClusterTable();
     void markLineBreaks();
     bool shapeTextIntoEndlessLine();
@@ -39,6 +39,7 @@
 
 class SkFont;
 class SkFontMgr;
+class SkShaperCache;
 
 /**
    Shapes text using HarfBuzz and places the shaped text into a
@@ -59,6 +60,14 @@ public:
 
     static std::unique_ptr<SkShaper> Make(sk_sp<SkFontMgr> = nullptr);
 
+    /**
+     *  Returns a shaper that keeps the runs made by shaper in cache. Shaping the same text again
+     *  with the same fonts, bidi levels, scripts, languages, features and width replays the
+     *  cached glyphs, positions and clusters instead of shaping it again.
+     */
+    static std::unique_ptr<SkShaper> MakeCaching(std::unique_ptr<SkShaper> shaper,
+                                                 sk_sp<SkShaperCache> cache);
+
     SkShaper();
     virtual ~SkShaper();
 
@@ -249,6 +258,42 @@ private:
     SkShaper& operator=(const SkShaper&) = delete;
 };
 
+/**
+ *  The shaped text kept by the shapers made with SkShaper::MakeCaching(). When the runs take
+ *  more than the byte limit, the least recently used are purged. A cache may be shared by
+ *  several shapers on several threads.
+ */
+class SKSHAPER_API SkShaperCache : public SkRefCnt {
+public:
+    static constexpr size_t kDefaultByteLimit = 1 << 20;
+
+    static sk_sp<SkShaperCache> Make(size_t byteLimit = kDefaultByteLimit);
+
+    struct Stats {
+        int    fRequests;   // calls to shape()
+        int    fHits;       // shape() calls replayed from the cache
+        int    fMisses;     // shape() calls passed on to the shaper
+        int    fAdded;
+        int    fEvicted;
+        int    fCount;      // texts in the cache now
+        size_t fBytesUsed;
+        size_t fByteLimit;
+    };
+    virtual Stats getStats() const = 0;
+
+    virtual size_t getByteLimit() const = 0;
+    /** Purges the least recently used texts until the rest fit in byteLimit. */
+    virtual void setByteLimit(size_t byteLimit) = 0;
+
+    /** Purges every text, keeping the byte limit. */
+    virtual void purgeAll() = 0;
+
+private:
+    // Caches are only made by Make().
+    SkShaperCache() = default;
+    friend class SkShaperCacheImpl;
+};
+
 /**
  * Helper for shaping text directly into a SkTextBlob.
  */
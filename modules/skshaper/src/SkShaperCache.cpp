@@ -0,0 +1,442 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkFont.h"
+#include "include/core/SkString.h"
+#include "include/core/SkTypeface.h"
+#include "include/private/SkMalloc.h"
+#include "include/private/SkMutex.h"
+#include "include/private/SkTArray.h"
+#include "include/private/SkTDArray.h"
+#include "include/private/SkTo.h"
+#include "modules/skshaper/include/SkShaper.h"
+#include "src/core/SkLRUCache.h"
+
+#include <limits.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+using RunHandler = SkShaper::RunHandler;
+
+// The calls a shaper made to its RunHandler for one text, with the runs and glyphs it gave.
+class ShapedText : public SkNVRefCnt<ShapedText> {
+public:
+    void replay(RunHandler* handler) const;
+
+    size_t sizeInBytes() const {
+        return sizeof(ShapedText) + fCalls.count() * sizeof(Call) + fRuns.count() * sizeof(Run) +
+               fGlyphs.count() * (sizeof(SkGlyphID) + 2 * sizeof(SkPoint) + sizeof(uint32_t));
+    }
+
+private:
+    friend class RecordingRunHandler;
+
+    enum class Kind : uint8_t {
+        kBeginLine,
+        kRunInfo,
+        kCommitRunInfo,
+        kRunBuffer,
+        kCommitRunBuffer,
+        kCommitLine,
+    };
+    struct Call {
+        Kind fKind;
+        int  fRun;  // index into fRuns, or -1
+    };
+    struct Run {
+        SkFont            fFont;
+        uint8_t           fBidiLevel;
+        SkVector          fAdvance;
+        size_t            fGlyphCount;
+        RunHandler::Range fUtf8Range;
+        int               fFirstGlyph;  // -1 unless the run was passed to runBuffer()
+    };
+
+    SkTDArray<Call>      fCalls;
+    SkTArray<Run>        fRuns;
+    // The glyphs of all the runs. Positions are relative to the point of their run's buffer.
+    SkTDArray<SkGlyphID> fGlyphs;
+    SkTDArray<SkPoint>   fPositions;
+    SkTDArray<SkPoint>   fOffsets;
+    SkTDArray<uint32_t>  fClusters;
+};
+
+void ShapedText::replay(RunHandler* handler) const {
+    for (const Call& call : fCalls) {
+        if (call.fRun < 0) {
+            switch (call.fKind) {
+                case Kind::kBeginLine:     handler->beginLine();     break;
+                case Kind::kCommitRunInfo: handler->commitRunInfo(); break;
+                case Kind::kCommitLine:    handler->commitLine();    break;
+                default: SkASSERT(false);
+            }
+            continue;
+        }
+
+        const Run& run = fRuns[call.fRun];
+        const RunHandler::RunInfo info = {
+            run.fFont, run.fBidiLevel, run.fAdvance, run.fGlyphCount, run.fUtf8Range
+        };
+        switch (call.fKind) {
+            case Kind::kRunInfo:
+                handler->runInfo(info);
+                break;
+            case Kind::kRunBuffer: {
+                const RunHandler::Buffer buffer = handler->runBuffer(info);
+                const int first = run.fFirstGlyph;
+                const size_t count = run.fGlyphCount;
+                memcpy(buffer.glyphs, fGlyphs.begin() + first, count * sizeof(SkGlyphID));
+                for (size_t i = 0; i < count; i++) {
+                    if (buffer.offsets) {
+                        buffer.positions[i] = buffer.point + fPositions[first + i];
+                        buffer.offsets[i] = fOffsets[first + i];
+                    } else {
+                        buffer.positions[i] = buffer.point + fPositions[first + i] +
+                                              fOffsets[first + i];
+                    }
+                }
+                if (buffer.clusters) {
+                    memcpy(buffer.clusters, fClusters.begin() + first, count * sizeof(uint32_t));
+                }
+                break;
+            }
+            case Kind::kCommitRunBuffer:
+                handler->commitRunBuffer(info);
+                break;
+            default:
+                SkASSERT(false);
+        }
+    }
+}
+
+// Records what a shaper gives to its RunHandler into a ShapedText. Each runBuffer() call gets
+// room for offsets and clusters, so that the text can be replayed into any handler.
+class RecordingRunHandler final : public RunHandler {
+public:
+    explicit RecordingRunHandler(ShapedText* text) : fText(text) {}
+
+    void beginLine() override { this->addCall(ShapedText::Kind::kBeginLine, -1); }
+    void runInfo(const RunInfo& info) override {
+        this->addCall(ShapedText::Kind::kRunInfo, this->addRun(info));
+    }
+    void commitRunInfo() override { this->addCall(ShapedText::Kind::kCommitRunInfo, -1); }
+    Buffer runBuffer(const RunInfo& info) override {
+        int runIndex = this->addRun(info);
+        this->addCall(ShapedText::Kind::kRunBuffer, runIndex);
+
+        // The shaper fills the buffer in before the next call, so the arrays can't move.
+        int count = SkToInt(info.glyphCount);
+        int first = fText->fGlyphs.count();
+        fText->fRuns[runIndex].fFirstGlyph = first;
+        fText->fGlyphs.append(count);
+        SkPoint* offsets = fText->fOffsets.append(count);
+        // Not every shaper writes the offsets.
+        sk_bzero(offsets, count * sizeof(SkPoint));
+        return {fText->fGlyphs.begin() + first,
+                fText->fPositions.append(count),
+                offsets,
+                fText->fClusters.append(count),
+                {0, 0}};
+    }
+    void commitRunBuffer(const RunInfo& info) override {
+        this->addCall(ShapedText::Kind::kCommitRunBuffer, this->addRun(info));
+    }
+    void commitLine() override { this->addCall(ShapedText::Kind::kCommitLine, -1); }
+
+private:
+    void addCall(ShapedText::Kind kind, int run) {
+        fText->fCalls.push_back({kind, run});
+    }
+    int addRun(const RunInfo& info) {
+        fText->fRuns.push_back({info.fFont, info.fBidiLevel, info.fAdvance, info.glyphCount,
+                                info.utf8Range, -1});
+        return fText->fRuns.count() - 1;
+    }
+
+    ShapedText* fText;
+};
+
+template <typename T> void write_key(SkString* key, const T& value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "");
+    key->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+void write_key(SkString* key, const SkString& value) {
+    write_key(key, value.size());
+    key->append(value);
+}
+void write_key(SkString* key, const SkFont& font) {
+    write_key(key, SkTypeface::UniqueID(font.getTypefaceOrDefault()));
+    write_key(key, font.getSize());
+    write_key(key, font.getScaleX());
+    write_key(key, font.getSkewX());
+    write_key(key, font.getEdging());
+    write_key(key, font.getHinting());
+    uint8_t flags = (font.isForceAutoHinting() << 0) | (font.isEmbeddedBitmaps() << 1) |
+                    (font.isSubpixel()         << 2) | (font.isLinearMetrics()   << 3) |
+                    (font.isEmbolden()         << 4) | (font.isBaselineSnap()    << 5);
+    write_key(key, flags);
+}
+
+SkFont current_value(const SkShaper::FontRunIterator& iterator) {
+    return iterator.currentFont();
+}
+uint8_t current_value(const SkShaper::BiDiRunIterator& iterator) {
+    return iterator.currentLevel();
+}
+SkFourByteTag current_value(const SkShaper::ScriptRunIterator& iterator) {
+    return iterator.currentScript();
+}
+SkString current_value(const SkShaper::LanguageRunIterator& iterator) {
+    return SkString(iterator.currentLanguage());
+}
+
+// Reads all the runs of an iterator up front, so that they can be part of the cache key, and
+// then plays them back to the shaper.
+template <typename Base, typename T>
+class RecordedRunIterator : public Base {
+public:
+    explicit RecordedRunIterator(Base& iterator) {
+        while (!iterator.atEnd()) {
+            iterator.consume();
+            fEnds.push_back(iterator.endOfCurrentRun());
+            fValues.push_back(current_value(iterator));
+        }
+    }
+
+    void writeKey(SkString* key) const {
+        write_key(key, fEnds.count());
+        for (int i = 0; i < fEnds.count(); i++) {
+            write_key(key, fEnds[i]);
+            write_key(key, fValues[i]);
+        }
+    }
+
+    void consume() override { SkASSERT(!this->atEnd()); fCurrent++; }
+    size_t endOfCurrentRun() const override { return fCurrent < 0 ? 0 : fEnds[fCurrent]; }
+    bool atEnd() const override { return fCurrent + 1 == fEnds.count(); }
+
+protected:
+    const T& current() const { return fValues[fCurrent]; }
+
+private:
+    SkTDArray<size_t> fEnds;
+    SkTArray<T> fValues;
+    int fCurrent = -1;
+};
+
+class RecordedFontRunIterator final
+        : public RecordedRunIterator<SkShaper::FontRunIterator, SkFont> {
+public:
+    using RecordedRunIterator::RecordedRunIterator;
+    const SkFont& currentFont() const override { return this->current(); }
+};
+class RecordedBiDiRunIterator final
+        : public RecordedRunIterator<SkShaper::BiDiRunIterator, uint8_t> {
+public:
+    using RecordedRunIterator::RecordedRunIterator;
+    uint8_t currentLevel() const override { return this->current(); }
+};
+class RecordedScriptRunIterator final
+        : public RecordedRunIterator<SkShaper::ScriptRunIterator, SkFourByteTag> {
+public:
+    using RecordedRunIterator::RecordedRunIterator;
+    SkFourByteTag currentScript() const override { return this->current(); }
+};
+class RecordedLanguageRunIterator final
+        : public RecordedRunIterator<SkShaper::LanguageRunIterator, SkString> {
+public:
+    using RecordedRunIterator::RecordedRunIterator;
+    const char* currentLanguage() const override { return this->current().c_str(); }
+};
+
+}  // namespace
+
+// The only SkShaperCache, since only it can call SkShaperCache's constructor.
+class SkShaperCacheImpl final : public SkShaperCache {
+public:
+    explicit SkShaperCacheImpl(size_t byteLimit) : fLRU(INT_MAX), fByteLimit(byteLimit) {}
+
+    sk_sp<const ShapedText> find(const SkString& key) {
+        SkAutoMutexExclusive lock(fMutex);
+        fRequests++;
+        if (Entry* entry = fLRU.find(key)) {
+            fHits++;
+            return entry->fText;
+        }
+        fMisses++;
+        return nullptr;
+    }
+
+    void add(const SkString& key, sk_sp<const ShapedText> text) {
+        size_t bytes = key.size() + text->sizeInBytes();
+        SkAutoMutexExclusive lock(fMutex);
+        // Another thread may have shaped the same text, or it may never fit.
+        if (bytes > fByteLimit || fLRU.find(key)) {
+            return;
+        }
+        fLRU.insert(key, {std::move(text), bytes});
+        fBytesUsed += bytes;
+        fAdded++;
+        this->purgeAsNeeded();
+    }
+
+    Stats getStats() const override {
+        SkAutoMutexExclusive lock(fMutex);
+        return {fRequests, fHits, fMisses, fAdded, fEvicted, fLRU.count(), fBytesUsed,
+                fByteLimit};
+    }
+
+    size_t getByteLimit() const override {
+        SkAutoMutexExclusive lock(fMutex);
+        return fByteLimit;
+    }
+
+    void setByteLimit(size_t byteLimit) override {
+        SkAutoMutexExclusive lock(fMutex);
+        fByteLimit = byteLimit;
+        this->purgeAsNeeded();
+    }
+
+    void purgeAll() override {
+        SkAutoMutexExclusive lock(fMutex);
+        fLRU.reset();
+        fBytesUsed = 0;
+    }
+
+private:
+    struct Entry {
+        sk_sp<const ShapedText> fText;
+        size_t fSizeInBytes;
+    };
+
+    void purgeAsNeeded() SK_REQUIRES(fMutex) {
+        while (fBytesUsed > fByteLimit) {
+            Entry* entry = fLRU.peekLRU();
+            fBytesUsed -= entry->fSizeInBytes;
+            fLRU.removeLRU();
+            fEvicted++;
+        }
+    }
+
+    mutable SkMutex fMutex;
+    SkLRUCache<SkString, Entry> fLRU SK_GUARDED_BY(fMutex);
+    size_t fBytesUsed SK_GUARDED_BY(fMutex) = 0;
+    size_t fByteLimit SK_GUARDED_BY(fMutex);
+    int fRequests SK_GUARDED_BY(fMutex) = 0;
+    int fHits     SK_GUARDED_BY(fMutex) = 0;
+    int fMisses   SK_GUARDED_BY(fMutex) = 0;
+    int fAdded    SK_GUARDED_BY(fMutex) = 0;
+    int fEvicted  SK_GUARDED_BY(fMutex) = 0;
+};
+
+namespace {
+
+using ShaperCache = SkShaperCacheImpl;
+
+class SkShaperCaching : public SkShaper {
+public:
+    SkShaperCaching(std::unique_ptr<SkShaper> shaper, sk_sp<ShaperCache> cache)
+        : fShaper(std::move(shaper)), fCache(std::move(cache)) {}
+
+private:
+    void shape(const char* utf8, size_t utf8Bytes,
+               const SkFont& srcFont,
+               bool leftToRight,
+               SkScalar width,
+               RunHandler* handler) const override {
+        SkString key;
+        write_key(&key, 'S');
+        write_key(&key, leftToRight);
+        write_key(&key, srcFont);
+        write_key(&key, width);
+        key.append(utf8, utf8Bytes);
+
+        this->shapeWithCache(key, handler, [&](RunHandler* recorder) {
+            fShaper->shape(utf8, utf8Bytes, srcFont, leftToRight, width, recorder);
+        });
+    }
+
+    void shape(const char* utf8, size_t utf8Bytes,
+               FontRunIterator& font,
+               BiDiRunIterator& bidi,
+               ScriptRunIterator& script,
+               LanguageRunIterator& language,
+               SkScalar width,
+               RunHandler* handler) const override {
+        this->shape(utf8, utf8Bytes, font, bidi, script, language, nullptr, 0, width, handler);
+    }
+
+    void shape(const char* utf8, size_t utf8Bytes,
+               FontRunIterator& font,
+               BiDiRunIterator& bidi,
+               ScriptRunIterator& script,
+               LanguageRunIterator& language,
+               const Feature* features, size_t featuresSize,
+               SkScalar width,
+               RunHandler* handler) const override {
+        RecordedFontRunIterator fontRuns(font);
+        RecordedBiDiRunIterator bidiRuns(bidi);
+        RecordedScriptRunIterator scriptRuns(script);
+        RecordedLanguageRunIterator languageRuns(language);
+
+        SkString key;
+        write_key(&key, 'I');
+        fontRuns.writeKey(&key);
+        bidiRuns.writeKey(&key);
+        scriptRuns.writeKey(&key);
+        languageRuns.writeKey(&key);
+        write_key(&key, featuresSize);
+        for (size_t i = 0; i < featuresSize; i++) {
+            write_key(&key, features[i].tag);
+            write_key(&key, features[i].value);
+            write_key(&key, features[i].start);
+            write_key(&key, features[i].end);
+        }
+        write_key(&key, width);
+        key.append(utf8, utf8Bytes);
+
+        this->shapeWithCache(key, handler, [&](RunHandler* recorder) {
+            fShaper->shape(utf8, utf8Bytes, fontRuns, bidiRuns, scriptRuns, languageRuns,
+                           features, featuresSize, width, recorder);
+        });
+    }
+
+    template <typename Shape>
+    void shapeWithCache(const SkString& key, RunHandler* handler, Shape&& shape) const {
+        if (sk_sp<const ShapedText> cached = fCache->find(key)) {
+            cached->replay(handler);
+            return;
+        }
+        sk_sp<ShapedText> text = sk_make_sp<ShapedText>();
+        RecordingRunHandler recorder(text.get());
+        shape(&recorder);
+        text->replay(handler);
+        fCache->add(key, std::move(text));
+    }
+
+    std::unique_ptr<SkShaper> fShaper;
+    sk_sp<ShaperCache> fCache;
+};
+
+}  // namespace
+
+sk_sp<SkShaperCache> SkShaperCache::Make(size_t byteLimit) {
+    return sk_make_sp<ShaperCache>(byteLimit);
+}
+
+std::unique_ptr<SkShaper> SkShaper::MakeCaching(std::unique_ptr<SkShaper> shaper,
+                                                sk_sp<SkShaperCache> cache) {
+    if (!shaper || !cache) {
+        return shaper;
+    }
+    // SkShaperCache's constructor is private, so every SkShaperCache is a ShaperCache.
+    return std::make_unique<SkShaperCaching>(
+            std::move(shaper), sk_sp<ShaperCache>(static_cast<ShaperCache*>(cache.release())));
+}
@@ -9,5 +9,5 @@
 #include "src/core/SkRTree.h"
 
 sk_sp<SkBBoxHierarchy> SkRTreeFactory::operator()() const {
-    return sk_make_sp<SkRTree>();
+    return sk_make_sp<SkRTree>(fPacking);
 }
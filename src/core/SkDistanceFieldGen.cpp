@@ -10,8 +10,11 @@
 #include "src/core/SkAutoMalloc.h"
 #include "src/core/SkDistanceFieldGen.h"
 #include "src/core/SkMask.h"
+#include "src/core/SkOpts.h"
 #include "src/core/SkPointPriv.h"
+#include "src/core/SkTaskGroup.h"
 
+#include <atomic>
 #include <utility>
 
 struct DFData {
@@ -198,123 +201,72 @@ static void init_distances(DFData* data, unsigned char* edges, int width, int he
 
 // Danielsson's 8SSEDT
 
+// The passes work on planes: the squared distances to the nearest (so far) edge texels, then
+// the x and then the y components of the vectors to them, each 'stride' floats apart. That way
+// SkOpts::distance_field_nearest_row() can try the neighbors above or below several texels at
+// once.
+
 // first stage forward pass
 // (forward in Y, forward in X)
-static void F1(DFData* curr, int width) {
-    // upper left
-    DFData* check = curr - width-1;
-    SkPoint distVec = check->fDistVector;
-    float distSq = check->fDistSq - 2.0f*(distVec.fX + distVec.fY - 1.0f);
-    if (distSq < curr->fDistSq) {
-        distVec.fX -= 1.0f;
-        distVec.fY -= 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
-    }
-
-    // up
-    check = curr - width;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq - 2.0f*distVec.fY + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fY -= 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
-    }
-
-    // upper right
-    check = curr - width+1;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq + 2.0f*(distVec.fX - distVec.fY + 1.0f);
-    if (distSq < curr->fDistSq) {
-        distVec.fX += 1.0f;
-        distVec.fY -= 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
-    }
-
+// The upper left, up and upper right neighbors only depend on the row above, so
+// SkOpts::distance_field_nearest_row() has already tried them for the whole row.
+static void F1(float* curr, int stride) {
     // left
-    check = curr - 1;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq - 2.0f*distVec.fX + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fX -= 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
+    const float* check = curr - 1;
+    float distSq = check[0] - 2.0f*check[stride] + 1.0f;
+    if (distSq < curr[0]) {
+        curr[0] = distSq;
+        curr[stride] = check[stride] - 1.0f;
+        curr[2*stride] = check[2*stride];
     }
 }
 
 // second stage forward pass
 // (forward in Y, backward in X)
-static void F2(DFData* curr, int width) {
+static void F2(float* curr, int stride) {
     // right
-    DFData* check = curr + 1;
-    SkPoint distVec = check->fDistVector;
-    float distSq = check->fDistSq + 2.0f*distVec.fX + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fX += 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
+    const float* check = curr + 1;
+    float distSq = check[0] + 2.0f*check[stride] + 1.0f;
+    if (distSq < curr[0]) {
+        curr[0] = distSq;
+        curr[stride] = check[stride] + 1.0f;
+        curr[2*stride] = check[2*stride];
     }
 }
 
 // first stage backward pass
 // (backward in Y, forward in X)
-static void B1(DFData* curr, int width) {
+static void B1(float* curr, int stride) {
     // left
-    DFData* check = curr - 1;
-    SkPoint distVec = check->fDistVector;
-    float distSq = check->fDistSq - 2.0f*distVec.fX + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fX -= 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
+    const float* check = curr - 1;
+    float distSq = check[0] - 2.0f*check[stride] + 1.0f;
+    if (distSq < curr[0]) {
+        curr[0] = distSq;
+        curr[stride] = check[stride] - 1.0f;
+        curr[2*stride] = check[2*stride];
     }
 }
 
 // second stage backward pass
 // (backward in Y, backwards in X)
-static void B2(DFData* curr, int width) {
+// 'below' is the nearest of the bottom left, bottom and bottom right neighbors, found for the
+// whole row by SkOpts::distance_field_nearest_row(). Taking it only if it is nearer than what
+// the right neighbor gave is the same as trying the three of them in turn.
+static void B2(float* curr, const float* below, int stride) {
     // right
-    DFData* check = curr + 1;
-    SkPoint distVec = check->fDistVector;
-    float distSq = check->fDistSq + 2.0f*distVec.fX + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fX += 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
+    const float* check = curr + 1;
+    float distSq = check[0] + 2.0f*check[stride] + 1.0f;
+    if (distSq < curr[0]) {
+        curr[0] = distSq;
+        curr[stride] = check[stride] + 1.0f;
+        curr[2*stride] = check[2*stride];
     }
 
-    // bottom left
-    check = curr + width-1;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq - 2.0f*(distVec.fX - distVec.fY - 1.0f);
-    if (distSq < curr->fDistSq) {
-        distVec.fX -= 1.0f;
-        distVec.fY += 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
-    }
-
-    // bottom
-    check = curr + width;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq + 2.0f*distVec.fY + 1.0f;
-    if (distSq < curr->fDistSq) {
-        distVec.fY += 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
-    }
-
-    // bottom right
-    check = curr + width+1;
-    distVec = check->fDistVector;
-    distSq = check->fDistSq + 2.0f*(distVec.fX + distVec.fY + 1.0f);
-    if (distSq < curr->fDistSq) {
-        distVec.fX += 1.0f;
-        distVec.fY += 1.0f;
-        curr->fDistSq = distSq;
-        curr->fDistVector = distVec;
+    // bottom left, bottom and bottom right
+    if (below[0] < curr[0]) {
+        curr[0] = below[0];
+        curr[stride] = below[stride];
+        curr[2*stride] = below[2*stride];
     }
 }
 
@@ -368,70 +320,92 @@ static bool generate_distance_field_from_image(unsigned char* distanceField,
     // create initial distance data, particularly at edges
     init_distances(dataPtr, edgePtr, dataWidth, dataHeight);
 
+    // split the distances into planes, each with an extra row for the nearest neighbors below
+    int stride = dataWidth*(dataHeight + 1);
+    SkAutoTMalloc<float> planes(3*stride);
+    float* distPtr = planes.get();
+    float* belowPtr = distPtr + dataWidth*dataHeight;
+    for (int i = 0; i < dataWidth*dataHeight; ++i) {
+        distPtr[i] = dataPtr[i].fDistSq;
+        distPtr[i + stride] = dataPtr[i].fDistVector.fX;
+        distPtr[i + 2*stride] = dataPtr[i].fDistVector.fY;
+    }
+
     // now perform Euclidean distance transform to propagate distances
 
     // forwards in y
-    DFData* currData = dataPtr+dataWidth+1; // skip outer buffer
+    float* currDist = distPtr+dataWidth+1; // skip outer buffer
     unsigned char* currEdge = edgePtr+dataWidth+1;
     for (int j = 1; j < dataHeight-1; ++j) {
+        SkOpts::distance_field_nearest_row(currDist, currDist - dataWidth, currEdge,
+                                           dataWidth-2, stride, -1.0f);
+
         // forwards in x
         for (int i = 1; i < dataWidth-1; ++i) {
             // don't need to calculate distance for edge pixels
             if (!*currEdge) {
-                F1(currData, dataWidth);
+                F1(currDist, stride);
             }
-            ++currData;
+            ++currDist;
             ++currEdge;
         }
 
         // backwards in x
-        --currData; // reset to end
+        --currDist; // reset to end
         --currEdge;
         for (int i = 1; i < dataWidth-1; ++i) {
             // don't need to calculate distance for edge pixels
             if (!*currEdge) {
-                F2(currData, dataWidth);
+                F2(currDist, stride);
             }
-            --currData;
+            --currDist;
             --currEdge;
         }
 
-        currData += dataWidth+1;
+        currDist += dataWidth+1;
         currEdge += dataWidth+1;
     }
 
     // backwards in y
-    currData = dataPtr+dataWidth*(dataHeight-2) - 1; // skip outer buffer
+    currDist = distPtr+dataWidth*(dataHeight-2) - 1; // skip outer buffer
     currEdge = edgePtr+dataWidth*(dataHeight-2) - 1;
     for (int j = 1; j < dataHeight-1; ++j) {
+        // Start each pixel of the row as "far away", then find the nearest neighbor below.
+        for (int i = 1; i < dataWidth-1; ++i) {
+            belowPtr[i] = 2000000.f;
+        }
+        SkOpts::distance_field_nearest_row(belowPtr + 1, currDist + dataWidth, currEdge,
+                                           dataWidth-2, stride, 1.0f);
+
         // forwards in x
         for (int i = 1; i < dataWidth-1; ++i) {
             // don't need to calculate distance for edge pixels
             if (!*currEdge) {
-                B1(currData, dataWidth);
+                B1(currDist, stride);
             }
-            ++currData;
+            ++currDist;
             ++currEdge;
         }
 
         // backwards in x
-        --currData; // reset to end
+        --currDist; // reset to end
         --currEdge;
-        for (int i = 1; i < dataWidth-1; ++i) {
+        for (int i = dataWidth-2; i > 0; --i) {
             // don't need to calculate distance for edge pixels
             if (!*currEdge) {
-                B2(currData, dataWidth);
+                B2(currDist, belowPtr + i, stride);
             }
-            --currData;
+            --currDist;
             --currEdge;
         }
 
-        currData -= dataWidth-1;
+        currDist -= dataWidth-1;
         currEdge -= dataWidth-1;
     }
 
     // copy results to final distance field data
-    currData = dataPtr + dataWidth+1;
+    DFData* currData = dataPtr + dataWidth+1;
+    currDist = distPtr + dataWidth+1;
     currEdge = edgePtr + dataWidth+1;
     unsigned char *dfPtr = distanceField;
     for (int j = 1; j < dataHeight-1; ++j) {
@@ -449,16 +423,18 @@ static bool generate_distance_field_from_image(unsigned char* distanceField,
 #else
             float dist;
             if (currData->fAlpha > 0.5f) {
-                dist = -SkScalarSqrt(currData->fDistSq);
+                dist = -SkScalarSqrt(*currDist);
             } else {
-                dist = SkScalarSqrt(currData->fDistSq);
+                dist = SkScalarSqrt(*currDist);
             }
             *dfPtr++ = pack_distance_field_val<SK_DistanceFieldMagnitude>(dist);
 #endif
             ++currData;
+            ++currDist;
             ++currEdge;
         }
         currData += 2;
+        currDist += 2;
         currEdge += 2;
     }
 
@@ -560,3 +536,37 @@ bool SkGenerateDistanceFieldFromBWImage(unsigned char* distanceField,
 
     return generate_distance_field_from_image(distanceField, copyPtr, width, height);
 }
+
+static bool generate_distance_field(const SkDistanceFieldJob& job) {
+    switch (job.fFormat) {
+        case SkMask::kA8_Format:
+            return SkGenerateDistanceFieldFromA8Image(job.fDistanceField, job.fImage,
+                                                      job.fWidth, job.fHeight, job.fRowBytes);
+        case SkMask::kLCD16_Format:
+            return SkGenerateDistanceFieldFromLCD16Mask(job.fDistanceField, job.fImage,
+                                                        job.fWidth, job.fHeight, job.fRowBytes);
+        case SkMask::kBW_Format:
+            return SkGenerateDistanceFieldFromBWImage(job.fDistanceField, job.fImage,
+                                                      job.fWidth, job.fHeight, job.fRowBytes);
+        default:
+            return false;
+    }
+}
+
+bool SkGenerateDistanceFields(SkSpan<const SkDistanceFieldJob> jobs, SkExecutor* executor) {
+    if (!executor || jobs.size() < 2) {
+        bool succeeded = true;
+        for (const SkDistanceFieldJob& job : jobs) {
+            succeeded &= generate_distance_field(job);
+        }
+        return succeeded;
+    }
+
+    std::atomic<bool> succeeded{true};
+    SkTaskGroup(*executor).batch(SkToInt(jobs.size()), [&](int i) {
+        if (!generate_distance_field(jobs[i])) {
+            succeeded.store(false, std::memory_order_relaxed);
+        }
+    });
+    return succeeded.load(std::memory_order_relaxed);
+}
@@ -8,6 +8,10 @@
 #define SkDistanceFieldGen_DEFINED
 
 #include "include/core/SkTypes.h"
+#include "src/core/SkMask.h"
+#include "src/core/SkSpan.h"
+
+class SkExecutor;
 
 // the max magnitude for the distance field
 // distance values are limited to the range (-SK_DistanceFieldMagnitude, SK_DistanceFieldMagnitude]
@@ -64,6 +68,25 @@ bool SkGenerateDistanceFieldFromBWImage(unsigned char* distanceField,
                                         const unsigned char* image,
                                         int w, int h, size_t rowBytes);
 
+/** One mask to generate a distance field for with SkGenerateDistanceFields(). */
+struct SkDistanceFieldJob {
+    unsigned char*       fDistanceField;  // allocated by the client with the padding above
+    const unsigned char* fImage;
+    int                  fWidth;
+    int                  fHeight;
+    size_t               fRowBytes;
+    SkMask::Format       fFormat;         // kA8_Format, kLCD16_Format or kBW_Format
+};
+
+/** Generate the distance fields for a batch of masks, such as the glyphs of a run
+
+ *  @param jobs              The masks and the distance fields to generate for them.
+ *  @param executor          If not null, the jobs are spread across its threads. The call
+ *                           still returns only when every distance field is done.
+ *  @return                  false if any of the distance fields could not be generated.
+ */
+bool SkGenerateDistanceFields(SkSpan<const SkDistanceFieldJob> jobs, SkExecutor* executor);
+
 /** Given width and height of original image, return size (in bytes) of distance field
  *  @param w                 Width of the original image.
  *  @param h                 Height of the original image.
@@ -0,0 +1,362 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/core/SkDynamicBBH.h"
+
+#include <algorithm>
+
+static SkRect join(const SkRect& a, const SkRect& b) {
+    SkRect r = a;
+    r.join(b);
+    return r;
+}
+
+// Half the perimeter, the 2D analogue of the surface area heuristic.
+static float cost(const SkRect& r) {
+    return r.width() + r.height();
+}
+
+void SkDynamicBBH::insert(const SkRect boxes[], int N) {
+    SkASSERT(N >= 0);
+    if (fRoot >= 0) {
+        fBoxes.reserve(fBoxes.size() + N);
+        for (int i = 0; i < N; i++) {
+            this->append(boxes[i]);
+        }
+        return;
+    }
+
+    // Into an empty tree, the boxes are loaded all at once, top down.
+    std::vector<Leaf> leaves;
+    leaves.reserve(N);
+    fNodes.reserve(2 * N);
+    for (int i = 0; i < N; i++) {
+        int index = (int)fBoxes.size();
+        fBoxes.push_back({-1, boxes[i]});
+        if (!boxes[i].isEmpty()) {
+            int leaf = this->allocateLeaf(index, boxes[i]);
+            fBoxes[index].fLeaf = leaf;
+            leaves.push_back({{boxes[i].centerX(), boxes[i].centerY()}, leaf});
+        }
+    }
+    if (!leaves.empty()) {
+        fRoot = this->bulkLoad(leaves.data(), (int)leaves.size());
+        fNodes[fRoot].fParent = -1;
+    }
+}
+
+int SkDynamicBBH::bulkLoad(Leaf leaves[], int count) {
+    if (count == 1) {
+        return leaves[0].fNode;
+    }
+
+    // Split the leaves in half at the median of their centers, along the axis they spread most.
+    SkRect centers;
+    centers.setBounds(&leaves[0].fCenter, 1);
+    for (int i = 1; i < count; i++) {
+        const SkPoint& c = leaves[i].fCenter;
+        centers.fLeft   = std::min(centers.fLeft,   c.fX);
+        centers.fTop    = std::min(centers.fTop,    c.fY);
+        centers.fRight  = std::max(centers.fRight,  c.fX);
+        centers.fBottom = std::max(centers.fBottom, c.fY);
+    }
+    int half = count / 2;
+    if (centers.width() >= centers.height()) {
+        std::nth_element(leaves, leaves + half, leaves + count, [](const Leaf& a, const Leaf& b) {
+            return a.fCenter.fX < b.fCenter.fX;
+        });
+    } else {
+        std::nth_element(leaves, leaves + half, leaves + count, [](const Leaf& a, const Leaf& b) {
+            return a.fCenter.fY < b.fCenter.fY;
+        });
+    }
+
+    int node = this->allocateNode();
+    int a = this->bulkLoad(leaves, half),
+        b = this->bulkLoad(leaves + half, count - half);
+    Node& n = fNodes[node];
+    n.fChildren[0] = a;
+    n.fChildren[1] = b;
+    n.fBounds = join(fNodes[a].fBounds, fNodes[b].fBounds);
+    n.fHeight = 1 + std::max(fNodes[a].fHeight, fNodes[b].fHeight);
+    fNodes[a].fParent = fNodes[b].fParent = node;
+    return node;
+}
+
+int SkDynamicBBH::append(const SkRect& bounds) {
+    int index = (int)fBoxes.size();
+    fBoxes.push_back({-1, SkRect::MakeEmpty()});
+    this->update(index, bounds);
+    return index;
+}
+
+void SkDynamicBBH::update(int index, const SkRect& bounds) {
+    SkASSERT(0 <= index && index < this->getCount());
+    Box& box = fBoxes[index];
+    SkRect leafBounds = bounds;
+    if (box.fLeaf >= 0) {
+        if (!bounds.isEmpty() && fNodes[box.fLeaf].fBounds.contains(bounds)) {
+            // The tree still covers the box where it is.
+            box.fBounds = bounds;
+            return;
+        }
+
+        // A box that has moved is likely to move again, so give it as much room to move
+        // again as it just moved, and it won't have to move in the tree every time.
+        float dx = SkScalarAbs(bounds.centerX() - box.fBounds.centerX()),
+              dy = SkScalarAbs(bounds.centerY() - box.fBounds.centerY());
+        leafBounds.outset(dx, dy);
+
+        int parent = fNodes[box.fLeaf].fParent;
+        if (!bounds.isEmpty() && parent >= 0 && fNodes[parent].fBounds.contains(leafBounds)) {
+            // A box that moves within its parent can stay where it is in the tree. Its
+            // ancestors may only shrink.
+            box.fBounds = bounds;
+            fNodes[box.fLeaf].fBounds = leafBounds;
+            this->refitAncestors(parent);
+            return;
+        }
+        this->removeLeaf(box.fLeaf);
+        this->freeNode(box.fLeaf);
+        box.fLeaf = -1;
+    }
+    box.fBounds = bounds;
+    if (bounds.isEmpty()) {
+        return;
+    }
+    int leaf = this->allocateLeaf(index, leafBounds);
+    this->insertLeaf(leaf);
+    fBoxes[index].fLeaf = leaf;
+}
+
+int SkDynamicBBH::allocateLeaf(int index, const SkRect& bounds) {
+    int leaf = this->allocateNode();
+    fNodes[leaf].fBounds = bounds;
+    fNodes[leaf].fHeight = 0;
+    fNodes[leaf].fIndex = index;
+    return leaf;
+}
+
+int SkDynamicBBH::allocateNode() {
+    int node = fFreeList;
+    if (node >= 0) {
+        fFreeList = fNodes[node].fParent;
+    } else {
+        node = (int)fNodes.size();
+        fNodes.emplace_back();
+    }
+    fNodes[node].fParent = -1;
+    fNodes[node].fChildren[0] = fNodes[node].fChildren[1] = -1;
+    return node;
+}
+
+void SkDynamicBBH::freeNode(int node) {
+    fNodes[node].fHeight = -1;
+    fNodes[node].fParent = fFreeList;
+    fFreeList = node;
+}
+
+void SkDynamicBBH::insertLeaf(int leaf) {
+    if (fRoot < 0) {
+        fRoot = leaf;
+        fNodes[leaf].fParent = -1;
+        return;
+    }
+
+    // Walk down to the best sibling for the leaf. Every node above the sibling grows to cover
+    // the leaf, so that growth is paid on the way down, and a child is only worth descending
+    // into if pairing with it costs less than pairing with the node we're at.
+    const SkRect bounds = fNodes[leaf].fBounds;
+    int sibling = fRoot;
+    while (!fNodes[sibling].isLeaf()) {
+        const Node& node = fNodes[sibling];
+        float combined = cost(join(node.fBounds, bounds));
+        float here = 2 * combined;
+        float inherited = 2 * (combined - cost(node.fBounds));
+
+        float childCost[2];
+        for (int i = 0; i < 2; i++) {
+            const Node& child = fNodes[node.fChildren[i]];
+            float grown = cost(join(child.fBounds, bounds));
+            childCost[i] = inherited + (child.isLeaf() ? grown : grown - cost(child.fBounds));
+        }
+        if (here < childCost[0] && here < childCost[1]) {
+            break;
+        }
+        sibling = node.fChildren[childCost[0] < childCost[1] ? 0 : 1];
+    }
+
+    // Give the sibling and the leaf a new parent, in the sibling's place.
+    int oldParent = fNodes[sibling].fParent;
+    int parent = this->allocateNode();
+    fNodes[parent].fParent = oldParent;
+    fNodes[parent].fBounds = join(fNodes[sibling].fBounds, bounds);
+    fNodes[parent].fHeight = fNodes[sibling].fHeight + 1;
+    fNodes[parent].fChildren[0] = sibling;
+    fNodes[parent].fChildren[1] = leaf;
+    fNodes[sibling].fParent = parent;
+    fNodes[leaf].fParent = parent;
+    if (oldParent < 0) {
+        fRoot = parent;
+    } else {
+        Node& p = fNodes[oldParent];
+        p.fChildren[p.fChildren[0] == sibling ? 0 : 1] = parent;
+    }
+
+    int top = this->balance(parent);
+    this->refitAncestors(fNodes[top].fParent);
+}
+
+void SkDynamicBBH::removeLeaf(int leaf) {
+    if (leaf == fRoot) {
+        fRoot = -1;
+        return;
+    }
+
+    // The leaf's sibling takes the place of their parent.
+    int parent = fNodes[leaf].fParent;
+    int grandParent = fNodes[parent].fParent;
+    int sibling = fNodes[parent].fChildren[fNodes[parent].fChildren[0] == leaf ? 1 : 0];
+    fNodes[sibling].fParent = grandParent;
+    this->freeNode(parent);
+    if (grandParent < 0) {
+        fRoot = sibling;
+    } else {
+        Node& g = fNodes[grandParent];
+        g.fChildren[g.fChildren[0] == parent ? 0 : 1] = sibling;
+        this->refitAncestors(grandParent);
+    }
+}
+
+void SkDynamicBBH::refitAncestors(int node) {
+    while (node >= 0) {
+        int balanced = this->balance(node);
+        Node& n = fNodes[balanced];
+        const Node& a = fNodes[n.fChildren[0]];
+        const Node& b = fNodes[n.fChildren[1]];
+        SkRect bounds = join(a.fBounds, b.fBounds);
+        int height = 1 + std::max(a.fHeight, b.fHeight);
+        if (balanced == node && bounds == n.fBounds && height == n.fHeight) {
+            // Nothing above here changes either.
+            return;
+        }
+        n.fBounds = bounds;
+        n.fHeight = height;
+        node = n.fParent;
+    }
+}
+
+int SkDynamicBBH::balance(int a) {
+    if (fNodes[a].isLeaf() || fNodes[a].fHeight < 2) {
+        return a;
+    }
+    int left = fNodes[a].fChildren[0],
+        right = fNodes[a].fChildren[1];
+    int difference = fNodes[right].fHeight - fNodes[left].fHeight;
+    if (-1 <= difference && difference <= 1) {
+        return a;
+    }
+
+    // c, the taller child of a, takes a's place, and a takes c's shorter child in exchange for c.
+    int slot = difference > 0 ? 1 : 0;
+    int c = fNodes[a].fChildren[slot];
+    int b = fNodes[a].fChildren[1 - slot];
+    int f = fNodes[c].fChildren[0],
+        g = fNodes[c].fChildren[1];
+    if (fNodes[f].fHeight > fNodes[g].fHeight) {
+        std::swap(f, g);
+    }
+    // Now f is c's shorter child, which moves to a, and g stays with c.
+
+    int parent = fNodes[a].fParent;
+    fNodes[c].fParent = parent;
+    if (parent < 0) {
+        fRoot = c;
+    } else {
+        Node& p = fNodes[parent];
+        p.fChildren[p.fChildren[0] == a ? 0 : 1] = c;
+    }
+
+    fNodes[c].fChildren[0] = a;
+    fNodes[c].fChildren[1] = g;
+    fNodes[a].fParent = c;
+    fNodes[a].fChildren[slot] = f;
+    fNodes[f].fParent = a;
+
+    fNodes[a].fBounds = join(fNodes[b].fBounds, fNodes[f].fBounds);
+    fNodes[a].fHeight = 1 + std::max(fNodes[b].fHeight, fNodes[f].fHeight);
+    fNodes[c].fBounds = join(fNodes[a].fBounds, fNodes[g].fBounds);
+    fNodes[c].fHeight = 1 + std::max(fNodes[a].fHeight, fNodes[g].fHeight);
+    return c;
+}
+
+void SkDynamicBBH::search(const SkRect& query, std::vector<int>* results) const {
+    if (fRoot < 0) {
+        return;
+    }
+    size_t first = results->size();
+    // The tree is balanced, so a small fixed stack covers any tree that fits in memory.
+    int stack[128];
+    int depth = 0;
+    stack[depth++] = fRoot;
+    while (depth > 0) {
+        const Node& node = fNodes[stack[--depth]];
+        if (!SkRect::Intersects(node.fBounds, query)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            // The leaf may have room around its box, so check the box itself too.
+            if (SkRect::Intersects(fBoxes[node.fIndex].fBounds, query)) {
+                results->push_back(node.fIndex);
+            }
+        } else {
+            SkASSERT(depth + 2 <= (int)SK_ARRAY_COUNT(stack));
+            stack[depth++] = node.fChildren[1];
+            stack[depth++] = node.fChildren[0];
+        }
+    }
+    std::sort(results->begin() + first, results->end());
+}
+
+size_t SkDynamicBBH::bytesUsed() const {
+    return sizeof(*this)
+         + fNodes.capacity() * sizeof(Node)
+         + fBoxes.capacity() * sizeof(Box);
+}
+
+int SkDynamicBBH::validate(int node, int parent) const {
+    const Node& n = fNodes[node];
+    if (n.fParent != parent || n.fHeight < 0) {
+        return -1;
+    }
+    if (n.isLeaf()) {
+        const Box& box = fBoxes[n.fIndex];
+        return box.fLeaf == node && n.fBounds.contains(box.fBounds) ? 0 : -1;
+    }
+    int a = this->validate(n.fChildren[0], node),
+        b = this->validate(n.fChildren[1], node);
+    if (a < 0 || b < 0 || std::abs(a - b) > 1 || n.fHeight != 1 + std::max(a, b) ||
+        n.fBounds != join(fNodes[n.fChildren[0]].fBounds, fNodes[n.fChildren[1]].fBounds)) {
+        return -1;
+    }
+    return n.fHeight;
+}
+
+bool SkDynamicBBH::isValid() const {
+    int leaves = 0;
+    for (const Box& box : fBoxes) {
+        leaves += box.fLeaf >= 0;
+    }
+    // A tree of L leaves has L - 1 inner nodes, and every other node is free.
+    int free = 0;
+    for (int node = fFreeList; node >= 0; node = fNodes[node].fParent) {
+        free++;
+    }
+    int used = leaves ? 2 * leaves - 1 : 0;
+    return (fRoot < 0 || this->validate(fRoot, -1) >= 0) &&
+           used + free == (int)fNodes.size();
+}
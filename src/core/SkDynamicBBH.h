@@ -0,0 +1,116 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkDynamicBBH_DEFINED
+#define SkDynamicBBH_DEFINED
+
+#include "include/core/SkBBHFactory.h"
+#include "include/core/SkRect.h"
+
+#include <vector>
+
+/**
+ * A bounding box hierarchy whose boxes can be moved, removed and added one at a time, for
+ * retained scenes that change a few elements per frame. SkRTree has to be rebuilt from all of
+ * its boxes instead.
+ *
+ * It is a binary tree of bounding boxes, with a leaf for each box. A box is added by walking
+ * down to the sibling that grows the perimeters of its new ancestors the least, and each node
+ * on the way back up is rotated if one of its subtrees has become more than one level taller
+ * than the other, as in an AVL tree. Adding, moving or removing a box therefore costs
+ * O(log N), and the tree stays balanced however the boxes move. Boxes inserted into an empty
+ * tree are instead loaded all at once, by splitting them in half recursively.
+ *
+ * A box that moves is given as much room around it in its leaf as it just moved, so that a box
+ * moving steadily only has to move in the tree now and then. Searches check the box itself.
+ *
+ * For more details see:
+ *
+ *  Catto, E. (2019). "Dynamic Bounding Volume Hierarchies", Game Developers Conference.
+ *
+ * Searching visits more nodes than searching an SkRTree of the same boxes, so pictures that
+ * never change are better off with SkRTree.
+ */
+class SkDynamicBBH : public SkBBoxHierarchy {
+public:
+    SkDynamicBBH() = default;
+
+    // Adds N boxes, numbered after the boxes already added. As with SkRTree, empty boxes are
+    // numbered, but never found.
+    void insert(const SkRect[], int N) override;
+    // Results are sorted, as for SkRTree.
+    void search(const SkRect& query, std::vector<int>* results) const override;
+    size_t bytesUsed() const override;
+
+    // Adds a box, and returns its index.
+    int append(const SkRect& bounds);
+
+    // Moves the box at index to new bounds. Moving it to empty bounds hides it from searches.
+    void update(int index, const SkRect& bounds);
+
+    // Hides the box at index from searches, until it is updated to non-empty bounds. Its index
+    // is not reused.
+    void remove(int index) { this->update(index, SkRect::MakeEmpty()); }
+
+    // The number of indices handed out, including those of empty or removed boxes.
+    int getCount() const { return (int)fBoxes.size(); }
+
+    // Methods below here are only public for tests.
+
+    // Return the height of the tree: 0 when empty, 1 for a single box.
+    int getHeight() const { return fRoot < 0 ? 0 : fNodes[fRoot].fHeight + 1; }
+
+    // Checks the links, bounds and balance of every node.
+    bool isValid() const;
+
+private:
+    struct Node {
+        SkRect fBounds;
+        int fParent;     // or the next free node, when this one is free
+        int fChildren[2];
+        int fHeight;     // 0 for leaves, -1 for free nodes
+        int fIndex;      // the box of a leaf
+
+        bool isLeaf() const { return fHeight == 0; }
+    };
+
+    struct Box {
+        int    fLeaf;    // the leaf node of the box, or -1 when it's empty
+        SkRect fBounds;  // within the bounds of its leaf
+    };
+
+    int allocateNode();
+    int allocateLeaf(int index, const SkRect& bounds);
+    void freeNode(int node);
+
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+
+    struct Leaf {
+        SkPoint fCenter;
+        int     fNode;
+    };
+
+    // Builds a subtree of the leaves, reordering them, and returns its root.
+    int bulkLoad(Leaf leaves[], int count);
+
+    // Rebalances and refits the nodes from node towards the root, until one doesn't change.
+    void refitAncestors(int node);
+
+    // Rotates the taller subtree of node above it, if the node is out of balance, and returns
+    // the root of the subtree that replaces it.
+    int balance(int node);
+
+    int validate(int node, int parent) const;
+
+    std::vector<Node> fNodes;
+    std::vector<Box>  fBoxes;
+    int fRoot = -1;
+    int fFreeList = -1;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "src/core/SkGeometry.h"
 #include "src/core/SkImageFilter_Base.h"
 #include "src/core/SkOpts.h"
+#include "src/core/SkPersistentStrikeCache.h"
 #include "src/core/SkResourceCache.h"
 #include "src/core/SkScalerContext.h"
 #include "src/core/SkStrikeCache.h"
@@ -132,3 +133,19 @@ void SkGraphics::PurgeFontCache() {
     SkStrikeCache::GlobalStrikeCache()->purgeAll();
     SkTypefaceCache::PurgeAll();
 }
+
+bool SkGraphics::SetFontCacheFile(const char path[]) {
+    sk_sp<SkPersistentStrikeCache> persistentCache =
+            path ? SkPersistentStrikeCache::MakeFromFile(path) : nullptr;
+    bool success = persistentCache != nullptr;
+    SkStrikeCache::GlobalStrikeCache()->setPersistentCache(std::move(persistentCache));
+    return success;
+}
+
+bool SkGraphics::WriteFontCacheFile(const char path[]) {
+    return SkPersistentStrikeCache::Write(SkStrikeCache::GlobalStrikeCache(), path);
+}
+
+void SkGraphics::SetFontCacheExecutor(SkExecutor* executor) {
+    SkStrikeCache::GlobalStrikeCache()->setRasterExecutor(executor);
+}
@@ -66,6 +66,11 @@ namespace SkOpts {
     extern void (*S32_alpha_D32_filter_DXDY)(const SkBitmapProcState&,
                                              const uint32_t* xy, int count, SkPMColor*);
 
+    // SkDistanceFieldGen's nearest edge search, for a row of pixels against the row above or below.
+    extern void (*distance_field_nearest_row)(float dst[], const float src[],
+                                              const uint8_t edges[], int count, int stride,
+                                              float dy);
+
 #define M(st) +1
     // We can't necessarily express the type of SkJumper stage functions here,
     // so we just use this void(*)(void) as a stand-in.
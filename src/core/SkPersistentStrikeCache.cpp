@@ -0,0 +1,361 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/core/SkPersistentStrikeCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "include/core/SkFontArguments.h"
+#include "include/core/SkMilestone.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkStream.h"
+#include "include/core/SkString.h"
+#include "include/core/SkTypeface.h"
+#include "include/private/SkTemplates.h"
+#include "src/core/SkGlyph.h"
+#include "src/core/SkOpts.h"
+#include "src/core/SkScalerCache.h"
+#include "src/core/SkStrikeSerialization.h"
+
+// The data starts with a Header, then Header::fStrikeCount IndexEntries sorted by typeface key
+// and descriptor checksum, then the strikes. Each strike is
+//     uint64_t             typeface key
+//     descriptor           with a font ID of 0
+//     uint64_t             glyph count
+//     glyph count x
+//         SkPackedGlyphID, advances, bounds, mask format, force BW and GlyphFlags
+//         image            if kHasImage
+//         uint64_t, path   if kHasPath
+static constexpr uint32_t kMagic = SkSetFourByteTag('s', 'k', 's', 'c');
+static constexpr uint32_t kVersion = 1;
+
+namespace {
+struct Header {
+    uint32_t fMagic;
+    uint32_t fVersion;
+    uint32_t fMilestone;
+    uint32_t fStrikeCount;
+};
+
+enum GlyphFlags : uint8_t {
+    kHasImage  = 1 << 0,
+    kPathIsSet = 1 << 1,  // The scaler context was asked for a path, ...
+    kHasPath   = 1 << 2,  // ... and it had one.
+};
+}  // namespace
+
+struct SkPersistentStrikeCache::IndexEntry {
+    uint64_t fTypefaceKey;
+    uint32_t fDescChecksum;
+    uint32_t fPad;
+    uint64_t fOffset;
+    uint64_t fSize;
+
+    bool operator<(const IndexEntry& that) const {
+        return fTypefaceKey < that.fTypefaceKey ||
+               (fTypefaceKey == that.fTypefaceKey && fDescChecksum < that.fDescChecksum);
+    }
+};
+
+static constexpr size_t kStrikeAlignment = 8;
+
+SkPersistentStrikeCache::SkPersistentStrikeCache(sk_sp<SkData> data,
+                                                 const IndexEntry* index,
+                                                 int strikeCount)
+        : fData{std::move(data)}
+        , fIndex{index}
+        , fStrikeCount{strikeCount} {}
+
+sk_sp<SkPersistentStrikeCache> SkPersistentStrikeCache::Make(sk_sp<SkData> data) {
+    if (!data || data->size() < sizeof(Header) ||
+        !SkIsAlign8(reinterpret_cast<uintptr_t>(data->data()))) {
+        return nullptr;
+    }
+
+    Header header;
+    memcpy(&header, data->data(), sizeof(Header));
+    if (header.fMagic != kMagic ||
+        header.fVersion != kVersion ||
+        header.fMilestone != SK_MILESTONE ||
+        header.fStrikeCount > (data->size() - sizeof(Header)) / sizeof(IndexEntry)) {
+        return nullptr;
+    }
+
+    auto index = reinterpret_cast<const IndexEntry*>(data->bytes() + sizeof(Header));
+    return sk_sp<SkPersistentStrikeCache>(
+            new SkPersistentStrikeCache(std::move(data), index, SkToInt(header.fStrikeCount)));
+}
+
+sk_sp<SkPersistentStrikeCache> SkPersistentStrikeCache::MakeFromFile(const char path[]) {
+    return Make(SkData::MakeFromFileName(path));
+}
+
+uint64_t SkPersistentStrikeCache::TypefaceKey(const SkTypeface& typeface) {
+    static constexpr SkFontTableTag kHeadTag = SkSetFourByteTag('h', 'e', 'a', 'd');
+    size_t headSize = typeface.getTableSize(kHeadTag);
+    if (headSize == 0) {
+        return 0;
+    }
+
+    std::vector<uint8_t> bytes;
+    Serializer serializer(&bytes);
+    if (typeface.getTableData(kHeadTag, 0, headSize, serializer.allocate(headSize, 4))
+            != headSize) {
+        return 0;
+    }
+
+    SkString familyName;
+    typeface.getFamilyName(&familyName);
+    serializer.write<uint64_t>(familyName.size());
+    memcpy(serializer.allocate(familyName.size(), 1), familyName.c_str(), familyName.size());
+
+    SkFontStyle style = typeface.fontStyle();
+    serializer.write<int32_t>(style.weight());
+    serializer.write<int32_t>(style.width());
+    serializer.write<int32_t>(style.slant());
+    serializer.write<int32_t>(typeface.countGlyphs());
+
+    using Coordinate = SkFontArguments::VariationPosition::Coordinate;
+    int axisCount = typeface.getVariationDesignPosition(nullptr, 0);
+    if (axisCount > 0) {
+        SkAutoSTMalloc<4, Coordinate> coordinates(axisCount);
+        if (typeface.getVariationDesignPosition(coordinates.get(), axisCount) == axisCount) {
+            for (int i = 0; i < axisCount; i++) {
+                serializer.write<Coordinate>(coordinates[i]);
+            }
+        }
+    }
+
+    uint64_t key = (uint64_t)SkOpts::hash(bytes.data(), bytes.size(), 0) << 32 |
+                   SkOpts::hash(bytes.data(), bytes.size(), kMagic);
+    return key != 0 ? key : 1;
+}
+
+uint64_t SkPersistentStrikeCache::typefaceKey(const SkTypeface& typeface) {
+    {
+        SkAutoMutexExclusive am(fTypefaceKeysMutex);
+        if (uint64_t* key = fTypefaceKeys.find(typeface.uniqueID())) {
+            return *key;
+        }
+    }
+    uint64_t key = TypefaceKey(typeface);
+    SkAutoMutexExclusive am(fTypefaceKeysMutex);
+    fTypefaceKeys.set(typeface.uniqueID(), key);
+    return key;
+}
+
+static void write_glyph(const SkGlyph& glyph, Serializer* serializer) {
+    serializer->write<SkPackedGlyphID>(glyph.getPackedID());
+    serializer->write<float>(glyph.advanceX());
+    serializer->write<float>(glyph.advanceY());
+    serializer->write<uint16_t>(glyph.width());
+    serializer->write<uint16_t>(glyph.height());
+    serializer->write<int16_t>(glyph.top());
+    serializer->write<int16_t>(glyph.left());
+    serializer->write<uint8_t>(glyph.maskFormat());
+}
+
+sk_sp<SkData> SkPersistentStrikeCache::Serialize(SkStrikeCache* cache) {
+    std::vector<IndexEntry> index;
+    std::vector<std::vector<uint8_t>> strikes;
+
+    cache->forEachStrike([&](const SkStrike& strike) {
+        const SkScalerContext* context = strike.getScalerContext();
+        uint64_t typefaceKey = TypefaceKey(*context->getTypeface());
+        if (typefaceKey == 0) {
+            return;
+        }
+
+        SkAutoDescriptor ad;
+        const SkDescriptor* desc = auto_descriptor_from_desc(&strike.getDescriptor(), 0, &ad);
+
+        std::vector<uint8_t> bytes;
+        Serializer serializer(&bytes);
+        serializer.write<uint64_t>(typefaceKey);
+        serializer.writeDescriptor(*desc);
+        uint64_t* glyphCount = serializer.allocate<uint64_t>();
+        size_t glyphCountOffset = reinterpret_cast<uint8_t*>(glyphCount) - bytes.data();
+        uint64_t count = 0;
+
+        strike.fScalerCache.forEachGlyph([&](const SkGlyph& glyph) {
+            uint8_t flags = 0;
+            if (glyph.fImage != nullptr) {
+                flags |= kHasImage;
+            }
+            if (glyph.setPathHasBeenCalled()) {
+                flags |= kPathIsSet;
+                if (glyph.path() != nullptr) {
+                    flags |= kHasPath;
+                }
+            }
+
+            write_glyph(glyph, &serializer);
+            serializer.write<int8_t>(glyph.fForceBW);
+            serializer.write<uint8_t>(flags);
+            if (flags & kHasImage) {
+                memcpy(serializer.allocate(glyph.imageSize(), glyph.formatAlignment()),
+                       glyph.fImage, glyph.imageSize());
+            }
+            if (flags & kHasPath) {
+                size_t pathSize = glyph.path()->writeToMemory(nullptr);
+                serializer.write<uint64_t>(pathSize);
+                glyph.path()->writeToMemory(serializer.allocate(pathSize, kPathAlignment));
+            }
+            count++;
+        });
+        memcpy(bytes.data() + glyphCountOffset, &count, sizeof(count));
+
+        index.push_back({typefaceKey, desc->getChecksum(), SkToU32(strikes.size()), 0, 0});
+        strikes.push_back(std::move(bytes));
+    });
+
+    std::sort(index.begin(), index.end());
+
+    size_t size = sizeof(Header) + index.size() * sizeof(IndexEntry);
+    for (IndexEntry& entry : index) {
+        // fPad holds the position of the strike's bytes until we lay them out.
+        const std::vector<uint8_t>& bytes = strikes[entry.fPad];
+        entry.fOffset = pad(size, kStrikeAlignment);
+        entry.fSize = bytes.size();
+        size = entry.fOffset + entry.fSize;
+    }
+
+    sk_sp<SkData> data = SkData::MakeUninitialized(size);
+    auto base = static_cast<uint8_t*>(data->writable_data());
+    memset(base, 0, size);
+    Header header = {kMagic, kVersion, SK_MILESTONE, SkToU32(index.size())};
+    memcpy(base, &header, sizeof(Header));
+    for (size_t i = 0; i < index.size(); i++) {
+        const std::vector<uint8_t>& bytes = strikes[index[i].fPad];
+        memcpy(base + index[i].fOffset, bytes.data(), bytes.size());
+        index[i].fPad = 0;
+    }
+    memcpy(base + sizeof(Header), index.data(), index.size() * sizeof(IndexEntry));
+    return data;
+}
+
+bool SkPersistentStrikeCache::Write(SkStrikeCache* cache, const char path[]) {
+    sk_sp<SkData> data = Serialize(cache);
+
+    SkString tempPath = SkStringPrintf("%s.tmp", path);
+    {
+        SkFILEWStream stream(tempPath.c_str());
+        if (!stream.isValid() || !stream.write(data->data(), data->size())) {
+            return false;
+        }
+    }
+
+    // Replace the old file without truncating it, as it may still be mapped.
+    if (std::rename(tempPath.c_str(), path) != 0) {
+        std::remove(path);
+        if (std::rename(tempPath.c_str(), path) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int SkPersistentStrikeCache::primeStrike(const SkTypeface& typeface, SkStrike* strike) {
+    if (fStrikeCount == 0) {
+        return 0;
+    }
+    uint64_t typefaceKey = this->typefaceKey(typeface);
+    if (typefaceKey == 0) {
+        return 0;
+    }
+
+    SkAutoDescriptor ad;
+    const SkDescriptor* desc = auto_descriptor_from_desc(&strike->getDescriptor(), 0, &ad);
+
+    IndexEntry target = {typefaceKey, desc->getChecksum(), 0, 0, 0};
+    const IndexEntry* end = fIndex + fStrikeCount;
+    for (const IndexEntry* entry = std::lower_bound(fIndex, end, target);
+         entry != end && !(target < *entry);
+         entry++) {
+        if (entry->fOffset > fData->size() || entry->fSize > fData->size() - entry->fOffset) {
+            return 0;
+        }
+
+        // Like the SkStrikeClient, treat the data as untrusted.
+        Deserializer deserializer(
+                reinterpret_cast<const volatile char*>(fData->bytes() + entry->fOffset),
+                entry->fSize);
+        uint64_t storedTypefaceKey;
+        SkAutoDescriptor storedDesc;
+        if (!deserializer.read<uint64_t>(&storedTypefaceKey) ||
+            !deserializer.readDescriptor(&storedDesc)) {
+            return 0;
+        }
+        if (storedTypefaceKey != typefaceKey || *storedDesc.getDesc() != *desc) {
+            continue;
+        }
+
+        uint64_t glyphCount;
+        if (!deserializer.read<uint64_t>(&glyphCount)) {
+            return 0;
+        }
+        int primed = 0;
+        for (uint64_t i = 0; i < glyphCount; i++) {
+            SkPackedGlyphID packedID;
+            if (!deserializer.read<SkPackedGlyphID>(&packedID)) {
+                return primed;
+            }
+            SkGlyph glyph{packedID};
+            uint8_t flags;
+            if (!deserializer.read<float>(&glyph.fAdvanceX) ||
+                !deserializer.read<float>(&glyph.fAdvanceY) ||
+                !deserializer.read<uint16_t>(&glyph.fWidth) ||
+                !deserializer.read<uint16_t>(&glyph.fHeight) ||
+                !deserializer.read<int16_t>(&glyph.fTop) ||
+                !deserializer.read<int16_t>(&glyph.fLeft) ||
+                !deserializer.read<uint8_t>(&glyph.fMaskFormat) ||
+                !deserializer.read<int8_t>(&glyph.fForceBW) ||
+                !deserializer.read<uint8_t>(&flags) ||
+                !SkMask::IsValidFormat(glyph.fMaskFormat)) {
+                return primed;
+            }
+
+            if (flags & kHasImage) {
+                if (glyph.isEmpty() || glyph.imageTooLarge()) {
+                    return primed;
+                }
+                const volatile void* image =
+                        deserializer.read(glyph.imageSize(), glyph.formatAlignment());
+                if (!image) {
+                    return primed;
+                }
+                glyph.fImage = (void*)image;
+            }
+
+            SkPath path;
+            const SkPath* pathPtr = nullptr;
+            if (flags & kHasPath) {
+                uint64_t pathSize;
+                if (!deserializer.read<uint64_t>(&pathSize)) {
+                    return primed;
+                }
+                const volatile void* pathData = deserializer.read(pathSize, kPathAlignment);
+                if (!pathData ||
+                    !path.readFromMemory(const_cast<const void*>(pathData), pathSize)) {
+                    return primed;
+                }
+                pathPtr = &path;
+            }
+
+            SkGlyph* allocatedGlyph = strike->mergeGlyphAndImage(packedID, glyph);
+            if ((flags & kPathIsSet) && !allocatedGlyph->isEmpty()) {
+                strike->mergePath(allocatedGlyph, pathPtr);
+            }
+            primed++;
+        }
+        return primed;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPersistentStrikeCache_DEFINED
+#define SkPersistentStrikeCache_DEFINED
+
+#include "include/core/SkData.h"
+#include "include/core/SkRefCnt.h"
+#include "include/core/SkTypes.h"
+#include "include/private/SkMutex.h"
+#include "include/private/SkTHash.h"
+#include "src/core/SkStrikeCache.h"
+
+class SkTypeface;
+
+/**
+ *  Glyph metrics, images and paths saved from the strikes of an SkStrikeCache, so that a later
+ *  process can start its strikes with those glyphs instead of making them again with the
+ *  scaler context.
+ *
+ *  The data is read in place, usually from a memory mapped file, and a strike's glyphs are only
+ *  read when the strike is created (see SkStrikeCache::setPersistentCache()).
+ *
+ *  Font IDs differ between processes, so strikes are stored under a key made from the
+ *  typeface's family name, style, glyph count, variation position and 'head' table, which holds
+ *  the font's revision and checksum. Typefaces without a 'head' table are not stored. The data
+ *  is ignored if it was written by a different format version or Skia milestone.
+ */
+class SkPersistentStrikeCache : public SkRefCnt {
+public:
+    /** Reads the data written by Write(). Returns nullptr if the data is not usable. */
+    static sk_sp<SkPersistentStrikeCache> Make(sk_sp<SkData> data);
+
+    /** Memory maps the file written by Write(). Returns nullptr if it is missing or not usable. */
+    static sk_sp<SkPersistentStrikeCache> MakeFromFile(const char path[]);
+
+    /** Serializes the glyphs of every strike in cache. */
+    static sk_sp<SkData> Serialize(SkStrikeCache* cache);
+
+    /**
+     *  Serializes the glyphs of every strike in cache to the file at path. The data is written to
+     *  a temporary file first, so an SkPersistentStrikeCache may still be mapping the old one.
+     */
+    static bool Write(SkStrikeCache* cache, const char path[]);
+
+    /** Adds the glyphs stored for strike, if any. Returns the number of glyphs added. */
+    int primeStrike(const SkTypeface& typeface, SkStrike* strike);
+
+    int strikeCount() const { return fStrikeCount; }
+
+private:
+    struct IndexEntry;
+
+    SkPersistentStrikeCache(sk_sp<SkData> data, const IndexEntry* index, int strikeCount);
+
+    // Returns 0 if typeface can't be stored.
+    static uint64_t TypefaceKey(const SkTypeface& typeface);
+    uint64_t typefaceKey(const SkTypeface& typeface);
+
+    const sk_sp<SkData>     fData;
+    const IndexEntry* const fIndex;
+    const int               fStrikeCount;
+
+    SkMutex                           fTypefaceKeysMutex;
+    SkTHashMap<SkFontID, uint64_t>    fTypefaceKeys SK_GUARDED_BY(fTypefaceKeysMutex);
+};
+
+#endif  // SkPersistentStrikeCache_DEFINED
@@ -284,19 +284,41 @@ void SkPictureData::flatten(SkWriteBuffer& buffer) const {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// If stream reads from the memory of backing, returns its position there, or else SIZE_MAX.
+static size_t position_in_backing(SkStream* stream, const SkData* backing) {
+    if (!backing || stream->getMemoryBase() != backing->data()) {
+        return SIZE_MAX;
+    }
+    return stream->getPosition();
+}
+
+// SkReadBuffer can only read bytes in place if they are 4-byte aligned.
+static bool can_read_in_place(const SkData* backing, size_t offset) {
+    return offset != SIZE_MAX && SkIsAlign4((uintptr_t)backing->bytes() + offset);
+}
+
 bool SkPictureData::parseStreamTag(SkStream* stream,
                                    uint32_t tag,
                                    uint32_t size,
                                    const SkDeserialProcs& procs,
-                                   SkTypefacePlayback* topLevelTFPlayback) {
+                                   SkTypefacePlayback* topLevelTFPlayback,
+                                   const SkData* backing) {
     switch (tag) {
-        case SK_PICT_READER_TAG:
+        case SK_PICT_READER_TAG: {
             SkASSERT(nullptr == fOpData);
-            fOpData = SkData::MakeFromStream(stream, size);
+            size_t offset = position_in_backing(stream, backing);
+            if (can_read_in_place(backing, offset)) {
+                if (stream->skip(size) != size) {
+                    return false;
+                }
+                fOpData = SkData::MakeSubset(backing, offset, size);
+            } else {
+                fOpData = SkData::MakeFromStream(stream, size);
+            }
             if (!fOpData) {
                 return false;
             }
-            break;
+        } break;
         case SK_PICT_FACTORY_TAG: {
             if (!stream->readU32(&size)) { return false; }
             fFactoryPlayback = std::make_unique<SkFactoryPlayback>(size);
@@ -328,7 +350,7 @@ bool SkPictureData::parseStreamTag(SkStream* stream,
             fPictures.reserve(SkToInt(size));
 
             for (uint32_t i = 0; i < size; i++) {
-                auto pic = SkPicture::MakeFromStream(stream, &procs, topLevelTFPlayback);
+                auto pic = SkPicture::MakeFromStream(stream, &procs, topLevelTFPlayback, backing);
                 if (!pic) {
                     return false;
                 }
@@ -336,13 +358,27 @@ bool SkPictureData::parseStreamTag(SkStream* stream,
             }
         } break;
         case SK_PICT_BUFFER_SIZE_TAG: {
-            SkAutoMalloc storage(size);
-            if (stream->read(storage.get(), size) != size) {
-                return false;
+            SkAutoMalloc storage;
+            const void* memory;
+            size_t offset = position_in_backing(stream, backing);
+            if (can_read_in_place(backing, offset)) {
+                if (stream->skip(size) != size) {
+                    return false;
+                }
+                memory = backing->bytes() + offset;
+            } else {
+                if (stream->read(storage.reset(size), size) != size) {
+                    return false;
+                }
+                memory = storage.get();
             }
 
-            SkReadBuffer buffer(storage.get(), size);
+            SkReadBuffer buffer(memory, size);
             buffer.setVersion(fInfo.getVersion());
+            if (offset != SIZE_MAX) {
+                // Even when the buffer is a copy, images can share the backing's bytes.
+                buffer.setBackingData(backing, offset);
+            }
 
             if (!fFactoryPlayback) {
                 return false;
@@ -474,13 +510,14 @@ void SkPictureData::parseBufferTag(SkReadBuffer& buffer, uint32_t tag, uint32_t
 SkPictureData* SkPictureData::CreateFromStream(SkStream* stream,
                                                const SkPictInfo& info,
                                                const SkDeserialProcs& procs,
-                                               SkTypefacePlayback* topLevelTFPlayback) {
+                                               SkTypefacePlayback* topLevelTFPlayback,
+                                               const SkData* backing) {
     std::unique_ptr<SkPictureData> data(new SkPictureData(info));
     if (!topLevelTFPlayback) {
         topLevelTFPlayback = &data->fTFPlayback;
     }
 
-    if (!data->parseStream(stream, procs, topLevelTFPlayback)) {
+    if (!data->parseStream(stream, procs, topLevelTFPlayback, backing)) {
         return nullptr;
     }
     return data.release();
@@ -499,7 +536,8 @@ SkPictureData* SkPictureData::CreateFromBuffer(SkReadBuffer& buffer,
 
 bool SkPictureData::parseStream(SkStream* stream,
                                 const SkDeserialProcs& procs,
-                                SkTypefacePlayback* topLevelTFPlayback) {
+                                SkTypefacePlayback* topLevelTFPlayback,
+                                const SkData* backing) {
     for (;;) {
         uint32_t tag;
         if (!stream->readU32(&tag)) { return false; }
@@ -509,7 +547,7 @@ bool SkPictureData::parseStream(SkStream* stream,
 
         uint32_t size;
         if (!stream->readU32(&size)) { return false; }
-        if (!this->parseStreamTag(stream, tag, size, procs, topLevelTFPlayback)) {
+        if (!this->parseStreamTag(stream, tag, size, procs, topLevelTFPlayback, backing)) {
             return false; // we're invalid
         }
     }
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/core/SkPictureProfile.h"
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkTime.h"
+#include "include/private/SkTemplates.h"
+#include "src/core/SkBigPicture.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkRecord.h"
+#include "src/core/SkRecordDraw.h"
+#include "src/core/SkRecorder.h"
+#include "src/utils/SkJSONWriter.h"
+
+#include <algorithm>
+
+namespace {
+
+// What the profile keeps about each op, besides how long it took.
+struct OpInfo {
+    SkRecords::Type fType;
+    uint32_t        fPaintFlags;
+    bool            fDraws;
+};
+
+struct GetOpInfo {
+    template <typename T>
+    SK_WHEN(T::kTags & SkRecords::kHasPaint_Tag, OpInfo) operator()(const T& op) {
+        return {T::kType, PaintFlags(AsPtr(op.paint)), SkToBool(T::kTags & SkRecords::kDraw_Tag)};
+    }
+
+    template <typename T>
+    SK_WHEN(!(T::kTags & SkRecords::kHasPaint_Tag), OpInfo) operator()(const T&) {
+        return {T::kType, 0, SkToBool(T::kTags & SkRecords::kDraw_Tag)};
+    }
+
+    static const SkPaint* AsPtr(const SkRecords::Optional<SkPaint>& paint) { return paint; }
+    static const SkPaint* AsPtr(const SkPaint& paint) { return &paint; }
+
+    static uint32_t PaintFlags(const SkPaint* paint) {
+        if (!paint) {
+            return 0;
+        }
+        uint32_t flags = 0;
+        if (paint->getShader()) {
+            flags |= SkPictureProfile::kShader_PaintFlag;
+        }
+        if (!paint->isSrcOver()) {
+            flags |= SkPictureProfile::kBlend_PaintFlag;
+        }
+        if (paint->getMaskFilter()) {
+            flags |= SkPictureProfile::kMaskFilter_PaintFlag;
+        }
+        if (paint->isAntiAlias()) {
+            flags |= SkPictureProfile::kAntiAlias_PaintFlag;
+        }
+        return flags;
+    }
+};
+
+static const struct {
+    uint32_t    fFlag;
+    const char* fName;
+} kPaintFlagNames[] = {
+    {SkPictureProfile::kShader_PaintFlag,     "shader"},
+    {SkPictureProfile::kBlend_PaintFlag,      "blend"},
+    {SkPictureProfile::kMaskFilter_PaintFlag, "maskfilter"},
+    {SkPictureProfile::kAntiAlias_PaintFlag,  "aa"},
+};
+
+}  // namespace
+
+const char* SkPictureProfile::Entry::name() const {
+    static const char* const kNames[] = {
+    #define NAME(T) #T,
+        SK_RECORD_TYPES(NAME)
+    #undef NAME
+    };
+    return kNames[fType];
+}
+
+SkString SkPictureProfile::Entry::description() const {
+    SkString description(this->name());
+    if (fPaintFlags) {
+        const char* separator = " [";
+        for (const auto& flag : kPaintFlagNames) {
+            if (fPaintFlags & flag.fFlag) {
+                description.appendf("%s%s", separator, flag.fName);
+                separator = " ";
+            }
+        }
+        description.append("]");
+    }
+    return description;
+}
+
+void SkPictureProfile::playback(const SkPicture* picture, SkCanvas* canvas) {
+    if (const SkBigPicture* bp = SkPicturePriv::AsSkBigPicture(sk_ref_sp(picture))) {
+        this->playback(*bp->record(), canvas, bp->drawablePicts(), bp->drawableCount());
+        return;
+    }
+    // Smaller pictures don't keep an SkRecord, so record one from them.
+    SkRecord record;
+    SkRecorder recorder(&record, picture->cullRect());
+    picture->playback(&recorder);
+    this->playback(record, canvas, nullptr, 0);
+}
+
+void SkPictureProfile::playback(const SkRecord& record, SkCanvas* canvas) {
+    this->playback(record, canvas, nullptr, 0);
+}
+
+void SkPictureProfile::playback(const SkRecord& record, SkCanvas* canvas,
+                                SkPicture const* const drawablePicts[], int drawableCount) {
+    SkAutoCanvasRestore saveRestore(canvas, true /*save now, restore at exit*/);
+
+    // The record's ops are bounded in the canvas's current local space, so they can be mapped
+    // to device pixels with the matrix the canvas has now.
+    SkAutoTMalloc<SkRect> bounds(record.count());
+    SkRecordFillBounds(canvas->getLocalClipBounds(), record, bounds.get());
+    const SkMatrix ctm = canvas->getTotalMatrix();
+    const SkRect clip = SkRect::Make(canvas->getDeviceClipBounds());
+
+    SkRecords::Draw draw(canvas, drawablePicts, nullptr, drawableCount);
+    for (int i = 0; i < record.count(); i++) {
+        double start = SkTime::GetNSecs();
+        record.visit(i, draw);
+        double ms = (SkTime::GetNSecs() - start) * 1e-6;
+
+        OpInfo info = record.visit(i, GetOpInfo());
+        double pixels = 0;
+        SkRect device;
+        if (info.fDraws && device.intersect(ctm.mapRect(bounds[i]), clip)) {
+            pixels = (double)device.width() * device.height();
+        }
+
+        uint64_t key = (uint64_t)info.fType << 32 | info.fPaintFlags;
+        auto found = fEntries.find(key);
+        if (found == fEntries.end()) {
+            found = fEntries.emplace(key, Entry{info.fType, info.fPaintFlags, 0, 0, 0}).first;
+        }
+        found->second.fCount  += 1;
+        found->second.fMs     += ms;
+        found->second.fPixels += pixels;
+    }
+}
+
+std::vector<SkPictureProfile::Entry> SkPictureProfile::entries() const {
+    std::vector<Entry> entries;
+    entries.reserve(fEntries.size());
+    for (const auto& [key, entry] : fEntries) {
+        entries.push_back(entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.fMs > b.fMs;
+    });
+    return entries;
+}
+
+double SkPictureProfile::totalMs() const {
+    double ms = 0;
+    for (const auto& [key, entry] : fEntries) {
+        ms += entry.fMs;
+    }
+    return ms;
+}
+
+SkString SkPictureProfile::report(int topN) const {
+    std::vector<Entry> entries = this->entries();
+    double totalMs = this->totalMs();
+
+    SkString report;
+    report.appendf("%10s %7s %8s %10s  %s\n", "ms", "%", "count", "Mpixels", "op");
+    for (int i = 0; i < std::min(topN, (int)entries.size()); i++) {
+        const Entry& entry = entries[i];
+        report.appendf("%10.3f %6.1f%% %8d %10.3f  %s\n",
+                       entry.fMs,
+                       totalMs > 0 ? 100 * entry.fMs / totalMs : 0.0,
+                       entry.fCount,
+                       entry.fPixels * 1e-6,
+                       entry.description().c_str());
+    }
+    report.appendf("%10.3f %6.1f%% %8s %10s  total\n", totalMs, 100.0, "", "");
+    return report;
+}
+
+void SkPictureProfile::writeJSON(SkJSONWriter* writer) const {
+    writer->beginArray();
+    for (const Entry& entry : this->entries()) {
+        writer->beginObject(nullptr, false);
+        writer->appendString("op", entry.name());
+        writer->beginArray("paint", false);
+        for (const auto& flag : kPaintFlagNames) {
+            if (entry.fPaintFlags & flag.fFlag) {
+                writer->appendString(flag.fName);
+            }
+        }
+        writer->endArray();
+        writer->appendS32("count", entry.fCount);
+        writer->appendDouble("ms", entry.fMs);
+        writer->appendDouble("pixels", entry.fPixels);
+        writer->endObject();
+    }
+    writer->endArray();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureProfile_DEFINED
+#define SkPictureProfile_DEFINED
+
+#include "include/core/SkString.h"
+#include "src/core/SkRecords.h"
+
+#include <map>
+#include <vector>
+
+class SkCanvas;
+class SkJSONWriter;
+class SkPicture;
+class SkRecord;
+
+/**
+ *  SkPictureProfile plays pictures back one op at a time, and adds up what each op costs: the
+ *  wall time spent in its canvas call, and the device pixels its bounds cover inside the clip.
+ *  Costs are kept per op type and per combination of the paint properties that pick how an op
+ *  is drawn.
+ *
+ *  This is a diagnostic tool and adds a timer read around every op, so it is only used when
+ *  asked for. On a GPU canvas the times are those of recording the work, not of executing it.
+ *  Nested pictures are timed as their DrawPicture op, not op by op.
+ */
+class SkPictureProfile {
+public:
+    enum PaintFlags : uint32_t {
+        kShader_PaintFlag     = 1 << 0,
+        kBlend_PaintFlag      = 1 << 1,  // Any blend mode other than src-over.
+        kMaskFilter_PaintFlag = 1 << 2,
+        kAntiAlias_PaintFlag  = 1 << 3,
+    };
+
+    struct Entry {
+        SkRecords::Type fType;
+        uint32_t        fPaintFlags;
+        int             fCount;
+        double          fMs;
+        double          fPixels;
+
+        // The op type, e.g. "DrawRect".
+        const char* name() const;
+        // The op type followed by its paint flags, e.g. "DrawRect [shader aa]".
+        SkString description() const;
+    };
+
+    /**
+     *  Draws the picture into the canvas, as SkPicture::playback() would, and adds the cost of
+     *  each of its ops to this profile.
+     */
+    void playback(const SkPicture*, SkCanvas*);
+
+    /** Like playback(), for a record that has no drawables. */
+    void playback(const SkRecord&, SkCanvas*);
+
+    /** Returns one entry per op type and paint flags seen, most total time first. */
+    std::vector<Entry> entries() const;
+
+    double totalMs() const;
+
+    /** Returns a table of the topN entries that cost the most time. */
+    SkString report(int topN) const;
+
+    /** Writes all entries, most total time first, as a JSON array of objects. */
+    void writeJSON(SkJSONWriter*) const;
+
+    void reset() { fEntries.clear(); }
+
+private:
+    void playback(const SkRecord&, SkCanvas*, SkPicture const* const drawablePicts[],
+                  int drawableCount);
+
+    // Keyed by (type << 32) | paint flags, so ties come out in a stable order.
+    std::map<uint64_t, Entry> fEntries;
+};
+
+#endif
@@ -71,6 +71,9 @@ sk_sp<SkPicture> SkPictureRecorder::finishRecordingAsPicture(uint32_t finishFlag
 
     // TODO: delay as much of this work until just before first playback?
     SkRecordOptimize(fRecord.get());
+    if (finishFlags & kCompact_FinishFlag) {
+        SkRecordCompact(fRecord.get());
+    }
 
     SkDrawableList* drawableList = fRecorder->getDrawableList();
     std::unique_ptr<SkBigPicture::SnapshotArray> pictList{
@@ -132,6 +135,9 @@ sk_sp<SkDrawable> SkPictureRecorder::finishRecordingAsDrawable(uint32_t finishFl
     fRecorder->restoreToCount(1);  // If we were missing any restores, add them now.
 
     SkRecordOptimize(fRecord.get());
+    if (finishFlags & kCompact_FinishFlag) {
+        SkRecordCompact(fRecord.get());
+    }
 
     if (fBBH.get()) {
         SkAutoTMalloc<SkRect> bounds(fRecord->count());
@@ -16,7 +16,8 @@
  * bounding rectangles.
  *
  * It only supports bulk-loading, i.e. creation from a batch of bounding rectangles.
- * This performs a bottom-up bulk load using the STR (sort-tile-recursive) algorithm.
+ * This performs a bottom-up bulk load, grouping the rectangles either in the order they are
+ * given, or after sorting them with the STR (sort-tile-recursive) algorithm.
  *
  * TODO: Experiment with other bulk-load algorithms (in particular the Hilbert pack variant,
  * which groups rects by position on the Hilbert curve, is probably worth a look). There also
@@ -26,10 +27,15 @@
  *
  *  Beckmann, N.; Kriegel, H. P.; Schneider, R.; Seeger, B. (1990). "The R*-tree:
  *      an efficient and robust access method for points and rectangles"
+ *
+ *  Leutenegger, S. T.; Lopez, M. A.; Edgington, J. (1997). "STR: a simple and efficient
+ *      algorithm for R-tree packing"
  */
 class SkRTree : public SkBBoxHierarchy {
 public:
-    SkRTree();
+    using Packing = SkRTreeFactory::Packing;
+
+    explicit SkRTree(Packing packing = Packing::kInsertionOrder);
 
     void insert(const SkRect[], int N) override;
     void search(const SkRect& query, std::vector<int>* results) const override;
@@ -38,7 +44,7 @@ public:
     // Methods and constants below here are only public for tests.
 
     // Return the depth of the tree structure.
-    int getDepth() const { return fCount ? fRoot.fSubtree->fLevel + 1 : 0; }
+    int getDepth() const { return fCount ? fNodes[fRoot.fIndex].fLevel + 1 : 0; }
     // Insertion count (not overall node count, which may be greater).
     int getCount() const { return fCount; }
 
@@ -47,23 +53,28 @@ public:
                      kMaxChildren = 11;
 
 private:
-    struct Node;
+    // kMaxChildren rounded up to a multiple of 4.
+    static constexpr int kChildSlots = 12;
 
     struct Branch {
-        union {
-            Node* fSubtree;
-            int fOpIndex;
-        };
+        int fIndex;  // of a node in fNodes, or of an op
         SkRect fBounds;
     };
 
+    // The bounds of the children are stored a side at a time, so that a few SIMD compares test
+    // them all against a query. The slots past fNumChildren have inverted bounds, which
+    // intersect nothing.
     struct Node {
         uint16_t fNumChildren;
         uint16_t fLevel;
-        Branch fChildren[kMaxChildren];
+        int fChildren[kChildSlots];  // indices of nodes, or of ops at level 0
+        float fLeft[kChildSlots];
+        float fTop[kChildSlots];
+        float fRight[kChildSlots];
+        float fBottom[kChildSlots];
     };
 
-    void search(Node* root, const SkRect& query, std::vector<int>* results) const;
+    void search(const Node& node, const SkRect& query, std::vector<int>* results) const;
 
     // Consumes the input array.
     Branch bulkLoad(std::vector<Branch>* branches, int level = 0);
@@ -73,8 +84,16 @@ private:
 
     Node* allocateNodeAtLevel(uint16_t level);
 
+    static void AddChild(Node* node, const Branch& branch);
+
+    // Sorts the op indices found by a search, which are all less than opCount.
+    static void SortResults(int results[], int count, int opCount);
+
+    const Packing fPacking;
     // This is the count of data elements (rather than total nodes in the tree)
     int fCount;
+    // The count of rects inserted, including the empty ones left out of the tree.
+    int fOpCount;
     Branch fRoot;
     std::vector<Node> fNodes;
 };
@@ -328,10 +328,21 @@ sk_sp<SkImage> SkReadBuffer::readImage() {
         return nullptr;
     }
 
-    sk_sp<SkData> data = SkData::MakeUninitialized(size);
-    if (!this->readPad32(data->writable_data(), size)) {
-        this->validate(false);
-        return nullptr;
+    sk_sp<SkData> data;
+    if (fBackingData) {
+        size_t offset = fBackingOffset + fReader.offset();
+        if (this->skip(size)) {
+            data = SkData::MakeSubset(fBackingData, offset, size);
+        }
+        if (!this->validate(data != nullptr)) {
+            return nullptr;
+        }
+    } else {
+        data = SkData::MakeUninitialized(size);
+        if (!this->readPad32(data->writable_data(), size)) {
+            this->validate(false);
+            return nullptr;
+        }
     }
     if (this->isVersionLT(SkPicturePriv::kDontNegateImageSize_Version)) {
         (void)this->read32();   // originX
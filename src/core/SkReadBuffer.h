@@ -152,6 +152,16 @@ public:
     void setDeserialProcs(const SkDeserialProcs& procs);
     const SkDeserialProcs& getDeserialProcs() const { return fProcs; }
 
+    /**
+     *  Call this if the buffer's memory holds the same bytes as data does, starting at offset.
+     *  Encoded images then share data instead of being copied out of the buffer, so data should
+     *  be immutable and it is kept alive by the images.
+     */
+    void setBackingData(const SkData* data, size_t offset) {
+        fBackingData = data;
+        fBackingOffset = offset;
+    }
+
     /**
      *  If isValid is false, sets the buffer to be "invalid". Returns true if the buffer
      *  is still valid.
@@ -213,6 +223,9 @@ private:
 
     SkDeserialProcs fProcs;
 
+    const SkData* fBackingData = nullptr;
+    size_t        fBackingOffset = 0;
+
     static bool IsPtrAlign4(const void* ptr) {
         return SkIsAlign4((uintptr_t)ptr);
     }
@@ -309,6 +322,7 @@ public:
     void setTypefaceArray(sk_sp<SkTypeface>[], int)        {}
     void setFactoryPlayback(SkFlattenable::Factory[], int) {}
     void setDeserialProcs(const SkDeserialProcs&)          {}
+    void setBackingData(const SkData*, size_t)             {}
 
     const SkDeserialProcs& getDeserialProcs() const {
         static const SkDeserialProcs procs;
@@ -106,6 +106,9 @@ public:
     // May change count() and the indices of ops, but preserves their order.
     void defrag();
 
+    // Frees the space reserved for commands beyond count().
+    void shrinkToFit();
+
 private:
     // An SkRecord is structured as an array of pointers into a big chunk of memory where
     // records representing each canvas draw call are stored:
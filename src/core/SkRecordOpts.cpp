@@ -7,10 +7,21 @@
 
 #include "src/core/SkRecordOpts.h"
 
+#include "include/core/SkColorFilter.h"
+#include "include/core/SkImageFilter.h"
+#include "include/core/SkMaskFilter.h"
+#include "include/core/SkPathEffect.h"
+#include "include/core/SkSerialProcs.h"
+#include "include/core/SkShader.h"
 #include "include/private/SkTDArray.h"
+#include "include/private/SkTHash.h"
 #include "src/core/SkCanvasPriv.h"
+#include "src/core/SkOpts.h"
+#include "src/core/SkPathPriv.h"
+#include "src/core/SkRecordDraw.h"
 #include "src/core/SkRecordPattern.h"
 #include "src/core/SkRecords.h"
+#include "src/core/SkRectPriv.h"
 
 using namespace SkRecords;
 
@@ -286,6 +297,520 @@ void SkRecordMergeSvgOpacityAndFilterLayers(SkRecord* record) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+static bool has_save_layers(SkRecord* record) {
+    for (int i = 0; i < record->count(); i++) {
+        if (record->mutate(i, Is<SaveLayer>())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A SaveLayer whose layer only starts out transparent and is only clipped to its bounds.
+static bool is_plain_layer(const SaveLayer* layer) {
+    return !layer->backdrop && !layer->clipMask &&
+           !(layer->saveLayerFlags & (SkCanvas::kInitWithPrevious_SaveLayerFlag |
+                                      SkCanvasPriv::kDontClipToLayer_SaveLayerFlag));
+}
+
+// Tracks the matrix of each op, as the Restores in a record know it.
+struct CTMTracker {
+    template <typename T> void operator()(const T&) {}
+    void operator()(const Restore& op)   { fCTM = op.matrix; }
+    void operator()(const SetMatrix& op) { fCTM = op.matrix; }
+    void operator()(const Concat44& op)  { fCTM.preConcat(op.matrix.asM33()); }
+    void operator()(const Concat& op)    { fCTM.preConcat(op.matrix); }
+    void operator()(const Scale& op)     { fCTM.preScale(op.sx, op.sy); }
+    void operator()(const Translate& op) { fCTM.preTranslate(op.dx, op.dy); }
+
+    SkMatrix fCTM = SkMatrix::I();
+};
+
+// Tracks whether each op is inside a SaveLayer with an image filter.
+struct ImageFilterTracker {
+    template <typename T> void operator()(const T&) {}
+    void operator()(const Save&)          { this->push(false); }
+    void operator()(const SaveBehind&)    { this->push(false); }
+    void operator()(const SaveLayer& op)  { this->push(op.paint && op.paint->getImageFilter()); }
+    void operator()(const Restore&) {
+        if (!fFiltered.isEmpty()) {
+            fFiltered.pop();
+        }
+    }
+
+    void push(bool filtered) { fFiltered.push_back(filtered || this->inFilteredLayer()); }
+    bool inFilteredLayer() const { return !fFiltered.isEmpty() && fFiltered.top(); }
+
+    SkTDArray<bool> fFiltered;
+};
+
+// Marks each SaveLayer with a backdrop SaveLayer anywhere inside it. A backdrop layer covers
+// the whole clip whatever is drawn in it, so what it draws isn't in its FillBounds.
+static void find_layers_around_backdrops(SkRecord* record, bool aroundBackdrop[]) {
+    SkTDArray<int> saves;  // The index of each open SaveLayer, or -1 for other saves.
+    for (int i = 0; i < record->count(); i++) {
+        aroundBackdrop[i] = false;
+        Is<SaveLayer> layer;
+        if (record->mutate(i, layer)) {
+            if (layer.get()->backdrop) {
+                for (int index : saves) {
+                    if (index >= 0) {
+                        aroundBackdrop[index] = true;
+                    }
+                }
+            }
+            saves.push_back(i);
+        } else if (record->mutate(i, Is<Save>()) || record->mutate(i, Is<SaveBehind>())) {
+            saves.push_back(-1);
+        } else if (record->mutate(i, Is<Restore>()) && !saves.isEmpty()) {
+            saves.pop();
+        }
+    }
+}
+
+void SkRecordTightenLayerBounds(SkRecord* record) {
+    if (!has_save_layers(record)) {
+        return;
+    }
+
+    // Each SaveLayer gets the bounds of everything drawn inside it, mapped to identity space.
+    // Those are the cull whenever the layer's paint, or any draw inside it, could draw anywhere.
+    // They also take in the image filters of the layers around it, which may move them (e.g.
+    // an offset filter) rather than only grow them, so layers inside those are left alone, as
+    // are layers around backdrop layers.
+    const SkRect cull = SkRectPriv::MakeLargest();
+    SkAutoTMalloc<SkRect> bounds(record->count());
+    SkRecordFillBounds(cull, *record, bounds.get());
+    SkAutoTMalloc<bool> aroundBackdrop(record->count());
+    find_layers_around_backdrops(record, aroundBackdrop.get());
+
+    CTMTracker tracker;
+    ImageFilterTracker filters;
+    for (int i = 0; i < record->count(); i++) {
+        Is<SaveLayer> match;
+        if (record->mutate(i, match) && is_plain_layer(match.get()) && bounds[i] != cull &&
+                !aroundBackdrop[i] && !filters.inFilteredLayer() &&
+                !tracker.fCTM.hasPerspective()) {
+            SaveLayer* layer = match.get();
+            SkMatrix inverse;
+            if (tracker.fCTM.invert(&inverse)) {
+                SkRect tight = inverse.mapRect(bounds[i]);
+                if (!layer->bounds) {
+                    // The Optional is empty, so there is nothing to destroy before replacing it.
+                    new (&layer->bounds) Optional<SkRect>(new (record->alloc<SkRect>()) SkRect);
+                } else if (!tight.intersect(*layer->bounds)) {
+                    tight.setEmpty();
+                }
+                *layer->bounds = tight;
+            }
+        }
+        record->visit(i, tracker);
+        record->visit(i, filters);
+    }
+}
+
+#ifndef SK_BUILD_FOR_ANDROID_FRAMEWORK
+// Sorts the ops inside a layer into those that don't draw, draws that could be drawn straight
+// onto the layer's destination, and the rest, which keep the layer.
+struct LayerChild {
+    enum Kind { kNoDraw_Kind, kDraw_Kind, kKeepsLayer_Kind };
+
+    template <typename T>
+    SK_WHEN(!(T::kTags & kDraw_Tag), void) operator()(T*) { this->set(kNoDraw_Kind); }
+
+    template <typename T>
+    SK_WHEN((T::kTags & kDrawWithPaint_Tag) == kDrawWithPaint_Tag, void) operator()(T* op) {
+        this->set(kDraw_Kind, AsPtr(op->paint));
+    }
+
+    // Drawables, shadows and quads don't have a paint to fold into, and may not draw with
+    // src-over.
+    template <typename T>
+    SK_WHEN((T::kTags & kDrawWithPaint_Tag) == kDraw_Tag, void) operator()(T*) {
+        this->set(kKeepsLayer_Kind);
+    }
+
+    // Nested layers and draws behind would see different pixels without the layer.
+    void operator()(SaveLayer*)  { this->set(kKeepsLayer_Kind); }
+    void operator()(SaveBehind*) { this->set(kKeepsLayer_Kind); }
+    void operator()(DrawBehind*) { this->set(kKeepsLayer_Kind); }
+
+    // Without a paint, a picture's own blend modes would reach the layer's destination.
+    void operator()(DrawPicture* op) {
+        this->set(op->paint ? kDraw_Kind : kKeepsLayer_Kind, op->paint);
+    }
+
+    void set(Kind kind, SkPaint* paint = nullptr) {
+        fKind = kind;
+        fPaint = paint;
+    }
+
+    static SkPaint* AsPtr(Optional<SkPaint>& paint) { return paint; }
+    static SkPaint* AsPtr(SkPaint& paint) { return &paint; }
+
+    Kind     fKind;
+    SkPaint* fPaint;
+};
+
+// Whether an op covers each pixel it draws at most once. Ops made of many primitives (points,
+// atlas sprites, vertices, glyphs, ...) may draw some pixels more than once, so folding alpha
+// into their paint would change how those pixels blend.
+struct CoversOnce {
+    template <typename T> bool operator()(const T&) { return false; }
+    bool operator()(const DrawRect&)      { return true; }
+    bool operator()(const DrawRRect&)     { return true; }
+    bool operator()(const DrawDRRect&)    { return true; }
+    bool operator()(const DrawOval&)      { return true; }
+    bool operator()(const DrawArc&)       { return true; }
+    bool operator()(const DrawPath&)      { return true; }
+    bool operator()(const DrawRegion&)    { return true; }
+    bool operator()(const DrawImage&)     { return true; }
+    bool operator()(const DrawImageRect&) { return true; }
+    // With a paint, a picture is drawn into a layer of its own first.
+    bool operator()(const DrawPicture&)   { return true; }
+};
+
+// Whether no two of the rects touch the same pixel.
+static bool pixels_disjoint(const SkTDArray<SkIRect>& rects) {
+    for (int i = 0; i < rects.count(); i++) {
+        for (int j = i + 1; j < rects.count(); j++) {
+            if (SkIRect::Intersects(rects[i], rects[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Folds the SaveLayer at index begin into the draws inside it, if that doesn't change what they
+// draw, returning whether it did.
+static bool fold_layer(SkRecord* record, int begin, const SkRect bounds[]) {
+    Is<SaveLayer> match;
+    record->mutate(begin, match);
+    if (!is_plain_layer(match.get())) {
+        return false;
+    }
+    // As in SaveLayerDrawRestoreNooper, the layer's bounds are taken as a hint.
+    const SkPaint* layerPaint = match.get()->paint;
+    SkPaint probe;
+    if (layerPaint && !fold_opacity_layer_color_to_paint(layerPaint, false, &probe)) {
+        // The layer's paint does more than apply alpha.
+        return false;
+    }
+
+    // Drawing src-over into a transparent layer that's drawn src-over is the same as drawing
+    // src-over straight onto the layer's destination, overlapping or not. If the layer has alpha
+    // to fold into the draws instead, no pixel can be drawn twice, by two draws or by one that's
+    // made of many primitives, where the layer would blend them together before applying its
+    // alpha.
+    const bool hasAlpha = layerPaint && layerPaint->getAlpha() != 0xFF;
+    SkTDArray<int> draws;
+    SkTDArray<SkIRect> drawBounds;
+    int depth = 0;
+    int end = begin + 1;
+    for (; end < record->count(); end++) {
+        if (record->mutate(end, Is<Save>())) {
+            depth++;
+        } else if (record->mutate(end, Is<Restore>()) && depth-- == 0) {
+            break;
+        }
+
+        LayerChild child;
+        record->mutate(end, child);
+        if (child.fKind == LayerChild::kKeepsLayer_Kind) {
+            return false;
+        }
+        if (child.fKind == LayerChild::kDraw_Kind) {
+            if (hasAlpha) {
+                // Hairlines blend where their segments cross, too.
+                if (!child.fPaint || !record->visit(end, CoversOnce()) ||
+                        (child.fPaint->getStyle() != SkPaint::kFill_Style &&
+                         child.fPaint->getStrokeWidth() == 0)) {
+                    return false;
+                }
+                SkPaint folded = *child.fPaint;
+                if (!fold_opacity_layer_color_to_paint(layerPaint, false, &folded)) {
+                    return false;
+                }
+                *drawBounds.append() = bounds[end].roundOut();
+            } else if (!effectively_srcover(child.fPaint)) {
+                return false;
+            }
+            *draws.append() = end;
+        }
+    }
+    if (end == record->count() || (hasAlpha && !pixels_disjoint(drawBounds))) {
+        return false;
+    }
+
+    if (hasAlpha) {
+        for (int index : draws) {
+            LayerChild child;
+            record->mutate(index, child);
+            fold_opacity_layer_color_to_paint(layerPaint, false, child.fPaint);
+        }
+    }
+    record->replace<NoOp>(begin);  // SaveLayer
+    record->replace<NoOp>(end);    // Restore
+    return true;
+}
+
+void SkRecordFoldLayerAlpha(SkRecord* record) {
+    if (!has_save_layers(record)) {
+        return;
+    }
+
+    // The bounds are in identity space, so only at that scale can two draws whose bounds are
+    // apart be sure not to touch the same pixel. Played back smaller, their antialiased edges
+    // might, which is why this isn't part of SkRecordOptimize().
+    SkAutoTMalloc<SkRect> bounds(record->count());
+    SkRecordFillBounds(SkRectPriv::MakeLargest(), *record, bounds.get());
+
+    // Inner layers come first, so that once folded, their outer layers can be too.
+    for (int i = record->count() - 1; i >= 0; i--) {
+        if (record->mutate(i, Is<SaveLayer>())) {
+            fold_layer(record, i, bounds.get());
+        }
+    }
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A DrawImageRect can join a batch if drawing it as an entry of an image set is no different
+// from drawing it alone.  Image filters would apply to the whole set as one layer, and the set's
+// bounds ignore mask filters, so paints with either are left alone.
+static bool can_batch_image_rect(const DrawImageRect* op) {
+    return !op->paint || (!op->paint->getImageFilter() && !op->paint->getMaskFilter());
+}
+
+static bool same_image_rect_state(const DrawImageRect* a, const DrawImageRect* b) {
+    if (a->constraint != b->constraint) {
+        return false;
+    }
+    if (!a->paint || !b->paint) {
+        return !a->paint && !b->paint;
+    }
+    return *a->paint == *b->paint;
+}
+
+// Replaces the DrawImageRects at indices[0..count) with one DrawEdgeAAImageSet at indices[0].
+// Every entry takes its antialiasing from the shared paint, all four edges or none, which is
+// exactly how the image set draws it when it isn't batched.
+static void batch_image_rects(SkRecord* record, const int indices[], int count) {
+    SkAutoTArray<SkCanvas::ImageSetEntry> set(count);
+    SkPaint* paint = nullptr;
+    SkCanvas::SrcRectConstraint constraint = SkCanvas::kStrict_SrcRectConstraint;
+    for (int i = 0; i < count; i++) {
+        Is<DrawImageRect> op;
+        record->mutate(indices[i], op);
+        if (i == 0) {
+            if (op.get()->paint) {
+                paint = new (record->alloc<SkPaint>()) SkPaint(*op.get()->paint);
+            }
+            constraint = op.get()->constraint;
+        }
+        const SkImage* image = op.get()->image.get();
+        SkRect src = op.get()->src ? *op.get()->src : SkRect::Make(image->bounds());
+        auto aa = paint && paint->isAntiAlias() ? SkCanvas::kAll_QuadAAFlags
+                                                : SkCanvas::kNone_QuadAAFlags;
+        set[i] = SkCanvas::ImageSetEntry(std::move(op.get()->image), src, op.get()->dst,
+                                         1.0f, aa);
+        record->replace<NoOp>(indices[i]);
+    }
+    new (record->replace<DrawEdgeAAImageSet>(indices[0])) DrawEdgeAAImageSet{
+            paint, std::move(set), count, nullptr, nullptr, constraint};
+}
+
+// Coalesces runs of DrawImageRects that share a paint and constraint, with nothing but NoOps
+// between them, into DrawEdgeAAImageSets.  A GPU device draws a set as one batch; elsewhere it
+// saves the per-draw work of playing back and dispatching each record.
+void SkRecordBatchImageRects(SkRecord* record) {
+    SkTDArray<int> run;
+    auto flush = [&] {
+        if (run.count() > 1) {
+            batch_image_rects(record, run.begin(), run.count());
+        }
+        run.rewind();
+    };
+    for (int i = 0; i < record->count(); i++) {
+        Is<DrawImageRect> op;
+        if (record->mutate(i, op)) {
+            if (!can_batch_image_rect(op.get())) {
+                flush();
+                continue;
+            }
+            if (!run.isEmpty()) {
+                Is<DrawImageRect> first;
+                record->mutate(run[0], first);
+                if (!same_image_rect_state(first.get(), op.get())) {
+                    flush();
+                }
+            }
+            run.push_back(i);
+        } else if (!record->mutate(i, Is<NoOp>())) {
+            flush();
+        }
+    }
+    flush();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Makes ops share the paths and paint effects that are equal to ones earlier in the record.
+class Interner {
+public:
+    Interner() {
+        // Images, pictures and typefaces are compared by ID, rather than encoded.
+        fProcs.fImageProc = [](SkImage* image, void*) { return WriteID(image->uniqueID()); };
+        fProcs.fPictureProc = [](SkPicture* pic, void*) { return WriteID(pic->uniqueID()); };
+        fProcs.fTypefaceProc = [](SkTypeface* face, void*) { return WriteID(face->uniqueID()); };
+    }
+
+    template <typename T>
+    SK_WHEN(T::kTags & kHasPaint_Tag, void) operator()(T* op) { this->intern(op->paint); }
+
+    template <typename T>
+    SK_WHEN(!(T::kTags & kHasPaint_Tag), void) operator()(T*) {}
+
+    void operator()(DrawPath* op) {
+        this->intern(op->paint);
+        this->intern(&op->path);
+    }
+    void operator()(ClipPath* op) { this->intern(&op->path); }
+    void operator()(DrawShadowRec* op) { this->intern(&op->path); }
+    void operator()(SaveLayer* op) {
+        this->intern(op->paint);
+        op->backdrop = this->intern(op->backdrop);
+    }
+
+private:
+    static sk_sp<SkData> WriteID(uint32_t id) { return SkData::MakeWithCopy(&id, sizeof(id)); }
+
+    // A flattened effect, compared by its bytes.
+    struct Flattened {
+        sk_sp<SkData> fData;
+
+        bool operator==(const Flattened& that) const { return fData->equals(that.fData.get()); }
+        struct Hash {
+            uint32_t operator()(const Flattened& f) const {
+                return SkOpts::hash(f.fData->data(), f.fData->size());
+            }
+        };
+    };
+
+    // A path, compared as SkPath compares them, and also by whether it's known to be an oval or
+    // a round rect, and by the direction and start point of that, which SkPath's equality
+    // ignores but drawing may not.
+    struct PathKey {
+        PathKey() = default;
+        explicit PathKey(const SkPath& path) : fPath(path) {
+            SkRect oval;
+            SkRRect rrect;
+            if (SkPathPriv::IsOval(path, &oval, &fDir, &fStart)) {
+                fShape = kOval_Shape;
+            } else if (SkPathPriv::IsRRect(path, &rrect, &fDir, &fStart)) {
+                fShape = kRRect_Shape;
+            }
+        }
+
+        bool operator==(const PathKey& that) const {
+            return fShape == that.fShape && fDir == that.fDir && fStart == that.fStart &&
+                   fPath == that.fPath;
+        }
+
+        struct Hash {
+            uint32_t operator()(const PathKey& key) const {
+                const SkPath& path = key.fPath;
+                uint32_t hash = SkOpts::hash(SkPathPriv::VerbData(path), path.countVerbs());
+                hash = SkOpts::hash(SkPathPriv::PointData(path),
+                                    path.countPoints() * sizeof(SkPoint), hash);
+                const uint32_t shape = key.fShape | (uint32_t)key.fDir << 2 | key.fStart << 3;
+                return SkOpts::hash(&shape, sizeof(shape), hash);
+            }
+        };
+
+        enum Shape { kNone_Shape, kOval_Shape, kRRect_Shape };
+
+        SkPath          fPath;
+        Shape           fShape = kNone_Shape;
+        SkPathDirection fDir = SkPathDirection::kCW;
+        unsigned        fStart = 0;
+    };
+
+    void intern(SkPaint& paint) {
+        if (paint.getPathEffect())  { paint.setPathEffect (this->intern(paint.refPathEffect()));  }
+        if (paint.getShader())      { paint.setShader     (this->intern(paint.refShader()));      }
+        if (paint.getMaskFilter())  { paint.setMaskFilter (this->intern(paint.refMaskFilter()));  }
+        if (paint.getColorFilter()) { paint.setColorFilter(this->intern(paint.refColorFilter())); }
+        if (paint.getImageFilter()) { paint.setImageFilter(this->intern(paint.refImageFilter())); }
+    }
+    void intern(Optional<SkPaint>& paint) {
+        if (paint) {
+            this->intern(*paint);
+        }
+    }
+
+    void intern(SkPath* path) {
+        // Volatile paths aren't worth sharing, and their volatility has to stay as it is.
+        if (path->isVolatile()) {
+            return;
+        }
+        PathKey key(*path);
+        if (const PathKey* equal = fPaths.find(key)) {
+            *path = equal->fPath;
+        } else {
+            fPaths.add(std::move(key));
+        }
+    }
+
+    template <typename T>
+    sk_sp<T> intern(sk_sp<T> effect) {
+        if (!effect) {
+            return nullptr;
+        }
+        // Each effect is only flattened the first time an op uses it.
+        sk_sp<SkFlattenable>* canonical = fByPointer.find(effect.get());
+        if (!canonical) {
+            sk_sp<SkFlattenable> flattenable(SkRef(const_cast<SkFlattenable*>(
+                    static_cast<const SkFlattenable*>(effect.get()))));
+            Flattened key = {effect->serialize(&fProcs)};
+            if (!key.fData) {
+                return effect;
+            }
+            canonical = fByContent.find(key);
+            if (!canonical) {
+                canonical = fByContent.set(key, flattenable);
+            }
+            canonical = fByPointer.set(effect.get(), *canonical);
+            // Hold on to the effect while it's a key, so its address isn't reused.
+            fKeepAlive.push_back(std::move(flattenable));
+        }
+        return sk_ref_sp(static_cast<T*>(canonical->get()));
+    }
+
+    SkSerialProcs                                               fProcs;
+    SkTHashSet<PathKey, PathKey::Hash>                          fPaths;
+    SkTHashMap<Flattened, sk_sp<SkFlattenable>, Flattened::Hash> fByContent;
+    SkTHashMap<const void*, sk_sp<SkFlattenable>>               fByPointer;
+    SkTArray<sk_sp<SkFlattenable>>                              fKeepAlive;
+};
+
+}  // namespace
+
+void SkRecordCompact(SkRecord* record) {
+    Interner interner;
+    for (int i = 0; i < record->count(); i++) {
+        record->mutate(i, interner);
+    }
+    record->defrag();
+    record->shrinkToFit();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 void SkRecordOptimize(SkRecord* record) {
     // This might be useful  as a first pass in the future if we want to weed
     // out junk for other optimization passes.  Right now, nothing needs it,
@@ -303,6 +828,7 @@ void SkRecordOptimize(SkRecord* record) {
     SkRecordNoopSaveLayerDrawRestores(record);
 #endif
     SkRecordMergeSvgOpacityAndFilterLayers(record);
+    SkRecordTightenLayerBounds(record);
 
     record->defrag();
 }
@@ -313,8 +839,11 @@ void SkRecordOptimize2(SkRecord* record) {
     // See why we turn this off in SkRecordOptimize above.
 #ifndef SK_BUILD_FOR_ANDROID_FRAMEWORK
     SkRecordNoopSaveLayerDrawRestores(record);
+    SkRecordFoldLayerAlpha(record);
 #endif
     SkRecordMergeSvgOpacityAndFilterLayers(record);
+    SkRecordTightenLayerBounds(record);
+    SkRecordBatchImageRects(record);
 
     record->defrag();
 }
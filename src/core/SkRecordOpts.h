@@ -20,12 +20,30 @@ void SkRecordNoopSaveRestores(SkRecord*);
 // For some SaveLayer-[drawing command]-Restore patterns, merge the SaveLayer's alpha into the
 // draw, and no-op the SaveLayer and Restore.
 void SkRecordNoopSaveLayerDrawRestores(SkRecord*);
+
+// For SaveLayers that only apply alpha, around draws that could take that alpha in their own
+// paints, fold the alpha into the draws and no-op the SaveLayer and Restore. The draws must not
+// touch the same pixels, which is only known when the record is drawn at its own scale.
+void SkRecordFoldLayerAlpha(SkRecord*);
 #endif
 
 // For SVG generated SaveLayer-Save-ClipRect-SaveLayer-3xRestore patterns, merge
 // the alpha of the first SaveLayer to the second SaveLayer.
 void SkRecordMergeSvgOpacityAndFilterLayers(SkRecord*);
 
+// Shrinks the bounds of SaveLayers to the bounds of what is drawn inside them, where that
+// doesn't change what the layers draw.
+void SkRecordTightenLayerBounds(SkRecord*);
+
+// Coalesces runs of DrawImageRects with identical paints into DrawEdgeAAImageSets.
+void SkRecordBatchImageRects(SkRecord*);
+
+// Makes ops share the paths and paint effects that are equal to those of earlier ops, and frees
+// the space reserved for more ops, to save memory in records that are kept for a long time.
+// Paints stay by value in each op and the op arena is not repacked, so bytesUsed() is
+// unchanged. Playback is unchanged.
+void SkRecordCompact(SkRecord*);
+
 // Experimental optimizers
 void SkRecordOptimize2(SkRecord*);
 
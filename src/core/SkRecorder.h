@@ -51,6 +51,12 @@ public:
     };
     void reset(SkRecord*, const SkRect& bounds, DrawPictureMode, SkMiniRecorder* = nullptr);
 
+    // Records into another SkRecord from here on, keeping the canvas's matrix, clip and saves.
+    void setRecord(SkRecord* record) {
+        SkASSERT(!fMiniRecorder);
+        fRecord = record;
+    }
+
     size_t approxBytesUsedBySubPictures() const { return fApproxBytesUsedBySubPictures; }
 
     SkDrawableList* getDrawableList() const { return fDrawableList.get(); }
@@ -89,6 +89,7 @@ void SkResourceCache::init() {
     // One of these should be explicit set by the caller after we return.
     fTotalByteLimit = 0;
     fDiscardableFactory = nullptr;
+    fShardClock = nullptr;
 }
 
 SkResourceCache::SkResourceCache(DiscardableFactory factory) {
@@ -120,6 +121,9 @@ bool SkResourceCache::find(const Key& key, FindVisitor visitor, void* context) {
         Rec* rec = *found;
         if (visitor(*rec, context)) {
             this->moveToHead(rec);  // for our LRU
+            if (fShardClock) {
+                rec->fLastUse = fShardClock->load(std::memory_order_relaxed);
+            }
             return true;
         } else {
             this->remove(rec);  // stale
@@ -159,6 +163,7 @@ void SkResourceCache::add(Rec* rec, void* payload) {
         }
     }
 
+    rec->fLastUse = fShardClock ? fShardClock->load(std::memory_order_relaxed) : 0;
     this->addToHead(rec);
     fHash->set(rec);
     rec->postAddInstall(payload);
@@ -200,6 +205,10 @@ void SkResourceCache::remove(Rec* rec) {
 }
 
 void SkResourceCache::purgeAsNeeded(bool forcePurge) {
+    if (fShardClock && !forcePurge) {
+        return;  // Shards purges to its budget across all of its shards.
+    }
+
     size_t byteLimit;
     int    countLimit;
 
@@ -225,6 +234,34 @@ void SkResourceCache::purgeAsNeeded(bool forcePurge) {
     }
 }
 
+bool SkResourceCache::oldestUse(uint32_t* use) const {
+    if (!fTail) {
+        return false;
+    }
+    *use = fTail->fLastUse;
+    return true;
+}
+
+bool SkResourceCache::purgeOldest(size_t bytesToFree, int countToFree,
+                                  uint32_t now, uint32_t minAge) {
+    size_t bytesFreed = 0;
+    int countFreed = 0;
+    Rec* rec = fTail;
+    while (rec && (bytesFreed < bytesToFree || countFreed < countToFree)) {
+        if (now - rec->fLastUse < minAge) {
+            break;
+        }
+        Rec* prev = rec->fPrev;
+        if (rec->canBePurged()) {
+            bytesFreed += rec->bytesUsed();
+            countFreed += 1;
+            this->remove(rec);
+        }
+        rec = prev;
+    }
+    return countFreed > 0;
+}
+
 //#define SK_TRACK_PURGE_SHAREDID_HITRATE
 
 #ifdef SK_TRACK_PURGE_SHAREDID_HITRATE
@@ -290,17 +327,21 @@ size_t SkResourceCache::setTotalByteLimit(size_t newLimit) {
     return prevLimit;
 }
 
-SkCachedData* SkResourceCache::newCachedData(size_t bytes) {
-    this->checkMessages();
-
-    if (fDiscardableFactory) {
-        SkDiscardableMemory* dm = fDiscardableFactory(bytes);
+static SkCachedData* new_cached_data(SkResourceCache::DiscardableFactory factory, size_t bytes) {
+    if (factory) {
+        SkDiscardableMemory* dm = factory(bytes);
         return dm ? new SkCachedData(bytes, dm) : nullptr;
     } else {
         return new SkCachedData(sk_malloc_throw(bytes), bytes);
     }
 }
 
+SkCachedData* SkResourceCache::newCachedData(size_t bytes) {
+    this->checkMessages();
+
+    return new_cached_data(fDiscardableFactory, bytes);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void SkResourceCache::release(Rec* rec) {
@@ -424,22 +465,29 @@ size_t SkResourceCache::getSingleAllocationByteLimit() const {
     return fSingleAllocationByteLimit;
 }
 
-size_t SkResourceCache::getEffectiveSingleAllocationByteLimit() const {
-    // fSingleAllocationByteLimit == 0 means the caller is asking for our default
-    size_t limit = fSingleAllocationByteLimit;
+static size_t effective_single_allocation_limit(size_t singleAllocationByteLimit,
+                                                size_t totalByteLimit,
+                                                SkResourceCache::DiscardableFactory factory) {
+    // singleAllocationByteLimit == 0 means the caller is asking for our default
+    size_t limit = singleAllocationByteLimit;
 
     // if we're not discardable (i.e. we are fixed-budget) then cap the single-limit
     // to our budget.
-    if (nullptr == fDiscardableFactory) {
+    if (nullptr == factory) {
         if (0 == limit) {
-            limit = fTotalByteLimit;
+            limit = totalByteLimit;
         } else {
-            limit = std::min(limit, fTotalByteLimit);
+            limit = std::min(limit, totalByteLimit);
         }
     }
     return limit;
 }
 
+size_t SkResourceCache::getEffectiveSingleAllocationByteLimit() const {
+    return effective_single_allocation_limit(fSingleAllocationByteLimit, fTotalByteLimit,
+                                             fDiscardableFactory);
+}
+
 void SkResourceCache::checkMessages() {
     SkTArray<PurgeSharedIDMessage> msgs;
     fPurgeSharedIDInbox.poll(&msgs);
@@ -450,88 +498,237 @@ void SkResourceCache::checkMessages() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static SkResourceCache* gResourceCache = nullptr;
-static SkMutex& resource_cache_mutex() {
-    static SkMutex& mutex = *(new SkMutex);
-    return mutex;
+SkShardedResourceCache::SkShardedResourceCache(DiscardableFactory factory)
+        : fDiscardableFactory(factory) {
+    for (Shard& shard : fShards) {
+        shard.fCache.reset(new SkResourceCache(factory));
+        shard.fCache->fShardClock = &fClock;
+    }
+}
+
+SkShardedResourceCache::SkShardedResourceCache(size_t byteLimit) : fByteLimit(byteLimit) {
+    for (Shard& shard : fShards) {
+        shard.fCache.reset(new SkResourceCache(byteLimit));
+        shard.fCache->fShardClock = &fClock;
+    }
+}
+
+// Adds the change in a shard's bytes and count, while its lock is held, to the totals.
+class SkShardedResourceCache::AutoUpdateTotals {
+public:
+    AutoUpdateTotals(SkShardedResourceCache* cache, const Shard& shard)
+            : fCache(cache)
+            , fShard(shard.fCache.get())
+            , fBytes(fShard->fTotalBytesUsed)
+            , fCount(fShard->fCount) {}
+
+    ~AutoUpdateTotals() {
+        fCache->fBytesUsed.fetch_add(fShard->fTotalBytesUsed - fBytes);
+        fCache->fCount.fetch_add(fShard->fCount - fCount);
+    }
+
+private:
+    SkShardedResourceCache* fCache;
+    const SkResourceCache*  fShard;
+    size_t                  fBytes;
+    int                     fCount;
+};
+
+bool SkShardedResourceCache::find(const Key& key, FindVisitor visitor, void* context) {
+    Shard& shard = this->shardFor(key);
+    SkAutoMutexExclusive am(shard.fMutex);
+    AutoUpdateTotals totals(this, shard);
+    return shard.fCache->find(key, visitor, context);
+}
+
+void SkShardedResourceCache::add(Rec* rec, void* payload) {
+    this->checkMessages();
+    fClock.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = this->shardFor(rec->getKey());
+    {
+        SkAutoMutexExclusive am(shard.fMutex);
+        AutoUpdateTotals totals(this, shard);
+        shard.fCache->add(rec, payload);
+    }
+    // since the new rec may push us over-budget, we perform a purge check now
+    this->purgeAsNeeded();
+}
+
+void SkShardedResourceCache::visitAll(Visitor visitor, void* context) {
+    for (Shard& shard : fShards) {
+        SkAutoMutexExclusive am(shard.fMutex);
+        shard.fCache->visitAll(visitor, context);
+    }
+}
+
+void SkShardedResourceCache::purgeAll() {
+    for (Shard& shard : fShards) {
+        SkAutoMutexExclusive am(shard.fMutex);
+        AutoUpdateTotals totals(this, shard);
+        shard.fCache->purgeAll();
+    }
 }
 
-/** Must hold resource_cache_mutex() when calling. */
-static SkResourceCache* get_cache() {
-    // resource_cache_mutex() is always held when this is called, so we don't need to be fancy in here.
-    resource_cache_mutex().assertHeld();
-    if (nullptr == gResourceCache) {
+bool SkShardedResourceCache::overBudget(size_t* bytesOver, int* countOver) const {
+    // Like SkResourceCache::purgeAsNeeded(), purge until we are under the limit.
+    if (fDiscardableFactory) {
+        *bytesOver = 0;
+        *countOver = fCount - SK_DISCARDABLEMEMORY_SCALEDIMAGECACHE_COUNT_LIMIT + 1;
+        return *countOver > 0;
+    }
+    size_t used = fBytesUsed,
+           limit = fByteLimit;
+    *bytesOver = used >= limit ? used - limit + 1 : 0;
+    *countOver = 0;
+    return *bytesOver > 0;
+}
+
+void SkShardedResourceCache::purgeAsNeeded() {
+    uint32_t skip = 0;  // Shards with nothing left that can be purged.
+    size_t bytesOver;
+    int countOver;
+    while (this->overBudget(&bytesOver, &countOver)) {
+        const uint32_t now = fClock.load(std::memory_order_relaxed);
+
+        // Find the shard whose least recently used rec is oldest, and the age of the next
+        // oldest, so we can purge from the first until it is no older than the second.
+        int oldest = -1;
+        uint32_t oldestAge = 0,
+                 nextOldestAge = 0;
+        for (int i = 0; i < kShardCount; ++i) {
+            if (skip & (1 << i)) {
+                continue;
+            }
+            uint32_t use;
+            {
+                SkAutoMutexExclusive am(fShards[i].fMutex);
+                if (!fShards[i].fCache->oldestUse(&use)) {
+                    continue;
+                }
+            }
+            uint32_t age = now - use;
+            if (oldest < 0 || age > oldestAge) {
+                nextOldestAge = oldestAge;
+                oldestAge = age;
+                oldest = i;
+            } else if (age > nextOldestAge) {
+                nextOldestAge = age;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+
+        Shard& shard = fShards[oldest];
+        SkAutoMutexExclusive am(shard.fMutex);
+        AutoUpdateTotals totals(this, shard);
+        if (!shard.fCache->purgeOldest(bytesOver, countOver, now, nextOldestAge)) {
+            skip |= 1 << oldest;
+        }
+    }
+}
+
+void SkShardedResourceCache::checkMessages() {
+    SkTArray<SkResourceCache::PurgeSharedIDMessage> msgs;
+    fPurgeSharedIDInbox.poll(&msgs);
+    if (msgs.empty()) {
+        return;
+    }
+    for (Shard& shard : fShards) {
+        SkAutoMutexExclusive am(shard.fMutex);
+        AutoUpdateTotals totals(this, shard);
+        shard.fCache->checkMessages();
+    }
+}
+
+size_t SkShardedResourceCache::setTotalByteLimit(size_t newLimit) {
+    size_t prevLimit = fByteLimit.exchange(newLimit);
+    if (newLimit < prevLimit) {
+        this->purgeAsNeeded();
+    }
+    return prevLimit;
+}
+
+size_t SkShardedResourceCache::setSingleAllocationByteLimit(size_t newLimit) {
+    return fSingleAllocationByteLimit.exchange(newLimit);
+}
+
+size_t SkShardedResourceCache::getEffectiveSingleAllocationByteLimit() const {
+    return effective_single_allocation_limit(fSingleAllocationByteLimit, fByteLimit,
+                                             fDiscardableFactory);
+}
+
+SkCachedData* SkShardedResourceCache::newCachedData(size_t bytes) {
+    return new_cached_data(fDiscardableFactory, bytes);
+}
+
+void SkShardedResourceCache::dump() const {
+    SkDebugf("SkResourceCache: count=%d bytes=%zu %s shards=%d\n",
+             fCount.load(), fBytesUsed.load(), fDiscardableFactory ? "discardable" : "malloc",
+             kShardCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static SkShardedResourceCache* get_cache() {
+    static SkShardedResourceCache* cache =
 #ifdef SK_USE_DISCARDABLE_SCALEDIMAGECACHE
-        gResourceCache = new SkResourceCache(SkDiscardableMemory::Create);
+            new SkShardedResourceCache(SkDiscardableMemory::Create);
 #else
-        gResourceCache = new SkResourceCache(SK_DEFAULT_IMAGE_CACHE_LIMIT);
+            new SkShardedResourceCache(SK_DEFAULT_IMAGE_CACHE_LIMIT);
 #endif
-    }
-    return gResourceCache;
+    return cache;
 }
 
 size_t SkResourceCache::GetTotalBytesUsed() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->getTotalBytesUsed();
 }
 
 size_t SkResourceCache::GetTotalByteLimit() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->getTotalByteLimit();
 }
 
 size_t SkResourceCache::SetTotalByteLimit(size_t newLimit) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->setTotalByteLimit(newLimit);
 }
 
 SkResourceCache::DiscardableFactory SkResourceCache::GetDiscardableFactory() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->discardableFactory();
 }
 
 SkCachedData* SkResourceCache::NewCachedData(size_t bytes) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->newCachedData(bytes);
 }
 
 void SkResourceCache::Dump() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     get_cache()->dump();
 }
 
 size_t SkResourceCache::SetSingleAllocationByteLimit(size_t size) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->setSingleAllocationByteLimit(size);
 }
 
 size_t SkResourceCache::GetSingleAllocationByteLimit() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->getSingleAllocationByteLimit();
 }
 
 size_t SkResourceCache::GetEffectiveSingleAllocationByteLimit() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->getEffectiveSingleAllocationByteLimit();
 }
 
 void SkResourceCache::PurgeAll() {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->purgeAll();
 }
 
 bool SkResourceCache::Find(const Key& key, FindVisitor visitor, void* context) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     return get_cache()->find(key, visitor, context);
 }
 
 void SkResourceCache::Add(Rec* rec, void* payload) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     get_cache()->add(rec, payload);
 }
 
 void SkResourceCache::VisitAll(Visitor visitor, void* context) {
-    SkAutoMutexExclusive am(resource_cache_mutex());
     get_cache()->visitAll(visitor, context);
 }
 
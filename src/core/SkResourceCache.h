@@ -9,9 +9,12 @@
 #define SkResourceCache_DEFINED
 
 #include "include/core/SkBitmap.h"
+#include "include/private/SkMutex.h"
 #include "include/private/SkTDArray.h"
 #include "src/core/SkMessageBus.h"
 
+#include <atomic>
+
 class SkCachedData;
 class SkDiscardableMemory;
 class SkTraceMemoryDump;
@@ -25,6 +28,7 @@ class SkTraceMemoryDump;
  *
  *  As a convenience, a global instance is also defined, which can be safely
  *  access across threads via the static methods (e.g. FindAndLock, etc.).
+ *  The global instance is an SkShardedResourceCache.
  */
 class SkResourceCache {
 public:
@@ -103,8 +107,9 @@ public:
         virtual SkDiscardableMemory* diagnostic_only_getDiscardable() const { return nullptr; }
 
     private:
-        Rec*    fNext;
-        Rec*    fPrev;
+        Rec*     fNext;
+        Rec*     fPrev;
+        uint32_t fLastUse;  // Only tracked by shards of the global cache.
 
         friend class SkResourceCache;
     };
@@ -272,9 +277,20 @@ private:
 
     SkMessageBus<PurgeSharedIDMessage>::Inbox fPurgeSharedIDInbox;
 
+    // Non-null when this is one shard of an SkShardedResourceCache. Recs are stamped with this
+    // clock when used, and purging to the budget is left to the SkShardedResourceCache.
+    const std::atomic<uint32_t>* fShardClock;
+
     void checkMessages();
     void purgeAsNeeded(bool forcePurge = false);
 
+    // Sets *use to the last use of the least recently used rec. Returns false if empty.
+    bool oldestUse(uint32_t* use) const;
+    // Purges least recently used recs until the bytes and count freed reach the given amounts,
+    // stopping at the first rec used less than minAge ticks of the shard clock before now.
+    // Returns true if anything was purged.
+    bool purgeOldest(size_t bytesToFree, int countToFree, uint32_t now, uint32_t minAge);
+
     // linklist management
     void moveToHead(Rec*);
     void addToHead(Rec*);
@@ -288,5 +304,79 @@ private:
 #else
     void validate() const {}
 #endif
+
+    friend class SkShardedResourceCache;
 };
+
+/**
+ *  A thread-safe cache made of SkResourceCache shards, each with its own lock, chosen by key
+ *  hash, so that threads looking up different keys rarely contend. The shards share one budget:
+ *  when an add pushes the total over it, recs are purged from whichever shard's least recently
+ *  used rec is oldest, giving approximately the LRU order of a single cache.
+ *
+ *  This backs the global cache used by SkResourceCache's static methods.
+ */
+class SkShardedResourceCache {
+public:
+    typedef SkResourceCache::Key                Key;
+    typedef SkResourceCache::Rec                Rec;
+    typedef SkResourceCache::FindVisitor        FindVisitor;
+    typedef SkResourceCache::Visitor            Visitor;
+    typedef SkResourceCache::DiscardableFactory DiscardableFactory;
+
+    explicit SkShardedResourceCache(DiscardableFactory);
+    explicit SkShardedResourceCache(size_t byteLimit);
+
+    bool find(const Key&, FindVisitor, void* context);
+    void add(Rec*, void* payload = nullptr);
+    void visitAll(Visitor, void* context);
+    void purgeAll();
+
+    size_t getTotalBytesUsed() const { return fBytesUsed.load(std::memory_order_relaxed); }
+    size_t getTotalByteLimit() const { return fByteLimit.load(std::memory_order_relaxed); }
+    size_t setTotalByteLimit(size_t newLimit);
+
+    size_t setSingleAllocationByteLimit(size_t maximumAllocationSize);
+    size_t getSingleAllocationByteLimit() const { return fSingleAllocationByteLimit; }
+    size_t getEffectiveSingleAllocationByteLimit() const;
+
+    DiscardableFactory discardableFactory() const { return fDiscardableFactory; }
+
+    SkCachedData* newCachedData(size_t bytes);
+
+    void dump() const;
+
+private:
+    static constexpr int kShardBits = 4;
+    static constexpr int kShardCount = 1 << kShardBits;
+
+    struct Shard {
+        SkMutex                          fMutex;
+        std::unique_ptr<SkResourceCache> fCache;
+    };
+
+    class AutoUpdateTotals;
+
+    Shard& shardFor(const Key& key) {
+        // Each shard's hash table indexes by the low bits, so pick the shard with the high ones.
+        return fShards[key.hash() >> (32 - kShardBits)];
+    }
+
+    bool overBudget(size_t* bytesOver, int* countOver) const;
+    void purgeAsNeeded();
+    void checkMessages();
+
+    Shard                    fShards[kShardCount];
+    std::atomic<uint32_t>    fClock{0};
+    std::atomic<size_t>      fBytesUsed{0};
+    std::atomic<int>         fCount{0};
+    std::atomic<size_t>      fByteLimit{0};
+    std::atomic<size_t>      fSingleAllocationByteLimit{0};
+    const DiscardableFactory fDiscardableFactory = nullptr;
+
+    // Every shard receives each purge message, but only reads its inbox when it is used.
+    // This one tells us when to have them all read theirs.
+    SkMessageBus<SkResourceCache::PurgeSharedIDMessage>::Inbox fPurgeSharedIDInbox;
+};
+
 #endif
@@ -7,12 +7,18 @@
 
 #include "src/core/SkScalerCache.h"
 
+#include "include/core/SkExecutor.h"
 #include "include/core/SkGraphics.h"
 #include "include/core/SkPath.h"
 #include "include/core/SkTypeface.h"
+#include "include/private/SkSemaphore.h"
+#include "include/private/SkTArray.h"
 #include "src/core/SkEnumerate.h"
 #include "src/core/SkScalerContext.h"
 
+#include <array>
+#include <atomic>
+
 static SkFontMetrics use_or_generate_metrics(
         const SkFontMetrics* metrics, SkScalerContext* context) {
     SkFontMetrics answer;
@@ -79,6 +85,11 @@ int SkScalerCache::countCachedGlyphs() const {
     return fGlyphMap.count();
 }
 
+void SkScalerCache::forEachGlyph(std::function<void(const SkGlyph&)> visitor) const {
+    SkAutoMutexExclusive lock(fMu);
+    fGlyphMap.foreach([&](const SkGlyph* glyph) { visitor(*glyph); });
+}
+
 std::tuple<SkSpan<const SkGlyph*>, size_t> SkScalerCache::internalPrepare(
         SkSpan<const SkGlyphID> glyphIDs, PathDetail pathDetail, const SkGlyph** results) {
     const SkGlyph** cursor = results;
@@ -104,6 +115,123 @@ std::tuple<const void*, size_t> SkScalerCache::prepareImage(SkGlyph* glyph) {
     return {glyph->image(), delta};
 }
 
+size_t SkScalerCache::batchPrepareImages(
+        SkSpan<const SkPackedGlyphID> glyphIDs, const SkGlyph* results[], SkExecutor* executor) {
+    size_t delta = 0;
+    SkSTArray<32, SkGlyph*> toMeasure;
+    SkSTArray<32, SkGlyph*> toRasterize;
+
+    // Scaler contexts for the other threads. What they hold (e.g. a font face and its buffers)
+    // isn't counted in the strike's memory, so they are freed once the batch is done.
+    std::vector<std::unique_ptr<SkScalerContext>> parallelScalers;
+
+    // Allocating the image marks it as set, so a glyph that repeats is only rasterized once.
+    auto needsImage = [&](SkGlyph* glyph) SK_REQUIRES(fMu) {
+        if (!glyph->setImageHasBeenCalled()) {
+            delta += glyph->allocImage(&fAlloc);
+            toRasterize.push_back(glyph);
+        }
+    };
+
+    for (auto [i, glyphID] : SkMakeEnumerate(glyphIDs)) {
+        SkGlyph* glyph = fGlyphMap.findOrNull(glyphID);
+        if (glyph == nullptr) {
+            size_t size;
+            std::tie(glyph, size) = this->makeGlyph(glyphID);
+            delta += size;
+            toMeasure.push_back(glyph);
+        } else {
+            // A new glyph repeated in glyphIDs is found here, but it has no width yet, so it is
+            // not given an image until it is measured below.
+            needsImage(glyph);
+        }
+        results[i] = glyph;
+    }
+
+    this->forEachGlyphInParallel(executor, {toMeasure.begin(), toMeasure.size()},
+                                 &parallelScalers,
+                                 [](SkScalerContext* scaler, SkGlyph* glyph) {
+                                     scaler->getMetrics(glyph);
+                                 });
+    for (SkGlyph* glyph : toMeasure) {
+        needsImage(glyph);
+    }
+    this->forEachGlyphInParallel(executor, {toRasterize.begin(), toRasterize.size()},
+                                 &parallelScalers,
+                                 [](SkScalerContext* scaler, SkGlyph* glyph) {
+                                     scaler->getImage(*glyph);
+                                 });
+    return delta;
+}
+
+void SkScalerCache::forEachGlyphInParallel(
+        SkExecutor* executor,
+        SkSpan<SkGlyph*> glyphs,
+        std::vector<std::unique_ptr<SkScalerContext>>* parallelScalers,
+        void (*fn)(SkScalerContext*, SkGlyph*)) {
+    // Below this many glyphs per thread, handing glyphs to other threads costs more than it saves.
+    static constexpr int kMinGlyphsPerScaler = 8;
+    static constexpr int kMaxScalers = 4;
+    static constexpr int kGlyphsPerClaim = 2;
+
+    const int glyphCount = SkToInt(glyphs.size());
+    const int scalerCount = std::min(kMaxScalers, glyphCount / kMinGlyphsPerScaler);
+    if (executor == nullptr || scalerCount < 2) {
+        for (SkGlyph* glyph : glyphs) {
+            fn(fScalerContext.get(), glyph);
+        }
+        return;
+    }
+
+    while (SkToInt(parallelScalers->size()) < scalerCount - 1) {
+        parallelScalers->push_back(fScalerContext->getTypeface()->createScalerContext(
+                fScalerContext->getEffects(), fDesc.getDesc()));
+    }
+
+    // Tasks may start after this returns, so what they share lives in a ref counted state. A
+    // task only touches the glyphs and scalers after claiming a scaler, and this thread waits
+    // for every task that did.
+    struct State : public SkNVRefCnt<State> {
+        std::atomic<int> fNextScaler{1};
+        std::atomic<int> fNextGlyph{0};
+        SkSemaphore fDone;
+    };
+    sk_sp<State> state = sk_make_sp<State>();
+
+    auto run = [glyphs, glyphCount, fn](State* state, SkScalerContext* scaler) {
+        for (int i = state->fNextGlyph.fetch_add(kGlyphsPerClaim, std::memory_order_relaxed);
+             i < glyphCount;
+             i = state->fNextGlyph.fetch_add(kGlyphsPerClaim, std::memory_order_relaxed)) {
+            for (int j = i; j < std::min(i + kGlyphsPerClaim, glyphCount); j++) {
+                fn(scaler, glyphs[j]);
+            }
+        }
+    };
+
+    std::array<SkScalerContext*, kMaxScalers> scalers;
+    for (int i = 1; i < scalerCount; i++) {
+        scalers[i] = (*parallelScalers)[i - 1].get();
+    }
+    for (int i = 1; i < scalerCount; i++) {
+        executor->add([state, run, scalers, scalerCount]() {
+            int index = state->fNextScaler.fetch_add(1, std::memory_order_acquire);
+            if (index < scalerCount) {
+                run(state.get(), scalers[index]);
+                state->fDone.signal();
+            }
+        });
+    }
+
+    run(state.get(), fScalerContext.get());
+
+    // Keep tasks that have not started from taking a scaler, then wait for those that did.
+    int claimed = std::min(state->fNextScaler.exchange(scalerCount, std::memory_order_acq_rel),
+                           scalerCount);
+    for (int i = 1; i < claimed; i++) {
+        state->fDone.wait();
+    }
+}
+
 std::tuple<SkGlyph*, size_t> SkScalerCache::mergeGlyphAndImage(
         SkPackedGlyphID toID, const SkGlyph& from) {
     SkAutoMutexExclusive lock{fMu};
@@ -134,9 +262,13 @@ std::tuple<SkSpan<const SkGlyph*>, size_t> SkScalerCache::preparePaths(
 }
 
 std::tuple<SkSpan<const SkGlyph*>, size_t> SkScalerCache::prepareImages(
-        SkSpan<const SkPackedGlyphID> glyphIDs, const SkGlyph* results[]) {
+        SkSpan<const SkPackedGlyphID> glyphIDs, const SkGlyph* results[], SkExecutor* executor) {
     const SkGlyph** cursor = results;
     SkAutoMutexExclusive lock{fMu};
+    if (executor != nullptr) {
+        size_t delta = this->batchPrepareImages(glyphIDs, results, executor);
+        return {{results, glyphIDs.size()}, delta};
+    }
     size_t delta = 0;
     for (auto glyphID : glyphIDs) {
         auto[glyph, glyphSize] = this->glyph(glyphID);
@@ -163,8 +295,30 @@ size_t SkScalerCache::commonFilterLoop(SkDrawableGlyphBuffer* drawables, Fn&& fn
     return total;
 }
 
-size_t SkScalerCache::prepareForDrawingMasksCPU(SkDrawableGlyphBuffer* drawables) {
+size_t SkScalerCache::prepareForDrawingMasksCPU(
+        SkDrawableGlyphBuffer* drawables, SkExecutor* executor) {
     SkAutoMutexExclusive lock{fMu};
+    if (executor != nullptr) {
+        SkZip<SkGlyphVariant, SkPoint> input = drawables->input();
+        SkAutoSTMalloc<64, SkPackedGlyphID> glyphIDs(input.size());
+        SkAutoSTMalloc<64, size_t> indices(input.size());
+        SkAutoSTMalloc<64, const SkGlyph*> glyphs(input.size());
+        size_t count = 0;
+        for (auto [i, packedID, pos] : SkMakeEnumerate(input)) {
+            if (SkScalarsAreFinite(pos.x(), pos.y())) {
+                glyphIDs[count] = packedID.packedID();
+                indices[count++] = i;
+            }
+        }
+        size_t delta = this->batchPrepareImages({glyphIDs.get(), count}, glyphs.get(), executor);
+        for (size_t i = 0; i < count; i++) {
+            // If the glyph is too large, then no image is created.
+            if (glyphs[i]->image() != nullptr) {
+                drawables->push_back(const_cast<SkGlyph*>(glyphs[i]), indices[i]);
+            }
+        }
+        return delta;
+    }
     size_t imageDelta = 0;
     size_t delta = this->commonFilterLoop(drawables,
         [&](size_t i, SkGlyph* glyph, SkPoint pos) SK_REQUIRES(fMu) {
@@ -17,8 +17,11 @@
 #include "src/core/SkGlyph.h"
 #include "src/core/SkGlyphRunPainter.h"
 #include "src/core/SkStrikeForGPU.h"
+#include <functional>
 #include <memory>
+#include <vector>
 
+class SkExecutor;
 class SkScalerContext;
 
 // This class represents a strike: a specific combination of typeface, size, matrix, etc., and
@@ -44,6 +47,9 @@ public:
     /** Return the number of glyphs currently cached. */
     int countCachedGlyphs() const SK_EXCLUDES(fMu);
 
+    /** Call visitor with each cached glyph, while holding the cache's lock. */
+    void forEachGlyph(std::function<void(const SkGlyph&)> visitor) const SK_EXCLUDES(fMu);
+
     /** If the advance axis intersects the glyph's path, append the positions scaled and offset
         to the array (if non-null), and set the count to the updated array length.
     */
@@ -60,10 +66,14 @@ public:
     std::tuple<SkSpan<const SkGlyph*>, size_t> preparePaths(
             SkSpan<const SkGlyphID> glyphIDs, const SkGlyph* results[]) SK_EXCLUDES(fMu);
 
+    // If executor is not null, glyphs missing from the cache are measured and rasterized on it
+    // in parallel, when there are enough of them.
     std::tuple<SkSpan<const SkGlyph*>, size_t> prepareImages(
-            SkSpan<const SkPackedGlyphID> glyphIDs, const SkGlyph* results[]) SK_EXCLUDES(fMu);
+            SkSpan<const SkPackedGlyphID> glyphIDs, const SkGlyph* results[],
+            SkExecutor* executor = nullptr) SK_EXCLUDES(fMu);
 
-    size_t prepareForDrawingMasksCPU(SkDrawableGlyphBuffer* drawables) SK_EXCLUDES(fMu);
+    size_t prepareForDrawingMasksCPU(
+            SkDrawableGlyphBuffer* drawables, SkExecutor* executor = nullptr) SK_EXCLUDES(fMu);
 
     // SkStrikeForGPU APIs
     const SkGlyphPositionRoundingSpec& roundingSpec() const {
@@ -107,6 +117,22 @@ private:
 
     std::tuple<const void*, size_t> prepareImage(SkGlyph* glyph) SK_REQUIRES(fMu);
 
+    // Like prepareImages(), but makes all the missing glyphs first, then measures them, then
+    // allocates and rasterizes their images, so each step can be split across executor.
+    size_t batchPrepareImages(SkSpan<const SkPackedGlyphID> glyphIDs,
+                              const SkGlyph* results[],
+                              SkExecutor* executor) SK_REQUIRES(fMu);
+
+    // Calls fn on each glyph, splitting the glyphs between this thread and tasks on executor.
+    // Each other thread uses a scaler context of its own from parallelScalers, which are added
+    // as needed. Returns once fn has been called on all of them; the lock is held throughout so
+    // no one else sees the glyphs half done.
+    void forEachGlyphInParallel(
+            SkExecutor* executor,
+            SkSpan<SkGlyph*> glyphs,
+            std::vector<std::unique_ptr<SkScalerContext>>* parallelScalers,
+            void (*fn)(SkScalerContext*, SkGlyph*)) SK_REQUIRES(fMu);
+
     // If the path has never been set, then use the scaler context to add the glyph.
     std::tuple<const SkPath*, size_t> preparePath(SkGlyph*) SK_REQUIRES(fMu);
 
@@ -7,7 +7,9 @@
 
 #include "src/core/SkStrikeCache.h"
 
+#include <algorithm>
 #include <cctype>
+#include <vector>
 
 #include "include/core/SkGraphics.h"
 #include "include/core/SkRefCnt.h"
@@ -16,6 +18,7 @@
 #include "include/private/SkMutex.h"
 #include "include/private/SkTemplates.h"
 #include "src/core/SkGlyphRunPainter.h"
+#include "src/core/SkPersistentStrikeCache.h"
 #include "src/core/SkScalerCache.h"
 
 bool gSkUseThreadLocalStrikeCaches_IAcknowledgeThisIsIncrediblyExperimental = false;
@@ -77,12 +80,12 @@ bool operator == (decltype(nullptr), const SkStrikeCache::ExclusiveStrikePtr& rh
     return nullptr == rhs.fStrike;
 }
 
+SkStrikeCache::SkStrikeCache() = default;
+
 SkStrikeCache::~SkStrikeCache() {
-    Strike* strike = fHead;
-    while (strike) {
-        Strike* next = strike->fNext;
-        strike->unref();
-        strike = next;
+    for (Shard& shard : fShards) {
+        SkAutoSpinlock ac(shard.fLock);
+        shard.fStrikes.foreach([](Strike** strike) { (*strike)->unref(); });
     }
 }
 
@@ -95,13 +98,19 @@ SkExclusiveStrikePtr SkStrikeCache::findOrCreateStrikeExclusive(
 auto SkStrikeCache::findOrCreateStrike(const SkDescriptor& desc,
                                        const SkScalerContextEffects& effects,
                                        const SkTypeface& typeface) -> sk_sp<Strike> {
-    SkAutoSpinlock ac(fLock);
-    sk_sp<Strike> strike = this->internalFindStrikeOrNull(desc);
+    sk_sp<Strike> strike = this->findStrikeOrNull(desc);
     if (strike == nullptr) {
+        // Make and prime the strike outside of any lock, while no other thread can see it. If
+        // another thread inserts the same strike first, internalInsertStrike() returns theirs
+        // and this one is dropped, along with what was primed into it.
         auto scaler = typeface.createScalerContext(effects, &desc);
-        strike = this->internalCreateStrike(desc, std::move(scaler));
+        strike = sk_make_sp<Strike>(this, desc, std::move(scaler), nullptr, nullptr);
+        if (sk_sp<SkPersistentStrikeCache> persistentCache = this->persistentCache()) {
+            persistentCache->primeStrike(typeface, strike.get());
+        }
+        strike = this->internalInsertStrike(std::move(strike));
     }
-    this->internalPurge();
+    this->purgeAsNeeded();
     return strike;
 }
 
@@ -181,33 +190,19 @@ void SkStrikeCache::DumpMemoryStatistics(SkTraceMemoryDump* dump) {
 }
 
 SkExclusiveStrikePtr SkStrikeCache::findStrikeExclusive(const SkDescriptor& desc) {
-    SkAutoSpinlock ac(fLock);
-    sk_sp<SkStrike> result = this->internalFindStrikeOrNull(desc);
-    this->internalPurge();
+    sk_sp<SkStrike> result = this->findStrikeOrNull(desc);
+    this->purgeAsNeeded();
     return SkExclusiveStrikePtr(result);
 }
 
-auto SkStrikeCache::internalFindStrikeOrNull(const SkDescriptor& desc) -> sk_sp<Strike> {
-    for (Strike* strike = fHead; strike != nullptr; strike = strike->fNext) {
-        if (strike->fScalerCache.getDescriptor() == desc) {
-            if (fHead != strike) {
-                // Make most recently used
-                strike->fPrev->fNext = strike->fNext;
-                if (strike->fNext != nullptr) {
-                    strike->fNext->fPrev = strike->fPrev;
-                } else {
-                    fTail = strike->fPrev;
-                }
-                fHead->fPrev = strike;
-                strike->fNext = fHead;
-                strike->fPrev = nullptr;
-                fHead = strike;
-            }
-
-            return sk_ref_sp(strike);
-        }
+auto SkStrikeCache::findStrikeOrNull(const SkDescriptor& desc) -> sk_sp<Strike> {
+    Shard& shard = this->shardFor(desc);
+    SkAutoSpinlock ac(shard.fLock);
+    if (Strike** strike = shard.fStrikes.find(desc)) {
+        // Make most recently used
+        (*strike)->fLastUse = fClock.load(std::memory_order_relaxed);
+        return sk_ref_sp(*strike);
     }
-
     return nullptr;
 }
 
@@ -217,54 +212,64 @@ SkExclusiveStrikePtr SkStrikeCache::createStrikeExclusive(
         SkFontMetrics* maybeMetrics,
         std::unique_ptr<SkStrikePinner> pinner)
 {
-    SkAutoSpinlock ac(fLock);
-    return SkExclusiveStrikePtr(
-            this->internalCreateStrike(desc, std::move(scaler), maybeMetrics, std::move(pinner)));
-}
+    // Replacing a strike removes the old one, which purges rely on nobody else doing.
+    SkAutoMutexExclusive ac(fPurgeMutex);
+    return SkExclusiveStrikePtr(this->internalInsertStrike(
+            sk_make_sp<Strike>(this, desc, std::move(scaler), maybeMetrics, std::move(pinner)),
+            /*replaceExisting=*/true));
+}
+
+auto SkStrikeCache::internalInsertStrike(sk_sp<Strike> strike,
+                                         bool replaceExisting) -> sk_sp<Strike> {
+    // Dropped after the shard lock is released.
+    sk_sp<Strike> replaced;
+
+    const SkDescriptor& desc = strike->getDescriptor();
+    Shard& shard = this->shardFor(desc);
+    SkAutoSpinlock ac(shard.fLock);
+    if (Strike** existing = shard.fStrikes.find(desc)) {
+        if (!replaceExisting) {
+            (*existing)->fLastUse = fClock.load(std::memory_order_relaxed);
+            return sk_ref_sp(*existing);
+        }
+        replaced = this->internalRemoveStrike(shard, *existing);
+    }
 
-auto SkStrikeCache::internalCreateStrike(
-        const SkDescriptor& desc,
-        std::unique_ptr<SkScalerContext> scaler,
-        SkFontMetrics* maybeMetrics,
-        std::unique_ptr<SkStrikePinner> pinner) -> sk_sp<Strike> {
-    auto strike =
-            sk_make_sp<Strike>(this, desc, std::move(scaler), maybeMetrics, std::move(pinner));
-    this->internalAttachToHead(strike);
+    strike->fLastUse = fClock.fetch_add(1, std::memory_order_relaxed) + 1;
+    strike->fInCache = true;
+    fCacheCount.fetch_add(1, std::memory_order_relaxed);
+    fTotalMemoryUsed.fetch_add(strike->fMemoryUsed, std::memory_order_relaxed);
+    shard.fStrikes.set(SkRef(strike.get()));
     return strike;
 }
 
 void SkStrikeCache::purgeAll() {
-    SkAutoSpinlock ac(fLock);
-    this->internalPurge(fTotalMemoryUsed);
+    SkAutoMutexExclusive ac(fPurgeMutex);
+    this->internalPurge(fTotalMemoryUsed.load(std::memory_order_relaxed));
 }
 
 size_t SkStrikeCache::getTotalMemoryUsed() const {
-    SkAutoSpinlock ac(fLock);
-    return fTotalMemoryUsed;
+    return fTotalMemoryUsed.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::getCacheCountUsed() const {
-    SkAutoSpinlock ac(fLock);
-    return fCacheCount;
+    return fCacheCount.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::getCacheCountLimit() const {
-    SkAutoSpinlock ac(fLock);
-    return fCacheCountLimit;
+    return fCacheCountLimit.load(std::memory_order_relaxed);
 }
 
 size_t SkStrikeCache::setCacheSizeLimit(size_t newLimit) {
-    SkAutoSpinlock ac(fLock);
+    SkAutoMutexExclusive ac(fPurgeMutex);
 
-    size_t prevLimit = fCacheSizeLimit;
-    fCacheSizeLimit = newLimit;
+    size_t prevLimit = fCacheSizeLimit.exchange(newLimit, std::memory_order_relaxed);
     this->internalPurge();
     return prevLimit;
 }
 
 size_t  SkStrikeCache::getCacheSizeLimit() const {
-    SkAutoSpinlock ac(fLock);
-    return fCacheSizeLimit;
+    return fCacheSizeLimit.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::setCacheCountLimit(int newCount) {
@@ -272,17 +277,15 @@ int SkStrikeCache::setCacheCountLimit(int newCount) {
         newCount = 0;
     }
 
-    SkAutoSpinlock ac(fLock);
+    SkAutoMutexExclusive ac(fPurgeMutex);
 
-    int prevCount = fCacheCountLimit;
-    fCacheCountLimit = newCount;
+    int prevCount = fCacheCountLimit.exchange(newCount, std::memory_order_relaxed);
     this->internalPurge();
     return prevCount;
 }
 
 int SkStrikeCache::getCachePointSizeLimit() const {
-    SkAutoSpinlock ac(fLock);
-    return fPointSizeLimit;
+    return fPointSizeLimit.load(std::memory_order_relaxed);
 }
 
 int SkStrikeCache::setCachePointSizeLimit(int newLimit) {
@@ -290,41 +293,81 @@ int SkStrikeCache::setCachePointSizeLimit(int newLimit) {
         newLimit = 0;
     }
 
-    SkAutoSpinlock ac(fLock);
+    return fPointSizeLimit.exchange(newLimit, std::memory_order_relaxed);
+}
 
-    int prevLimit = fPointSizeLimit;
-    fPointSizeLimit = newLimit;
-    return prevLimit;
+void SkStrikeCache::setPersistentCache(sk_sp<SkPersistentStrikeCache> persistentCache) {
+    SkAutoSpinlock ac(fPersistentCacheLock);
+    fPersistentCache = std::move(persistentCache);
+}
+
+auto SkStrikeCache::persistentCache() const -> sk_sp<SkPersistentStrikeCache> {
+    SkAutoSpinlock ac(fPersistentCacheLock);
+    return fPersistentCache;
+}
+
+void SkStrikeCache::setRasterExecutor(SkExecutor* executor) {
+    fRasterExecutor.store(executor, std::memory_order_relaxed);
+}
+
+SkExecutor* SkStrikeCache::rasterExecutor() const {
+    return fRasterExecutor.load(std::memory_order_relaxed);
 }
 
 void SkStrikeCache::forEachStrike(std::function<void(const Strike&)> visitor) const {
-    SkAutoSpinlock ac(fLock);
+    // Strikes are only removed while holding the purge mutex, so holding it keeps them all alive.
+    SkAutoMutexExclusive ac(fPurgeMutex);
 
     this->validate();
 
-    for (Strike* strike = fHead; strike != nullptr; strike = strike->fNext) {
-        visitor(*strike);
+    for (Shard& shard : fShards) {
+        std::vector<const Strike*> strikes;
+        {
+            SkAutoSpinlock as(shard.fLock);
+            strikes.reserve(shard.fStrikes.count());
+            shard.fStrikes.foreach([&](Strike** strike) { strikes.push_back(*strike); });
+        }
+        for (const Strike* strike : strikes) {
+            visitor(*strike);
+        }
+    }
+}
+
+bool SkStrikeCache::overBudget() const {
+    return fTotalMemoryUsed.load(std::memory_order_relaxed) >
+                   fCacheSizeLimit.load(std::memory_order_relaxed) ||
+           fCacheCount.load(std::memory_order_relaxed) >
+                   fCacheCountLimit.load(std::memory_order_relaxed);
+}
+
+void SkStrikeCache::purgeAsNeeded() {
+    if (this->overBudget()) {
+        SkAutoMutexExclusive ac(fPurgeMutex);
+        this->internalPurge();
     }
 }
 
 size_t SkStrikeCache::internalPurge(size_t minBytesNeeded) {
     this->validate();
 
+    const size_t totalMemoryUsed = fTotalMemoryUsed.load(std::memory_order_relaxed);
+    const int    cacheCount      = fCacheCount.load(std::memory_order_relaxed);
+
     size_t bytesNeeded = 0;
-    if (fTotalMemoryUsed > fCacheSizeLimit) {
-        bytesNeeded = fTotalMemoryUsed - fCacheSizeLimit;
+    if (totalMemoryUsed > fCacheSizeLimit) {
+        bytesNeeded = totalMemoryUsed - fCacheSizeLimit;
     }
     bytesNeeded = std::max(bytesNeeded, minBytesNeeded);
     if (bytesNeeded) {
         // no small purges!
-        bytesNeeded = std::max(bytesNeeded, fTotalMemoryUsed >> 2);
+        bytesNeeded = std::max(bytesNeeded, totalMemoryUsed >> 2);
     }
 
     int countNeeded = 0;
-    if (fCacheCount > fCacheCountLimit) {
-        countNeeded = fCacheCount - fCacheCountLimit;
+    if (cacheCount > fCacheCountLimit) {
+        countNeeded = cacheCount - fCacheCountLimit;
         // no small purges!
-        countNeeded = std::max(countNeeded, fCacheCount >> 2);
+        countNeeded = std::max(countNeeded, cacheCount >> 2);
     }
 
     // early exit
@@ -332,23 +375,49 @@ size_t SkStrikeCache::internalPurge(size_t minBytesNeeded) {
         return 0;
     }
 
+    // Strikes found from now on count as used after every strike we are about to look at.
+    const uint32_t now = fClock.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Strikes are only removed from the shards while holding the purge mutex, which we hold, so
+    // these stay in their shards until we remove them below.
+    struct Candidate {
+        Strike*  fStrike;
+        uint32_t fAge;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(cacheCount);
+    for (Shard& shard : fShards) {
+        SkAutoSpinlock ac(shard.fLock);
+        shard.fStrikes.foreach([&](Strike** strike) {
+            candidates.push_back({*strike, now - (*strike)->fLastUse});
+        });
+    }
+
+    // Delete the least recently used strikes first.
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.fAge > b.fAge; });
+
     size_t  bytesFreed = 0;
     int     countFreed = 0;
 
-    // Start at the tail and proceed backwards deleting; the list is in LRU
-    // order, with unimportant entries at the tail.
-    Strike* strike = fTail;
-    while (strike != nullptr && (bytesFreed < bytesNeeded || countFreed < countNeeded)) {
-        Strike* prev = strike->fPrev;
+    std::vector<sk_sp<Strike>> removed;
+    for (const Candidate& candidate : candidates) {
+        if (bytesFreed >= bytesNeeded && countFreed >= countNeeded) {
+            break;
+        }
+        Strike* strike = candidate.fStrike;
+        Shard& shard = this->shardFor(strike->getDescriptor());
+        SkAutoSpinlock ac(shard.fLock);
 
         // Only delete if the strike is not pinned.
         if (strike->fPinner == nullptr || strike->fPinner->canDelete()) {
             bytesFreed += strike->fMemoryUsed;
             countFreed += 1;
-            this->internalRemoveStrike(strike);
+            removed.push_back(this->internalRemoveStrike(shard, strike));
         }
-        strike = prev;
     }
+    // Unref outside of the shard locks; this may delete the scaler contexts.
+    removed.clear();
 
     this->validate();
 
@@ -362,74 +431,44 @@ size_t SkStrikeCache::internalPurge(size_t minBytesNeeded) {
     return bytesFreed;
 }
 
-void SkStrikeCache::internalAttachToHead(sk_sp<Strike> strike) {
-    SkASSERT(nullptr == strike->fPrev && nullptr == strike->fNext);
-
-    fCacheCount += 1;
-    fTotalMemoryUsed += strike->fMemoryUsed;
-
-    if (fHead) {
-        fHead->fPrev = strike.get();
-        strike->fNext = fHead;
-    }
-
-    if (fTail == nullptr) {
-        fTail = strike.get();
-    }
-
-    fHead = strike.release(); // Transfer ownership of strike to the cache list.
-}
-
-void SkStrikeCache::internalRemoveStrike(Strike* strike) {
+auto SkStrikeCache::internalRemoveStrike(Shard& shard, Strike* strike) -> sk_sp<Strike> {
     SkASSERT(fCacheCount > 0);
-    fCacheCount -= 1;
-    fTotalMemoryUsed -= strike->fMemoryUsed;
+    fCacheCount.fetch_sub(1, std::memory_order_relaxed);
+    fTotalMemoryUsed.fetch_sub(strike->fMemoryUsed, std::memory_order_relaxed);
 
-    if (strike->fPrev) {
-        strike->fPrev->fNext = strike->fNext;
-    } else {
-        fHead = strike->fNext;
-    }
-    if (strike->fNext) {
-        strike->fNext->fPrev = strike->fPrev;
-    } else {
-        fTail = strike->fPrev;
-    }
-    strike->fPrev = strike->fNext = nullptr;
-    strike->fRemoved = true;
-    strike->unref();
+    shard.fStrikes.remove(strike->getDescriptor());
+    strike->fInCache = false;
+    return sk_sp<Strike>(strike);  // Transfer ownership of strike from the shard.
 }
 
 void SkStrikeCache::validate() const {
 #ifdef SK_DEBUG
-    size_t computedBytes = 0;
-    int computedCount = 0;
-
-    const Strike* strike = fHead;
-    while (strike != nullptr) {
-        computedBytes += strike->fMemoryUsed;
-        computedCount += 1;
-        strike = strike->fNext;
-    }
-
-    // Can't use SkASSERTF because it looses thread annotations.
-    if (fCacheCount != computedCount) {
-        SkDebugf("fCacheCount: %d, computedCount: %d", fCacheCount, computedCount);
-        SK_ABORT("fCacheCount != computedCount");
-    }
-    if (fTotalMemoryUsed != computedBytes) {
-        SkDebugf("fTotalMemoryUsed: %d, computedBytes: %d", fTotalMemoryUsed, computedBytes);
-        SK_ABORT("fTotalMemoryUsed == computedBytes");
+    // Other threads may be adding strikes or glyphs, so totals can only be checked per shard.
+    for (Shard& shard : fShards) {
+        SkAutoSpinlock ac(shard.fLock);
+        size_t computedBytes = 0;
+        shard.fStrikes.foreach([&](Strike** strike) {
+            if (!(*strike)->fInCache) {
+                SK_ABORT("removed strike is still in its shard");
+            }
+            computedBytes += (*strike)->fMemoryUsed;
+        });
+        if (computedBytes > fTotalMemoryUsed.load(std::memory_order_relaxed)) {
+            SkDebugf("fTotalMemoryUsed: %zu, computedBytes: %zu",
+                     fTotalMemoryUsed.load(std::memory_order_relaxed), computedBytes);
+            SK_ABORT("fTotalMemoryUsed < computedBytes");
+        }
     }
 #endif
 }
 
 void SkStrikeCache::Strike::updateDelta(size_t increase) {
     if (increase != 0) {
-        SkAutoSpinlock lock{fStrikeCache->fLock};
+        SkAutoSpinlock lock{fStrikeCache->shardFor(this->getDescriptor()).fLock};
         fMemoryUsed += increase;
-        if (!fRemoved) {
-            fStrikeCache->fTotalMemoryUsed += increase;
+        // Strikes are counted in full when they are inserted.
+        if (fInCache) {
+            fStrikeCache->fTotalMemoryUsed.fetch_add(increase, std::memory_order_relaxed);
         }
     }
 }
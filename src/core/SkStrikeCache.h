@@ -8,14 +8,19 @@
 #ifndef SkStrikeCache_DEFINED
 #define SkStrikeCache_DEFINED
 
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "include/private/SkMutex.h"
 #include "include/private/SkSpinlock.h"
+#include "include/private/SkTHash.h"
 #include "include/private/SkTemplates.h"
 #include "src/core/SkDescriptor.h"
 #include "src/core/SkScalerCache.h"
 
+class SkExecutor;
+class SkPersistentStrikeCache;
 class SkTraceMemoryDump;
 
 #ifndef SK_DEFAULT_FONT_CACHE_COUNT_LIMIT
@@ -38,9 +43,12 @@ public:
     virtual bool canDelete() = 0;
 };
 
+// Strikes are kept in shards picked by the descriptor hash, each guarded by its own spinlock,
+// so threads finding existing strikes only contend when they look in the same shard. The
+// shards share one budget, enforced by internalPurge().
 class SkStrikeCache final : public SkStrikeForGPUCacheInterface {
 public:
-    SkStrikeCache() = default;
+    SkStrikeCache();
     ~SkStrikeCache() override;
 
     class Strike final : public SkRefCnt, public SkStrikeForGPU {
@@ -95,13 +103,15 @@ public:
 
         SkSpan<const SkGlyph*> prepareImages(SkSpan<const SkPackedGlyphID> glyphIDs,
                                              const SkGlyph* results[]) {
-            auto [glyphs, increase] = fScalerCache.prepareImages(glyphIDs, results);
+            auto [glyphs, increase] = fScalerCache.prepareImages(
+                    glyphIDs, results, fStrikeCache->rasterExecutor());
             this->updateDelta(increase);
             return glyphs;
         }
 
         void prepareForDrawingMasksCPU(SkDrawableGlyphBuffer* drawables) {
-            size_t increase = fScalerCache.prepareForDrawingMasksCPU(drawables);
+            size_t increase = fScalerCache.prepareForDrawingMasksCPU(
+                    drawables, fStrikeCache->rasterExecutor());
             this->updateDelta(increase);
         }
 
@@ -138,12 +148,12 @@ public:
         void updateDelta(size_t increase);
 
         SkStrikeCache* const            fStrikeCache;
-        Strike*                         fNext{nullptr};
-        Strike*                         fPrev{nullptr};
         SkScalerCache                   fScalerCache;
         std::unique_ptr<SkStrikePinner> fPinner;
+        // The following are guarded by the lock of the strike's shard.
         size_t                          fMemoryUsed{sizeof(SkScalerCache)};
-        bool                            fRemoved{false};
+        uint32_t                        fLastUse{0};
+        bool                            fInCache{false};
     };  // Strike
 
     class ExclusiveStrikePtr {
@@ -169,23 +179,23 @@ public:
 
     static SkStrikeCache* GlobalStrikeCache();
 
-    ExclusiveStrikePtr findStrikeExclusive(const SkDescriptor&) SK_EXCLUDES(fLock);
+    ExclusiveStrikePtr findStrikeExclusive(const SkDescriptor&) SK_EXCLUDES(fPurgeMutex);
 
     ExclusiveStrikePtr createStrikeExclusive(
             const SkDescriptor& desc,
             std::unique_ptr<SkScalerContext> scaler,
             SkFontMetrics* maybeMetrics = nullptr,
-            std::unique_ptr<SkStrikePinner> = nullptr) SK_EXCLUDES(fLock);
+            std::unique_ptr<SkStrikePinner> = nullptr) SK_EXCLUDES(fPurgeMutex);
 
     ExclusiveStrikePtr findOrCreateStrikeExclusive(
             const SkDescriptor& desc,
             const SkScalerContextEffects& effects,
-            const SkTypeface& typeface) SK_EXCLUDES(fLock);
+            const SkTypeface& typeface) SK_EXCLUDES(fPurgeMutex);
 
     SkScopedStrikeForGPU findOrCreateScopedStrike(
             const SkDescriptor& desc,
             const SkScalerContextEffects& effects,
-            const SkTypeface& typeface) override SK_EXCLUDES(fLock);
+            const SkTypeface& typeface) override SK_EXCLUDES(fPurgeMutex);
 
     static void PurgeAll();
     static void Dump();
@@ -194,53 +204,105 @@ public:
     // SkTraceMemoryDump interface.
     static void DumpMemoryStatistics(SkTraceMemoryDump* dump);
 
-    void purgeAll() SK_EXCLUDES(fLock); // does not change budget
+    void purgeAll() SK_EXCLUDES(fPurgeMutex); // does not change budget
 
-    int getCacheCountLimit() const SK_EXCLUDES(fLock);
-    int setCacheCountLimit(int limit) SK_EXCLUDES(fLock);
-    int getCacheCountUsed() const SK_EXCLUDES(fLock);
+    int getCacheCountLimit() const;
+    int setCacheCountLimit(int limit) SK_EXCLUDES(fPurgeMutex);
+    int getCacheCountUsed() const;
 
-    size_t getCacheSizeLimit() const SK_EXCLUDES(fLock);
-    size_t setCacheSizeLimit(size_t limit) SK_EXCLUDES(fLock);
-    size_t getTotalMemoryUsed() const SK_EXCLUDES(fLock);
+    size_t getCacheSizeLimit() const;
+    size_t setCacheSizeLimit(size_t limit) SK_EXCLUDES(fPurgeMutex);
+    size_t getTotalMemoryUsed() const;
 
-    int  getCachePointSizeLimit() const SK_EXCLUDES(fLock);
-    int  setCachePointSizeLimit(int limit) SK_EXCLUDES(fLock);
+    int  getCachePointSizeLimit() const;
+    int  setCachePointSizeLimit(int limit);
+
+    // Strikes created by findOrCreateStrikeExclusive() and findOrCreateScopedStrike() from now
+    // on start with any glyphs stored for them in persistentCache. Pass nullptr to stop.
+    void setPersistentCache(sk_sp<SkPersistentStrikeCache> persistentCache);
+
+    // Glyphs missing from a strike when a run is prepared for drawing are measured and
+    // rasterized in parallel on executor, which must outlive its use. Pass nullptr to do it all
+    // on the drawing thread, which is the default.
+    void setRasterExecutor(SkExecutor* executor);
+    SkExecutor* rasterExecutor() const;
 
 private:
-    sk_sp<Strike> internalFindStrikeOrNull(const SkDescriptor& desc) SK_REQUIRES(fLock);
-    sk_sp<Strike> internalCreateStrike(
-            const SkDescriptor& desc,
-            std::unique_ptr<SkScalerContext> scaler,
-            SkFontMetrics* maybeMetrics = nullptr,
-            std::unique_ptr<SkStrikePinner> = nullptr) SK_REQUIRES(fLock);
+    friend class SkPersistentStrikeCache;  // For forEachStrike().
+
+    sk_sp<SkPersistentStrikeCache> persistentCache() const;
+
+    static constexpr int kShardBits = 4;
+    static constexpr int kShardCount = 1 << kShardBits;
+
+    struct StrikeTraits {
+        static const SkDescriptor& GetKey(const Strike* strike) {
+            return strike->getDescriptor();
+        }
+        static uint32_t Hash(const SkDescriptor& desc) { return desc.getChecksum(); }
+    };
+
+    // The hash table holds a ref on each of its strikes.
+    struct Shard {
+        SkSpinlock                                       fLock;
+        SkTHashTable<Strike*, SkDescriptor, StrikeTraits> fStrikes SK_GUARDED_BY(fLock);
+    };
+
+    Shard& shardFor(const SkDescriptor& desc) const {
+        // The shard's hash table indexes by the low bits, so pick the shard with the high ones.
+        return fShards[desc.getChecksum() >> (32 - kShardBits)];
+    }
+
+    sk_sp<Strike> findStrikeOrNull(const SkDescriptor& desc);
+    // Adds the strike to its shard, and returns it. If the shard already has a strike with the
+    // same descriptor, that one is returned instead, unless replaceExisting is true, which
+    // requires the caller to hold fPurgeMutex.
+    sk_sp<Strike> internalInsertStrike(sk_sp<Strike> strike, bool replaceExisting = false);
     sk_sp<Strike> findOrCreateStrike(
             const SkDescriptor& desc,
             const SkScalerContextEffects& effects,
-            const SkTypeface& typeface) SK_EXCLUDES(fLock);
+            const SkTypeface& typeface) SK_EXCLUDES(fPurgeMutex);
+
+    // Removes the strike from the hash table of its shard, whose lock must be held, and returns
+    // the table's ref so the caller can drop it after releasing the lock.
+    sk_sp<Strike> internalRemoveStrike(Shard& shard, Strike* strike);
 
-    // The following methods can only be called when mutex is already held.
-    void internalRemoveStrike(Strike* strike) SK_REQUIRES(fLock);
-    void internalAttachToHead(sk_sp<Strike> strike) SK_REQUIRES(fLock);
+    bool overBudget() const;
+    // Calls internalPurge() if we are over budget.
+    void purgeAsNeeded() SK_EXCLUDES(fPurgeMutex);
 
     // Checkout budgets, modulated by the specified min-bytes-needed-to-purge,
     // and attempt to purge caches to match.
     // Returns number of bytes freed.
-    size_t internalPurge(size_t minBytesNeeded = 0) SK_REQUIRES(fLock);
+    size_t internalPurge(size_t minBytesNeeded = 0) SK_REQUIRES(fPurgeMutex);
 
     // A simple accounting of what each glyph cache reports and the strike cache total.
-    void validate() const SK_REQUIRES(fLock);
-
-    void forEachStrike(std::function<void(const Strike&)> visitor) const SK_EXCLUDES(fLock);
-
-    mutable SkSpinlock fLock;
-    Strike* fHead SK_GUARDED_BY(fLock) {nullptr};
-    Strike* fTail SK_GUARDED_BY(fLock) {nullptr};
-    size_t  fCacheSizeLimit{SK_DEFAULT_FONT_CACHE_LIMIT};
-    size_t  fTotalMemoryUsed SK_GUARDED_BY(fLock) {0};
-    int32_t fCacheCountLimit{SK_DEFAULT_FONT_CACHE_COUNT_LIMIT};
-    int32_t fCacheCount SK_GUARDED_BY(fLock) {0};
-    int32_t fPointSizeLimit{SK_DEFAULT_FONT_CACHE_POINT_SIZE_LIMIT};
+    void validate() const;
+
+    void forEachStrike(std::function<void(const Strike&)> visitor) const SK_EXCLUDES(fPurgeMutex);
+
+    mutable Shard fShards[kShardCount];
+
+    // Serializes purges, and anything else that removes strikes. The shard locks are taken
+    // after it, one at a time.
+    mutable SkMutex fPurgeMutex;
+
+    // Strikes are stamped with this clock when found. It ticks when a strike is created or the
+    // cache goes over budget, so finding a strike does not write to memory shared by all threads.
+    std::atomic<uint32_t> fClock{0};
+
+    // Updated while holding the lock of the shard that changed.
+    std::atomic<size_t>  fTotalMemoryUsed{0};
+    std::atomic<int32_t> fCacheCount{0};
+
+    std::atomic<size_t>  fCacheSizeLimit{SK_DEFAULT_FONT_CACHE_LIMIT};
+    std::atomic<int32_t> fCacheCountLimit{SK_DEFAULT_FONT_CACHE_COUNT_LIMIT};
+    std::atomic<int32_t> fPointSizeLimit{SK_DEFAULT_FONT_CACHE_POINT_SIZE_LIMIT};
+
+    std::atomic<SkExecutor*> fRasterExecutor{nullptr};
+
+    mutable SkSpinlock             fPersistentCacheLock;
+    sk_sp<SkPersistentStrikeCache> fPersistentCache SK_GUARDED_BY(fPersistentCacheLock);
 };
 
 using SkExclusiveStrikePtr = SkStrikeCache::ExclusiveStrikePtr;
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkStrikeSerialization_DEFINED
+#define SkStrikeSerialization_DEFINED
+
+// Helpers for writing strikes to, and reading them from, flat memory. Shared by SkStrikeServer,
+// SkStrikeClient and SkPersistentStrikeCache.
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "src/core/SkDescriptor.h"
+#include "src/core/SkScalerContext.h"
+
+// Copies source_desc into ad, with the typeface's font ID replaced by font_id.
+inline SkDescriptor* auto_descriptor_from_desc(const SkDescriptor* source_desc,
+                                               SkFontID font_id,
+                                               SkAutoDescriptor* ad) {
+    ad->reset(source_desc->getLength());
+    auto* desc = ad->getDesc();
+
+    // Rec.
+    {
+        uint32_t size;
+        auto ptr = source_desc->findEntry(kRec_SkDescriptorTag, &size);
+        SkScalerContextRec rec;
+        std::memcpy((void*)&rec, ptr, size);
+        rec.fFontID = font_id;
+        desc->addEntry(kRec_SkDescriptorTag, sizeof(rec), &rec);
+    }
+
+    // Effects.
+    {
+        uint32_t size;
+        auto ptr = source_desc->findEntry(kEffects_SkDescriptorTag, &size);
+        if (ptr) { desc->addEntry(kEffects_SkDescriptorTag, size, ptr); }
+    }
+
+    desc->computeChecksum();
+    return desc;
+}
+
+// -- Serializer -----------------------------------------------------------------------------------
+inline size_t pad(size_t size, size_t alignment) {
+    return (size + (alignment - 1)) & ~(alignment - 1);
+}
+
+// Alignment between x86 and x64 differs for some types, in particular
+// int64_t and doubles have 4 and 8-byte alignment, respectively.
+// Be consistent even when writing and reading across different architectures.
+template<typename T>
+size_t serialization_alignment() {
+  return sizeof(T) == 8 ? 8 : alignof(T);
+}
+
+class Serializer {
+public:
+    explicit Serializer(std::vector<uint8_t>* buffer) : fBuffer{buffer} {}
+
+    template <typename T, typename... Args>
+    T* emplace(Args&&... args) {
+        auto result = allocate(sizeof(T), serialization_alignment<T>());
+        return new (result) T{std::forward<Args>(args)...};
+    }
+
+    template <typename T>
+    void write(const T& data) {
+        T* result = (T*)allocate(sizeof(T), serialization_alignment<T>());
+        memcpy(result, &data, sizeof(T));
+    }
+
+    template <typename T>
+    T* allocate() {
+        T* result = (T*)allocate(sizeof(T), serialization_alignment<T>());
+        return result;
+    }
+
+    void writeDescriptor(const SkDescriptor& desc) {
+        write(desc.getLength());
+        auto result = allocate(desc.getLength(), alignof(SkDescriptor));
+        memcpy(result, &desc, desc.getLength());
+    }
+
+    void* allocate(size_t size, size_t alignment) {
+        size_t aligned = pad(fBuffer->size(), alignment);
+        fBuffer->resize(aligned + size);
+        return &(*fBuffer)[aligned];
+    }
+
+private:
+    std::vector<uint8_t>* fBuffer;
+};
+
+// -- Deserializer -------------------------------------------------------------------------------
+// Note that the Deserializer is reading untrusted data, we need to guard against invalid data.
+class Deserializer {
+public:
+    Deserializer(const volatile char* memory, size_t memorySize)
+            : fMemory(memory), fMemorySize(memorySize) {}
+
+    template <typename T>
+    bool read(T* val) {
+        auto* result = this->ensureAtLeast(sizeof(T), serialization_alignment<T>());
+        if (!result) return false;
+
+        memcpy(val, const_cast<const char*>(result), sizeof(T));
+        return true;
+    }
+
+    bool readDescriptor(SkAutoDescriptor* ad) {
+        uint32_t descLength = 0u;
+        if (!read<uint32_t>(&descLength)) return false;
+        if (descLength < sizeof(SkDescriptor)) return false;
+        if (descLength != SkAlign4(descLength)) return false;
+
+        auto* result = this->ensureAtLeast(descLength, alignof(SkDescriptor));
+        if (!result) return false;
+
+        ad->reset(descLength);
+        memcpy(ad->getDesc(), const_cast<const char*>(result), descLength);
+
+        if (ad->getDesc()->getLength() > descLength) return false;
+        return ad->getDesc()->isValid();
+    }
+
+    const volatile void* read(size_t size, size_t alignment) {
+      return this->ensureAtLeast(size, alignment);
+    }
+
+    size_t bytesRead() const { return fBytesRead; }
+
+private:
+    const volatile char* ensureAtLeast(size_t size, size_t alignment) {
+        size_t padded = pad(fBytesRead, alignment);
+
+        // Not enough data.
+        if (padded > fMemorySize) return nullptr;
+        if (size > fMemorySize - padded) return nullptr;
+
+        auto* result = fMemory + padded;
+        fBytesRead = padded + size;
+        return result;
+    }
+
+    // Note that we read each piece of memory only once to guard against TOCTOU violations.
+    const volatile char* fMemory;
+    size_t fMemorySize;
+    size_t fBytesRead = 0u;
+};
+
+// Paths use a SkWriter32 which requires 4 byte alignment.
+static constexpr size_t kPathAlignment  = 4u;
+
+#endif  // SkStrikeSerialization_DEFINED
@@ -15,6 +15,8 @@
 #include "src/core/SkImagePriv.h"
 #include "src/core/SkNextID.h"
 
+#include <atomic>
+
 #if SK_SUPPORT_GPU
 #include "include/private/GrRecordingContext.h"
 #include "include/private/GrResourceKey.h"
@@ -178,6 +180,14 @@ static bool generate_pixels(SkImageGenerator* gen, const SkPixmap& pmap, int ori
     return true;
 }
 
+static std::atomic<int32_t> gRasterDecodes{0};
+static std::atomic<int32_t> gRasterDecodesAvoided{0};
+
+SkImage_Lazy::DecodeStats SkImage_Lazy::GetDecodeStats() {
+    return { gRasterDecodes.load(std::memory_order_relaxed),
+             gRasterDecodesAvoided.load(std::memory_order_relaxed) };
+}
+
 bool SkImage_Lazy::getROPixels(SkBitmap* bitmap, SkImage::CachingHint chint) const {
     auto check_output_bitmap = [bitmap]() {
         SkASSERT(bitmap->isImmutable());
@@ -191,20 +201,28 @@ bool SkImage_Lazy::getROPixels(SkBitmap* bitmap, SkImage::CachingHint chint) con
         return true;
     }
 
+    // Every image with this desc shares our generator, so holding its mutex makes us the only
+    // thread that can be decoding these pixels.  Threads that missed the cache while another
+    // thread was decoding wait here, then find that thread's result instead of decoding again.
+    ScopedGenerator generator(fSharedGenerator);
+    if (SkBitmapCache::Find(desc, bitmap)) {
+        gRasterDecodesAvoided.fetch_add(1, std::memory_order_relaxed);
+        check_output_bitmap();
+        return true;
+    }
+    gRasterDecodes.fetch_add(1, std::memory_order_relaxed);
+
     if (SkImage::kAllow_CachingHint == chint) {
         SkPixmap pmap;
         SkBitmapCache::RecPtr cacheRec = SkBitmapCache::Alloc(desc, this->imageInfo(), &pmap);
-        if (!cacheRec ||
-            !generate_pixels(ScopedGenerator(fSharedGenerator), pmap,
-                             fOrigin.x(), fOrigin.y())) {
+        if (!cacheRec || !generate_pixels(generator, pmap, fOrigin.x(), fOrigin.y())) {
             return false;
         }
         SkBitmapCache::Add(std::move(cacheRec), bitmap);
         this->notifyAddedToRasterCache();
     } else {
         if (!bitmap->tryAllocPixels(this->imageInfo()) ||
-            !generate_pixels(ScopedGenerator(fSharedGenerator), bitmap->pixmap(), fOrigin.x(),
-                             fOrigin.y())) {
+            !generate_pixels(generator, bitmap->pixmap(), fOrigin.x(), fOrigin.y())) {
             return false;
         }
         bitmap->setImmutable();
@@ -50,6 +50,15 @@ public:
     sk_sp<SkData> onRefEncoded() const override;
     sk_sp<SkImage> onMakeSubset(GrRecordingContext*, const SkIRect&) const override;
     bool getROPixels(SkBitmap*, CachingHint) const override;
+
+    struct DecodeStats {
+        int32_t fDecodes;         // raster decodes performed by getROPixels()
+        int32_t fDecodesAvoided;  // decodes skipped because another thread had just finished
+                                  // decoding the same pixels into the cache
+    };
+
+    // Returns process-wide totals, for all SkImage_Lazy instances.
+    static DecodeStats GetDecodeStats();
     bool onIsLazyGenerated() const override { return true; }
     sk_sp<SkImage> onMakeColorTypeAndColorSpace(GrRecordingContext*,
                                                 SkColorType, sk_sp<SkColorSpace>) const override;
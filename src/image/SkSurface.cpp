@@ -88,6 +88,18 @@ bool SkSurface_Base::onReplaceBackendTexture(const GrBackendTexture&,
     return false;
 }
 
+SkImageInfo SkSurface_Base::onImageInfo() {
+    return this->getCachedCanvas()->imageInfo();
+}
+
+bool SkSurface_Base::onPeekPixels(SkPixmap* pmap) {
+    return this->getCachedCanvas()->peekPixels(pmap);
+}
+
+bool SkSurface_Base::onReadPixels(const SkPixmap& pm, int srcX, int srcY) {
+    return this->getCachedCanvas()->readPixels(pm, srcX, srcY);
+}
+
 void SkSurface_Base::onDraw(SkCanvas* canvas, SkScalar x, SkScalar y, const SkPaint* paint) {
     auto image = this->makeImageSnapshot();
     if (image) {
@@ -293,10 +305,11 @@ SkSurface::SkSurface(const SkImageInfo& info, const SkSurfaceProps* props)
 
 SkImageInfo SkSurface::imageInfo() {
     // TODO: do we need to go through canvas for this?
-    return this->getCanvas()->imageInfo();
+    return asSB(this)->onImageInfo();
 }
 
 uint32_t SkSurface::generationID() {
+    asSB(this)->onFinishDeferredDraws();
     if (0 == fGenerationID) {
         fGenerationID = asSB(this)->newGenerationID();
     }
@@ -312,6 +325,7 @@ SkCanvas* SkSurface::getCanvas() {
 }
 
 sk_sp<SkImage> SkSurface::makeImageSnapshot() {
+    asSB(this)->onFinishDeferredDraws();
     return asSB(this)->refCachedImage();
 }
 
@@ -325,6 +339,7 @@ sk_sp<SkImage> SkSurface::makeImageSnapshot(const SkIRect& srcBounds) {
     if (bounds == surfBounds) {
         return this->makeImageSnapshot();
     } else {
+        asSB(this)->onFinishDeferredDraws();
         return asSB(this)->onNewImageSnapshot(&bounds);
     }
 }
@@ -343,11 +358,11 @@ void SkSurface::draw(SkCanvas* canvas, SkScalar x, SkScalar y,
 }
 
 bool SkSurface::peekPixels(SkPixmap* pmap) {
-    return this->getCanvas()->peekPixels(pmap);
+    return asSB(this)->onPeekPixels(pmap);
 }
 
 bool SkSurface::readPixels(const SkPixmap& pm, int srcX, int srcY) {
-    return this->getCanvas()->readPixels(pm, srcX, srcY);
+    return asSB(this)->onReadPixels(pm, srcX, srcY);
 }
 
 bool SkSurface::readPixels(const SkImageInfo& dstInfo, void* dstPixels, size_t dstRowBytes,
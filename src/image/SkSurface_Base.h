@@ -49,6 +49,20 @@ public:
 
     virtual void onWritePixels(const SkPixmap&, int x, int y) = 0;
 
+    /**
+     *  Default implementations return the info, and peek and read the pixels, of the cached
+     *  canvas.
+     */
+    virtual SkImageInfo onImageInfo();
+    virtual bool onPeekPixels(SkPixmap*);
+    virtual bool onReadPixels(const SkPixmap&, int srcX, int srcY);
+
+    /**
+     *  Surfaces whose canvas defers its drawing finish that drawing here, before their contents
+     *  are snapshot or their generation ID is read.
+     */
+    virtual void onFinishDeferredDraws() {}
+
     /**
      * Default implementation does a rescale/read and then calls the callback.
      */
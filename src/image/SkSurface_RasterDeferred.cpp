@@ -0,0 +1,214 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
+#include "include/private/SkSemaphore.h"
+#include "src/core/SkRecordDraw.h"
+#include "src/core/SkRecorder.h"
+#include "src/image/SkSurface_Base.h"
+
+// Records the draws to its canvas, and rasterizes them into an ordinary raster surface on a
+// worker thread when flushed. One flushed frame rasterizes while the next is recorded.
+class SkSurface_RasterDeferred : public SkSurface_Base {
+public:
+    SkSurface_RasterDeferred(sk_sp<SkSurface> target, SkExecutor* executor);
+    ~SkSurface_RasterDeferred() override;
+
+    SkCanvas* onNewCanvas() override;
+    sk_sp<SkSurface> onNewSurface(const SkImageInfo&) override;
+    sk_sp<SkImage> onNewImageSnapshot(const SkIRect* subset) override;
+    void onWritePixels(const SkPixmap&, int x, int y) override;
+    SkImageInfo onImageInfo() override { return fTarget->imageInfo(); }
+    bool onPeekPixels(SkPixmap*) override;
+    bool onReadPixels(const SkPixmap&, int srcX, int srcY) override;
+    void onAsyncRescaleAndReadPixels(const SkImageInfo&, const SkIRect& srcRect, RescaleGamma,
+                                     SkFilterQuality, ReadPixelsCallback,
+                                     ReadPixelsContext) override;
+    void onAsyncRescaleAndReadPixelsYUV420(SkYUVColorSpace, sk_sp<SkColorSpace> dstColorSpace,
+                                           const SkIRect& srcRect, const SkISize& dstSize,
+                                           RescaleGamma, SkFilterQuality, ReadPixelsCallback,
+                                           ReadPixelsContext) override;
+    void onDraw(SkCanvas*, SkScalar x, SkScalar y, const SkPaint*) override;
+    // The target surface copies its pixels on write itself, if they're shared with a snapshot.
+    void onCopyOnWrite(ContentChangeMode) override {}
+    GrSemaphoresSubmitted onFlush(BackendSurfaceAccess, const GrFlushInfo&) override;
+    void onFinishDeferredDraws() override;
+
+private:
+    // Hands the draws recorded so far to the worker, once it has finished the ones before.
+    // finishedProc, if any, is called on the worker when they have been drawn.
+    void submit(GrGpuFinishedProc finishedProc, GrGpuFinishedContext finishedContext);
+
+    // Blocks until the worker has finished the draws handed to it.
+    void waitForWorker();
+
+    sk_sp<SkSurface>                              fTarget;
+    SkExecutor*                                   fClientExecutor;
+    std::unique_ptr<SkExecutor>                   fOwnedExecutor;
+    SkExecutor&                                   fExecutor;
+    // Signaled by the worker when it finishes a task. A frame can take a while to draw, so
+    // we block on this rather than spin, as SkTaskGroup::wait() would.
+    SkSemaphore                                   fWorkerDone;
+    bool                                          fWorkerBusy = false;
+
+    SkRecorder*                                   fRecorder = nullptr;  // Owned by our base.
+    sk_sp<SkRecord>                               fRecording;
+
+    // Only touched by the worker while it's busy.
+    sk_sp<SkRecord>                               fRasterizing;
+    std::unique_ptr<SkBigPicture::SnapshotArray>  fRasterizingDrawables;
+
+    typedef SkSurface_Base INHERITED;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkSurface_RasterDeferred::SkSurface_RasterDeferred(sk_sp<SkSurface> target, SkExecutor* executor)
+    : INHERITED(target->imageInfo(), &target->props())
+    , fTarget(std::move(target))
+    , fClientExecutor(executor)
+    , fOwnedExecutor(executor ? nullptr : SkExecutor::MakeFIFOThreadPool(1))
+    , fExecutor(executor ? *executor : *fOwnedExecutor)
+    , fRecording(sk_make_sp<SkRecord>()) {}
+
+SkSurface_RasterDeferred::~SkSurface_RasterDeferred() {
+    // Draws that were never flushed can't be seen by anyone, so they're dropped.
+    this->waitForWorker();
+    if (fRecorder) {
+        fRecorder->forgetRecord();
+    }
+}
+
+SkCanvas* SkSurface_RasterDeferred::onNewCanvas() {
+    fRecorder = new SkRecorder(fRecording.get(), SkRect::Make(fTarget->imageInfo().bounds()));
+    return fRecorder;
+}
+
+sk_sp<SkSurface> SkSurface_RasterDeferred::onNewSurface(const SkImageInfo& info) {
+    return SkSurface::MakeRasterDeferred(info, fClientExecutor, &this->props());
+}
+
+void SkSurface_RasterDeferred::submit(GrGpuFinishedProc finishedProc,
+                                      GrGpuFinishedContext finishedContext) {
+    if (fRecording->count() == 0 && !finishedProc) {
+        return;
+    }
+    this->waitForWorker();
+
+    if (fRecording->count() > 0) {
+        // Our canvas doesn't tell us when it draws, so snapshots are released and the
+        // generation ID changed here instead.
+        this->notifyContentWillChange(kRetain_ContentChangeMode);
+
+        std::unique_ptr<SkDrawableList> drawables = fRecorder->detachDrawableList();
+        fRasterizingDrawables.reset(drawables ? drawables->newDrawableSnapshot() : nullptr);
+        fRasterizing = std::move(fRecording);
+        fRecording = sk_make_sp<SkRecord>();
+        fRecorder->setRecord(fRecording.get());
+    }
+
+    fWorkerBusy = true;
+    fExecutor.add([this, finishedProc, finishedContext] {
+        if (fRasterizing) {
+            // The target's canvas keeps its saves, matrix and clip from frame to frame, just as
+            // our recording canvas does, so each frame is drawn without being wrapped in a save.
+            const SkBigPicture::SnapshotArray* drawables = fRasterizingDrawables.get();
+            SkRecords::Draw draw(fTarget->getCanvas(),
+                                 drawables ? drawables->begin() : nullptr, nullptr,
+                                 drawables ? drawables->count() : 0, &SkMatrix::I());
+            for (int i = 0; i < fRasterizing->count(); i++) {
+                fRasterizing->visit(i, draw);
+            }
+            fRasterizing.reset();
+            fRasterizingDrawables.reset();
+        }
+        if (finishedProc) {
+            finishedProc(finishedContext);
+        }
+        fWorkerDone.signal();
+    });
+}
+
+void SkSurface_RasterDeferred::waitForWorker() {
+    if (fWorkerBusy) {
+        fWorkerDone.wait();
+        fWorkerBusy = false;
+    }
+}
+
+GrSemaphoresSubmitted SkSurface_RasterDeferred::onFlush(BackendSurfaceAccess,
+                                                       const GrFlushInfo& info) {
+    this->submit(info.fFinishedProc, info.fFinishedContext);
+    if (info.fFlags & kSyncCpu_GrFlushFlag) {
+        this->waitForWorker();
+    }
+    return GrSemaphoresSubmitted::kNo;
+}
+
+void SkSurface_RasterDeferred::onFinishDeferredDraws() {
+    this->submit(nullptr, nullptr);
+    this->waitForWorker();
+}
+
+sk_sp<SkImage> SkSurface_RasterDeferred::onNewImageSnapshot(const SkIRect* subset) {
+    this->onFinishDeferredDraws();
+    return subset ? fTarget->makeImageSnapshot(*subset) : fTarget->makeImageSnapshot();
+}
+
+void SkSurface_RasterDeferred::onWritePixels(const SkPixmap& src, int x, int y) {
+    this->onFinishDeferredDraws();
+    fTarget->writePixels(src, x, y);
+}
+
+bool SkSurface_RasterDeferred::onPeekPixels(SkPixmap* pmap) {
+    this->onFinishDeferredDraws();
+    return fTarget->peekPixels(pmap);
+}
+
+bool SkSurface_RasterDeferred::onReadPixels(const SkPixmap& dst, int srcX, int srcY) {
+    this->onFinishDeferredDraws();
+    return fTarget->readPixels(dst, srcX, srcY);
+}
+
+void SkSurface_RasterDeferred::onAsyncRescaleAndReadPixels(const SkImageInfo& info,
+                                                           const SkIRect& srcRect,
+                                                           RescaleGamma rescaleGamma,
+                                                           SkFilterQuality rescaleQuality,
+                                                           ReadPixelsCallback callback,
+                                                           ReadPixelsContext context) {
+    this->onFinishDeferredDraws();
+    fTarget->asyncRescaleAndReadPixels(info, srcRect, rescaleGamma, rescaleQuality, callback,
+                                       context);
+}
+
+void SkSurface_RasterDeferred::onAsyncRescaleAndReadPixelsYUV420(
+        SkYUVColorSpace yuvColorSpace, sk_sp<SkColorSpace> dstColorSpace, const SkIRect& srcRect,
+        const SkISize& dstSize, RescaleGamma rescaleGamma, SkFilterQuality rescaleQuality,
+        ReadPixelsCallback callback, ReadPixelsContext context) {
+    this->onFinishDeferredDraws();
+    fTarget->asyncRescaleAndReadPixelsYUV420(yuvColorSpace, std::move(dstColorSpace), srcRect,
+                                             dstSize, rescaleGamma, rescaleQuality, callback,
+                                             context);
+}
+
+void SkSurface_RasterDeferred::onDraw(SkCanvas* canvas, SkScalar x, SkScalar y,
+                                      const SkPaint* paint) {
+    this->onFinishDeferredDraws();
+    fTarget->draw(canvas, x, y, paint);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+sk_sp<SkSurface> SkSurface::MakeRasterDeferred(const SkImageInfo& info, SkExecutor* executor,
+                                               const SkSurfaceProps* props) {
+    sk_sp<SkSurface> target = SkSurface::MakeRaster(info, props);
+    if (!target) {
+        return nullptr;
+    }
+    return sk_make_sp<SkSurface_RasterDeferred>(std::move(target), executor);
+}
@@ -15,6 +15,11 @@ bool SkJpegEncoder::Encode(SkWStream*, const SkPixmap&, const Options&) { return
 std::unique_ptr<SkEncoder> SkJpegEncoder::Make(SkWStream*, const SkPixmap&, const Options&) {
     return nullptr;
 }
+bool SkJpegEncoder::EncodeYUV(SkWStream*, const SkYUVASizeInfo&,
+                              const void* const[SkYUVASizeInfo::kMaxCount],
+                              SkYUVColorSpace, const Options&) {
+    return false;
+}
 #endif
 
 #ifndef SK_HAS_PNG_LIBRARY
@@ -76,6 +81,13 @@ bool SkEncodeImage(SkWStream* dst, const SkPixmap& src,
 }
 
 bool SkEncoder::encodeRows(int numRows) {
+    if (!fSrc.addr()) {
+        return false;
+    }
+    return this->encodeRemainingRows(numRows);
+}
+
+bool SkEncoder::encodeRemainingRows(int numRows) {
     SkASSERT(numRows > 0 && fCurrRow < fSrc.height());
     if (numRows <= 0 || fCurrRow >= fSrc.height()) {
         return false;
@@ -94,6 +106,21 @@ bool SkEncoder::encodeRows(int numRows) {
     return true;
 }
 
+bool SkEncoder::encodeRows(const SkPixmap& rows) {
+    if (!rows.addr() || rows.width() != fSrc.width() || rows.colorType() != fSrc.colorType() ||
+            rows.alphaType() != fSrc.alphaType() || rows.height() <= 0 ||
+            fCurrRow >= fSrc.height()) {
+        return false;
+    }
+
+    if (!this->onSetRows(&rows)) {
+        return false;
+    }
+    bool result = this->encodeRemainingRows(rows.height());
+    this->onSetRows(nullptr);
+    return result;
+}
+
 sk_sp<SkData> SkEncodePixmap(const SkPixmap& src, SkEncodedImageFormat format, int quality) {
     SkDynamicMemoryWStream stream;
     return SkEncodeImage(&stream, src, format, quality) ? stream.detachAsData() : nullptr;
@@ -23,6 +23,16 @@ static inline bool SkPixmapIsValid(const SkPixmap& src) {
     return true;
 }
 
+// As SkPixmapIsValid(), but |src| may have no pixels, for an encoder that will be given all of
+// its rows with SkEncoder::encodeRows(const SkPixmap&).
+static inline bool SkPixmapInfoIsValid(const SkPixmap& src) {
+    if (!SkImageInfoIsValid(src.info())) {
+        return false;
+    }
+
+    return !src.addr() || src.rowBytes() >= src.info().minRowBytes();
+}
+
 #if defined(SK_BUILD_FOR_MAC) || defined(SK_BUILD_FOR_IOS)
     bool SkEncodeImageWithCG(SkWStream*, const SkPixmap&, SkEncodedImageFormat);
 #else
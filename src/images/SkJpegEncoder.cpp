@@ -18,6 +18,7 @@
 #include "src/images/SkImageEncoderFns.h"
 #include "src/images/SkJPEGWriteUtility.h"
 
+#include <algorithm>
 #include <stdio.h>
 
 extern "C" {
@@ -44,6 +45,16 @@ public:
 
     transform_scanline_proc proc() const { return fProc; }
 
+    // Rows passed to SkEncoder::encodeRows(const SkPixmap&) start at row |top| of the image.
+    void setRows(const SkPixmap* rows, int top) {
+        fRows = rows;
+        fRowsTop = top;
+    }
+
+    const void* srcRow(const SkPixmap& src, int y) const {
+        return fRows ? fRows->addr(0, y - fRowsTop) : src.addr(0, y);
+    }
+
     ~SkJpegEncoderMgr() {
         jpeg_destroy_compress(&fCInfo);
     }
@@ -64,6 +75,8 @@ private:
     skjpeg_error_mgr        fErrMgr;
     skjpeg_destination_mgr  fDstMgr;
     transform_scanline_proc fProc;
+    const SkPixmap*         fRows = nullptr;
+    int                     fRowsTop = 0;
 };
 
 bool SkJpegEncoderMgr::setParams(const SkImageInfo& srcInfo, const SkJpegEncoder::Options& options)
@@ -166,7 +179,7 @@ bool SkJpegEncoderMgr::setParams(const SkImageInfo& srcInfo, const SkJpegEncoder
 
 std::unique_ptr<SkEncoder> SkJpegEncoder::Make(SkWStream* dst, const SkPixmap& src,
                                                const Options& options) {
-    if (!SkPixmapIsValid(src)) {
+    if (!SkPixmapInfoIsValid(src)) {
         return nullptr;
     }
 
@@ -209,6 +222,11 @@ SkJpegEncoder::SkJpegEncoder(std::unique_ptr<SkJpegEncoderMgr> encoderMgr, const
 
 SkJpegEncoder::~SkJpegEncoder() {}
 
+bool SkJpegEncoder::onSetRows(const SkPixmap* rows) {
+    fEncoderMgr->setRows(rows, fCurrRow);
+    return true;
+}
+
 bool SkJpegEncoder::onEncodeRows(int numRows) {
     skjpeg_error_mgr::AutoPushJmpBuf jmp(fEncoderMgr->errorMgr());
     if (setjmp(jmp)) {
@@ -218,8 +236,8 @@ bool SkJpegEncoder::onEncodeRows(int numRows) {
     const size_t srcBytes = SkColorTypeBytesPerPixel(fSrc.colorType()) * fSrc.width();
     const size_t jpegSrcBytes = fEncoderMgr->cinfo()->input_components * fSrc.width();
 
-    const void* srcRow = fSrc.addr(0, fCurrRow);
     for (int i = 0; i < numRows; i++) {
+        const void* srcRow = fEncoderMgr->srcRow(fSrc, fCurrRow + i);
         JSAMPLE* jpegSrcRow = (JSAMPLE*) srcRow;
         if (fEncoderMgr->proc()) {
             sk_msan_assert_initialized(srcRow, SkTAddOffset<const void>(srcRow, srcBytes));
@@ -238,7 +256,6 @@ bool SkJpegEncoder::onEncodeRows(int numRows) {
         }
 
         jpeg_write_scanlines(fEncoderMgr->cinfo(), &jpegSrcRow, 1);
-        srcRow = SkTAddOffset<const void>(srcRow, fSrc.rowBytes());
     }
 
     fCurrRow += numRows;
@@ -254,4 +271,113 @@ bool SkJpegEncoder::Encode(SkWStream* dst, const SkPixmap& src, const Options& o
     return encoder.get() && encoder->encodeRows(src.height());
 }
 
+// Returns the chroma sampling factor (1 or 2) for one dimension, or 0 if |chroma| is not a
+// valid downsampling of |luma|.
+static int yuv_sampling_factor(int luma, int chroma) {
+    if (chroma == luma) {
+        return 1;
+    }
+    if (chroma == (luma + 1) / 2) {
+        return 2;
+    }
+    return 0;
+}
+
+bool SkJpegEncoder::EncodeYUV(SkWStream* dst, const SkYUVASizeInfo& sizeInfo,
+                              const void* const planes[SkYUVASizeInfo::kMaxCount],
+                              SkYUVColorSpace colorSpace, const Options& options) {
+    if (kJPEG_SkYUVColorSpace != colorSpace) {
+        return false;
+    }
+
+    const SkISize& ySize = sizeInfo.fSizes[0];
+    const SkISize& uvSize = sizeInfo.fSizes[1];
+    if (ySize.isEmpty() || uvSize.isEmpty() || uvSize != sizeInfo.fSizes[2]) {
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!planes[i] || sizeInfo.fWidthBytes[i] < (size_t) sizeInfo.fSizes[i].width()) {
+            return false;
+        }
+    }
+
+    // The downsampling is implied by the plane sizes.  We support the same factors that
+    // Downsample exposes: 4:2:0, 4:2:2 and 4:4:4.
+    const int hSamp = yuv_sampling_factor(ySize.width(), uvSize.width());
+    const int vSamp = yuv_sampling_factor(ySize.height(), uvSize.height());
+    if (!hSamp || !vSamp || (1 == hSamp && 2 == vSamp)) {
+        return false;
+    }
+
+    // In raw data mode, libjpeg-turbo reads every component in whole 8x8 blocks, and we must
+    // hand it a full iMCU row (8 rows of each chroma block, vSamp*8 rows of luma) per call.
+    // Rows past the bottom of a plane simply repeat the last row.  Columns past the width are
+    // read directly from the plane when its widthBytes cover them (as SkCodec guarantees);
+    // otherwise the rows are copied into a small scratch strip and padded by replication.
+    const int rowsPerPass[3] = { vSamp * DCTSIZE, DCTSIZE, DCTSIZE };
+    SkAutoTMalloc<uint8_t> scratch[3];
+    for (int i = 0; i < 3; i++) {
+        const size_t paddedWidth = SkAlign8(sizeInfo.fSizes[i].width());
+        if (sizeInfo.fWidthBytes[i] < paddedWidth) {
+            scratch[i].reset(rowsPerPass[i] * paddedWidth);
+        }
+    }
+
+    std::unique_ptr<SkJpegEncoderMgr> encoderMgr = SkJpegEncoderMgr::Make(dst);
+
+    skjpeg_error_mgr::AutoPushJmpBuf jmp(encoderMgr->errorMgr());
+    if (setjmp(jmp)) {
+        return false;
+    }
+
+    jpeg_compress_struct* cinfo = encoderMgr->cinfo();
+    cinfo->image_width = ySize.width();
+    cinfo->image_height = ySize.height();
+    cinfo->in_color_space = JCS_YCbCr;
+    cinfo->input_components = 3;
+    jpeg_set_defaults(cinfo);
+
+    cinfo->raw_data_in = TRUE;
+    cinfo->comp_info[0].h_samp_factor = hSamp;
+    cinfo->comp_info[0].v_samp_factor = vSamp;
+    cinfo->comp_info[1].h_samp_factor = 1;
+    cinfo->comp_info[1].v_samp_factor = 1;
+    cinfo->comp_info[2].h_samp_factor = 1;
+    cinfo->comp_info[2].v_samp_factor = 1;
+
+    // See SkJpegEncoderMgr::setParams().
+    cinfo->optimize_coding = TRUE;
+
+    jpeg_set_quality(cinfo, options.fQuality, TRUE);
+    jpeg_start_compress(cinfo, TRUE);
+
+    JSAMPROW rows[3][2 * DCTSIZE];
+    JSAMPARRAY rowArrays[3] = { rows[0], rows[1], rows[2] };
+    for (int y = 0; y < ySize.height(); y += rowsPerPass[0]) {
+        for (int i = 0; i < 3; i++) {
+            const int width = sizeInfo.fSizes[i].width();
+            const int height = sizeInfo.fSizes[i].height();
+            const size_t paddedWidth = SkAlign8(width);
+            const int firstRow = (0 == i) ? y : y / vSamp;
+            for (int r = 0; r < rowsPerPass[i]; r++) {
+                const int srcRow = std::min(firstRow + r, height - 1);
+                const uint8_t* src = SkTAddOffset<const uint8_t>(planes[i],
+                                                                 srcRow * sizeInfo.fWidthBytes[i]);
+                if (scratch[i]) {
+                    uint8_t* dstRow = scratch[i].get() + r * paddedWidth;
+                    memcpy(dstRow, src, width);
+                    memset(dstRow + width, src[width - 1], paddedWidth - width);
+                    src = dstRow;
+                }
+                rows[i][r] = const_cast<JSAMPROW>(src);
+            }
+        }
+
+        jpeg_write_raw_data(cinfo, rowArrays, rowsPerPass[0]);
+    }
+
+    jpeg_finish_compress(cinfo);
+    return true;
+}
+
 #endif
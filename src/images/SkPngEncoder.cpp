@@ -64,6 +64,16 @@ public:
     int pngBytesPerPixel() const { return fPngBytesPerPixel; }
     transform_scanline_proc proc() const { return fProc; }
 
+    // Rows passed to SkEncoder::encodeRows(const SkPixmap&) start at row |top| of the image.
+    void setRows(const SkPixmap* rows, int top) {
+        fRows = rows;
+        fRowsTop = top;
+    }
+
+    const void* srcRow(const SkPixmap& src, int y) const {
+        return fRows ? fRows->addr(0, y - fRowsTop) : src.addr(0, y);
+    }
+
     ~SkPngEncoderMgr() {
         png_destroy_write_struct(&fPngPtr, &fInfoPtr);
     }
@@ -79,6 +89,8 @@ private:
     png_infop               fInfoPtr;
     int                     fPngBytesPerPixel;
     transform_scanline_proc fProc;
+    const SkPixmap*         fRows = nullptr;
+    int                     fRowsTop = 0;
 };
 
 std::unique_ptr<SkPngEncoderMgr> SkPngEncoderMgr::Make(SkWStream* stream) {
@@ -394,7 +406,7 @@ void SkPngEncoderMgr::chooseProc(const SkImageInfo& srcInfo) {
 
 std::unique_ptr<SkEncoder> SkPngEncoder::Make(SkWStream* dst, const SkPixmap& src,
                                               const Options& options) {
-    if (!SkPixmapIsValid(src)) {
+    if (!SkPixmapInfoIsValid(src)) {
         return nullptr;
     }
 
@@ -427,13 +439,18 @@ SkPngEncoder::SkPngEncoder(std::unique_ptr<SkPngEncoderMgr> encoderMgr, const Sk
 
 SkPngEncoder::~SkPngEncoder() {}
 
+bool SkPngEncoder::onSetRows(const SkPixmap* rows) {
+    fEncoderMgr->setRows(rows, fCurrRow);
+    return true;
+}
+
 bool SkPngEncoder::onEncodeRows(int numRows) {
     if (setjmp(png_jmpbuf(fEncoderMgr->pngPtr()))) {
         return false;
     }
 
-    const void* srcRow = fSrc.addr(0, fCurrRow);
     for (int y = 0; y < numRows; y++) {
+        const void* srcRow = fEncoderMgr->srcRow(fSrc, fCurrRow + y);
         sk_msan_assert_initialized(srcRow,
                                    (const uint8_t*)srcRow + (fSrc.width() << fSrc.shiftPerPixel()));
         fEncoderMgr->proc()((char*)fStorage.get(),
@@ -443,7 +460,6 @@ bool SkPngEncoder::onEncodeRows(int numRows) {
 
         png_bytep rowPtr = (png_bytep) fStorage.get();
         png_write_rows(fEncoderMgr->pngPtr(), &rowPtr, 1);
-        srcRow = SkTAddOffset<const void>(srcRow, fSrc.rowBytes());
     }
 
     fCurrRow += numRows;
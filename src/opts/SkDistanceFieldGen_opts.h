@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkDistanceFieldGen_opts_DEFINED
+#define SkDistanceFieldGen_opts_DEFINED
+
+#include "include/private/SkNx.h"
+
+namespace SK_OPTS_NS {
+
+// dst and src point at squared distances, with the x and y components of the vectors to the
+// nearest edges following them in planes stride floats apart. For each of the count pixels of
+// dst that is not an edge, tries the pixels of src to its upper (dy = -1) or lower (dy = 1)
+// left, straight up or down, and upper or lower right, in that order, and keeps the first one
+// that is nearer. The arithmetic matches the scalar passes of SkDistanceFieldGen.cpp exactly.
+static void distance_field_nearest_row_scalar(float dst[], const float src[],
+                                              const uint8_t edges[], int count, int stride,
+                                              float dy) {
+    for (int i = 0; i < count; i++) {
+        if (edges[i]) {
+            continue;
+        }
+        float* curr = dst + i;
+        const float* check = src + i - 1;
+        float distSq = check[0] - 2.0f*(check[stride] - dy*check[2*stride] - 1.0f);
+        if (distSq < curr[0]) {
+            curr[0] = distSq;
+            curr[stride] = check[stride] - 1.0f;
+            curr[2*stride] = check[2*stride] + dy;
+        }
+        check = src + i;
+        distSq = check[0] + 2.0f*(dy*check[2*stride]) + 1.0f;
+        if (distSq < curr[0]) {
+            curr[0] = distSq;
+            curr[stride] = check[stride];
+            curr[2*stride] = check[2*stride] + dy;
+        }
+        check = src + i + 1;
+        distSq = check[0] + 2.0f*(check[stride] + dy*check[2*stride] + 1.0f);
+        if (distSq < curr[0]) {
+            curr[0] = distSq;
+            curr[stride] = check[stride] + 1.0f;
+            curr[2*stride] = check[2*stride] + dy;
+        }
+    }
+}
+
+/*not static*/ inline void distance_field_nearest_row(float dst[], const float src[],
+                                                      const uint8_t edges[], int count, int stride,
+                                                      float dy) {
+    const Sk4f two(2.0f), one(1.0f), vdy(dy);
+    auto load = [stride](const float* p, Sk4f* distSq, Sk4f* x, Sk4f* y) {
+        *distSq = Sk4f::Load(p);
+        *x      = Sk4f::Load(p + stride);
+        *y      = Sk4f::Load(p + 2*stride);
+    };
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Sk4f isEdge = Sk4f(edges[i], edges[i+1], edges[i+2], edges[i+3]) > 0.0f;
+        if (isEdge.allTrue()) {
+            continue;
+        }
+        float* curr = dst + i;
+        Sk4f distSq, x, y;
+        load(curr, &distSq, &x, &y);
+        Sk4f edgeDistSq = distSq, edgeX = x, edgeY = y;
+
+        Sk4f checkDistSq, checkX, checkY;
+        load(src + i - 1, &checkDistSq, &checkX, &checkY);
+        Sk4f candidate = checkDistSq - two*(checkX - vdy*checkY - one);
+        Sk4f nearer = candidate < distSq;
+        distSq = nearer.thenElse(candidate, distSq);
+        x      = nearer.thenElse(checkX - one, x);
+        y      = nearer.thenElse(checkY + vdy, y);
+
+        load(src + i, &checkDistSq, &checkX, &checkY);
+        candidate = checkDistSq + two*(vdy*checkY) + one;
+        nearer = candidate < distSq;
+        distSq = nearer.thenElse(candidate, distSq);
+        x      = nearer.thenElse(checkX, x);
+        y      = nearer.thenElse(checkY + vdy, y);
+
+        load(src + i + 1, &checkDistSq, &checkX, &checkY);
+        candidate = checkDistSq + two*(checkX + vdy*checkY + one);
+        nearer = candidate < distSq;
+        distSq = nearer.thenElse(candidate, distSq);
+        x      = nearer.thenElse(checkX + one, x);
+        y      = nearer.thenElse(checkY + vdy, y);
+
+        // Edge pixels keep their distances.
+        isEdge.thenElse(edgeDistSq, distSq).store(curr);
+        isEdge.thenElse(edgeX, x).store(curr + stride);
+        isEdge.thenElse(edgeY, y).store(curr + 2*stride);
+    }
+    distance_field_nearest_row_scalar(dst + i, src + i, edges + i, count - i, stride, dy);
+}
+
+}  // namespace SK_OPTS_NS
+
+#endif  // SkDistanceFieldGen_opts_DEFINED
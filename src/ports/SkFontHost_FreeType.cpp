@@ -9,12 +9,14 @@
 #include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
 #include "include/core/SkFontMetrics.h"
+#include "include/core/SkGraphics.h"
 #include "include/core/SkPath.h"
 #include "include/core/SkStream.h"
 #include "include/core/SkString.h"
 #include "include/private/SkColorData.h"
 #include "include/private/SkMalloc.h"
 #include "include/private/SkMutex.h"
+#include "include/private/SkTHash.h"
 #include "include/private/SkTemplates.h"
 #include "include/private/SkTo.h"
 #include "src/core/SkAdvancedTypefaceMetrics.h"
@@ -25,11 +27,13 @@
 #include "src/core/SkMask.h"
 #include "src/core/SkMaskGamma.h"
 #include "src/core/SkScalerContext.h"
+#include "src/core/SkTLazy.h"
 #include "src/ports/SkFontHost_FreeType_common.h"
 #include "src/sfnt/SkOTUtils.h"
 #include "src/utils/SkCallableTraits.h"
 #include "src/utils/SkMatrix22.h"
 
+#include <atomic>
 #include <memory>
 
 #include <ft2build.h>
@@ -130,6 +134,7 @@ public:
         , fLibrary(nullptr)
         , fIsLCDSupported(false)
         , fLightHintingIsYOnly(false)
+        , fFacesAreIndependent(false)
         , fLCDExtra(0)
     {
         if (FT_New_Library(&gFTMemory, &fLibrary)) {
@@ -177,6 +182,16 @@ public:
         }
 #endif
 
+// Before 2.6.2 the rasterizers shared a render pool owned by the FT_Library, so only one face
+// could load or render a glyph at a time.
+#if SK_FREETYPE_MINIMUM_RUNTIME_VERSION >= 0x02060200
+        fFacesAreIndependent = true;
+#else
+        if (major > 2 || ((major == 2 && minor > 6) || (major == 2 && minor == 6 && patch >= 2))) {
+            fFacesAreIndependent = true;
+        }
+#endif
+
 // The 'light' hinting is vertical only starting in 2.8.0.
 #if SK_FREETYPE_MINIMUM_RUNTIME_VERSION >= 0x02080000
         fLightHintingIsYOnly = true;
@@ -217,6 +232,7 @@ public:
     bool isLCDSupported() { return fIsLCDSupported; }
     int lcdExtra() { return fLCDExtra; }
     bool lightHintingIsYOnly() { return fLightHintingIsYOnly; }
+    bool facesAreIndependent() { return fFacesAreIndependent; }
 
     // FT_Get_{MM,Var}_{Blend,Design}_Coordinates were added in FreeType 2.7.1.
     // Prior to this there was no way to get the coordinates out of the FT_Face.
@@ -235,6 +251,7 @@ private:
     FT_Library fLibrary;
     bool fIsLCDSupported;
     bool fLightHintingIsYOnly;
+    bool fFacesAreIndependent;
     int fLCDExtra;
 
     // FT_Library_SetLcdFilterWeights was introduced in FreeType 2.4.0.
@@ -254,6 +271,8 @@ private:
 
 struct SkFaceRec;
 
+// Guards the FT_Library, its reference count, and the list of shared faces. FT_Open_Face and
+// FT_Done_Face must be called with this held. Work on a face only needs the face's own mutex.
 static SkMutex& f_t_mutex() {
     static SkMutex& mutex = *(new SkMutex);
     return mutex;
@@ -302,6 +321,11 @@ struct SkFaceRec {
     uint32_t fRefCnt;
     uint32_t fFontID;
 
+    // Guards fFace and its sizes. Take this before f_t_mutex(), never while holding it.
+    SkMutex fMutex;
+    // Shared faces are in the gFaceRecHead list; others belong to a single scaler context.
+    bool fShared;
+
     // FreeType prior to 2.7.1 does not implement retreiving variation design metrics.
     // Cache the variation design metrics used to create the font if the user specifies them.
     SkAutoSTMalloc<4, SkFixed> fAxes;
@@ -337,7 +361,7 @@ extern "C" {
 
 SkFaceRec::SkFaceRec(std::unique_ptr<SkStreamAsset> stream, uint32_t fontID)
         : fNext(nullptr), fSkStream(std::move(stream)), fRefCnt(1), fFontID(fontID)
-        , fAxesCount(0), fNamedVariationSpecified(false)
+        , fShared(true), fAxesCount(0), fNamedVariationSpecified(false)
 {
     sk_bzero(&fFTStream, sizeof(fFTStream));
     fFTStream.size = fSkStream->getLength();
@@ -390,12 +414,21 @@ static void ft_face_setup_axes(SkFaceRec* rec, const SkFontData& data) {
     }
 }
 
-// Will return nullptr on failure
+// Each exclusive face takes the memory and setup of a face of its own, so only this many are
+// opened for each typeface. Scaler contexts past those share the typeface's shared face.
+#ifndef SK_FREETYPE_EXCLUSIVE_FACES_PER_TYPEFACE
+    #define SK_FREETYPE_EXCLUSIVE_FACES_PER_TYPEFACE 4
+#endif
+
+// The number of exclusive faces open for each typeface, by font ID.
 // Caller must lock f_t_mutex() before calling this function.
-static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
+static SkTHashMap<SkFontID, int>& exclusive_face_counts() {
     f_t_mutex().assertHeld();
+    static auto& counts = *(new SkTHashMap<SkFontID, int>);
+    return counts;
+}
 
-    const SkFontID fontID = typeface->uniqueID();
+static SkFaceRec* find_shared_ft_face(SkFontID fontID) {
     SkFaceRec* cachedRec = gFaceRecHead;
     while (cachedRec) {
         if (cachedRec->fFontID == fontID) {
@@ -405,12 +438,41 @@ static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
         }
         cachedRec = cachedRec->fNext;
     }
+    return nullptr;
+}
+
+// Will return nullptr on failure
+// Caller must lock f_t_mutex() before calling this function.
+// If exclusive is true, the font data is in memory, and the typeface has fewer than
+// SK_FREETYPE_EXCLUSIVE_FACES_PER_TYPEFACE exclusive faces, a new face is opened for the caller
+// alone so that it can be used without contending with other users of the typeface.
+static SkFaceRec* ref_ft_face(const SkTypeface* typeface, bool exclusive = false) {
+    f_t_mutex().assertHeld();
+
+    const SkFontID fontID = typeface->uniqueID();
+    if (exclusive) {
+        const int* count = exclusive_face_counts().find(fontID);
+        exclusive = !count || *count < SK_FREETYPE_EXCLUSIVE_FACES_PER_TYPEFACE;
+    }
+    if (!exclusive) {
+        if (SkFaceRec* cachedRec = find_shared_ft_face(fontID)) {
+            return cachedRec;
+        }
+    }
 
     std::unique_ptr<SkFontData> data = typeface->makeFontData();
     if (nullptr == data || !data->hasStream()) {
         return nullptr;
     }
 
+    // A face read through a stream may hold a file open; share those rather than multiply them.
+    if (exclusive && !data->getStream()->getMemoryBase()) {
+        exclusive = false;
+        if (SkFaceRec* cachedRec = find_shared_ft_face(fontID)) {
+            return cachedRec;
+        }
+    }
+
     std::unique_ptr<SkFaceRec> rec(new SkFaceRec(data->detachStream(), fontID));
 
     FT_Open_Args args;
@@ -448,8 +510,18 @@ static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
         FT_Select_Charmap(rec->fFace.get(), FT_ENCODING_MS_SYMBOL);
     }
 
-    rec->fNext = gFaceRecHead;
-    gFaceRecHead = rec.get();
+    if (exclusive) {
+        rec->fShared = false;
+        int* count = exclusive_face_counts().find(fontID);
+        if (count) {
+            *count += 1;
+        } else {
+            exclusive_face_counts().set(fontID, 1);
+        }
+    } else {
+        rec->fNext = gFaceRecHead;
+        gFaceRecHead = rec.get();
+    }
     return rec.release();
 }
 
@@ -458,6 +530,17 @@ static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
 extern /*static*/ void unref_ft_face(SkFaceRec* faceRec) {
     f_t_mutex().assertHeld();
 
+    if (!faceRec->fShared) {
+        SkASSERT(faceRec->fRefCnt == 1);
+        int* count = exclusive_face_counts().find(faceRec->fFontID);
+        SkASSERT(count && *count > 0);
+        if (--*count == 0) {
+            exclusive_face_counts().remove(faceRec->fFontID);
+        }
+        delete faceRec;
+        return;
+    }
+
     SkFaceRec*  rec = gFaceRecHead;
     SkFaceRec*  prev = nullptr;
     while (rec) {
@@ -479,20 +562,51 @@ extern /*static*/ void unref_ft_face(SkFaceRec* faceRec) {
     SkDEBUGFAIL("shouldn't get here, face not in list");
 }
 
+// Locks a face for use. Separate faces may be used on separate threads at the same time, unless
+// the FreeType library in use predates that, in which case f_t_mutex() is also held.
+class AutoFTFaceLock {
+public:
+    explicit AutoFTFaceLock(SkFaceRec* rec) SK_NO_THREAD_SAFETY_ANALYSIS
+            : fFaceRec(rec)
+            , fLockLibrary(!gFTLibrary->facesAreIndependent()) {
+        fFaceRec->fMutex.acquire();
+        if (fLockLibrary) {
+            f_t_mutex().acquire();
+        }
+    }
+
+    ~AutoFTFaceLock() SK_NO_THREAD_SAFETY_ANALYSIS {
+        if (fLockLibrary) {
+            f_t_mutex().release();
+        }
+        fFaceRec->fMutex.release();
+    }
+
+private:
+    SkFaceRec* fFaceRec;
+    bool fLockLibrary;
+};
+
 class AutoFTAccess {
 public:
     AutoFTAccess(const SkTypeface* tf) : fFaceRec(nullptr) {
-        f_t_mutex().acquire();
-        SkASSERT_RELEASE(ref_ft_library());
-        fFaceRec = ref_ft_face(tf);
+        {
+            SkAutoMutexExclusive ac(f_t_mutex());
+            SkASSERT_RELEASE(ref_ft_library());
+            fFaceRec = ref_ft_face(tf);
+        }
+        if (fFaceRec) {
+            fFaceLock.init(fFaceRec);
+        }
     }
 
     ~AutoFTAccess() {
+        fFaceLock.reset();
+        SkAutoMutexExclusive ac(f_t_mutex());
         if (fFaceRec) {
             unref_ft_face(fFaceRec);
         }
         unref_ft_library();
-        f_t_mutex().release();
     }
 
     FT_Face face() { return fFaceRec ? fFaceRec->fFace.get() : nullptr; }
@@ -504,6 +618,7 @@ public:
 
 private:
     SkFaceRec* fFaceRec;
+    SkTLazy<AutoFTFaceLock> fFaceLock;
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -531,7 +646,7 @@ private:
     using UnrefFTFace = SkFunctionWrapper<decltype(unref_ft_face), unref_ft_face>;
     std::unique_ptr<SkFaceRec, UnrefFTFace> fFaceRec;
 
-    FT_Face   fFace;  // Borrowed face from gFaceRecHead.
+    FT_Face   fFace;  // Borrowed from fFaceRec, which is usually not shared with other scalers.
     FT_Size   fFTSize;  // The size on the fFace for this scaler.
     FT_Int    fStrikeIndex;
 
@@ -549,13 +664,21 @@ private:
     bool      fDoLinearMetrics;
     bool      fLCDIsVert;
 
+    /** If true, paths are the typeface's cached outlines in font units mapped by fOutlineMatrix,
+        as long as the cache has them or has room for them. */
+    bool      fUseOutlineCache;
+    SkMatrix  fOutlineMatrix;
+
     FT_Error setupSize();
     void getBBoxForCurrentGlyph(const SkGlyph* glyph, FT_BBox* bbox,
                                 bool snapToPixelBoundary = false);
     bool getCBoxForLetter(char letter, FT_BBox* bbox);
-    // Caller must lock f_t_mutex() before calling this function.
+    // Gets the outline in font units from the typeface's cache, loading and adding it on a miss.
+    // Returns false if it isn't cached and there's no room to cache it.
+    bool getCachedOutline(SkGlyphID glyphID, SkPath* path);
+    // Caller must lock the face (AutoFTFaceLock) before calling this function.
     void updateGlyphIfLCD(SkGlyph* glyph);
-    // Caller must lock f_t_mutex() before calling this function.
+    // Caller must lock the face (AutoFTFaceLock) before calling this function.
     // update FreeType2 glyph slot with glyph emboldened
     void emboldenIfNeeded(FT_Face face, FT_GlyphSlot glyph, SkGlyphID gid);
     bool shouldSubpixelBitmap(const SkGlyph&, const SkMatrix&);
@@ -848,11 +971,15 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(sk_sp<SkTypeface> typeface,
     , fFace(nullptr)
     , fFTSize(nullptr)
     , fStrikeIndex(-1)
+    , fUseOutlineCache(false)
 {
-    SkAutoMutexExclusive  ac(f_t_mutex());
-    SkASSERT_RELEASE(ref_ft_library());
+    {
+        SkAutoMutexExclusive  ac(f_t_mutex());
+        SkASSERT_RELEASE(ref_ft_library());
 
-    fFaceRec.reset(ref_ft_face(this->getTypeface()));
+        // Use a face of our own if we can, so our glyphs don't wait on other scalers.
+        fFaceRec.reset(ref_ft_face(this->getTypeface(), true));
+    }
 
     // load the font file
     if (nullptr == fFaceRec) {
@@ -860,6 +987,8 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(sk_sp<SkTypeface> typeface,
         return;
     }
 
+    AutoFTFaceLock  ac(fFaceRec.get());
+
     fLCDIsVert = SkToBool(fRec.fFlags & SkScalerContext::kLCD_Vertical_Flag);
 
     // compute the flags we send to Load_Glyph
@@ -1021,18 +1150,30 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(sk_sp<SkTypeface> typeface,
     FT_Palette_Select(fFaceRec->fFace.get(), 0, nullptr);
 #endif
 
+    // Without hinting, FreeType only scales the outline to the size and applies fMatrix22, so
+    // an outline in font units can be mapped to this size without going through FreeType.
+    FT_Face face = fFaceRec->fFace.get();
+    fUseOutlineCache = FT_IS_SCALABLE(face) && !FT_IS_TRICKY(face) &&
+                       (fLoadGlyphFlags & FT_LOAD_NO_HINTING) &&
+                       !this->isVertical() &&
+                       !(fRec.fFlags & SkScalerContext::kEmbolden_Flag);
+    // x_scale and y_scale map font units to 26.6 pixels.
+    fOutlineMatrix = fMatrix22Scalar;
+    fOutlineMatrix.preScale(SkFT_FixedToScalar(ftSize->metrics.x_scale) / 64,
+                            SkFT_FixedToScalar(ftSize->metrics.y_scale) / 64);
+
     fFTSize = ftSize.release();
-    fFace = fFaceRec->fFace.get();
+    fFace = face;
     fDoLinearMetrics = linearMetrics;
 }
 
 SkScalerContext_FreeType::~SkScalerContext_FreeType() {
-    SkAutoMutexExclusive  ac(f_t_mutex());
-
     if (fFTSize != nullptr) {
+        AutoFTFaceLock  ac(fFaceRec.get());
         FT_Done_Size(fFTSize);
     }
 
+    SkAutoMutexExclusive  ac(f_t_mutex());
     fFaceRec = nullptr;
 
     unref_ft_library();
@@ -1042,7 +1183,7 @@ SkScalerContext_FreeType::~SkScalerContext_FreeType() {
     this face with other context (at different sizes).
 */
 FT_Error SkScalerContext_FreeType::setupSize() {
-    f_t_mutex().assertHeld();
+    fFaceRec->fMutex.assertHeld();
     FT_Error err = FT_Activate_Size(fFTSize);
     if (err != 0) {
         return err;
@@ -1063,7 +1204,7 @@ bool SkScalerContext_FreeType::generateAdvance(SkGlyph* glyph) {
         return false;
     }
 
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    AutoFTFaceLock  ac(fFaceRec.get());
 
     if (this->setupSize()) {
         glyph->zeroMetrics();
@@ -1168,7 +1309,7 @@ bool SkScalerContext_FreeType::shouldSubpixelBitmap(const SkGlyph& glyph, const
 }
 
 void SkScalerContext_FreeType::generateMetrics(SkGlyph* glyph) {
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    AutoFTFaceLock  ac(fFaceRec.get());
 
     glyph->fMaskFormat = fRec.fMaskFormat;
 
@@ -1320,7 +1461,7 @@ void SkScalerContext_FreeType::generateMetrics(SkGlyph* glyph) {
 }
 
 void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph) {
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    AutoFTFaceLock  ac(fFaceRec.get());
 
     if (this->setupSize()) {
         sk_bzero(glyph.fImage, glyph.imageSize());
@@ -1350,10 +1491,78 @@ void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph) {
 }
 
 
+// The bytes of outlines cached by all typefaces together.
+static std::atomic<size_t> gOutlineCacheBytes{0};
+
+SkTypeface_FreeType::~SkTypeface_FreeType() {
+    SkAutoMutexExclusive ac(fOutlineCacheMutex);
+    gOutlineCacheBytes.fetch_sub(fOutlineCacheBytes, std::memory_order_relaxed);
+}
+
+bool SkScalerContext_FreeType::getCachedOutline(SkGlyphID glyphID, SkPath* path) {
+    const SkTypeface_FreeType* typeface = static_cast<SkTypeface_FreeType*>(this->getTypeface());
+    {
+        SkAutoMutexExclusive ac(typeface->fOutlineCacheMutex);
+        if (const SkPath* outline = typeface->fOutlineCache.find(glyphID)) {
+            *path = *outline;
+            return true;
+        }
+        if (typeface->fOutlineCacheBytes >= SK_FREETYPE_OUTLINE_CACHE_LIMIT ||
+            gOutlineCacheBytes.load(std::memory_order_relaxed) >=
+                    SkGraphics::GetFontCacheLimit() / 4)
+        {
+            return false;
+        }
+    }
+
+    {
+        AutoFTFaceLock  ac(fFaceRec.get());
+
+        // Font units, untransformed. The next setupSize() puts back the size and transform.
+        FT_Set_Transform(fFace, nullptr, nullptr);
+        FT_Error err = FT_Load_Glyph(fFace, glyphID, FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP);
+        if (err != 0 || fFace->glyph->format != FT_GLYPH_FORMAT_OUTLINE) {
+            path->reset();
+            return false;
+        }
+
+        // generateGlyphPath() reads points as 26.6, so make font units 26.6 too. Otherwise the
+        // on-curve points FreeType puts between off-curve ones would be rounded to whole units.
+        FT_Outline& outline = fFace->glyph->outline;
+        for (int i = 0; i < outline.n_points; i++) {
+            outline.points[i].x *= 64;
+            outline.points[i].y *= 64;
+        }
+        if (!generateGlyphPath(fFace, path)) {
+            path->reset();
+            return false;
+        }
+    }
+
+    SkAutoMutexExclusive ac(typeface->fOutlineCacheMutex);
+    size_t bytes = path->approximateBytesUsed();
+    if (typeface->fOutlineCacheBytes + bytes <= SK_FREETYPE_OUTLINE_CACHE_LIMIT &&
+        gOutlineCacheBytes.load(std::memory_order_relaxed) + bytes <=
+                SkGraphics::GetFontCacheLimit() / 4 &&
+        !typeface->fOutlineCache.find(glyphID))
+    {
+        typeface->fOutlineCache.set(glyphID, *path);
+        typeface->fOutlineCacheBytes += bytes;
+        gOutlineCacheBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    return true;
+}
+
 bool SkScalerContext_FreeType::generatePath(SkGlyphID glyphID, SkPath* path) {
     SkASSERT(path);
 
-    SkAutoMutexExclusive  ac(f_t_mutex());
+    // Outlines the cache can't hold are loaded at this size, as they would be without it.
+    if (fUseOutlineCache && this->getCachedOutline(glyphID, path)) {
+        path->transform(fOutlineMatrix);
+        return true;
+    }
+
+    AutoFTFaceLock  ac(fFaceRec.get());
 
     // FT_IS_SCALABLE is documented to mean the face contains outline glyphs.
     if (!FT_IS_SCALABLE(fFace) || this->setupSize()) {
@@ -1394,7 +1603,7 @@ void SkScalerContext_FreeType::generateFontMetrics(SkFontMetrics* metrics) {
         return;
     }
 
-    SkAutoMutexExclusive ac(f_t_mutex());
+    AutoFTFaceLock  ac(fFaceRec.get());
 
     if (this->setupSize()) {
         sk_bzero(metrics, sizeof(*metrics));
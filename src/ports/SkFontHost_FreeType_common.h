@@ -9,9 +9,11 @@
 #ifndef SKFONTHOST_FREETYPE_COMMON_H_
 #define SKFONTHOST_FREETYPE_COMMON_H_
 
+#include "include/core/SkPath.h"
 #include "include/core/SkTypeface.h"
 #include "include/core/SkTypes.h"
 #include "include/private/SkMutex.h"
+#include "include/private/SkTHash.h"
 #include "src/core/SkGlyph.h"
 #include "src/core/SkScalerContext.h"
 #include "src/utils/SkCharToGlyphCache.h"
@@ -34,6 +36,12 @@ const char* SkTraceFtrGetError(int);
 #define SK_TRACEFTR(ERR, ...) do { sk_ignore_unused_variable(ERR); } while (false)
 #endif
 
+// The most bytes of unhinted outlines each typeface keeps for its scaler contexts. All
+// typefaces together also keep at most a quarter of SkGraphics::GetFontCacheLimit().
+#ifndef SK_FREETYPE_OUTLINE_CACHE_LIMIT
+    #define SK_FREETYPE_OUTLINE_CACHE_LIMIT (32 * 1024)
+#endif
+
 
 class SkScalerContext_FreeType_Base : public SkScalerContext {
 protected:
@@ -92,6 +100,7 @@ protected:
     SkTypeface_FreeType(const SkFontStyle& style, bool isFixedPitch)
         : INHERITED(style, isFixedPitch)
     {}
+    ~SkTypeface_FreeType() override;
 
     std::unique_ptr<SkFontData> cloneFontData(const SkFontArguments&) const;
     virtual SkScalerContext* onCreateScalerContext(const SkScalerContextEffects&,
@@ -118,9 +127,20 @@ protected:
     sk_sp<SkData> onCopyTableData(SkFontTableTag) const override;
 
 private:
+    friend class SkScalerContext_FreeType;  // For the outline cache.
+
     mutable SkMutex fC2GCacheMutex;
     mutable SkCharToGlyphCache fC2GCache;
 
+    // Unhinted glyph outlines in font units, shared by the scaler contexts of this typeface so
+    // that a new size transforms them instead of loading them from the font again. Outlines are
+    // added until they take SK_FREETYPE_OUTLINE_CACHE_LIMIT bytes, or the outlines of all
+    // typefaces take their share of the font cache limit, and then kept as they are. Other
+    // glyphs are then loaded from FreeType at each size, as they would be without the cache.
+    mutable SkMutex fOutlineCacheMutex;
+    mutable SkTHashMap<SkGlyphID, SkPath> fOutlineCache SK_GUARDED_BY(fOutlineCacheMutex);
+    mutable size_t fOutlineCacheBytes SK_GUARDED_BY(fOutlineCacheMutex) = 0;
+
     typedef SkTypeface INHERITED;
 };
 
@@ -8,14 +8,22 @@
 #include "include/codec/SkCodec.h"
 #include "include/core/SkData.h"
 #include "include/core/SkImage.h"
+#include "include/private/SkTo.h"
 #include "include/utils/SkAnimCodecPlayer.h"
 #include "src/codec/SkCodecImageGenerator.h"
+#include "src/core/SkTaskGroup.h"
 #include <algorithm>
 
-SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec) : fCodec(std::move(codec)) {
+SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec)
+    : SkAnimCodecPlayer(std::move(codec), CacheOptions()) {}
+
+SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec, const CacheOptions& options)
+        : fCodec(std::move(codec))
+        , fOptions(options) {
     fImageInfo = fCodec->getInfo();
     fFrameInfos = fCodec->getFrameInfo();
     fImages.resize(fFrameInfos.size());
+    fLastUsed.resize(fFrameInfos.size());
 
     // change the interpretation of fDuration to a end-time for that frame
     size_t dur = 0;
@@ -31,22 +39,28 @@ SkAnimCodecPlayer::SkAnimCodecPlayer(std::unique_ptr<SkCodec> codec) : fCodec(st
         fImages.clear();
         fImages.push_back(SkImage::MakeFromGenerator(
                               SkCodecImageGenerator::MakeFromCodec(std::move(fCodec))));
+        fCachedCount = 1;
     }
 }
 
-SkAnimCodecPlayer::~SkAnimCodecPlayer() {}
+SkAnimCodecPlayer::~SkAnimCodecPlayer() {
+    // Stop any decode-ahead before the codec goes away.
+    fAheadFrom = -1;
+    if (fAheadTasks) {
+        fAheadTasks->wait();
+    }
+}
 
 SkISize SkAnimCodecPlayer::dimensions() {
     return { fImageInfo.width(), fImageInfo.height() };
 }
 
-sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
-    SkASSERT((unsigned)index < fFrameInfos.size());
-
-    if (fImages[index]) {
-        return fImages[index];
-    }
+int SkAnimCodecPlayer::cachedFrameCount() {
+    SkAutoMutexExclusive lock(fMutex);
+    return fCachedCount;
+}
 
+sk_sp<SkImage> SkAnimCodecPlayer::decodeFrame(int index, const sk_sp<SkImage>& prior) {
     size_t rb = fImageInfo.minRowBytes();
     size_t size = fImageInfo.computeByteSize(rb);
     auto data = SkData::MakeUninitialized(size);
@@ -54,27 +68,136 @@ sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
     SkCodec::Options opts;
     opts.fFrameIndex = index;
 
-    const int requiredFrame = fFrameInfos[index].fRequiredFrame;
-    if (requiredFrame != SkCodec::kNoFrame) {
-        auto requiredImage = fImages[requiredFrame];
-        SkPixmap requiredPM;
-        if (requiredImage && requiredImage->peekPixels(&requiredPM)) {
-            sk_careful_memcpy(data->writable_data(), requiredPM.addr(), size);
-            opts.fPriorFrame = requiredFrame;
-        }
+    SkPixmap requiredPM;
+    if (prior && prior->peekPixels(&requiredPM)) {
+        sk_careful_memcpy(data->writable_data(), requiredPM.addr(), size);
+        opts.fPriorFrame = fFrameInfos[index].fRequiredFrame;
     }
     if (SkCodec::kSuccess == fCodec->getPixels(fImageInfo, data->writable_data(), rb, &opts)) {
-        return fImages[index] = SkImage::MakeRasterData(fImageInfo, std::move(data), rb);
+        return SkImage::MakeRasterData(fImageInfo, std::move(data), rb);
     }
     return nullptr;
 }
 
+// The current frame and the frames being decoded ahead of it are never evicted.
+bool SkAnimCodecPlayer::isProtected(int index) const {
+    const int from = fAheadFrom;
+    if (from < 0) {
+        return false;
+    }
+    const int frameCount = SkToInt(fFrameInfos.size());
+    int window = fOptions.fExecutor ? fOptions.fDecodeAhead : 0;
+    if (fOptions.fMaxCachedFrames > 0) {
+        window = std::min(window, fOptions.fMaxCachedFrames - 1);
+    }
+    return (index - from + frameCount) % frameCount <= window;
+}
+
+void SkAnimCodecPlayer::cacheFrame(int index, sk_sp<SkImage> image) {
+    SkASSERT(!fImages[index]);
+
+    while (fOptions.fMaxCachedFrames > 0 && fCachedCount >= fOptions.fMaxCachedFrames) {
+        // Evict the least recently used frame, keeping keyframes as long as possible: any
+        // later frame can be decoded starting from one without going back further.
+        int victim = -1;
+        bool victimIsKeyframe = true;
+        for (int i = 0; i < SkToInt(fImages.size()); ++i) {
+            if (!fImages[i] || this->isProtected(i)) {
+                continue;
+            }
+            const bool isKeyframe = fFrameInfos[i].fRequiredFrame == SkCodec::kNoFrame;
+            if (victim < 0 || (victimIsKeyframe && !isKeyframe) ||
+                (victimIsKeyframe == isKeyframe && fLastUsed[i] < fLastUsed[victim])) {
+                victim = i;
+                victimIsKeyframe = isKeyframe;
+            }
+        }
+        if (victim < 0) {
+            break;
+        }
+        fImages[victim].reset();
+        fCachedCount--;
+    }
+
+    fImages[index] = std::move(image);
+    fLastUsed[index] = ++fUseCount;
+    fCachedCount++;
+}
+
+sk_sp<SkImage> SkAnimCodecPlayer::getFrameAt(int index) {
+    SkASSERT((unsigned)index < fFrameInfos.size());
+
+    if (fImages[index]) {
+        fLastUsed[index] = ++fUseCount;
+        return fImages[index];
+    }
+
+    // Walk back through the required frames to the nearest one we still have (or one that
+    // needs no prior frame), then decode forward from there, keeping each frame on the way.
+    std::vector<int> toDecode = { index };
+    sk_sp<SkImage> prior;
+    for (int required = fFrameInfos[index].fRequiredFrame; required != SkCodec::kNoFrame;
+         required = fFrameInfos[required].fRequiredFrame) {
+        if (fImages[required]) {
+            prior = fImages[required];
+            fLastUsed[required] = ++fUseCount;
+            break;
+        }
+        toDecode.push_back(required);
+    }
+
+    for (auto i = toDecode.rbegin(); i != toDecode.rend(); ++i) {
+        prior = this->decodeFrame(*i, prior);
+        if (!prior) {
+            return nullptr;
+        }
+        this->cacheFrame(*i, prior);
+    }
+    return prior;
+}
+
+void SkAnimCodecPlayer::decodeAhead(int from) {
+    if (!fOptions.fExecutor || fOptions.fDecodeAhead <= 0) {
+        return;
+    }
+    if (!fAheadTasks) {
+        fAheadTasks.reset(new SkTaskGroup(*fOptions.fExecutor));
+    }
+
+    int count = std::min(fOptions.fDecodeAhead, SkToInt(fFrameInfos.size()) - 1);
+    if (fOptions.fMaxCachedFrames > 0) {
+        count = std::min(count, fOptions.fMaxCachedFrames - 1);
+    }
+    fAheadTasks->add([this, from, count] {
+        for (int i = 1; i <= count; ++i) {
+            SkAutoMutexExclusive lock(fMutex);
+            if (fAheadFrom != from) {
+                return;  // The player has moved on.
+            }
+            this->getFrameAt((from + i) % SkToInt(fFrameInfos.size()));
+        }
+    });
+}
+
 sk_sp<SkImage> SkAnimCodecPlayer::getFrame() {
     SkASSERT(fTotalDuration > 0 || fImages.size() == 1);
 
-    return fTotalDuration > 0
-        ? this->getFrameAt(fCurrIndex)
-        : fImages.front();
+    if (!fTotalDuration) {
+        return fImages.front();
+    }
+
+    const int index = fCurrIndex;
+    const bool moved = fAheadFrom.exchange(index) != index;
+
+    sk_sp<SkImage> frame;
+    {
+        SkAutoMutexExclusive lock(fMutex);
+        frame = this->getFrameAt(index);
+    }
+    if (moved) {
+        this->decodeAhead(index);
+    }
+    return frame;
 }
 
 bool SkAnimCodecPlayer::seek(uint32_t msec) {
@@ -92,5 +215,3 @@ bool SkAnimCodecPlayer::seek(uint32_t msec) {
     fCurrIndex = lower - fFrameInfos.begin();
     return fCurrIndex != prevIndex;
 }
-
-
@@ -11,9 +11,14 @@
 #include "include/core/SkPictureRecorder.h"
 #include "include/core/SkSerialProcs.h"
 #include "include/core/SkStream.h"
+#include "include/core/SkTypeface.h"
 #include "include/private/SkTArray.h"
+#include "include/private/SkTHash.h"
 #include "include/private/SkTo.h"
 #include "include/utils/SkNWayCanvas.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkReadBuffer.h"
+#include "src/core/SkWriteBuffer.h"
 #include "src/utils/SkMultiPictureDocumentPriv.h"
 
 #include <limits.h>
@@ -22,13 +27,26 @@
   File format:
       BEGINNING_OF_FILE:
         kMagic
-        uint32_t version_number (==2)
+        uint32_t version_number (==3)
         uint32_t page_count
         {
           float sizeX
           float sizeY
         } * page_count
-        skp file
+        uint32_t typeface_count
+        uint32_t image_count
+        uint32_t typeface_serializer * typeface_count
+        {
+          uint64_t offset
+          uint64_t size
+        } * (typeface_count + image_count + page_count)
+        typefaces, images and pages, at the offsets from the beginning of the file given above
+
+  Each page is a flattened picture that refers to typefaces and images by their index, so any
+  page can be read on its own. A typeface_serializer of 1 marks a typeface written by the
+  SkSerialProcs typeface proc, and 0 one written by SkTypeface::serialize(). Version 2 files
+  have a single skp file after the page sizes, which draws every page followed by a kEndPage
+  annotation.
 */
 
 namespace {
@@ -37,35 +55,110 @@ static constexpr char kMagic[] = "Skia Multi-Picture Doc\n\n";
 
 static constexpr char kEndPage[] = "SkMultiPictureEndPage";
 
-const uint32_t kVersion = 2;
+const uint32_t kVersion = 3;
+const uint32_t kUnindexedVersion = 2;
+
+enum TypefaceSerializer : uint32_t {
+    kDefault_TypefaceSerializer = 0,  // SkTypeface::serialize()
+    kProc_TypefaceSerializer    = 1,  // SkSerialProcs::fTypefaceProc
+};
+
+struct IndexEntry {
+    uint64_t fOffset;
+    uint64_t fSize;
+};
+
+// Pages refer to the typefaces and images they share by index.
+static sk_sp<SkData> make_index_data(int index) {
+    int32_t value = index;
+    return SkData::MakeWithCopy(&value, sizeof(value));
+}
 
-static SkSize join(const SkTArray<SkSize>& sizes) {
-    SkSize joined = {0, 0};
-    for (SkSize s : sizes) {
-        joined = SkSize{std::max(joined.width(), s.width()), std::max(joined.height(), s.height())};
+static bool read_index_data(const void* data, size_t length, int count, int* index) {
+    int32_t value;
+    if (length != sizeof(value)) {
+        return false;
     }
-    return joined;
+    memcpy(&value, data, sizeof(value));
+    *index = value;
+    return value >= 0 && value < count;
+}
+
+template <typename T>
+static int add_shared(T* object, SkTHashMap<uint32_t, int>* indices, SkTArray<sk_sp<T>>* objects) {
+    if (int* index = indices->find(object->uniqueID())) {
+        return *index;
+    }
+    objects->push_back(sk_ref_sp(object));
+    return *indices->set(object->uniqueID(), objects->count() - 1);
 }
 
 struct MultiPictureDocument final : public SkDocument {
     const SkSerialProcs fProcs;
     SkPictureRecorder fPictureRecorder;
     SkSize fCurrentPageSize;
-    SkTArray<sk_sp<SkPicture>> fPages;
+    SkTArray<sk_sp<SkData>> fPages;
     SkTArray<SkSize> fSizes;
+    SkTArray<sk_sp<SkTypeface>> fTypefaces;
+    SkTArray<sk_sp<SkImage>> fImages;
+    SkTHashMap<uint32_t, int> fTypefaceIndices;
+    SkTHashMap<uint32_t, int> fImageIndices;
     MultiPictureDocument(SkWStream* s, const SkSerialProcs* procs)
         : SkDocument(s)
         , fProcs(procs ? *procs : SkSerialProcs())
     {}
     ~MultiPictureDocument() override { this->close(); }
 
+    static sk_sp<SkData> SerializeTypeface(SkTypeface* typeface, void* ctx) {
+        auto doc = static_cast<MultiPictureDocument*>(ctx);
+        return make_index_data(add_shared(typeface, &doc->fTypefaceIndices, &doc->fTypefaces));
+    }
+    static sk_sp<SkData> SerializeImage(SkImage* image, void* ctx) {
+        auto doc = static_cast<MultiPictureDocument*>(ctx);
+        return make_index_data(add_shared(image, &doc->fImageIndices, &doc->fImages));
+    }
+
+    sk_sp<SkData> serializeTypeface(SkTypeface* typeface, TypefaceSerializer* serializer) const {
+        if (fProcs.fTypefaceProc) {
+            if (auto data = fProcs.fTypefaceProc(typeface, fProcs.fTypefaceCtx)) {
+                *serializer = kProc_TypefaceSerializer;
+                return data;
+            }
+        }
+        *serializer = kDefault_TypefaceSerializer;
+        return typeface->serialize();
+    }
+    sk_sp<SkData> serializeImage(SkImage* image) const {
+        // Like SkBinaryWriteBuffer::writeImage(), where empty data reads back as an empty image.
+        sk_sp<SkData> data;
+        if (fProcs.fImageProc) {
+            data = fProcs.fImageProc(image, fProcs.fImageCtx);
+        }
+        if (!data) {
+            data = image->encodeToData();
+        }
+        return data ? data : SkData::MakeEmpty();
+    }
+
     SkCanvas* onBeginPage(SkScalar w, SkScalar h) override {
         fCurrentPageSize.set(w, h);
         return fPictureRecorder.beginRecording(w, h);
     }
     void onEndPage() override {
         fSizes.push_back(fCurrentPageSize);
-        fPages.push_back(fPictureRecorder.finishRecordingAsPicture());
+        sk_sp<SkPicture> page = fPictureRecorder.finishRecordingAsPicture();
+
+        SkSerialProcs procs = fProcs;
+        procs.fTypefaceProc = SerializeTypeface;
+        procs.fTypefaceCtx = this;
+        procs.fImageProc = SerializeImage;
+        procs.fImageCtx = this;
+        SkBinaryWriteBuffer buffer;
+        buffer.setSerialProcs(procs);
+        SkPicturePriv::Flatten(page, buffer);
+        sk_sp<SkData> data = SkData::MakeUninitialized(buffer.bytesWritten());
+        buffer.writeToMemory(data->writable_data());
+        fPages.push_back(std::move(data));
     }
     void onClose(SkWStream* wStream) override {
         SkASSERT(wStream);
@@ -76,22 +169,44 @@ struct MultiPictureDocument final : public SkDocument {
         for (SkSize s : fSizes) {
             wStream->write(&s, sizeof(s));
         }
-        SkSize bigsize = join(fSizes);
-        SkCanvas* c = fPictureRecorder.beginRecording(SkRect::MakeSize(bigsize));
-        for (const sk_sp<SkPicture>& page : fPages) {
-            c->drawPicture(page);
-            // Annotations must include some data.
-            c->drawAnnotation(SkRect::MakeEmpty(), kEndPage, SkData::MakeWithCString("X"));
+
+        SkTArray<sk_sp<SkData>> entries;
+        SkTArray<TypefaceSerializer> serializers;
+        serializers.push_back_n(fTypefaces.count());
+        for (int i = 0; i < fTypefaces.count(); i++) {
+            entries.push_back(this->serializeTypeface(fTypefaces[i].get(), &serializers[i]));
         }
-        sk_sp<SkPicture> p = fPictureRecorder.finishRecordingAsPicture();
-        p->serialize(wStream, &fProcs);
-        fPages.reset();
-        fSizes.reset();
-        return;
+        for (const sk_sp<SkImage>& image : fImages) {
+            entries.push_back(this->serializeImage(image.get()));
+        }
+        entries.push_back_n(fPages.count(), fPages.begin());
+        wStream->write32(SkToU32(fTypefaces.count()));
+        wStream->write32(SkToU32(fImages.count()));
+        for (TypefaceSerializer serializer : serializers) {
+            wStream->write32(serializer);
+        }
+
+        uint64_t offset = wStream->bytesWritten() + entries.count() * sizeof(IndexEntry);
+        for (const sk_sp<SkData>& data : entries) {
+            IndexEntry entry = {offset, data->size()};
+            wStream->write(&entry, sizeof(entry));
+            offset += data->size();
+        }
+        for (const sk_sp<SkData>& data : entries) {
+            wStream->write(data->data(), data->size());
+        }
+        this->reset();
     }
     void onAbort() override {
+        this->reset();
+    }
+    void reset() {
         fPages.reset();
         fSizes.reset();
+        fTypefaces.reset();
+        fImages.reset();
+        fTypefaceIndices.reset();
+        fImageIndices.reset();
     }
 };
 }
@@ -102,7 +217,9 @@ sk_sp<SkDocument> SkMakeMultiPictureDocument(SkWStream* wStream, const SkSerialP
 
 ////////////////////////////////////////////////////////////////////////////////
 
-int SkMultiPictureDocumentReadPageCount(SkStreamSeekable* stream) {
+// Reads the header up to the page sizes, and returns the page count, or 0 if the stream is not a
+// document that we can read.
+static int read_header(SkStreamSeekable* stream, uint32_t* version) {
     if (!stream) {
         return 0;
     }
@@ -110,11 +227,9 @@ int SkMultiPictureDocumentReadPageCount(SkStreamSeekable* stream) {
     const size_t size = sizeof(kMagic) - 1;
     char buffer[size];
     if (size != stream->read(buffer, size) || 0 != memcmp(kMagic, buffer, size)) {
-        stream = nullptr;
         return 0;
     }
-    uint32_t versionNumber;
-    if (!stream->readU32(&versionNumber) || versionNumber != kVersion) {
+    if (!stream->readU32(version) || (*version != kVersion && *version != kUnindexedVersion)) {
         return 0;
     }
     uint32_t pageCount;
@@ -125,6 +240,11 @@ int SkMultiPictureDocumentReadPageCount(SkStreamSeekable* stream) {
     return SkTo<int>(pageCount);
 }
 
+int SkMultiPictureDocumentReadPageCount(SkStreamSeekable* stream) {
+    uint32_t version;
+    return read_header(stream, &version);
+}
+
 bool SkMultiPictureDocumentReadPageSizes(SkStreamSeekable* stream,
                                          SkDocumentPage* dstArray,
                                          int dstArrayCount) {
@@ -174,15 +294,12 @@ struct PagerCanvas : public SkNWayCanvas {
         }
     }
 };
-}  // namespace
 
-bool SkMultiPictureDocumentRead(SkStreamSeekable* stream,
-                                SkDocumentPage* dstArray,
-                                int dstArrayCount,
-                                const SkDeserialProcs* procs) {
-    if (!SkMultiPictureDocumentReadPageSizes(stream, dstArray, dstArrayCount)) {
-        return false;
-    }
+// Reads the pages of a version 2 document, with the stream positioned after the page sizes.
+static bool read_unindexed_pages(SkStreamSeekable* stream,
+                                 SkDocumentPage* dstArray,
+                                 int dstArrayCount,
+                                 const SkDeserialProcs* procs) {
     SkSize joined = {0.0f, 0.0f};
     for (int i = 0; i < dstArrayCount; ++i) {
         joined = SkSize{std::max(joined.width(), dstArray[i].fSize.width()),
@@ -190,6 +307,9 @@ bool SkMultiPictureDocumentRead(SkStreamSeekable* stream,
     }
 
     auto picture = SkPicture::MakeFromStream(stream, procs);
+    if (!picture) {
+        return false;
+    }
 
     PagerCanvas canvas(joined.toCeil(), dstArray, dstArrayCount);
     // Must call playback(), not drawPicture() to reach
@@ -201,3 +321,232 @@ bool SkMultiPictureDocumentRead(SkStreamSeekable* stream,
     }
     return true;
 }
+
+class UnindexedReader final : public SkMultiPictureDocumentReader {
+public:
+    explicit UnindexedReader(SkTArray<SkDocumentPage> pages) : fPages(std::move(pages)) {}
+
+    int pageCount() const override { return fPages.count(); }
+    SkSize pageSize(int pageIndex) const override {
+        return pageIndex >= 0 && pageIndex < fPages.count() ? fPages[pageIndex].fSize
+                                                            : SkSize{0, 0};
+    }
+    sk_sp<SkPicture> readPage(int pageIndex) override {
+        return pageIndex >= 0 && pageIndex < fPages.count() ? fPages[pageIndex].fPicture
+                                                            : nullptr;
+    }
+
+private:
+    SkTArray<SkDocumentPage> fPages;
+};
+
+class IndexedReader final : public SkMultiPictureDocumentReader {
+public:
+    IndexedReader(SkStreamSeekable* stream, const SkDeserialProcs& procs, SkTArray<SkSize> sizes,
+                  SkTArray<IndexEntry> entries, SkTArray<uint32_t> typefaceSerializers,
+                  int imageCount)
+            : fStream(stream)
+            , fProcs(procs)
+            , fSizes(std::move(sizes))
+            , fEntries(std::move(entries))
+            , fTypefaceSerializers(std::move(typefaceSerializers))
+            , fTypefaces(fTypefaceSerializers.count())
+            , fImages(imageCount) {
+        fTypefaces.push_back_n(fTypefaceSerializers.count());
+        fImages.push_back_n(imageCount);
+    }
+
+    int pageCount() const override { return fSizes.count(); }
+    SkSize pageSize(int pageIndex) const override {
+        return pageIndex >= 0 && pageIndex < fSizes.count() ? fSizes[pageIndex] : SkSize{0, 0};
+    }
+
+    sk_sp<SkPicture> readPage(int pageIndex) override {
+        if (pageIndex < 0 || pageIndex >= fSizes.count()) {
+            return nullptr;
+        }
+        sk_sp<SkData> data =
+                this->readEntry(fTypefaces.count() + fImages.count() + pageIndex);
+        if (!data) {
+            return nullptr;
+        }
+        SkDeserialProcs procs = fProcs;
+        procs.fTypefaceProc = DeserializeTypeface;
+        procs.fTypefaceCtx = this;
+        procs.fImageProc = DeserializeImage;
+        procs.fImageCtx = this;
+        SkReadBuffer buffer(data->data(), data->size());
+        buffer.setDeserialProcs(procs);
+        sk_sp<SkPicture> picture = SkPicturePriv::MakeFromBuffer(buffer);
+        return buffer.isValid() ? picture : nullptr;
+    }
+
+private:
+    template <typename T>
+    struct Shared {
+        sk_sp<T> fObject;
+        bool     fRead = false;
+    };
+
+    sk_sp<SkData> readEntry(int index) {
+        const IndexEntry& entry = fEntries[index];
+        if (!SkTFitsIn<size_t>(entry.fOffset) || !SkTFitsIn<size_t>(entry.fSize)) {
+            return nullptr;
+        }
+        size_t offset = SkTo<size_t>(entry.fOffset),
+               size   = SkTo<size_t>(entry.fSize);
+        if (fStream->hasLength() &&
+            (offset > fStream->getLength() || size > fStream->getLength() - offset)) {
+            return nullptr;
+        }
+        if (!fStream->seek(offset)) {
+            return nullptr;
+        }
+        sk_sp<SkData> data = SkData::MakeUninitialized(size);
+        if (fStream->read(data->writable_data(), size) != size) {
+            return nullptr;
+        }
+        return data;
+    }
+
+    static sk_sp<SkTypeface> DeserializeTypeface(const void* data, size_t length, void* ctx) {
+        auto reader = static_cast<IndexedReader*>(ctx);
+        int index;
+        if (!read_index_data(data, length, reader->fTypefaces.count(), &index)) {
+            return nullptr;
+        }
+        Shared<SkTypeface>& typeface = reader->fTypefaces[index];
+        if (!typeface.fRead) {
+            typeface.fRead = true;
+            // Like SkReadBuffer::readTypeface(), only the caller's proc reads what its
+            // counterpart wrote.
+            if (sk_sp<SkData> entry = reader->readEntry(index)) {
+                const SkDeserialProcs& procs = reader->fProcs;
+                if (reader->fTypefaceSerializers[index] == kProc_TypefaceSerializer) {
+                    if (procs.fTypefaceProc) {
+                        typeface.fObject = procs.fTypefaceProc(entry->data(), entry->size(),
+                                                               procs.fTypefaceCtx);
+                    }
+                } else {
+                    SkMemoryStream stream(std::move(entry));
+                    typeface.fObject = SkTypeface::MakeDeserialize(&stream);
+                }
+            }
+        }
+        return typeface.fObject;
+    }
+
+    static sk_sp<SkImage> DeserializeImage(const void* data, size_t length, void* ctx) {
+        auto reader = static_cast<IndexedReader*>(ctx);
+        int index;
+        if (!read_index_data(data, length, reader->fImages.count(), &index)) {
+            return nullptr;
+        }
+        Shared<SkImage>& image = reader->fImages[index];
+        if (!image.fRead) {
+            image.fRead = true;
+            if (sk_sp<SkData> entry = reader->readEntry(reader->fTypefaces.count() + index)) {
+                const SkDeserialProcs& procs = reader->fProcs;
+                if (procs.fImageProc) {
+                    image.fObject = procs.fImageProc(entry->data(), entry->size(),
+                                                     procs.fImageCtx);
+                }
+                if (!image.fObject) {
+                    image.fObject = SkImage::MakeFromEncoded(std::move(entry));
+                }
+            }
+        }
+        return image.fObject;
+    }
+
+    SkStreamSeekable*             fStream;
+    const SkDeserialProcs         fProcs;
+    const SkTArray<SkSize>        fSizes;
+    const SkTArray<IndexEntry>    fEntries;   // Typefaces, then images, then pages.
+    const SkTArray<uint32_t>      fTypefaceSerializers;
+    SkTArray<Shared<SkTypeface>>  fTypefaces;
+    SkTArray<Shared<SkImage>>     fImages;
+};
+}  // namespace
+
+std::unique_ptr<SkMultiPictureDocumentReader> SkMultiPictureDocumentReader::Make(
+        SkStreamSeekable* stream, const SkDeserialProcs* procs) {
+    uint32_t version;
+    int pageCount = read_header(stream, &version);
+    if (pageCount < 1) {
+        return nullptr;
+    }
+    if (stream->hasLength() && stream->getLength() / sizeof(SkSize) < (size_t)pageCount) {
+        return nullptr;
+    }
+
+    if (version == kUnindexedVersion) {
+        SkTArray<SkDocumentPage> pages;
+        pages.push_back_n(pageCount);
+        for (SkDocumentPage& page : pages) {
+            if (sizeof(page.fSize) != stream->read(&page.fSize, sizeof(page.fSize))) {
+                return nullptr;
+            }
+        }
+        if (!read_unindexed_pages(stream, pages.begin(), pageCount, procs)) {
+            return nullptr;
+        }
+        return std::make_unique<UnindexedReader>(std::move(pages));
+    }
+
+    SkTArray<SkSize> sizes;
+    sizes.push_back_n(pageCount);
+    if (stream->read(sizes.begin(), pageCount * sizeof(SkSize)) != pageCount * sizeof(SkSize)) {
+        return nullptr;
+    }
+    uint32_t typefaceCount, imageCount;
+    if (!stream->readU32(&typefaceCount) || !stream->readU32(&imageCount) ||
+        typefaceCount > INT_MAX - SkTo<uint32_t>(pageCount) ||
+        imageCount > INT_MAX - SkTo<uint32_t>(pageCount) - typefaceCount) {
+        return nullptr;
+    }
+    if (stream->hasLength() && stream->getLength() / sizeof(uint32_t) < typefaceCount) {
+        return nullptr;
+    }
+    SkTArray<uint32_t> typefaceSerializers;
+    typefaceSerializers.push_back_n(SkTo<int>(typefaceCount));
+    for (uint32_t& serializer : typefaceSerializers) {
+        if (!stream->readU32(&serializer) || (serializer != kDefault_TypefaceSerializer &&
+                                              serializer != kProc_TypefaceSerializer)) {
+            return nullptr;
+        }
+    }
+    int entryCount = SkTo<int>(typefaceCount + imageCount) + pageCount;
+    if (stream->hasLength() && stream->getLength() / sizeof(IndexEntry) < (size_t)entryCount) {
+        return nullptr;
+    }
+    SkTArray<IndexEntry> entries;
+    entries.push_back_n(entryCount);
+    if (stream->read(entries.begin(), entryCount * sizeof(IndexEntry)) !=
+            entryCount * sizeof(IndexEntry)) {
+        return nullptr;
+    }
+    return std::make_unique<IndexedReader>(stream, procs ? *procs : SkDeserialProcs(),
+                                           std::move(sizes), std::move(entries),
+                                           std::move(typefaceSerializers), SkTo<int>(imageCount));
+}
+
+bool SkMultiPictureDocumentRead(SkStreamSeekable* stream,
+                                SkDocumentPage* dstArray,
+                                int dstArrayCount,
+                                const SkDeserialProcs* procs) {
+    if (!dstArray || dstArrayCount < 1) {
+        return false;
+    }
+    auto reader = SkMultiPictureDocumentReader::Make(stream, procs);
+    if (!reader || reader->pageCount() != dstArrayCount) {
+        return false;
+    }
+    for (int i = 0; i < dstArrayCount; ++i) {
+        dstArray[i] = {reader->readPage(i), reader->pageSize(i)};
+        if (!dstArray[i].fPicture) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -12,6 +12,8 @@
 #include "include/core/SkPicture.h"
 #include "include/core/SkSize.h"
 
+#include <memory>
+
 struct SkDeserialProcs;
 struct SkSerialProcs;
 class SkStreamSeekable;
@@ -41,4 +43,35 @@ SK_SPI bool SkMultiPictureDocumentRead(SkStreamSeekable* src,
                                        int dstArrayCount,
                                        const SkDeserialProcs* = nullptr);
 
+/**
+ *  Reads the pages of an SkMultiPictureDocument one at a time, seeking to each page as it is
+ *  read. Typefaces and images shared by pages are deserialized the first time a page uses them,
+ *  and are reused by the pages read after that.
+ *
+ *  Documents written before pages were indexed have to be read all at once, so Make() reads
+ *  all of their pages up front.
+ *
+ *  The reader is not thread safe.
+ */
+class SK_SPI SkMultiPictureDocumentReader {
+public:
+    /**
+     *  Returns nullptr if src is not an SkMultiPictureDocument. src must outlive the reader,
+     *  and must not be used by anything else while the reader is.
+     */
+    static std::unique_ptr<SkMultiPictureDocumentReader> Make(SkStreamSeekable* src,
+                                                              const SkDeserialProcs* = nullptr);
+
+    virtual ~SkMultiPictureDocumentReader() = default;
+
+    virtual int pageCount() const = 0;
+    virtual SkSize pageSize(int pageIndex) const = 0;
+
+    /**
+     *  Deserializes the page, or returns nullptr if it cannot be read. The pages of indexed
+     *  documents are not kept by the reader, so reading a page again deserializes it again.
+     */
+    virtual sk_sp<SkPicture> readPage(int pageIndex) = 0;
+};
+
 #endif  // SkMultiPictureDocument_DEFINED
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkPictureBandEncoder.h"
+
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkPicture.h"
+#include "include/encode/SkJpegEncoder.h"
+#include "include/encode/SkPngEncoder.h"
+#include "src/core/SkTaskGroup.h"
+
+#include <algorithm>
+
+static void draw_band(const SkPicture* picture, SkBitmap* strip, int top) {
+    strip->eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas canvas(*strip);
+    canvas.translate(0, -SkIntToScalar(top));
+    canvas.drawPicture(picture);
+}
+
+bool SkPictureBandEncoder::Encode(SkWStream* dst, const SkPicture* picture,
+                                  const SkImageInfo& info, SkEncodedImageFormat format,
+                                  int quality, const Options& options) {
+    switch (format) {
+        case SkEncodedImageFormat::kJPEG:
+            return Encode(dst, picture, info, [quality](SkWStream* dst, const SkPixmap& src) {
+                SkJpegEncoder::Options opts;
+                opts.fQuality = quality;
+                return SkJpegEncoder::Make(dst, src, opts);
+            }, options);
+        case SkEncodedImageFormat::kPNG:
+            return Encode(dst, picture, info, [](SkWStream* dst, const SkPixmap& src) {
+                return SkPngEncoder::Make(dst, src, SkPngEncoder::Options());
+            }, options);
+        default:
+            return false;
+    }
+}
+
+bool SkPictureBandEncoder::Encode(SkWStream* dst, const SkPicture* picture,
+                                  const SkImageInfo& info, const MakeEncoderProc& makeEncoder,
+                                  const Options& options) {
+    if (!picture || info.isEmpty() || options.fBandHeight <= 0) {
+        return false;
+    }
+
+    const int bandHeight = std::min(options.fBandHeight, info.height());
+    const int bandCount = (info.height() + bandHeight - 1) / bandHeight;
+
+    // With an executor, we double buffer: band N+1 is drawn into one strip while band N is
+    // encoded from the other.
+    const int stripCount = (options.fExecutor && bandCount > 1) ? 2 : 1;
+    SkBitmap strips[2];
+    for (int i = 0; i < stripCount; i++) {
+        if (!strips[i].tryAllocPixels(info.makeWH(info.width(), bandHeight))) {
+            return false;
+        }
+    }
+
+    // Every row is passed to the encoder from a strip, so |src| only describes the image.
+    const SkPixmap src(info, nullptr, info.minRowBytes());
+    std::unique_ptr<SkEncoder> encoder = makeEncoder(dst, src);
+    if (!encoder) {
+        return false;
+    }
+
+    auto drawBand = [&](int band) {
+        draw_band(picture, &strips[band % stripCount], band * bandHeight);
+    };
+
+    std::unique_ptr<SkTaskGroup> taskGroup;
+    if (stripCount > 1) {
+        taskGroup.reset(new SkTaskGroup(*options.fExecutor));
+    }
+
+    drawBand(0);
+    for (int band = 0; band < bandCount; band++) {
+        const bool hasNext = band + 1 < bandCount;
+        if (hasNext && taskGroup) {
+            taskGroup->add([&drawBand, band] { drawBand(band + 1); });
+        }
+
+        const int top = band * bandHeight;
+        SkPixmap rows;
+        SkAssertResult(strips[band % stripCount].pixmap().extractSubset(
+                &rows, SkIRect::MakeWH(info.width(), std::min(bandHeight, info.height() - top))));
+        const bool success = encoder->encodeRows(rows);
+
+        if (taskGroup) {
+            taskGroup->wait();
+        } else if (hasNext && success) {
+            drawBand(band + 1);
+        }
+
+        if (!success) {
+            return false;
+        }
+    }
+
+    return true;
+}
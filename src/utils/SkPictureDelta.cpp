@@ -0,0 +1,426 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "src/utils/SkPictureDelta.h"
+
+#include "include/core/SkStream.h"
+#include "include/private/SkTo.h"
+#include "src/core/SkPicturePriv.h"
+#include "src/core/SkReadBuffer.h"
+#include "src/core/SkWriteBuffer.h"
+
+#include <vector>
+
+/*
+  Frame format, in 32-bit words:
+      uint32_t frame_index (0 for a key frame)
+      {
+        uint32_t dropped_count
+        uint32_t id * dropped_count
+        uint32_t added_count
+        {
+          uint32_t id
+          byte array
+        } * added_count
+      } for typefaces, then for images
+      uint32_t word_count, of the flattened picture
+      {
+        uint32_t count << 1 | 1, uint32_t offset in the previous flattened picture   (a copy)
+        or
+        uint32_t count << 1, uint32_t words[count]                                    (new words)
+      } until there are word_count words
+
+  The flattened picture refers to typefaces and images by their uniqueID() on the encoder's side.
+*/
+
+namespace {
+
+// A typeface or image that has not been used for this many frames is dropped.
+static constexpr uint32_t kUnusedFramesToKeep = 8;
+
+// Copies are found by looking up the hash of every run of this many words of the frame among
+// the hashes of the aligned runs in the previous frame.
+static constexpr int kBlockWords = 8;
+static constexpr uint32_t kHashMul = 0x01000193;
+
+static sk_sp<SkData> make_id_data(uint32_t id) {
+    return SkData::MakeWithCopy(&id, sizeof(id));
+}
+
+static bool read_id_data(const void* data, size_t length, uint32_t* id) {
+    if (length != sizeof(*id)) {
+        return false;
+    }
+    memcpy(id, data, sizeof(*id));
+    return true;
+}
+
+static uint32_t hash_block(const uint32_t* words) {
+    uint32_t hash = 0;
+    for (int i = 0; i < kBlockWords; i++) {
+        hash = hash * kHashMul + words[i];
+    }
+    return hash;
+}
+
+class BlockIndex {
+public:
+    BlockIndex(const uint32_t* words, int count) {
+        int blocks = count / kBlockWords;
+        int capacity = 16;
+        while (capacity < 2 * blocks) {
+            capacity *= 2;
+        }
+        fMask = capacity - 1;
+        fSlots.assign(capacity, -1);
+        // Later blocks don't replace earlier ones, which are more likely to come up first.
+        for (int i = 0; i < blocks; i++) {
+            int& slot = fSlots[Slot(hash_block(words + i * kBlockWords)) & fMask];
+            if (slot < 0) {
+                slot = i * kBlockWords;
+            }
+        }
+    }
+
+    // Returns an offset into the words whose block may have this hash, or -1.
+    int find(uint32_t hash) const { return fSlots[Slot(hash) & fMask]; }
+
+private:
+    static uint32_t Slot(uint32_t hash) { return (hash * 0x9E3779B1) >> 7; }
+
+    std::vector<int> fSlots;
+    uint32_t         fMask;
+};
+
+// Writes cur as copies from prev and new words.
+static void write_delta(SkBinaryWriteBuffer* buffer, const uint32_t* prev, int prevCount,
+                        const uint32_t* cur, int curCount) {
+    buffer->writeUInt(SkToU32(curCount));
+
+    int pending = 0;   // The first word not written yet.
+    auto writeNew = [&](int end) {
+        if (end > pending) {
+            buffer->writeUInt(SkToU32(end - pending) << 1);
+            buffer->write(cur + pending, (end - pending) * sizeof(uint32_t));
+        }
+    };
+
+    if (prevCount >= kBlockWords) {
+        BlockIndex index(prev, prevCount);
+
+        // kHashMul^kBlockWords, to take the oldest word out of a rolling hash.
+        uint32_t outMul = 1;
+        for (int i = 0; i < kBlockWords; i++) {
+            outMul *= kHashMul;
+        }
+
+        int i = 0;
+        uint32_t hash = curCount >= kBlockWords ? hash_block(cur) : 0;
+        while (i + kBlockWords <= curCount) {
+            int found = index.find(hash);
+            if (found >= 0 && 0 == memcmp(cur + i, prev + found, kBlockWords * sizeof(uint32_t))) {
+                // Grow the match both ways, but not back into words already written.
+                int start = i, from = found;
+                while (start > pending && from > 0 && cur[start - 1] == prev[from - 1]) {
+                    start--;
+                    from--;
+                }
+                int end = i + kBlockWords, to = found + kBlockWords;
+                while (end < curCount && to < prevCount && cur[end] == prev[to]) {
+                    end++;
+                    to++;
+                }
+                writeNew(start);
+                buffer->writeUInt(SkToU32(end - start) << 1 | 1);
+                buffer->writeUInt(SkToU32(from));
+                pending = i = end;
+                if (i + kBlockWords <= curCount) {
+                    hash = hash_block(cur + i);
+                }
+                continue;
+            }
+            if (i + kBlockWords < curCount) {
+                hash = hash * kHashMul - cur[i] * outMul + cur[i + kBlockWords];
+            }
+            i++;
+        }
+    }
+    writeNew(curCount);
+}
+
+// Reads a picture written by write_delta(), or returns nullptr.
+static sk_sp<SkData> read_delta(SkReadBuffer* buffer, const SkData* prev) {
+    const uint32_t* prevWords = prev ? static_cast<const uint32_t*>(prev->data()) : nullptr;
+    const size_t prevCount = prev ? prev->size() / sizeof(uint32_t) : 0;
+
+    const size_t count = buffer->readUInt();
+    // A copy takes two words and makes at most all of the previous words, and new words take
+    // a word each, so don't allocate for more words than the frame could make.
+    const uint64_t available = buffer->available() / sizeof(uint32_t);
+    if (!buffer->validate(count <= available / 2 * prevCount + available)) {
+        return nullptr;
+    }
+    sk_sp<SkData> data = SkData::MakeUninitialized(count * sizeof(uint32_t));
+    uint32_t* words = static_cast<uint32_t*>(data->writable_data());
+    size_t made = 0;
+    while (made < count && buffer->isValid()) {
+        uint32_t instruction = buffer->readUInt();
+        size_t n = instruction >> 1;
+        if (!buffer->validate(n > 0 && n <= count - made)) {
+            return nullptr;
+        }
+        if (instruction & 1) {
+            size_t from = buffer->readUInt();
+            if (!buffer->validate(from <= prevCount && n <= prevCount - from)) {
+                return nullptr;
+            }
+            memcpy(words + made, prevWords + from, n * sizeof(uint32_t));
+        } else {
+            const void* src = buffer->skip(n, sizeof(uint32_t));
+            if (!src) {
+                return nullptr;
+            }
+            memcpy(words + made, src, n * sizeof(uint32_t));
+        }
+        made += n;
+    }
+    return buffer->isValid() ? data : nullptr;
+}
+
+}  // namespace
+
+SkPictureDeltaEncoder::SkPictureDeltaEncoder(const SkSerialProcs* procs)
+    : fProcs(procs ? *procs : SkSerialProcs()) {}
+
+void SkPictureDeltaEncoder::reset() {
+    fFrame = 0;
+    fPrevious = nullptr;
+    fTypefaces.reset();
+    fImages.reset();
+}
+
+sk_sp<SkData> SkPictureDeltaEncoder::SerializeTypeface(SkTypeface* typeface, void* ctx) {
+    auto encoder = static_cast<SkPictureDeltaEncoder*>(ctx);
+    uint32_t id = typeface->uniqueID();
+    if (Shared<SkTypeface>* shared = encoder->fTypefaces.find(id)) {
+        shared->fLastUsed = encoder->fFrame;
+    } else {
+        encoder->fTypefaces.set(id, {sk_ref_sp(typeface), encoder->fFrame});
+        encoder->fNewTypefaces.push_back(id);
+    }
+    return make_id_data(id);
+}
+
+sk_sp<SkData> SkPictureDeltaEncoder::SerializeImage(SkImage* image, void* ctx) {
+    auto encoder = static_cast<SkPictureDeltaEncoder*>(ctx);
+    uint32_t id = image->uniqueID();
+    if (Shared<SkImage>* shared = encoder->fImages.find(id)) {
+        shared->fLastUsed = encoder->fFrame;
+    } else {
+        encoder->fImages.set(id, {sk_ref_sp(image), encoder->fFrame});
+        encoder->fNewImages.push_back(id);
+    }
+    return make_id_data(id);
+}
+
+// Drops the objects that have not been used for a while, and writes their IDs, then writes the
+// objects that are new in this frame.
+template <typename T, typename SerializeFn>
+static void write_shared(SkBinaryWriteBuffer* buffer, uint32_t frame,
+                         SkTHashMap<uint32_t, T>* shared, SkTArray<uint32_t>* added,
+                         SerializeFn&& serialize) {
+    SkTArray<uint32_t> dropped;
+    shared->mutate([&](uint32_t id, T* object) {
+        if (frame - object->fLastUsed > kUnusedFramesToKeep) {
+            dropped.push_back(id);
+            return false;
+        }
+        return true;
+    });
+    buffer->writeUInt(SkToU32(dropped.count()));
+    for (uint32_t id : dropped) {
+        buffer->writeUInt(id);
+    }
+
+    buffer->writeUInt(SkToU32(added->count()));
+    for (uint32_t id : *added) {
+        buffer->writeUInt(id);
+        buffer->writeDataAsByteArray(serialize(shared->find(id)->fObject.get()).get());
+    }
+    added->reset();
+}
+
+sk_sp<SkData> SkPictureDeltaEncoder::encode(const SkPicture* picture) {
+    if (!picture) {
+        return nullptr;
+    }
+
+    SkSerialProcs procs = fProcs;
+    procs.fTypefaceProc = SerializeTypeface;
+    procs.fTypefaceCtx = this;
+    procs.fImageProc = SerializeImage;
+    procs.fImageCtx = this;
+    SkBinaryWriteBuffer flattened;
+    flattened.setSerialProcs(procs);
+    SkPicturePriv::Flatten(sk_ref_sp(picture), flattened);
+    sk_sp<SkData> current = SkData::MakeUninitialized(flattened.bytesWritten());
+    flattened.writeToMemory(current->writable_data());
+
+    SkBinaryWriteBuffer buffer;
+    buffer.writeUInt(fFrame);
+    write_shared(&buffer, fFrame, &fTypefaces, &fNewTypefaces, [this](SkTypeface* typeface) {
+        if (fProcs.fTypefaceProc) {
+            if (auto data = fProcs.fTypefaceProc(typeface, fProcs.fTypefaceCtx)) {
+                return data;
+            }
+        }
+        return typeface->serialize();
+    });
+    write_shared(&buffer, fFrame, &fImages, &fNewImages, [this](SkImage* image) {
+        // Like SkBinaryWriteBuffer::writeImage(), where empty data reads back as an empty image.
+        sk_sp<SkData> data;
+        if (fProcs.fImageProc) {
+            data = fProcs.fImageProc(image, fProcs.fImageCtx);
+        }
+        if (!data) {
+            data = image->encodeToData();
+        }
+        return data ? data : SkData::MakeEmpty();
+    });
+
+    const auto* prevWords = fPrevious ? static_cast<const uint32_t*>(fPrevious->data()) : nullptr;
+    int prevCount = fPrevious ? SkToInt(fPrevious->size() / sizeof(uint32_t)) : 0;
+    write_delta(&buffer, prevWords, prevCount,
+                static_cast<const uint32_t*>(current->data()),
+                SkToInt(current->size() / sizeof(uint32_t)));
+
+    fPrevious = std::move(current);
+    fFrame++;
+
+    sk_sp<SkData> frame = SkData::MakeUninitialized(buffer.bytesWritten());
+    buffer.writeToMemory(frame->writable_data());
+    return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SkPictureDeltaDecoder::SkPictureDeltaDecoder(const SkDeserialProcs* procs)
+    : fProcs(procs ? *procs : SkDeserialProcs()) {}
+
+sk_sp<SkTypeface> SkPictureDeltaDecoder::DeserializeTypeface(const void* data, size_t length,
+                                                             void* ctx) {
+    auto decoder = static_cast<SkPictureDeltaDecoder*>(ctx);
+    uint32_t id;
+    sk_sp<SkTypeface>* typeface;
+    if (!read_id_data(data, length, &id) || !(typeface = decoder->fTypefaces.find(id))) {
+        decoder->fMissingObject = true;
+        return nullptr;
+    }
+    return *typeface;
+}
+
+sk_sp<SkImage> SkPictureDeltaDecoder::DeserializeImage(const void* data, size_t length,
+                                                       void* ctx) {
+    auto decoder = static_cast<SkPictureDeltaDecoder*>(ctx);
+    uint32_t id;
+    sk_sp<SkImage>* image;
+    if (!read_id_data(data, length, &id) || !(image = decoder->fImages.find(id))) {
+        decoder->fMissingObject = true;
+        return nullptr;
+    }
+    return *image;
+}
+
+// Drops and adds the objects written by write_shared().
+template <typename T, typename DeserializeFn>
+static bool read_shared(SkReadBuffer* buffer, SkTHashMap<uint32_t, sk_sp<T>>* shared,
+                        DeserializeFn&& deserialize) {
+    uint32_t dropped = buffer->readUInt();
+    if (!buffer->validateCanReadN<uint32_t>(dropped)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < dropped; i++) {
+        shared->remove(buffer->readUInt());
+    }
+
+    uint32_t added = buffer->readUInt();
+    for (uint32_t i = 0; i < added && buffer->isValid(); i++) {
+        uint32_t id = buffer->readUInt();
+        sk_sp<SkData> data = buffer->readByteArrayAsData();
+        if (buffer->isValid()) {
+            shared->set(id, deserialize(std::move(data)));
+        }
+    }
+    return buffer->isValid();
+}
+
+bool SkPictureDeltaDecoder::readFrame(const void* data, size_t size, sk_sp<SkPicture>* picture) {
+    SkReadBuffer buffer(data, size);
+    uint32_t frame = buffer.readUInt();
+    if (!buffer.isValid()) {
+        return false;
+    }
+    if (frame == 0) {
+        fPrevious = nullptr;
+        fTypefaces.reset();
+        fImages.reset();
+    } else if (!fSynced || frame != fFrame) {
+        return false;
+    }
+
+    bool shared = read_shared(&buffer, &fTypefaces, [this](sk_sp<SkData> data) {
+        sk_sp<SkTypeface> typeface;
+        if (fProcs.fTypefaceProc) {
+            typeface = fProcs.fTypefaceProc(data->data(), data->size(), fProcs.fTypefaceCtx);
+        }
+        if (!typeface) {
+            SkMemoryStream stream(std::move(data));
+            typeface = SkTypeface::MakeDeserialize(&stream);
+        }
+        return typeface;
+    }) && read_shared(&buffer, &fImages, [this](sk_sp<SkData> data) {
+        sk_sp<SkImage> image;
+        if (fProcs.fImageProc) {
+            image = fProcs.fImageProc(data->data(), data->size(), fProcs.fImageCtx);
+        }
+        if (!image) {
+            image = SkImage::MakeFromEncoded(std::move(data));
+        }
+        return image;
+    });
+    if (!shared) {
+        return false;
+    }
+
+    sk_sp<SkData> current = read_delta(&buffer, fPrevious.get());
+    if (!current || !buffer.eof()) {
+        return false;
+    }
+
+    SkDeserialProcs procs = fProcs;
+    procs.fTypefaceProc = DeserializeTypeface;
+    procs.fTypefaceCtx = this;
+    procs.fImageProc = DeserializeImage;
+    procs.fImageCtx = this;
+    SkReadBuffer pictureBuffer(current->data(), current->size());
+    pictureBuffer.setDeserialProcs(procs);
+    fMissingObject = false;
+    *picture = SkPicturePriv::MakeFromBuffer(pictureBuffer);
+    if (!*picture || !pictureBuffer.isValid() || fMissingObject) {
+        return false;
+    }
+
+    fPrevious = std::move(current);
+    fFrame = frame + 1;
+    return true;
+}
+
+sk_sp<SkPicture> SkPictureDeltaDecoder::decode(const void* data, size_t size) {
+    sk_sp<SkPicture> picture;
+    fSynced = data && this->readFrame(data, size, &picture);
+    return fSynced ? picture : nullptr;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureDelta_DEFINED
+#define SkPictureDelta_DEFINED
+
+#include "include/core/SkData.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkSerialProcs.h"
+#include "include/core/SkTypeface.h"
+#include "include/private/SkTArray.h"
+#include "include/private/SkTHash.h"
+
+/**
+ *  Serializes a stream of pictures, such as the frames of an animation, sending each frame as
+ *  its changes from the frame before it.
+ *
+ *  Each typeface and image is sent once, the first time a frame uses it, and frames refer to it
+ *  by ID after that. One that no frame has used for a while is dropped by both sides. The rest
+ *  of a frame (its ops, paints, paths, text blobs and so on) is flattened as by
+ *  SkPicture::serialize(), and only the runs of it that are not in the previous frame are sent.
+ *  The runs that are, are sent as copies.
+ *
+ *  The first frame, and the first after reset(), is a key frame, which does not depend on the
+ *  frames before it.
+ */
+class SK_SPI SkPictureDeltaEncoder {
+public:
+    /**
+     *  procs are used for each typeface and image the first time it is sent, and for any
+     *  pictures that have custom procs.
+     */
+    explicit SkPictureDeltaEncoder(const SkSerialProcs* procs = nullptr);
+
+    /**
+     *  Returns the next frame, which draws picture. Returns nullptr if picture is null, and
+     *  the frame after that is still the next one.
+     */
+    sk_sp<SkData> encode(const SkPicture* picture);
+
+    /**
+     *  Forgets the frames before, so the next frame is a key frame.
+     */
+    void reset();
+
+private:
+    template <typename T>
+    struct Shared {
+        sk_sp<T> fObject;
+        uint32_t fLastUsed;   // The frame that last used the object.
+    };
+
+    static sk_sp<SkData> SerializeTypeface(SkTypeface*, void* ctx);
+    static sk_sp<SkData> SerializeImage(SkImage*, void* ctx);
+
+    const SkSerialProcs                     fProcs;
+    uint32_t                                fFrame = 0;
+    sk_sp<SkData>                           fPrevious;   // The previous frame, flattened.
+    SkTHashMap<uint32_t, Shared<SkTypeface>> fTypefaces;  // By uniqueID(), as sent.
+    SkTHashMap<uint32_t, Shared<SkImage>>    fImages;
+    SkTArray<uint32_t>                      fNewTypefaces;
+    SkTArray<uint32_t>                      fNewImages;
+};
+
+/**
+ *  Reads the frames written by an SkPictureDeltaEncoder. Every frame must be decoded, in the
+ *  order they were encoded, starting with a key frame.
+ */
+class SK_SPI SkPictureDeltaDecoder {
+public:
+    /**
+     *  procs are used for each typeface and image the first time it is received, and for any
+     *  pictures that were written with custom procs.
+     */
+    explicit SkPictureDeltaDecoder(const SkDeserialProcs* procs = nullptr);
+
+    /**
+     *  Returns the picture of the next frame, or nullptr if the frame cannot be read. A frame
+     *  that follows a frame that was missed or could not be read cannot be read either, so
+     *  decoding picks up again at the next key frame.
+     */
+    sk_sp<SkPicture> decode(const void* data, size_t size);
+
+    sk_sp<SkPicture> decode(const SkData* data) {
+        return data ? this->decode(data->data(), data->size()) : nullptr;
+    }
+
+private:
+    bool readFrame(const void* data, size_t size, sk_sp<SkPicture>* picture);
+
+    static sk_sp<SkTypeface> DeserializeTypeface(const void* data, size_t length, void* ctx);
+    static sk_sp<SkImage> DeserializeImage(const void* data, size_t length, void* ctx);
+
+    const SkDeserialProcs                    fProcs;
+    bool                                     fSynced = false;
+    uint32_t                                 fFrame = 0;     // The frame expected next.
+    sk_sp<SkData>                            fPrevious;
+    SkTHashMap<uint32_t, sk_sp<SkTypeface>>  fTypefaces;
+    SkTHashMap<uint32_t, sk_sp<SkImage>>     fImages;
+    bool                                     fMissingObject = false;
+};
+
+#endif  // SkPictureDelta_DEFINED
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkPicturePredecoder.h"
+
+#include "include/core/SkBitmap.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkRRect.h"
+#include "include/core/SkRegion.h"
+#include "include/private/SkTHash.h"
+#include "include/utils/SkNoDrawCanvas.h"
+#include "src/core/SkBitmapCache.h"
+#include "src/core/SkMipMap.h"
+#include "src/core/SkTaskGroup.h"
+#include "src/image/SkImage_Base.h"
+
+namespace {
+
+// Plays back a picture without drawing anything, noting each lazily generated image it would
+// draw inside the clip, and whether that image would be drawn scaled down with mipmaps.
+class ImageCollectorCanvas final : public SkNoDrawCanvas {
+public:
+    ImageCollectorCanvas(const SkIRect& deviceClip,
+                         SkTHashMap<uint32_t, bool>* images,
+                         std::vector<sk_sp<SkImage>>* order)
+        : INHERITED(deviceClip.right(), deviceClip.bottom())
+        , fImages(images)
+        , fOrder(order) {
+        this->clipRect(SkRect::Make(deviceClip));
+    }
+
+protected:
+    void onDrawImage(const SkImage* image, SkScalar x, SkScalar y, const SkPaint* paint) override {
+        const SkRect bounds = SkRect::Make(image->bounds());
+        this->addImage(image, bounds, bounds.makeOffset(x, y), paint, nullptr);
+    }
+
+    void onDrawImageRect(const SkImage* image, const SkRect* src, const SkRect& dst,
+                         const SkPaint* paint, SrcRectConstraint) override {
+        this->addImage(image, src ? *src : SkRect::Make(image->bounds()), dst, paint, nullptr);
+    }
+
+    void onDrawImageNine(const SkImage* image, const SkIRect&, const SkRect& dst,
+                         const SkPaint* paint) override {
+        this->addImage(image, SkRect::Make(image->bounds()), dst, paint, nullptr);
+    }
+
+    void onDrawImageLattice(const SkImage* image, const Lattice&, const SkRect& dst,
+                            const SkPaint* paint) override {
+        this->addImage(image, SkRect::Make(image->bounds()), dst, paint, nullptr);
+    }
+
+    void onDrawAtlas(const SkImage* atlas, const SkRSXform[], const SkRect[], const SkColor[],
+                     int, SkBlendMode, const SkRect* cull, const SkPaint* paint) override {
+        const SkRect bounds = SkRect::Make(atlas->bounds());
+        this->addImage(atlas, bounds, cull ? *cull : bounds, paint, nullptr);
+    }
+
+    void onDrawEdgeAAImageSet(const ImageSetEntry set[], int count, const SkPoint[],
+                              const SkMatrix preViewMatrices[], const SkPaint* paint,
+                              SrcRectConstraint) override {
+        for (int i = 0; i < count; ++i) {
+            const SkMatrix* preViewMatrix =
+                    set[i].fMatrixIndex >= 0 ? &preViewMatrices[set[i].fMatrixIndex] : nullptr;
+            this->addImage(set[i].fImage.get(), set[i].fSrcRect, set[i].fDstRect, paint,
+                           preViewMatrix);
+        }
+    }
+
+    // Images can also be drawn through an image shader on a paint.
+    void onDrawPaint(const SkPaint& paint) override {
+        this->addShaderImage(paint, nullptr);
+    }
+    void onDrawRect(const SkRect& rect, const SkPaint& paint) override {
+        this->addShaderImage(paint, &rect);
+    }
+    void onDrawRRect(const SkRRect& rrect, const SkPaint& paint) override {
+        this->addShaderImage(paint, &rrect.rect());
+    }
+    void onDrawDRRect(const SkRRect& outer, const SkRRect&, const SkPaint& paint) override {
+        this->addShaderImage(paint, &outer.rect());
+    }
+    void onDrawOval(const SkRect& oval, const SkPaint& paint) override {
+        this->addShaderImage(paint, &oval);
+    }
+    void onDrawPath(const SkPath& path, const SkPaint& paint) override {
+        this->addShaderImage(paint, path.isInverseFillType() ? nullptr : &path.getBounds());
+    }
+    void onDrawRegion(const SkRegion& region, const SkPaint& paint) override {
+        const SkRect bounds = SkRect::Make(region.getBounds());
+        this->addShaderImage(paint, &bounds);
+    }
+
+    // SkNoDrawCanvas skips nested pictures and drawables, but we need to see into them.
+    void onDrawPicture(const SkPicture* picture, const SkMatrix* matrix,
+                       const SkPaint* paint) override {
+        this->SkCanvas::onDrawPicture(picture, matrix, paint);
+    }
+    void onDrawDrawable(SkDrawable* drawable, const SkMatrix* matrix) override {
+        this->SkCanvas::onDrawDrawable(drawable, matrix);
+    }
+
+private:
+    void addImage(const SkImage* image, const SkRect& src, const SkRect& dst,
+                  const SkPaint* paint, const SkMatrix* preViewMatrix) {
+        if (!image || !image->isLazyGenerated() || src.isEmpty()) {
+            return;
+        }
+
+        SkMatrix localToDevice = this->getTotalMatrix();
+        SkRect localDst = dst;
+        if (preViewMatrix) {
+            localToDevice.preConcat(*preViewMatrix);
+            localDst = preViewMatrix->mapRect(dst);
+        }
+        if (this->quickReject(localDst)) {
+            return;
+        }
+
+        // Raster playback uses mipmaps for medium (and high, when downscaling) quality draws
+        // that shrink the image.  A negative min scale means perspective; assume the worst.
+        bool needsMips = false;
+        if (paint && paint->getFilterQuality() >= kMedium_SkFilterQuality) {
+            SkMatrix srcToDevice = SkMatrix::Concat(
+                    localToDevice, SkMatrix::MakeRectToRect(src, dst, SkMatrix::kFill_ScaleToFit));
+            needsMips = srcToDevice.getMinScale() < 1;
+        }
+        this->add(image, needsMips);
+    }
+
+    void addShaderImage(const SkPaint& paint, const SkRect* bounds) {
+        SkShader* shader = paint.getShader();
+        SkMatrix localMatrix;
+        SkImage* image = shader ? shader->isAImage(&localMatrix, (SkTileMode*)nullptr) : nullptr;
+        if (!image || !image->isLazyGenerated()) {
+            return;
+        }
+        if (bounds && this->quickReject(*bounds)) {
+            return;
+        }
+
+        bool needsMips = false;
+        if (paint.getFilterQuality() >= kMedium_SkFilterQuality) {
+            needsMips = SkMatrix::Concat(this->getTotalMatrix(), localMatrix).getMinScale() < 1;
+        }
+        this->add(image, needsMips);
+    }
+
+    void add(const SkImage* image, bool needsMips) {
+        if (bool* existing = fImages->find(image->uniqueID())) {
+            *existing = *existing || needsMips;
+            return;
+        }
+        fImages->set(image->uniqueID(), needsMips);
+        fOrder->push_back(sk_ref_sp(const_cast<SkImage*>(image)));
+    }
+
+    SkTHashMap<uint32_t, bool>*  fImages;
+    std::vector<sk_sp<SkImage>>* fOrder;
+
+    typedef SkNoDrawCanvas INHERITED;
+};
+
+}  // namespace
+
+SkPicturePredecoder::SkPicturePredecoder(const SkPicture* picture, const SkMatrix& matrix,
+                                         const SkIRect& deviceClip) {
+    if (!picture || deviceClip.isEmpty() || deviceClip.left() < 0 || deviceClip.top() < 0) {
+        return;
+    }
+
+    SkTHashMap<uint32_t, bool> needsMips;
+    std::vector<sk_sp<SkImage>> images;
+    {
+        ImageCollectorCanvas canvas(deviceClip, &needsMips, &images);
+        canvas.concat(matrix);
+        picture->playback(&canvas);
+    }
+
+    for (sk_sp<SkImage>& image : images) {
+        const SkImageInfo& info = image->imageInfo();
+        const bool mips = *needsMips.find(image->uniqueID());
+        const SkBitmapCacheDesc desc = SkBitmapCacheDesc::Make(image.get());
+
+        size_t bytes = 0;
+        SkBitmap cached;
+        if (!SkBitmapCache::Find(desc, &cached)) {
+            bytes += info.computeMinByteSize();
+        }
+        if (mips) {
+            if (const SkMipMap* cachedMips = SkMipMapCache::FindAndRef(desc)) {
+                cachedMips->unref();
+            } else {
+                for (int level = 0; level < SkMipMap::ComputeLevelCount(info.width(),
+                                                                        info.height()); ++level) {
+                    SkISize size = SkMipMap::ComputeLevelSize(info.width(), info.height(), level);
+                    bytes += info.makeDimensions(size).computeMinByteSize();
+                }
+            }
+        }
+
+        if (bytes > 0) {
+            fBytesToDecode += bytes;
+            fImages.push_back({std::move(image), mips});
+        }
+    }
+}
+
+SkPicturePredecoder::~SkPicturePredecoder() {
+    this->wait();
+}
+
+static void predecode(const SkImage* image, bool needsMips) {
+    const SkImage_Base* imageBase = as_IB(image);
+    if (needsMips) {
+        // This decodes (or finds) the base level too.
+        if (const SkMipMap* mips = SkMipMapCache::AddAndRef(imageBase)) {
+            mips->unref();
+        }
+    } else {
+        SkBitmap bitmap;
+        imageBase->getROPixels(&bitmap, SkImage::kAllow_CachingHint);
+    }
+}
+
+void SkPicturePredecoder::decode(SkExecutor* executor) {
+    SkASSERT(!fTasks);
+    if (!executor) {
+        for (const Image& image : fImages) {
+            predecode(image.fImage.get(), image.fNeedsMips);
+        }
+        return;
+    }
+
+    fTasks.reset(new SkTaskGroup(*executor));
+    for (const Image& image : fImages) {
+        fTasks->add([image] { predecode(image.fImage.get(), image.fNeedsMips); });
+    }
+}
+
+void SkPicturePredecoder::wait() {
+    if (fTasks) {
+        fTasks->wait();
+    }
+}
@@ -15,10 +15,16 @@
 #include "include/core/SkTypes.h"
 #include "include/private/SkColorData.h"
 #include "src/core/SkUtils.h"
+#include "src/image/SkImage_Base.h"
+#include "src/image/SkImage_Lazy.h"
 #include "tests/Test.h"
 #include "tools/ToolUtils.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <utility>
+#include <vector>
 
 class TestImageGenerator : public SkImageGenerator {
 public:
@@ -126,3 +132,76 @@ DEF_TEST(Image_NewFromGenerator, r) {
         }
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+// Counts its decodes.  Each decode waits until |threadCount| threads have started requesting
+// pixels, then takes long enough that those requests overlap it.
+class SlowCountingGenerator : public SkImageGenerator {
+public:
+    SlowCountingGenerator(std::atomic<int>* decodeCount, const std::atomic<int>* startedCount,
+                          int threadCount)
+        : INHERITED(SkImageInfo::MakeN32Premul(16, 16))
+        , fDecodeCount(decodeCount)
+        , fStartedCount(startedCount)
+        , fThreadCount(threadCount) {}
+
+protected:
+    bool onGetPixels(const SkImageInfo& info, void* pixels, size_t rowBytes,
+                     const Options&) override {
+        fDecodeCount->fetch_add(1);
+        while (fStartedCount->load() < fThreadCount) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        SkPixmap(info, pixels, rowBytes).erase(SK_ColorRED);
+        return true;
+    }
+
+private:
+    std::atomic<int>*       fDecodeCount;
+    const std::atomic<int>* fStartedCount;
+    const int               fThreadCount;
+
+    typedef SkImageGenerator INHERITED;
+};
+}  // namespace
+
+DEF_TEST(Image_Lazy_SingleFlightDecode, r) {
+    constexpr int kThreads = 8;
+    std::atomic<int> decodeCount{0};
+    std::atomic<int> startedCount{0};
+    sk_sp<SkImage> image = SkImage::MakeFromGenerator(
+            std::make_unique<SlowCountingGenerator>(&decodeCount, &startedCount, kThreads));
+    REPORTER_ASSERT(r, image);
+
+    const SkImage_Lazy::DecodeStats before = SkImage_Lazy::GetDecodeStats();
+
+    // The decode can't finish until every thread has started, so the others are all waiting on
+    // it rather than finding its result already cached.
+    std::atomic<int> successes{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&] {
+            startedCount.fetch_add(1);
+            SkBitmap bm;
+            if (as_IB(image)->getROPixels(&bm, SkImage::kAllow_CachingHint) &&
+                    bm.getColor(8, 8) == SK_ColorRED) {
+                successes.fetch_add(1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Every thread gets the pixels, but only one of them decodes.
+    REPORTER_ASSERT(r, successes.load() == kThreads);
+    REPORTER_ASSERT(r, decodeCount.load() == 1);
+
+    const SkImage_Lazy::DecodeStats after = SkImage_Lazy::GetDecodeStats();
+    REPORTER_ASSERT(r, after.fDecodes - before.fDecodes >= 1);
+    REPORTER_ASSERT(r, after.fDecodesAvoided - before.fDecodesAvoided >= 1);
+    REPORTER_ASSERT(r, after.fDecodesAvoided - before.fDecodesAvoided <= kThreads - 1);
+}
@@ -10,6 +10,7 @@
 #include "include/codec/SkCodecAnimation.h"
 #include "include/core/SkBitmap.h"
 #include "include/core/SkData.h"
+#include "include/core/SkExecutor.h"
 #include "include/core/SkImage.h"
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkRect.h"
@@ -17,6 +18,7 @@
 #include "include/core/SkSize.h"
 #include "include/core/SkString.h"
 #include "include/core/SkTypes.h"
+#include "include/private/SkTo.h"
 #include "include/utils/SkAnimCodecPlayer.h"
 #include "tests/CodecPriv.h"
 #include "tests/Test.h"
@@ -496,3 +498,68 @@ DEF_TEST(AnimCodecPlayer, r) {
         REPORTER_ASSERT(r, f1->bounds().size() == test.fSize);
     }
 }
+
+DEF_TEST(AnimCodecPlayer_FrameCache, r) {
+    std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(1);
+
+    for (const char* file : { "images/alphabetAnim.gif", "images/randPixelsAnim.gif" }) {
+        sk_sp<SkData> data = GetResourceAsData(file);
+        if (!data) {
+            continue;
+        }
+
+        // Decode each frame from scratch to compare against.
+        std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(data);
+        const std::vector<SkCodec::FrameInfo> frameInfos = codec->getFrameInfo();
+        const int frameCount = SkToInt(frameInfos.size());
+        std::vector<SkBitmap> expected(frameCount);
+        std::vector<uint32_t> startTimes(frameCount);
+        uint32_t startTime = 0;
+        for (int i = 0; i < frameCount; ++i) {
+            SkCodec::Options options;
+            options.fFrameIndex = i;
+            expected[i].allocPixels(codec->getInfo());
+            REPORTER_ASSERT(r, SkCodec::kSuccess == codec->getPixels(expected[i].pixmap(),
+                                                                     &options));
+            startTimes[i] = startTime + 1;  // The player rounds up to the next frame.
+            startTime += frameInfos[i].fDuration;
+        }
+
+        SkAnimCodecPlayer::CacheOptions cacheOptions;
+        cacheOptions.fMaxCachedFrames = 3;
+        for (SkExecutor* ahead : { (SkExecutor*)nullptr, executor.get() }) {
+            cacheOptions.fExecutor = ahead;
+            cacheOptions.fDecodeAhead = ahead ? 2 : 0;
+            SkAnimCodecPlayer player(SkCodec::MakeFromData(data), cacheOptions);
+
+            // Play forward twice, then jump around.
+            std::vector<int> order;
+            for (int i = 0; i < 2 * frameCount; ++i) {
+                order.push_back(i % frameCount);
+            }
+            for (int i = 0; i < frameCount; ++i) {
+                order.push_back((i * 7 + 3) % frameCount);
+            }
+
+            for (int index : order) {
+                player.seek(startTimes[index]);
+                sk_sp<SkImage> frame = player.getFrame();
+                REPORTER_ASSERT(r, frame);
+                if (!frame) {
+                    continue;
+                }
+                REPORTER_ASSERT(r, player.cachedFrameCount() <= cacheOptions.fMaxCachedFrames);
+
+                SkPixmap pm;
+                REPORTER_ASSERT(r, frame->peekPixels(&pm));
+                const SkPixmap& want = expected[index].pixmap();
+                for (int y = 0; y < want.height(); ++y) {
+                    if (memcmp(pm.addr(0, y), want.addr(0, y), want.info().minRowBytes())) {
+                        ERRORF(r, "%s: frame %d mismatch at row %d", file, index, y);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
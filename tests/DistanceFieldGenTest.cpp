@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkExecutor.h"
+#include "include/utils/SkRandom.h"
+#include "src/core/SkDistanceFieldGen.h"
+#include "src/core/SkOpts.h"
+#include "tests/Test.h"
+
+#include <vector>
+
+// The upper (dy = -1) or lower (dy = 1) neighbors as SkDistanceFieldGen's scalar passes tried
+// them, one pixel at a time.
+static void nearest_row_reference(float dst[], const float src[], const uint8_t edges[],
+                                  int count, int stride, float dy) {
+    for (int i = 0; i < count; i++) {
+        if (edges[i]) {
+            continue;
+        }
+        float* curr = dst + i;
+        auto take = [&](const float* check, float distSq, float dx) {
+            if (distSq < curr[0]) {
+                curr[0] = distSq;
+                curr[stride] = check[stride] + dx;
+                curr[2*stride] = check[2*stride] + dy;
+            }
+        };
+        const float* check = src + i - 1;
+        take(check, dy < 0 ? check[0] - 2.0f*(check[stride] + check[2*stride] - 1.0f)
+                           : check[0] - 2.0f*(check[stride] - check[2*stride] - 1.0f), -1.0f);
+        check = src + i;
+        take(check, dy < 0 ? check[0] - 2.0f*check[2*stride] + 1.0f
+                           : check[0] + 2.0f*check[2*stride] + 1.0f, 0.0f);
+        check = src + i + 1;
+        take(check, dy < 0 ? check[0] + 2.0f*(check[stride] - check[2*stride] + 1.0f)
+                           : check[0] + 2.0f*(check[stride] + check[2*stride] + 1.0f), 1.0f);
+    }
+}
+
+DEF_TEST(DistanceFieldGen_NearestRow, reporter) {
+    SkRandom rand;
+    for (int count = 0; count < 19; count++) {
+        for (float dy : {-1.0f, 1.0f}) {
+            // Planes of squared distances, x and y, where src includes the pixels on either side.
+            int stride = count + 2;
+            std::vector<float> src(3*stride), expected(3*stride), actual;
+            std::vector<uint8_t> edges(count);
+            for (int i = 0; i < stride; i++) {
+                src[i] = rand.nextRangeF(0, 50);
+                src[i + stride] = rand.nextRangeF(-5, 5);
+                src[i + 2*stride] = rand.nextRangeF(-5, 5);
+                expected[i] = rand.nextRangeF(0, 50);
+                expected[i + stride] = rand.nextRangeF(-5, 5);
+                expected[i + 2*stride] = rand.nextRangeF(-5, 5);
+            }
+            for (int i = 0; i < count; i++) {
+                // Some rows are all edges, some have none.
+                edges[i] = count % 3 == 0 ? 0xff
+                         : count % 3 == 1 ? 0
+                         : (rand.nextBool() ? 0xff : 0);
+            }
+            actual = expected;
+
+            nearest_row_reference(expected.data(), src.data() + 1, edges.data(), count, stride,
+                                  dy);
+            SkOpts::distance_field_nearest_row(actual.data(), src.data() + 1, edges.data(), count,
+                                               stride, dy);
+            REPORTER_ASSERT(reporter, !memcmp(expected.data(), actual.data(),
+                                              expected.size() * sizeof(float)));
+        }
+    }
+}
+
+DEF_TEST(DistanceFieldGen_Batch, reporter) {
+    SkRandom rand;
+    const SkMask::Format formats[] = {SkMask::kA8_Format, SkMask::kBW_Format,
+                                      SkMask::kLCD16_Format};
+    constexpr int kJobCount = 12;
+
+    std::vector<uint8_t> images[kJobCount], expected[kJobCount], actual[kJobCount];
+    SkDistanceFieldJob jobs[kJobCount];
+    for (int i = 0; i < kJobCount; i++) {
+        SkDistanceFieldJob& job = jobs[i];
+        job.fWidth = 1 + rand.nextULessThan(40);
+        job.fHeight = 1 + rand.nextULessThan(40);
+        job.fFormat = formats[i % SK_ARRAY_COUNT(formats)];
+        job.fRowBytes = job.fFormat == SkMask::kBW_Format    ? (job.fWidth + 7) / 8
+                      : job.fFormat == SkMask::kLCD16_Format ? job.fWidth * 2
+                      : job.fWidth;
+        images[i].resize(job.fRowBytes * job.fHeight);
+        for (uint8_t& b : images[i]) {
+            b = rand.nextBool() ? 0xff : rand.nextU() & 0xff;
+        }
+        job.fImage = images[i].data();
+
+        size_t size = SkComputeDistanceFieldSize(job.fWidth, job.fHeight);
+        expected[i].resize(size);
+        switch (job.fFormat) {
+            case SkMask::kA8_Format:
+                SkGenerateDistanceFieldFromA8Image(expected[i].data(), job.fImage,
+                                                   job.fWidth, job.fHeight, job.fRowBytes);
+                break;
+            case SkMask::kBW_Format:
+                SkGenerateDistanceFieldFromBWImage(expected[i].data(), job.fImage,
+                                                   job.fWidth, job.fHeight, job.fRowBytes);
+                break;
+            default:
+                SkGenerateDistanceFieldFromLCD16Mask(expected[i].data(), job.fImage,
+                                                     job.fWidth, job.fHeight, job.fRowBytes);
+                break;
+        }
+    }
+
+    auto executor = SkExecutor::MakeFIFOThreadPool(3);
+    for (SkExecutor* e : {(SkExecutor*)nullptr, executor.get()}) {
+        for (int i = 0; i < kJobCount; i++) {
+            actual[i].assign(expected[i].size(), 0);
+            jobs[i].fDistanceField = actual[i].data();
+        }
+        REPORTER_ASSERT(reporter, SkGenerateDistanceFields({jobs, kJobCount}, e));
+        for (int i = 0; i < kJobCount; i++) {
+            REPORTER_ASSERT(reporter, actual[i] == expected[i]);
+        }
+    }
+
+    // Formats without a distance field make the batch fail, but the others are still done.
+    jobs[1].fFormat = SkMask::kARGB32_Format;
+    actual[0].assign(expected[0].size(), 0);
+    REPORTER_ASSERT(reporter, !SkGenerateDistanceFields({jobs, 2}, executor.get()));
+    REPORTER_ASSERT(reporter, actual[0] == expected[0]);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/utils/SkRandom.h"
+#include "src/core/SkDynamicBBH.h"
+#include "src/core/SkRTree.h"
+#include "tests/Test.h"
+
+#include <cmath>
+
+static SkRect random_rect(SkRandom& rand) {
+    SkRect rect = {0,0,0,0};
+    while (rect.isEmpty()) {
+        rect.fLeft   = rand.nextRangeF(0, 1000);
+        rect.fRight  = rand.nextRangeF(0, 1000);
+        rect.fTop    = rand.nextRangeF(0, 1000);
+        rect.fBottom = rand.nextRangeF(0, 1000);
+        rect.sort();
+    }
+    return rect;
+}
+
+static void check_queries(skiatest::Reporter* reporter, SkRandom& rand,
+                          const std::vector<SkRect>& rects, const SkDynamicBBH& bbh) {
+    REPORTER_ASSERT(reporter, bbh.isValid());
+    for (int i = 0; i < 20; i++) {
+        SkRect query = random_rect(rand);
+        std::vector<int> expected;
+        for (int j = 0; j < (int)rects.size(); j++) {
+            if (SkRect::Intersects(query, rects[j])) {
+                expected.push_back(j);
+            }
+        }
+        std::vector<int> found;
+        bbh.search(query, &found);
+        REPORTER_ASSERT(reporter, found == expected);
+    }
+}
+
+DEF_TEST(DynamicBBH, reporter) {
+    SkRandom rand;
+    SkDynamicBBH bbh;
+    REPORTER_ASSERT(reporter, bbh.getHeight() == 0 && bbh.isValid());
+    std::vector<int> found;
+    bbh.search(SkRect::MakeWH(1000, 1000), &found);
+    REPORTER_ASSERT(reporter, found.empty());
+
+    // Start like a picture would, with all the boxes at once.
+    std::vector<SkRect> rects;
+    for (int i = 0; i < 200; i++) {
+        rects.push_back(random_rect(rand));
+    }
+    rects[17].setEmpty();
+    bbh.insert(rects.data(), (int)rects.size());
+    REPORTER_ASSERT(reporter, bbh.getCount() == 200);
+    check_queries(reporter, rand, rects, bbh);
+
+    // Searches find the same boxes as SkRTree does.
+    SkRTree rtree;
+    rtree.insert(rects.data(), (int)rects.size());
+    for (int i = 0; i < 20; i++) {
+        SkRect query = random_rect(rand);
+        std::vector<int> fromRTree, fromBBH;
+        rtree.search(query, &fromRTree);
+        bbh.search(query, &fromBBH);
+        REPORTER_ASSERT(reporter, fromRTree == fromBBH);
+    }
+
+    // Then change a few boxes at a time.
+    for (int frame = 0; frame < 50; frame++) {
+        for (int i = 0; i < 10; i++) {
+            int index = rand.nextULessThan((uint32_t)rects.size());
+            switch (rand.nextULessThan(4)) {
+                case 0:
+                    rects[index] = random_rect(rand);
+                    break;
+                case 1:
+                    rects[index].offset(rand.nextRangeF(-5, 5), rand.nextRangeF(-5, 5));
+                    break;
+                case 2:
+                    bbh.remove(index);
+                    rects[index].setEmpty();
+                    continue;
+                case 3:
+                    rects.push_back(random_rect(rand));
+                    REPORTER_ASSERT(reporter,
+                                    bbh.append(rects.back()) == (int)rects.size() - 1);
+                    continue;
+            }
+            bbh.update(index, rects[index]);
+        }
+        check_queries(reporter, rand, rects, bbh);
+    }
+
+    // However the boxes came and went, the tree stays balanced.
+    int boxes = 0;
+    for (const SkRect& rect : rects) {
+        boxes += !rect.isEmpty();
+    }
+    REPORTER_ASSERT(reporter, bbh.getHeight() <= 1.45 * std::log2(boxes) + 2);
+
+    // Removing every box empties the tree, and its nodes are reused for new ones.
+    size_t bytes = bbh.bytesUsed();
+    for (int i = 0; i < bbh.getCount(); i++) {
+        bbh.remove(i);
+    }
+    REPORTER_ASSERT(reporter, bbh.getHeight() == 0 && bbh.isValid());
+    bbh.search(SkRect::MakeWH(1000, 1000), &found);
+    REPORTER_ASSERT(reporter, found.empty());
+    for (int i = 0; i < 100; i++) {
+        bbh.update(i, rects[i].isEmpty() ? random_rect(rand) : rects[i]);
+    }
+    REPORTER_ASSERT(reporter, bbh.isValid() && bbh.bytesUsed() == bytes);
+}
+
+DEF_TEST(DynamicBBH_SortedInsertion, reporter) {
+    // Boxes added in order along a line are the worst case for an unbalanced tree.
+    SkDynamicBBH bbh;
+    for (int i = 0; i < 4096; i++) {
+        bbh.append(SkRect::MakeXYWH(i, 0, 1, 1));
+    }
+    REPORTER_ASSERT(reporter, bbh.isValid());
+    REPORTER_ASSERT(reporter, bbh.getHeight() <= 1.45 * 12 + 2);
+
+    std::vector<int> found;
+    bbh.search(SkRect::MakeXYWH(100.5f, 0, 3, 1), &found);
+    REPORTER_ASSERT(reporter, found == std::vector<int>({100, 101, 102, 103}));
+}
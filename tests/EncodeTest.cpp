@@ -8,6 +8,7 @@
 #include "tests/Test.h"
 #include "tools/Resources.h"
 
+#include "include/codec/SkCodec.h"
 #include "include/core/SkBitmap.h"
 #include "include/core/SkColorPriv.h"
 #include "include/core/SkEncodedImageFormat.h"
@@ -17,6 +18,7 @@
 #include "include/encode/SkJpegEncoder.h"
 #include "include/encode/SkPngEncoder.h"
 #include "include/encode/SkWebpEncoder.h"
+#include "src/core/SkAutoMalloc.h"
 
 #include "png.h"
 
@@ -100,6 +102,48 @@ DEF_TEST(Encode, r) {
     test_encode(r, SkEncodedImageFormat::kPNG);
 }
 
+DEF_TEST(Encode_RowsFromPixmap, r) {
+    SkBitmap bitmap;
+    bitmap.allocPixels(SkImageInfo::MakeN32Premul(16, 16));
+    bitmap.eraseColor(SK_ColorBLUE);
+    bitmap.erase(SK_ColorRED, SkIRect::MakeXYWH(0, 8, 16, 8));
+
+    SkDynamicMemoryWStream expected;
+    REPORTER_ASSERT(r, SkPngEncoder::Encode(&expected, bitmap.pixmap(), SkPngEncoder::Options()));
+
+    // Encode the same image from two separate 8-row pixmaps.
+    SkBitmap top, bottom;
+    SkAssertResult(bitmap.extractSubset(&top, SkIRect::MakeXYWH(0, 0, 16, 8)));
+    SkAssertResult(bitmap.extractSubset(&bottom, SkIRect::MakeXYWH(0, 8, 16, 8)));
+
+    SkDynamicMemoryWStream actual;
+    auto encoder = SkPngEncoder::Make(&actual, bitmap.pixmap(), SkPngEncoder::Options());
+    REPORTER_ASSERT(r, encoder->encodeRows(top.pixmap()));
+
+    // Rows must match the src's width and color type.
+    SkBitmap wrongSize;
+    wrongSize.allocPixels(SkImageInfo::MakeN32Premul(15, 8));
+    REPORTER_ASSERT(r, !encoder->encodeRows(wrongSize.pixmap()));
+    SkBitmap wrongType;
+    wrongType.allocPixels(SkImageInfo::MakeA8(16, 8));
+    REPORTER_ASSERT(r, !encoder->encodeRows(wrongType.pixmap()));
+
+    REPORTER_ASSERT(r, encoder->encodeRows(bottom.pixmap()));
+    sk_sp<SkData> expectedData = expected.detachAsData();
+    REPORTER_ASSERT(r, expectedData->equals(actual.detachAsData().get()));
+
+    // Once every row has been encoded, further rows are rejected.
+    REPORTER_ASSERT(r, !encoder->encodeRows(bottom.pixmap()));
+
+    // An encoder may be made without pixels, if every row is passed to it.
+    const SkPixmap noPixels(bitmap.info(), nullptr, bitmap.rowBytes());
+    SkDynamicMemoryWStream fromRows;
+    encoder = SkPngEncoder::Make(&fromRows, noPixels, SkPngEncoder::Options());
+    REPORTER_ASSERT(r, encoder && !encoder->encodeRows(8));
+    REPORTER_ASSERT(r, encoder->encodeRows(top.pixmap()) && encoder->encodeRows(bottom.pixmap()));
+    REPORTER_ASSERT(r, expectedData->equals(fromRows.detachAsData().get()));
+}
+
 static inline bool almost_equals(SkPMColor a, SkPMColor b, int tolerance) {
     if (SkTAbs((int)SkGetPackedR32(a) - (int)SkGetPackedR32(b)) > tolerance) {
         return false;
@@ -216,6 +260,70 @@ DEF_TEST(Encode_JpegDownsample, r) {
     REPORTER_ASSERT(r, almost_equals(bm1, bm2, 60));
 }
 
+DEF_TEST(Encode_JpegYUV, r) {
+    // These cover 4:4:4, 4:2:2 and 4:2:0 downsampling respectively.
+    for (const char* path : { "images/mandrill_h1v1.jpg",
+                              "images/mandrill_h2v1.jpg",
+                              "images/mandrill_512_q075.jpg" }) {
+        sk_sp<SkData> encoded = GetResourceAsData(path);
+        if (!encoded) {
+            continue;
+        }
+        std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(encoded);
+        REPORTER_ASSERT(r, codec);
+        if (!codec) {
+            continue;
+        }
+
+        SkYUVASizeInfo sizeInfo;
+        SkYUVColorSpace colorSpace;
+        if (!codec->queryYUV8(&sizeInfo, &colorSpace)) {
+            ERRORF(r, "%s: failed to query YUV planes\n", path);
+            continue;
+        }
+
+        SkAutoMalloc storage(sizeInfo.computeTotalBytes());
+        void* planes[SkYUVASizeInfo::kMaxCount];
+        sizeInfo.computePlanes(storage.get(), planes);
+        if (SkCodec::kSuccess != codec->getYUV8Planes(sizeInfo, planes)) {
+            ERRORF(r, "%s: failed to decode YUV planes\n", path);
+            continue;
+        }
+
+        SkDynamicMemoryWStream yuvStream;
+        SkJpegEncoder::Options options;
+        bool success = SkJpegEncoder::EncodeYUV(&yuvStream, sizeInfo, planes, colorSpace, options);
+        REPORTER_ASSERT(r, success);
+        if (!success) {
+            continue;
+        }
+
+        // Only full range YUV can be stored in a jpeg.
+        SkNullWStream dummy;
+        REPORTER_ASSERT(r, !SkJpegEncoder::EncodeYUV(&dummy, sizeInfo, planes,
+                                                     kRec709_SkYUVColorSpace, options));
+
+        // The chroma planes must be a supported downsampling of the luma plane.
+        SkYUVASizeInfo badSizeInfo = sizeInfo;
+        badSizeInfo.fSizes[1].fWidth = badSizeInfo.fSizes[2].fWidth = 1;
+        REPORTER_ASSERT(r, !SkJpegEncoder::EncodeYUV(&dummy, badSizeInfo, planes,
+                                                     colorSpace, options));
+
+        // The encoded jpeg should keep the original downsampling, and decode to nearly the
+        // same pixels as the original.
+        sk_sp<SkData> yuvData = yuvStream.detachAsData();
+        std::unique_ptr<SkCodec> yuvCodec = SkCodec::MakeFromData(yuvData);
+        SkYUVASizeInfo yuvSizeInfo;
+        REPORTER_ASSERT(r, yuvCodec && yuvCodec->queryYUV8(&yuvSizeInfo, nullptr));
+        REPORTER_ASSERT(r, yuvSizeInfo == sizeInfo);
+
+        SkBitmap expected, actual;
+        SkImage::MakeFromEncoded(encoded)->asLegacyBitmap(&expected);
+        SkImage::MakeFromEncoded(yuvData)->asLegacyBitmap(&actual);
+        REPORTER_ASSERT(r, almost_equals(expected, actual, 20));
+    }
+}
+
 static inline void pushComment(
         std::vector<std::string>& comments, const char* keyword, const char* text) {
     comments.push_back(keyword);
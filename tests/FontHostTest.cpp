@@ -5,7 +5,11 @@
  * found in the LICENSE file.
  */
 
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
 #include "include/core/SkFont.h"
+#include "include/core/SkGraphics.h"
 #include "include/core/SkPaint.h"
 #include "include/core/SkStream.h"
 #include "include/core/SkTypeface.h"
@@ -13,8 +17,13 @@
 #include "src/core/SkEndian.h"
 #include "src/core/SkFontStream.h"
 #include "src/core/SkOSFile.h"
+#include "src/core/SkStrikeSpec.h"
+#include "src/core/SkTaskGroup.h"
 #include "tests/Test.h"
 #include "tools/Resources.h"
+#include "tools/ToolUtils.h"
+
+#include <algorithm>
 
 //#define DUMP_TABLES
 //#define DUMP_TTC_TABLES
@@ -273,3 +282,124 @@ DEF_TEST(FontHost, reporter) {
 }
 
 // need tests for SkStrSearch
+
+// Rasterizing glyphs for different typefaces and sizes on many threads at once must give the
+// same results as doing it on one thread.
+DEF_TEST(FontHost_ConcurrentRasterization, reporter) {
+    sk_sp<SkTypeface> typefaces[] = {
+        MakeResourceAsTypeface("fonts/Roboto-Regular.ttf"),
+        MakeResourceAsTypeface("fonts/Distortable.ttf"),
+    };
+    for (const sk_sp<SkTypeface>& typeface : typefaces) {
+        if (!typeface) {
+            return;
+        }
+    }
+
+    constexpr int kJobs = 16;
+    auto draw = [&](int job, SkBitmap* bitmap) {
+        bitmap->allocN32Pixels(256, 32);
+        bitmap->eraseColor(SK_ColorWHITE);
+        SkFont font(typefaces[job % SK_ARRAY_COUNT(typefaces)], 12 + job);
+        SkCanvas canvas(*bitmap);
+        canvas.drawString("Sphinx of black quartz, judge", 2, 24, font, SkPaint());
+    };
+
+    SkBitmap expected[kJobs];
+    for (int job = 0; job < kJobs; ++job) {
+        draw(job, &expected[job]);
+    }
+
+    SkGraphics::PurgeFontCache();
+    SkBitmap actual[kJobs];
+    std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(8);
+    SkTaskGroup(*executor).batch(kJobs, [&](int job) { draw(job, &actual[job]); });
+
+    for (int job = 0; job < kJobs; ++job) {
+        REPORTER_ASSERT(reporter, ToolUtils::equal_pixels(expected[job], actual[job]), "%d", job);
+    }
+}
+
+// Unhinted outlines scale linearly, so a glyph's path at one size is its path at another size
+// scaled, even though each size makes its own paths. Those paths come from outlines the typeface
+// caches in font units, and match the paths FreeType scales itself to within its rounding.
+DEF_TEST(FontHost_UnhintedPathsScale, reporter) {
+    static const char* kFonts[] = {"fonts/Roboto-Regular.ttf", "fonts/Distortable.ttf"};
+    for (const char* fontName : kFonts) {
+        sk_sp<SkTypeface> typeface = MakeResourceAsTypeface(fontName);
+        if (!typeface) {
+            continue;
+        }
+        SkFont font(typeface);
+        font.setHinting(SkFontHinting::kNone);
+        font.setSkewX(-0.25f);
+        const SkGlyphID glyphIDs[] = {font.unicharToGlyph('a'), font.unicharToGlyph('Q'),
+                                      font.unicharToGlyph('&'), font.unicharToGlyph('8')};
+        constexpr int kGlyphCount = SK_ARRAY_COUNT(glyphIDs);
+        auto getPaths = [&](const SkFont& font, SkScalar size, SkPath paths[kGlyphCount]) {
+            SkFont sized(font);
+            sized.setSize(size);
+            SkStrikeSpec spec = SkStrikeSpec::MakeMask(
+                    sized, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                    SkScalerContextFlags::kNone, SkMatrix::I());
+            SkBulkGlyphMetricsAndPaths metricsAndPaths{spec};
+            SkSpan<const SkGlyph*> glyphs = metricsAndPaths.glyphs(SkMakeSpan(glyphIDs));
+            for (int i = 0; i < kGlyphCount; i++) {
+                REPORTER_ASSERT(reporter, glyphs[i]->path());
+                if (glyphs[i]->path()) {
+                    paths[i] = *glyphs[i]->path();
+                }
+                // The path fits in the glyph's bounds, which FreeType works out from the outline.
+                SkRect bounds = glyphs[i]->rect().makeOutset(1, 1);
+                REPORTER_ASSERT(reporter, bounds.contains(paths[i].getBounds()),
+                                "glyph %d size %g", glyphIDs[i], size);
+            }
+        };
+
+        // With no room to cache outlines, a typeface of its own gets every path from FreeType.
+        SkFont uncached(font);
+        uncached.setTypeface(MakeResourceAsTypeface(fontName));
+
+        SkPath base[kGlyphCount];
+        getPaths(font, 20, base);
+        for (SkScalar size : {7.5f, 20.25f, 64.0f, 211.0f}) {
+            SkPath paths[kGlyphCount];
+            getPaths(font, size, paths);
+            SkPath freetypePaths[kGlyphCount];
+            {
+                size_t limit = SkGraphics::SetFontCacheLimit(0);
+                getPaths(uncached, size, freetypePaths);
+                SkGraphics::SetFontCacheLimit(limit);
+            }
+            for (int i = 0; i < kGlyphCount; i++) {
+                // FreeType rounds each point to 1/64 of a pixel, before and after the skew, and
+                // rounds the points between off-curve points too. The cached outline doesn't.
+                const SkPath& a = paths[i];
+                const SkPath& b = freetypePaths[i];
+                REPORTER_ASSERT(reporter, a.countVerbs() == b.countVerbs() &&
+                                          a.countPoints() == b.countPoints(),
+                                "glyph %d size %g", glyphIDs[i], size);
+                if (a.countPoints() == b.countPoints()) {
+                    SkScalar maxDiff = 0;
+                    for (int p = 0; p < a.countPoints(); p++) {
+                        SkVector diff = a.getPoint(p) - b.getPoint(p);
+                        maxDiff = std::max({maxDiff, SkScalarAbs(diff.fX), SkScalarAbs(diff.fY)});
+                    }
+                    REPORTER_ASSERT(reporter, maxDiff <= 1.0f / 32,
+                                    "glyph %d size %g: %g px", glyphIDs[i], size, maxDiff);
+                }
+
+                SkPath scaled;
+                base[i].transform(SkMatrix::MakeScale(size / 20), &scaled);
+                // The bounds of paths at other sizes are the same, give or take FreeType's rounding.
+                SkScalar tolerance = std::max(size / 20, 1.0f) / 32;
+                SkRect ab = a.getBounds(), sb = scaled.getBounds();
+                REPORTER_ASSERT(reporter, SkScalarNearlyEqual(ab.fLeft, sb.fLeft, tolerance) &&
+                                          SkScalarNearlyEqual(ab.fTop, sb.fTop, tolerance) &&
+                                          SkScalarNearlyEqual(ab.fRight, sb.fRight, tolerance) &&
+                                          SkScalarNearlyEqual(ab.fBottom, sb.fBottom, tolerance),
+                                "glyph %d size %g", glyphIDs[i], size);
+            }
+        }
+    }
+}
@@ -5,8 +5,10 @@
  * found in the LICENSE file.
  */
 
+#include "include/core/SkExecutor.h"
 #include "src/core/SkDiscardableMemory.h"
 #include "src/core/SkResourceCache.h"
+#include "src/core/SkTaskGroup.h"
 #include "tests/Test.h"
 
 namespace {
@@ -42,7 +44,8 @@ struct TestingRec : public SkResourceCache::Rec {
 static const int COUNT = 10;
 static const int DIM = 256;
 
-static void test_cache(skiatest::Reporter* reporter, SkResourceCache& cache, bool testPurge) {
+template <typename Cache>
+static void test_cache(skiatest::Reporter* reporter, Cache& cache, bool testPurge) {
     for (int i = 0; i < COUNT; ++i) {
         TestingKey key(i);
         intptr_t value = -1;
@@ -134,6 +137,68 @@ DEF_TEST(ImageCache, reporter) {
         SkResourceCache cache(defLimit);
         test_cache_purge_shared_id(reporter, cache);
     }
+    {
+        SkShardedResourceCache cache(defLimit);
+        test_cache(reporter, cache, true);
+    }
+    {
+        sk_sp<SkDiscardableMemoryPool> pool(SkDiscardableMemoryPool::Make(defLimit));
+        gPool = pool.get();
+        SkShardedResourceCache cache(pool_factory);
+        test_cache(reporter, cache, true);
+    }
+}
+
+DEF_TEST(ImageCache_Sharded, r) {
+    const size_t recBytes = TestingRec(TestingKey(0), 0).bytesUsed();
+    SkShardedResourceCache cache(100 * recBytes);
+
+    // Fill half the budget, then use the first few recs again.
+    for (int i = 0; i < 50; ++i) {
+        cache.add(new TestingRec(TestingKey(i), i));
+    }
+    intptr_t value;
+    for (int i = 0; i < 10; ++i) {
+        REPORTER_ASSERT(r, cache.find(TestingKey(i), TestingRec::Visitor, &value));
+    }
+
+    // Going over budget purges the least recently used recs, whichever shard they are in.
+    for (int i = 100; i < 180; ++i) {
+        cache.add(new TestingRec(TestingKey(i), i));
+    }
+    REPORTER_ASSERT(r, cache.getTotalBytesUsed() < cache.getTotalByteLimit());
+    for (int i = 0; i < 10; ++i) {
+        REPORTER_ASSERT(r, cache.find(TestingKey(i), TestingRec::Visitor, &value));
+    }
+    for (int i = 10; i < 30; ++i) {
+        REPORTER_ASSERT(r, !cache.find(TestingKey(i), TestingRec::Visitor, &value));
+    }
+    for (int i = 100; i < 180; ++i) {
+        REPORTER_ASSERT(r, cache.find(TestingKey(i), TestingRec::Visitor, &value));
+        REPORTER_ASSERT(r, value == i);
+    }
+
+    // Hammer it from several threads; the totals must stay consistent.
+    std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(8);
+    SkTaskGroup(*executor).batch(8, [&](int thread) {
+        for (int i = 0; i < 1000; ++i) {
+            TestingKey key(thread * 1000 + i);
+            intptr_t found;
+            if (!cache.find(key, TestingRec::Visitor, &found)) {
+                cache.add(new TestingRec(key, thread * 1000 + i));
+            }
+        }
+    });
+    REPORTER_ASSERT(r, cache.getTotalBytesUsed() < cache.getTotalByteLimit());
+
+    size_t visitedBytes = 0;
+    cache.visitAll([](const SkResourceCache::Rec& rec, void* ctx) {
+        *(size_t*)ctx += rec.bytesUsed();
+    }, &visitedBytes);
+    REPORTER_ASSERT(r, visitedBytes == cache.getTotalBytesUsed());
+
+    cache.purgeAll();
+    REPORTER_ASSERT(r, cache.getTotalBytesUsed() == 0);
 }
 
 DEF_TEST(ImageCache_doubleAdd, r) {
@@ -15,11 +15,13 @@
 #include "include/core/SkString.h"
 #include "include/core/SkSurface.h"
 #include "include/core/SkTextBlob.h"
+#include "include/utils/SkNoDrawCanvas.h"
 #include "src/core/SkRecord.h"
 #include "src/core/SkRecorder.h"
 #include "src/utils/SkMultiPictureDocument.h"
 #include "tests/Test.h"
 #include "tools/SkSharingProc.h"
+#include "tools/ToolUtils.h"
 
 namespace {
 
@@ -209,13 +211,199 @@ DEF_TEST(Serialize_and_deserialize_multi_skp, reporter) {
         // Extract the SkRecord from the deserialized picture using playback (instead of a mess of
         // friend classes to grab the private record inside frame.fPicture
         SkRecord record;
-        // This picture mode is necessary so that we record the command contents of frame.fPicture
-        // not just a 'DrawPicture' command, but don't record pictures within it. We want to assert
-        // that the code under test reffed them like it should have.
-        resultRecorder.reset(&record, bounds, SkRecorder::PlaybackTop_DrawPictureMode, nullptr);
+        // Pages are read as pictures of their own, so this records the command contents of
+        // frame.fPicture, but doesn't record pictures within it. We want to assert that the code
+        // under test reffed them like it should have.
+        resultRecorder.reset(&record, bounds, SkRecorder::Record_DrawPictureMode, nullptr);
         frame.fPicture->playback(&resultRecorder);
         // Compare the record to the expected one
         compareRecords(record, expectedRecords[i], i, reporter);
         i++;
     }
 }
+
+// Collects the images drawn, including those drawn by nested pictures.
+class ImageCollectingCanvas : public SkNoDrawCanvas {
+public:
+    ImageCollectingCanvas() : SkNoDrawCanvas(256, 256) {}
+
+    std::vector<const SkImage*> fImages;
+
+protected:
+    void onDrawImage(const SkImage* image, SkScalar, SkScalar, const SkPaint*) override {
+        fImages.push_back(image);
+    }
+    void onDrawImageRect(const SkImage* image, const SkRect*, const SkRect&, const SkPaint*,
+                         SrcRectConstraint) override {
+        fImages.push_back(image);
+    }
+};
+
+static void check_page(skiatest::Reporter* reporter, SkPicture* page, const SkRecord& expected,
+                       int pageIndex) {
+    REPORTER_ASSERT(reporter, page);
+    if (!page) {
+        return;
+    }
+    SkRecord record;
+    SkRecorder recorder(nullptr, 1, 1);
+    recorder.reset(&record, page->cullRect(), SkRecorder::Record_DrawPictureMode, nullptr);
+    page->playback(&recorder);
+    compareRecords(record, expected, pageIndex, reporter);
+}
+
+// Test reading single pages of a multi picture document, in any order.
+DEF_TEST(Multi_skp_reader, reporter) {
+    auto surface(SkSurface::MakeRasterN32Premul(100, 100));
+    surface->getCanvas()->clear(SK_ColorGREEN);
+    sk_sp<SkImage> image(surface->makeImageSnapshot());
+
+    SkPictureRecorder pr;
+    draw_basic(pr.beginRecording(100, 100), 42, image);
+    sk_sp<SkPicture> sub = pr.finishRecordingAsPicture();
+
+    SkFont font(ToolUtils::create_portable_typeface(), 12);
+    auto draw_page = [&](SkCanvas* canvas, int i) {
+        draw_advanced(canvas, i, image, sub);
+        canvas->drawTextBlob(SkTextBlob::MakeFromString("shared", font), 10, 200, SkPaint());
+    };
+
+    static const int NUM_PAGES = 10;
+    SkDynamicMemoryWStream stream;
+    sk_sp<SkDocument> doc = SkMakeMultiPictureDocument(&stream);
+    SkRecord expectedRecords[NUM_PAGES];
+    for (int i = 0; i < NUM_PAGES; i++) {
+        draw_page(doc->beginPage(200 + i, 256), i);
+        doc->endPage();
+        SkRecorder canvas(&expectedRecords[i], 200 + i, 256);
+        draw_page(&canvas, i);
+    }
+    doc->close();
+    std::unique_ptr<SkStreamAsset> written = stream.detachAsStream();
+
+    auto reader = SkMultiPictureDocumentReader::Make(written.get());
+    REPORTER_ASSERT(reporter, reader && reader->pageCount() == NUM_PAGES);
+    if (!reader) {
+        return;
+    }
+    REPORTER_ASSERT(reporter, !reader->readPage(-1) && !reader->readPage(NUM_PAGES));
+
+    // Every page draws the same image, and so they all share one deserialized image.
+    const SkImage* shared = nullptr;
+    for (int i = NUM_PAGES - 1; i >= 0; i -= 3) {
+        REPORTER_ASSERT(reporter, reader->pageSize(i) == SkSize::Make(200 + i, 256));
+        sk_sp<SkPicture> page = reader->readPage(i);
+        check_page(reporter, page.get(), expectedRecords[i], i);
+
+        ImageCollectingCanvas images;
+        page->playback(&images);
+        REPORTER_ASSERT(reporter, !images.fImages.empty());
+        for (const SkImage* pageImage : images.fImages) {
+            shared = shared ? shared : pageImage;
+            REPORTER_ASSERT(reporter, pageImage == shared);
+        }
+    }
+
+    // All of the pages can still be read at once.
+    std::vector<SkDocumentPage> pages(NUM_PAGES);
+    REPORTER_ASSERT(reporter, SkMultiPictureDocumentRead(written.get(), pages.data(), NUM_PAGES));
+    for (int i = 0; i < NUM_PAGES; i++) {
+        REPORTER_ASSERT(reporter, pages[i].fSize == SkSize::Make(200 + i, 256));
+        check_page(reporter, pages[i].fPicture.get(), expectedRecords[i], i);
+    }
+
+    // A document that is cut short fails to read the pages it lost.
+    sk_sp<SkData> data = SkData::MakeFromStream(written->duplicate().get(),
+                                                written->getLength() - 1);
+    SkMemoryStream truncated(data);
+    auto truncatedReader = SkMultiPictureDocumentReader::Make(&truncated);
+    REPORTER_ASSERT(reporter, truncatedReader);
+    if (truncatedReader) {
+        REPORTER_ASSERT(reporter, truncatedReader->readPage(0));
+        REPORTER_ASSERT(reporter, !truncatedReader->readPage(NUM_PAGES - 1));
+    }
+}
+
+// Documents written before pages were indexed hold one picture with all of the pages.
+DEF_TEST(Multi_skp_reader_unindexed, reporter) {
+    static const int NUM_PAGES = 3;
+    SkDynamicMemoryWStream stream;
+    stream.writeText("Skia Multi-Picture Doc\n\n");
+    stream.write32(2);
+    stream.write32(NUM_PAGES);
+    SkPictureRecorder recorder;
+    SkCanvas* canvas = recorder.beginRecording(300, 300);
+    for (int i = 0; i < NUM_PAGES; i++) {
+        SkSize size = SkSize::Make(100 * (i + 1), 100);
+        stream.write(&size, sizeof(size));
+
+        SkPictureRecorder pageRecorder;
+        pageRecorder.beginRecording(size.width(), size.height())->drawRect({0, 0, 10.0f * i, 10},
+                                                                          SkPaint());
+        canvas->drawPicture(pageRecorder.finishRecordingAsPicture());
+        canvas->drawAnnotation(SkRect::MakeEmpty(), "SkMultiPictureEndPage",
+                               SkData::MakeWithCString("X").get());
+    }
+    recorder.finishRecordingAsPicture()->serialize(&stream);
+    std::unique_ptr<SkStreamAsset> written = stream.detachAsStream();
+
+    auto reader = SkMultiPictureDocumentReader::Make(written.get());
+    REPORTER_ASSERT(reporter, reader && reader->pageCount() == NUM_PAGES);
+    if (!reader) {
+        return;
+    }
+    for (int i = NUM_PAGES - 1; i >= 0; i--) {
+        REPORTER_ASSERT(reporter, reader->pageSize(i) == SkSize::Make(100 * (i + 1), 100));
+        sk_sp<SkPicture> page = reader->readPage(i);
+        REPORTER_ASSERT(reporter, page && page->cullRect().width() == 100 * (i + 1));
+    }
+}
+
+// The reader's typeface proc only reads the typefaces the writer's proc serialized.
+DEF_TEST(Multi_skp_reader_typeface_procs, reporter) {
+    sk_sp<SkTypeface> custom = ToolUtils::create_portable_typeface();
+    sk_sp<SkTypeface> other = ToolUtils::create_portable_typeface("serif", SkFontStyle::Bold());
+    static constexpr char kCustomData[] = "custom typeface";
+
+    SkSerialProcs serialProcs;
+    serialProcs.fTypefaceProc = [](SkTypeface* typeface, void* ctx) -> sk_sp<SkData> {
+        return typeface == ctx ? SkData::MakeWithCString(kCustomData) : nullptr;
+    };
+    serialProcs.fTypefaceCtx = custom.get();
+
+    SkDynamicMemoryWStream stream;
+    sk_sp<SkDocument> doc = SkMakeMultiPictureDocument(&stream, &serialProcs);
+    SkCanvas* canvas = doc->beginPage(100, 100);
+    canvas->drawTextBlob(SkTextBlob::MakeFromString("custom", SkFont(custom, 12)), 10, 20,
+                         SkPaint());
+    canvas->drawTextBlob(SkTextBlob::MakeFromString("other", SkFont(other, 12)), 10, 40,
+                         SkPaint());
+    doc->endPage();
+    doc->close();
+    std::unique_ptr<SkStreamAsset> written = stream.detachAsStream();
+
+    struct Context {
+        sk_sp<SkTypeface> fCustom;
+        int               fCalls = 0;
+        bool              fOnlyCustomData = true;
+    } context = {custom};
+    SkDeserialProcs deserialProcs;
+    deserialProcs.fTypefaceProc = [](const void* data, size_t length,
+                                     void* ctx) -> sk_sp<SkTypeface> {
+        auto context = static_cast<Context*>(ctx);
+        context->fCalls++;
+        context->fOnlyCustomData &= length == sizeof(kCustomData) &&
+                                    !memcmp(data, kCustomData, length);
+        return context->fCustom;
+    };
+    deserialProcs.fTypefaceCtx = &context;
+
+    auto reader = SkMultiPictureDocumentReader::Make(written.get(), &deserialProcs);
+    REPORTER_ASSERT(reporter, reader && reader->pageCount() == 1);
+    if (!reader) {
+        return;
+    }
+    REPORTER_ASSERT(reporter, reader->readPage(0));
+    REPORTER_ASSERT(reporter, context.fCalls == 1);
+    REPORTER_ASSERT(reporter, context.fOnlyCustomData);
+}
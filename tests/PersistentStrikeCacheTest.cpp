@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkFont.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkSurfaceProps.h"
+#include "src/core/SkPersistentStrikeCache.h"
+#include "src/core/SkScalerCache.h"
+#include "src/core/SkStrikeCache.h"
+#include "src/core/SkStrikeSpec.h"
+#include "src/utils/SkOSPath.h"
+#include "tests/Test.h"
+#include "tools/Resources.h"
+
+static SkStrikeSpec make_strike_spec(sk_sp<SkTypeface> typeface, SkScalar size) {
+    SkFont font(std::move(typeface), size);
+    font.setEdging(SkFont::Edging::kAntiAlias);
+    return SkStrikeSpec::MakeMask(font, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                                  SkScalerContextFlags::kNone, SkMatrix::I());
+}
+
+static constexpr int kGlyphCount = 40;
+
+// Makes the first kGlyphCount glyphs of the strike, with images and paths.
+static std::vector<const SkGlyph*> make_glyphs(SkStrike* strike) {
+    SkGlyphID ids[kGlyphCount];
+    SkPackedGlyphID packedIDs[kGlyphCount];
+    for (int i = 0; i < kGlyphCount; i++) {
+        ids[i] = SkTo<SkGlyphID>(i);
+        packedIDs[i] = SkPackedGlyphID{ids[i]};
+    }
+    std::vector<const SkGlyph*> glyphs(kGlyphCount);
+    strike->preparePaths(SkSpan<const SkGlyphID>{ids, kGlyphCount}, glyphs.data());
+    strike->prepareImages(SkSpan<const SkPackedGlyphID>{packedIDs, kGlyphCount}, glyphs.data());
+    return glyphs;
+}
+
+static void check_same_glyphs(skiatest::Reporter* reporter,
+                              const std::vector<const SkGlyph*>& expected,
+                              const std::vector<const SkGlyph*>& actual) {
+    REPORTER_ASSERT(reporter, expected.size() == actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        const SkGlyph& e = *expected[i];
+        const SkGlyph& a = *actual[i];
+        REPORTER_ASSERT(reporter, e.getPackedID() == a.getPackedID());
+        REPORTER_ASSERT(reporter, e.advanceX() == a.advanceX() && e.advanceY() == a.advanceY());
+        REPORTER_ASSERT(reporter, e.iRect() == a.iRect());
+        REPORTER_ASSERT(reporter, e.maskFormat() == a.maskFormat());
+        REPORTER_ASSERT(reporter, (e.image() == nullptr) == (a.image() == nullptr));
+        if (e.image() && a.image()) {
+            REPORTER_ASSERT(reporter, !memcmp(e.image(), a.image(), e.imageSize()));
+        }
+        REPORTER_ASSERT(reporter, (e.path() == nullptr) == (a.path() == nullptr));
+        if (e.path() && a.path()) {
+            REPORTER_ASSERT(reporter, *e.path() == *a.path());
+        }
+    }
+}
+
+DEF_TEST(PersistentStrikeCache, reporter) {
+    sk_sp<SkTypeface> typeface = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+    sk_sp<SkTypeface> otherTypeface = MakeResourceAsTypeface("fonts/Distortable.ttf");
+    if (!typeface || !otherTypeface) {
+        return;
+    }
+
+    SkStrikeCache source;
+    std::vector<std::vector<const SkGlyph*>> expected;
+    std::vector<SkExclusiveStrikePtr> sourceStrikes;
+    for (SkScalar size : {12, 31}) {
+        SkStrikeSpec spec = make_strike_spec(typeface, size);
+        sourceStrikes.push_back(spec.findOrCreateExclusiveStrike(&source));
+        expected.push_back(make_glyphs(sourceStrikes.back().get()));
+    }
+
+    sk_sp<SkData> data = SkPersistentStrikeCache::Serialize(&source);
+    sk_sp<SkPersistentStrikeCache> persistentCache = SkPersistentStrikeCache::Make(data);
+    REPORTER_ASSERT(reporter, persistentCache && persistentCache->strikeCount() == 2);
+    if (!persistentCache) {
+        return;
+    }
+
+    // A new process would have new font IDs, so load the font again.
+    sk_sp<SkTypeface> reloaded = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+    REPORTER_ASSERT(reporter, reloaded->uniqueID() != typeface->uniqueID());
+
+    SkStrikeCache target;
+    target.setPersistentCache(persistentCache);
+    int i = 0;
+    for (SkScalar size : {12, 31}) {
+        SkExclusiveStrikePtr strike =
+                make_strike_spec(reloaded, size).findOrCreateExclusiveStrike(&target);
+        REPORTER_ASSERT(reporter, strike->fScalerCache.countCachedGlyphs() == kGlyphCount);
+        check_same_glyphs(reporter, expected[i++], make_glyphs(strike.get()));
+    }
+    // The primed glyphs were counted once, when their strikes were inserted.
+    target.purgeAll();
+    REPORTER_ASSERT(reporter, target.getTotalMemoryUsed() == 0);
+
+    // Strikes that were not stored start empty.
+    SkExclusiveStrikePtr otherSize =
+            make_strike_spec(reloaded, 13).findOrCreateExclusiveStrike(&target);
+    REPORTER_ASSERT(reporter, otherSize->fScalerCache.countCachedGlyphs() == 0);
+    SkExclusiveStrikePtr otherFont =
+            make_strike_spec(otherTypeface, 12).findOrCreateExclusiveStrike(&target);
+    REPORTER_ASSERT(reporter, otherFont->fScalerCache.countCachedGlyphs() == 0);
+
+    // Data that is damaged or cut short is rejected, or primes at most the glyphs it has.
+    REPORTER_ASSERT(reporter, !SkPersistentStrikeCache::Make(SkData::MakeWithCString("nope")));
+    for (size_t length : {data->size() / 4, data->size() / 2, data->size() - 1}) {
+        auto truncated = SkPersistentStrikeCache::Make(SkData::MakeSubset(data.get(), 0, length));
+        if (truncated) {
+            SkStrikeCache cache;
+            cache.setPersistentCache(truncated);
+            SkExclusiveStrikePtr strike =
+                    make_strike_spec(reloaded, 31).findOrCreateExclusiveStrike(&cache);
+            REPORTER_ASSERT(reporter,
+                            strike->fScalerCache.countCachedGlyphs() <= kGlyphCount);
+        }
+    }
+
+    // Round trip through a file.
+    SkString tmpDir = skiatest::GetTmpDir();
+    if (!tmpDir.isEmpty()) {
+        SkString path = SkOSPath::Join(tmpDir.c_str(), "persistent_strike_cache");
+        REPORTER_ASSERT(reporter, SkPersistentStrikeCache::Write(&source, path.c_str()));
+        sk_sp<SkPersistentStrikeCache> fromFile =
+                SkPersistentStrikeCache::MakeFromFile(path.c_str());
+        REPORTER_ASSERT(reporter, fromFile && fromFile->strikeCount() == 2);
+
+        // Writing again replaces the file while it is still mapped.
+        REPORTER_ASSERT(reporter, SkPersistentStrikeCache::Write(&source, path.c_str()));
+        SkStrikeCache cache;
+        cache.setPersistentCache(fromFile);
+        SkExclusiveStrikePtr strike =
+                make_strike_spec(reloaded, 12).findOrCreateExclusiveStrike(&cache);
+        check_same_glyphs(reporter, expected[0], make_glyphs(strike.get()));
+    }
+}
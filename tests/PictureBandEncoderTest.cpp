@@ -0,0 +1,137 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkStream.h"
+#include "include/effects/SkGradientShader.h"
+#include "include/encode/SkPngEncoder.h"
+#include "include/utils/SkPictureBandEncoder.h"
+#include "tests/Test.h"
+
+#include <algorithm>
+
+static sk_sp<SkPicture> make_picture(int width, int height) {
+    SkPictureRecorder recorder;
+    SkCanvas* canvas = recorder.beginRecording(SkIntToScalar(width), SkIntToScalar(height));
+
+    const SkPoint pts[] = {{0, 0}, {SkIntToScalar(width), SkIntToScalar(height)}};
+    const SkColor colors[] = {SK_ColorRED, SK_ColorBLUE};
+    SkPaint paint;
+    paint.setShader(SkGradientShader::MakeLinear(pts, colors, nullptr, 2, SkTileMode::kClamp));
+    canvas->drawRect(SkRect::MakeIWH(width, height), paint);
+
+    paint.setShader(nullptr);
+    paint.setAntiAlias(true);
+    paint.setColor(SK_ColorGREEN);
+    canvas->drawCircle(width * 0.5f, height * 0.5f, width * 0.3f, paint);
+    paint.setColor(0x80000000);
+    canvas->drawOval(SkRect::MakeLTRB(3, 5, width - 7, height * 0.4f), paint);
+    return recorder.finishRecordingAsPicture();
+}
+
+static SkBitmap decode(sk_sp<SkData> data) {
+    SkBitmap bm;
+    sk_sp<SkImage> image = SkImage::MakeFromEncoded(std::move(data));
+    if (image) {
+        bm.allocPixels(SkImageInfo::MakeN32Premul(image->width(), image->height()));
+        image->readPixels(bm.pixmap(), 0, 0);
+    }
+    return bm;
+}
+
+// Draws |picture| as SkPictureBandEncoder does, into a strip |bandHeight| rows tall that is
+// translated to each band in turn.
+static SkBitmap draw_in_bands(const SkPicture* picture, const SkImageInfo& info,
+                              int bandHeight) {
+    SkBitmap result;
+    result.allocPixels(info);
+    SkBitmap strip;
+    strip.allocPixels(info.makeWH(info.width(), std::min(bandHeight, info.height())));
+    for (int top = 0; top < info.height(); top += bandHeight) {
+        strip.eraseColor(SK_ColorTRANSPARENT);
+        SkCanvas canvas(strip);
+        canvas.translate(0, -SkIntToScalar(top));
+        canvas.drawPicture(picture);
+
+        SkPixmap rows;
+        SkAssertResult(strip.pixmap().extractSubset(
+                &rows, SkIRect::MakeWH(info.width(), std::min(bandHeight, info.height() - top))));
+        SkAssertResult(result.writePixels(rows, 0, top));
+    }
+    return result;
+}
+
+static sk_sp<SkData> encode_png(const SkPixmap& pixmap) {
+    SkDynamicMemoryWStream stream;
+    if (!SkPngEncoder::Encode(&stream, pixmap, SkPngEncoder::Options())) {
+        return nullptr;
+    }
+    return stream.detachAsData();
+}
+
+DEF_TEST(PictureBandEncoder, r) {
+    const int kWidth = 61, kHeight = 97;
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(kWidth, kHeight);
+    sk_sp<SkPicture> picture = make_picture(kWidth, kHeight);
+
+    // The reference is the picture rasterized all at once.
+    SkBitmap expected;
+    expected.allocPixels(info);
+    expected.eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas(expected).drawPicture(picture);
+
+    sk_sp<SkData> expectedData = encode_png(expected.pixmap());
+    REPORTER_ASSERT(r, expectedData);
+
+    std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(1);
+    for (SkExecutor* exec : { (SkExecutor*)nullptr, executor.get() }) {
+        for (int bandHeight : { 1, 7, 16, kHeight, 1000 }) {
+            SkPictureBandEncoder::Options options;
+            options.fBandHeight = bandHeight;
+            options.fExecutor = exec;
+
+            SkDynamicMemoryWStream stream;
+            bool success = SkPictureBandEncoder::Encode(&stream, picture.get(), info,
+                                                        SkEncodedImageFormat::kPNG, 100, options);
+            REPORTER_ASSERT(r, success);
+            sk_sp<SkData> data = stream.detachAsData();
+
+            // Every band is exactly what drawing the picture into its strip gives.
+            sk_sp<SkData> bandsData =
+                    encode_png(draw_in_bands(picture.get(), info, bandHeight).pixmap());
+            REPORTER_ASSERT(r, data->equals(bandsData.get()), "band height %d", bandHeight);
+            if (bandHeight >= kHeight) {
+                // A single band is drawn exactly as the whole picture would be.
+                REPORTER_ASSERT(r, data->equals(expectedData.get()));
+            }
+        }
+
+        SkPictureBandEncoder::Options options;
+        options.fBandHeight = 10;
+        options.fExecutor = exec;
+        SkDynamicMemoryWStream stream;
+        REPORTER_ASSERT(r, SkPictureBandEncoder::Encode(&stream, picture.get(), info,
+                                                        SkEncodedImageFormat::kJPEG, 100,
+                                                        options));
+        SkBitmap actual = decode(stream.detachAsData());
+        REPORTER_ASSERT(r, actual.width() == kWidth && actual.height() == kHeight);
+    }
+
+    SkPictureBandEncoder::Options options;
+    SkNullWStream dummy;
+    REPORTER_ASSERT(r, !SkPictureBandEncoder::Encode(&dummy, nullptr, info,
+                                                     SkEncodedImageFormat::kPNG, 100, options));
+    REPORTER_ASSERT(r, !SkPictureBandEncoder::Encode(&dummy, picture.get(), info,
+                                                     SkEncodedImageFormat::kGIF, 100, options));
+    options.fBandHeight = 0;
+    REPORTER_ASSERT(r, !SkPictureBandEncoder::Encode(&dummy, picture.get(), info,
+                                                     SkEncodedImageFormat::kPNG, 100, options));
+}
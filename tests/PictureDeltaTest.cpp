@@ -0,0 +1,178 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkFont.h"
+#include "include/core/SkPath.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkTextBlob.h"
+#include "include/utils/SkRandom.h"
+#include "src/utils/SkPictureDelta.h"
+#include "tests/Test.h"
+#include "tools/ToolUtils.h"
+
+namespace {
+// A scene of many rects, paths, text and images, some of which move from frame to frame.
+struct Scene {
+    Scene() {
+        SkRandom rand;
+        SkBitmap bitmap;
+        bitmap.allocN32Pixels(64, 64);
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                *bitmap.getAddr32(x, y) = rand.nextU() | 0xFF000000;
+            }
+        }
+        fImage = SkImage::MakeFromBitmap(bitmap);
+
+        fPath.addCircle(10, 10, 10);
+        fPath.lineTo(30, 5);
+        SkFont font(ToolUtils::create_portable_typeface(), 12);
+        fBlob = SkTextBlob::MakeFromString("Hello, frame", font);
+
+        for (int i = 0; i < 300; i++) {
+            fPositions.push_back({rand.nextRangeF(0, 200), rand.nextRangeF(0, 200)});
+            fColors.push_back(rand.nextU() | 0xFF000000);
+        }
+    }
+
+    // Moves every 20th item.
+    void animate(int frame) {
+        for (int i = frame % 20; i < (int)fPositions.size(); i += 20) {
+            fPositions[i].offset(1, 1);
+        }
+    }
+
+    sk_sp<SkPicture> record() const {
+        SkPictureRecorder recorder;
+        SkCanvas* canvas = recorder.beginRecording(256, 256);
+        for (int i = 0; i < (int)fPositions.size(); i++) {
+            SkPaint paint;
+            paint.setColor(fColors[i]);
+            SkPoint p = fPositions[i];
+            switch (i % 4) {
+                case 0: canvas->drawRect(SkRect::MakeXYWH(p.x(), p.y(), 20, 10), paint); break;
+                case 1: canvas->save();
+                        canvas->translate(p.x(), p.y());
+                        canvas->drawPath(fPath, paint);
+                        canvas->restore();
+                        break;
+                case 2: canvas->drawTextBlob(fBlob, p.x(), p.y(), paint); break;
+                case 3: canvas->drawImage(fImage, p.x(), p.y()); break;
+            }
+        }
+        return recorder.finishRecordingAsPicture();
+    }
+
+    sk_sp<SkImage>       fImage;
+    SkPath               fPath;
+    sk_sp<SkTextBlob>    fBlob;
+    std::vector<SkPoint> fPositions;
+    std::vector<SkColor> fColors;
+};
+
+static SkBitmap draw(const SkPicture* picture) {
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(256, 256);
+    bitmap.eraseColor(SK_ColorWHITE);
+    SkCanvas canvas(bitmap);
+    canvas.drawPicture(picture);
+    return bitmap;
+}
+
+// Typefaces may not deserialize as the typeface that was serialized, so pictures are compared
+// after a round trip through SkPicture::serialize().
+static SkBitmap draw_serialized(const SkPicture* picture) {
+    sk_sp<SkPicture> deserialized = SkPicture::MakeFromData(picture->serialize().get());
+    return draw(deserialized.get());
+}
+}  // namespace
+
+DEF_TEST(PictureDelta, r) {
+    Scene scene;
+    SkPictureDeltaEncoder encoder;
+    SkPictureDeltaDecoder decoder;
+
+    std::vector<sk_sp<SkData>> frames;
+    for (int i = 0; i < 10; i++) {
+        scene.animate(i);
+        sk_sp<SkPicture> picture = scene.record();
+        sk_sp<SkData> frame = encoder.encode(picture.get());
+        REPORTER_ASSERT(r, frame);
+
+        sk_sp<SkPicture> decoded = decoder.decode(frame.get());
+        REPORTER_ASSERT(r, decoded);
+        if (decoded) {
+            REPORTER_ASSERT(r, ToolUtils::equal_pixels(draw_serialized(picture.get()),
+                                                       draw(decoded.get())));
+        }
+
+        // The first frame has everything, but the rest only have what moved.
+        size_t serialized = picture->serialize()->size();
+        if (i == 0) {
+            REPORTER_ASSERT(r, frame->size() > serialized / 2);
+        } else {
+            REPORTER_ASSERT(r, frame->size() < serialized / 10);
+        }
+        frames.push_back(std::move(frame));
+    }
+    REPORTER_ASSERT(r, !encoder.encode(nullptr));
+
+    // Frames must be decoded in order, starting with a key frame.
+    SkPictureDeltaDecoder late;
+    REPORTER_ASSERT(r, !late.decode(frames[1].get()));
+    REPORTER_ASSERT(r, late.decode(frames[0].get()));
+    REPORTER_ASSERT(r, !late.decode(frames[2].get()));
+    REPORTER_ASSERT(r, !late.decode(frames[1].get()));   // It waits for a key frame now.
+
+    // A truncated frame can't be read.
+    SkPictureDeltaDecoder truncated;
+    REPORTER_ASSERT(r, !truncated.decode(frames[0]->data(), frames[0]->size() - 4));
+    REPORTER_ASSERT(r, !truncated.decode(nullptr));
+
+    // After a reset, the encoder writes a key frame, which resyncs a decoder.
+    encoder.reset();
+    scene.animate(10);
+    sk_sp<SkPicture> picture = scene.record();
+    sk_sp<SkData> key = encoder.encode(picture.get());
+    sk_sp<SkPicture> decoded = late.decode(key.get());
+    REPORTER_ASSERT(r, decoded && ToolUtils::equal_pixels(draw_serialized(picture.get()),
+                                                          draw(decoded.get())));
+    REPORTER_ASSERT(r, decoder.decode(key.get()));
+}
+
+DEF_TEST(PictureDelta_DropsUnusedObjects, r) {
+    Scene scene;
+    SkPictureDeltaEncoder encoder;
+    SkPictureDeltaDecoder decoder;
+
+    auto encoded_size = [&](const SkPicture* picture) {
+        sk_sp<SkData> frame = encoder.encode(picture);
+        REPORTER_ASSERT(r, decoder.decode(frame.get()));
+        return frame->size();
+    };
+
+    sk_sp<SkPicture> withImage = scene.record();
+    SkPictureRecorder recorder;
+    recorder.beginRecording(256, 256)->drawColor(SK_ColorBLUE);
+    sk_sp<SkPicture> withoutImage = recorder.finishRecordingAsPicture();
+
+    // The image is sent once, and later frames that draw it only refer to it...
+    const size_t imageSize = scene.fImage->encodeToData()->size();
+    size_t first = encoded_size(withImage.get());
+    encoded_size(withoutImage.get());
+    size_t again = encoded_size(withImage.get());
+    REPORTER_ASSERT(r, again + imageSize <= first);
+
+    // ... until it hasn't been drawn for a while, when it has to be sent again.
+    for (int i = 0; i < 10; i++) {
+        encoded_size(withoutImage.get());
+    }
+    size_t resent = encoded_size(withImage.get());
+    REPORTER_ASSERT(r, resent >= again + imageSize);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkBitmap.h"
+#include "include/core/SkCanvas.h"
+#include "include/core/SkExecutor.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkImageGenerator.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkShader.h"
+#include "include/utils/SkPicturePredecoder.h"
+#include "tests/Test.h"
+
+#include <atomic>
+
+namespace {
+class CountingGenerator : public SkImageGenerator {
+public:
+    CountingGenerator(std::atomic<int>* decodeCount)
+        : INHERITED(SkImageInfo::MakeN32Premul(16, 16)), fDecodeCount(decodeCount) {}
+
+protected:
+    bool onGetPixels(const SkImageInfo& info, void* pixels, size_t rowBytes,
+                     const Options&) override {
+        fDecodeCount->fetch_add(1);
+        SkPixmap(info, pixels, rowBytes).erase(SK_ColorBLUE);
+        return true;
+    }
+
+private:
+    std::atomic<int>* fDecodeCount;
+
+    typedef SkImageGenerator INHERITED;
+};
+
+sk_sp<SkImage> make_counting_image(std::atomic<int>* decodeCount) {
+    return SkImage::MakeFromGenerator(std::make_unique<CountingGenerator>(decodeCount));
+}
+}  // namespace
+
+DEF_TEST(PicturePredecoder, r) {
+    std::atomic<int> insideDecodes{0},
+                     outsideDecodes{0};
+    sk_sp<SkImage> inside  = make_counting_image(&insideDecodes),
+                   outside = make_counting_image(&outsideDecodes);
+
+    SkRTreeFactory bbhFactory;
+    SkPictureRecorder recorder;
+    SkCanvas* recordingCanvas = recorder.beginRecording(SkRect::MakeWH(512, 512), &bbhFactory);
+    recordingCanvas->drawImage(inside, 10, 10);
+    recordingCanvas->drawImage(inside, 40, 10);   // A second draw of the same image.
+    recordingCanvas->drawImage(outside, 400, 400);
+    sk_sp<SkPicture> picture = recorder.finishRecordingAsPicture();
+
+    const SkIRect clip = SkIRect::MakeWH(100, 100);
+    {
+        SkPicturePredecoder predecoder(picture.get(), SkMatrix::I(), clip);
+        REPORTER_ASSERT(r, predecoder.imageCount() == 1);
+        REPORTER_ASSERT(r, predecoder.bytesToDecode() == 16 * 16 * 4);
+
+        std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(2);
+        predecoder.decode(executor.get());
+        predecoder.wait();
+        REPORTER_ASSERT(r, insideDecodes == 1);
+        REPORTER_ASSERT(r, outsideDecodes == 0);
+    }
+
+    // Playback finds the image already decoded.
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(clip.width(), clip.height());
+    SkCanvas canvas(bitmap);
+    canvas.drawPicture(picture);
+    REPORTER_ASSERT(r, insideDecodes == 1);
+    REPORTER_ASSERT(r, outsideDecodes == 0);
+    REPORTER_ASSERT(r, bitmap.getColor(20, 20) == SK_ColorBLUE);
+
+    // Nothing is left to decode.
+    SkPicturePredecoder again(picture.get(), SkMatrix::I(), clip);
+    REPORTER_ASSERT(r, again.imageCount() == 0);
+    REPORTER_ASSERT(r, again.bytesToDecode() == 0);
+}
+
+DEF_TEST(PicturePredecoder_ShaderAndMips, r) {
+    std::atomic<int> shaderDecodes{0},
+                     scaledDecodes{0};
+    sk_sp<SkImage> shaderImage = make_counting_image(&shaderDecodes),
+                   scaledImage = make_counting_image(&scaledDecodes);
+
+    SkPictureRecorder recorder;
+    SkCanvas* recordingCanvas = recorder.beginRecording(SkRect::MakeWH(100, 100));
+    SkPaint shaderPaint;
+    shaderPaint.setShader(shaderImage->makeShader());
+    recordingCanvas->drawRect(SkRect::MakeWH(50, 50), shaderPaint);
+
+    SkPaint scaledPaint;
+    scaledPaint.setFilterQuality(kMedium_SkFilterQuality);
+    recordingCanvas->drawImageRect(scaledImage, SkRect::MakeXYWH(60, 60, 4, 4), &scaledPaint);
+    sk_sp<SkPicture> picture = recorder.finishRecordingAsPicture();
+
+    SkPicturePredecoder predecoder(picture.get(), SkMatrix::I(), SkIRect::MakeWH(100, 100));
+    REPORTER_ASSERT(r, predecoder.imageCount() == 2);
+    // The scaled-down image needs its mipmaps too.
+    REPORTER_ASSERT(r, predecoder.bytesToDecode() > 2 * 16 * 16 * 4);
+
+    predecoder.decode(nullptr);
+    REPORTER_ASSERT(r, shaderDecodes == 1);
+    REPORTER_ASSERT(r, scaledDecodes == 1);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkMaskFilter.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkStream.h"
+#include "include/core/SkSurface.h"
+#include "include/effects/SkGradientShader.h"
+#include "src/core/SkPictureProfile.h"
+#include "src/utils/SkJSONWriter.h"
+#include "tests/Test.h"
+
+using Entry = SkPictureProfile::Entry;
+
+static const Entry* find_entry(const std::vector<Entry>& entries, SkRecords::Type type,
+                               uint32_t paintFlags) {
+    for (const auto& entry : entries) {
+        if (entry.fType == type && entry.fPaintFlags == paintFlags) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+DEF_TEST(PictureProfile, r) {
+    SkPictureRecorder recorder;
+    SkCanvas* canvas = recorder.beginRecording(200, 200);
+    SkPaint plain;
+    for (int i = 0; i < 3; i++) {
+        canvas->drawRect(SkRect::MakeXYWH(10 * i, 0, 10, 10), plain);
+    }
+    SkPaint fancy;
+    fancy.setAntiAlias(true);
+    fancy.setBlendMode(SkBlendMode::kMultiply);
+    SkPoint pts[] = {{0, 0}, {100, 0}};
+    SkColor colors[] = {SK_ColorRED, SK_ColorBLUE};
+    fancy.setShader(SkGradientShader::MakeLinear(pts, colors, nullptr, 2, SkTileMode::kClamp));
+    canvas->drawRect(SkRect::MakeXYWH(0, 50, 100, 20), fancy);
+    SkPaint blurred;
+    blurred.setMaskFilter(SkMaskFilter::MakeBlur(kNormal_SkBlurStyle, 3));
+    canvas->save();
+    canvas->translate(150, 150);
+    // Half of this is outside the 200x200 surface.
+    canvas->drawOval(SkRect::MakeWH(100, 20), blurred);
+    canvas->restore();
+    sk_sp<SkPicture> picture = recorder.finishRecordingAsPicture();
+
+    auto surface = SkSurface::MakeRasterN32Premul(200, 200);
+    SkPictureProfile profile;
+    profile.playback(picture.get(), surface->getCanvas());
+    // The profile draws the picture, so it must also leave the canvas as it found it.
+    REPORTER_ASSERT(r, surface->getCanvas()->getSaveCount() == 1);
+    REPORTER_ASSERT(r, surface->getCanvas()->getTotalMatrix().isIdentity());
+
+    std::vector<Entry> entries = profile.entries();
+    const auto* rects = find_entry(entries, SkRecords::DrawRect_Type, 0);
+    REPORTER_ASSERT(r, rects && rects->fCount == 3 && rects->fPixels == 300);
+    const auto* fancyRect = find_entry(entries, SkRecords::DrawRect_Type,
+                                       SkPictureProfile::kShader_PaintFlag |
+                                       SkPictureProfile::kBlend_PaintFlag |
+                                       SkPictureProfile::kAntiAlias_PaintFlag);
+    REPORTER_ASSERT(r, fancyRect && fancyRect->fCount == 1);
+    REPORTER_ASSERT(r, fancyRect && fancyRect->description().equals("DrawRect [shader blend aa]"));
+    const auto* oval = find_entry(entries, SkRecords::DrawOval_Type,
+                                  SkPictureProfile::kMaskFilter_PaintFlag);
+    // The blur spreads past the oval, but the surface only has 50 pixels of it in each direction.
+    REPORTER_ASSERT(r, oval && oval->fPixels > 50 * 20 && oval->fPixels <= 50 * 50);
+    REPORTER_ASSERT(r, find_entry(entries, SkRecords::Save_Type, 0));
+
+    int ops = 0;
+    double ms = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        ops += entries[i].fCount;
+        ms += entries[i].fMs;
+        REPORTER_ASSERT(r, i == 0 || entries[i - 1].fMs >= entries[i].fMs);
+    }
+    REPORTER_ASSERT(r, ops == picture->approximateOpCount());
+    REPORTER_ASSERT(r, SkScalarNearlyEqual(ms, profile.totalMs()));
+
+    // The report has a header, the requested rows and a total.
+    SkString report = profile.report(2);
+    int lines = 0;
+    for (const char* c = report.c_str(); *c; c++) {
+        lines += *c == '\n';
+    }
+    REPORTER_ASSERT(r, lines == 4);
+
+    SkDynamicMemoryWStream stream;
+    {
+        SkJSONWriter writer(&stream);
+        profile.writeJSON(&writer);
+    }
+    sk_sp<SkData> json = stream.detachAsData();
+    SkString text((const char*)json->data(), json->size());
+    REPORTER_ASSERT(r, text.contains(
+            R"({"op":"DrawRect","paint":["shader","blend","aa"],"count":1,)"));
+
+    // Playing back again adds to the same entries.
+    profile.playback(picture.get(), surface->getCanvas());
+    entries = profile.entries();
+    rects = find_entry(entries, SkRecords::DrawRect_Type, 0);
+    REPORTER_ASSERT(r, rects && rects->fCount == 6);
+
+    profile.reset();
+    REPORTER_ASSERT(r, profile.entries().empty());
+}
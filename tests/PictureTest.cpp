@@ -25,6 +25,7 @@
 #include "include/core/SkStream.h"
 #include "include/core/SkTypeface.h"
 #include "include/core/SkTypes.h"
+#include "include/utils/SkNoDrawCanvas.h"
 #include "include/utils/SkRandom.h"
 #include "src/core/SkBigPicture.h"
 #include "src/core/SkClipOpPriv.h"
@@ -32,6 +33,7 @@
 #include "src/core/SkPicturePriv.h"
 #include "src/core/SkRectPriv.h"
 #include "tests/Test.h"
+#include "tools/Resources.h"
 
 #include <memory>
 
@@ -968,3 +970,75 @@ DEF_TEST(Picture_fillsBBH, r) {
                         "results.size() == %d, want %d\n", (int)results.size(), n);
     }
 }
+
+// Collects the encoded data of each image drawn.
+class EncodedImageCanvas : public SkNoDrawCanvas {
+public:
+    EncodedImageCanvas() : SkNoDrawCanvas(256, 256) {}
+
+    std::vector<sk_sp<SkData>> fEncoded;
+
+protected:
+    void onDrawImage(const SkImage* image, SkScalar, SkScalar, const SkPaint*) override {
+        fEncoded.push_back(image->refEncodedData());
+    }
+};
+
+DEF_TEST(Picture_MakeFromSharedData, r) {
+    sk_sp<SkImage> image = GetResourceAsImage("images/mandrill_128.png");
+    if (!image) {
+        return;
+    }
+    sk_sp<SkData> encoded = image->refEncodedData();
+
+    SkPictureRecorder recorder;
+    recorder.beginRecording(256, 256)->drawImage(image, 128, 128);
+    sk_sp<SkPicture> inner = recorder.finishRecordingAsPicture();
+    SkCanvas* canvas = recorder.beginRecording(256, 256);
+    canvas->drawImage(image, 0, 0);
+    canvas->drawPicture(inner);
+    sk_sp<SkData> data = recorder.finishRecordingAsPicture()->serialize();
+
+    // The op data is read in place when it is aligned, and copied otherwise. Try both.
+    for (size_t offset : {0, 1, 2, 3}) {
+        sk_sp<SkData> storage = SkData::MakeUninitialized(offset + data->size());
+        memcpy((char*)storage->writable_data() + offset, data->data(), data->size());
+        sk_sp<SkData> backing = SkData::MakeSubset(storage.get(), offset, data->size());
+
+        sk_sp<SkPicture> picture = SkPicture::MakeFromSharedData(backing);
+        REPORTER_ASSERT(r, picture && picture->approximateOpCount() == 2);
+        if (!picture) {
+            continue;
+        }
+        EncodedImageCanvas images;
+        picture->playback(&images);
+        REPORTER_ASSERT(r, images.fEncoded.size() == 2);
+        for (const sk_sp<SkData>& imageData : images.fEncoded) {
+            REPORTER_ASSERT(r, imageData && imageData->equals(encoded.get()));
+            if (imageData) {
+                REPORTER_ASSERT(r, imageData->bytes() >= backing->bytes() &&
+                                   imageData->bytes() + imageData->size() <=
+                                           backing->bytes() + backing->size());
+            }
+        }
+    }
+
+    // Otherwise, the bytes are copied, so the picture doesn't depend on them.
+    for (sk_sp<SkPicture> picture : {SkPicture::MakeFromData(data->data(), data->size()),
+                                     SkPicture::MakeFromData(data.get())}) {
+        REPORTER_ASSERT(r, picture);
+        if (!picture) {
+            continue;
+        }
+        EncodedImageCanvas images;
+        picture->playback(&images);
+        REPORTER_ASSERT(r, images.fEncoded.size() == 2);
+        for (const sk_sp<SkData>& imageData : images.fEncoded) {
+            REPORTER_ASSERT(r, imageData && imageData->equals(encoded.get()));
+            if (imageData) {
+                REPORTER_ASSERT(r, imageData->bytes() < data->bytes() ||
+                                   imageData->bytes() >= data->bytes() + data->size());
+            }
+        }
+    }
+}
@@ -53,7 +53,7 @@ static void run_queries(skiatest::Reporter* reporter, SkRandom& rand, SkRect rec
     }
 }
 
-DEF_TEST(RTree, reporter) {
+static void test_rtree(skiatest::Reporter* reporter, SkRTree::Packing packing) {
     int expectedDepthMin = -1;
     int tmp = NUM_RECTS;
     while (tmp > 0) {
@@ -73,7 +73,7 @@ DEF_TEST(RTree, reporter) {
     SkRandom rand;
     SkAutoTMalloc<SkRect> rects(NUM_RECTS);
     for (size_t i = 0; i < NUM_ITERATIONS; ++i) {
-        SkRTree rtree;
+        SkRTree rtree(packing);
         REPORTER_ASSERT(reporter, 0 == rtree.getCount());
 
         for (int j = 0; j < NUM_RECTS; j++) {
@@ -89,3 +89,11 @@ DEF_TEST(RTree, reporter) {
                                   expectedDepthMax >= rtree.getDepth());
     }
 }
+
+DEF_TEST(RTree, reporter) {
+    test_rtree(reporter, SkRTree::Packing::kInsertionOrder);
+}
+
+DEF_TEST(RTree_SortTileRecursive, reporter) {
+    test_rtree(reporter, SkRTree::Packing::kSortTileRecursive);
+}
@@ -8,11 +8,15 @@
 #include "tests/RecordTestUtils.h"
 #include "tests/Test.h"
 
+#include "include/core/SkBitmap.h"
 #include "include/core/SkColorFilter.h"
 #include "include/core/SkPictureRecorder.h"
 #include "include/core/SkSurface.h"
+#include "include/core/SkMaskFilter.h"
+#include "include/effects/SkGradientShader.h"
 #include "include/effects/SkImageFilters.h"
 #include "src/core/SkRecord.h"
+#include "src/core/SkRecordDraw.h"
 #include "src/core/SkRecordOpts.h"
 #include "src/core/SkRecorder.h"
 #include "src/core/SkRecords.h"
@@ -426,3 +430,341 @@ DEF_TEST(savelayer_srcmode_alpha, r) {
     do_savelayer_srcmode(r, 0x80FF0000);
 }
 
+
+static sk_sp<SkImage> make_checker_image(SkColor a, SkColor b) {
+    auto surface = SkSurface::MakeRasterN32Premul(16, 16);
+    surface->getCanvas()->clear(a);
+    SkPaint paint;
+    paint.setColor(b);
+    surface->getCanvas()->drawRect(SkRect::MakeWH(8, 8), paint);
+    surface->getCanvas()->drawRect(SkRect::MakeXYWH(8, 8, 8, 8), paint);
+    return surface->makeImageSnapshot();
+}
+
+static SkBitmap draw_record(const SkRecord& record) {
+    SkBitmap bitmap;
+    bitmap.allocN32Pixels(100, 100);
+    SkCanvas canvas(bitmap);
+    canvas.clear(SK_ColorWHITE);
+    SkRecordDraw(record, &canvas, nullptr, nullptr, 0, nullptr, nullptr);
+    return bitmap;
+}
+
+DEF_TEST(RecordOpts_BatchImageRects, r) {
+    sk_sp<SkImage> red = make_checker_image(SK_ColorRED, SK_ColorYELLOW),
+                   blue = make_checker_image(SK_ColorBLUE, SK_ColorGREEN);
+
+    SkPaint aa;
+    aa.setAntiAlias(true);
+    aa.setAlphaf(0.5f);
+    aa.setFilterQuality(kLow_SkFilterQuality);
+    SkPaint blurred;
+    blurred.setMaskFilter(SkMaskFilter::MakeBlur(kNormal_SkBlurStyle, 2));
+
+    SkRecord record;
+    SkRecorder recorder(&record, 100, 100);
+    // A run of three overlapping draws, with a NoOp in the middle, ...
+    recorder.drawImageRect(red, SkRect::MakeXYWH(10, 10, 30, 30), &aa);
+    recorder.drawImageRect(blue, SkRect::MakeXYWH(4, 4, 8, 8), SkRect::MakeXYWH(20.5f, 20, 30, 30),
+                           &aa, SkCanvas::kFast_SrcRectConstraint);
+    recorder.save();
+    recorder.restore();
+    recorder.drawImageRect(red, SkRect::MakeXYWH(30, 30, 30, 30), &aa);
+    // ... one of two without a paint, one alone, ...
+    recorder.drawImageRect(blue, SkRect::MakeXYWH(60, 10, 20, 20), nullptr);
+    recorder.drawImageRect(red, SkRect::MakeXYWH(70, 20, 20, 20), nullptr);
+    recorder.drawRect(SkRect::MakeXYWH(0, 60, 10, 10), SkPaint());
+    recorder.drawImageRect(red, SkRect::MakeXYWH(10, 60, 20, 20), nullptr);
+    // ... and two that can't be batched because of their mask filters.
+    recorder.drawImageRect(red, SkRect::MakeXYWH(40, 60, 20, 20), &blurred);
+    recorder.drawImageRect(blue, SkRect::MakeXYWH(60, 60, 20, 20), &blurred);
+
+    SkRecord optimized;
+    SkRecorder copier(&optimized, 100, 100);
+    SkRecordDraw(record, &copier, nullptr, nullptr, 0, nullptr, nullptr);
+    SkRecordNoopSaveRestores(&optimized);
+    SkRecordBatchImageRects(&optimized);
+    optimized.defrag();
+
+    REPORTER_ASSERT(r, 6 == optimized.count());
+    auto set = assert_type<SkRecords::DrawEdgeAAImageSet>(r, optimized, 0);
+    if (set) {
+        REPORTER_ASSERT(r, 3 == set->count);
+        REPORTER_ASSERT(r, set->paint && *set->paint == aa);
+        REPORTER_ASSERT(r, set->constraint == SkCanvas::kFast_SrcRectConstraint);
+        REPORTER_ASSERT(r, set->set[0].fSrcRect == SkRect::MakeWH(16, 16));
+        REPORTER_ASSERT(r, set->set[1].fSrcRect == SkRect::MakeXYWH(4, 4, 8, 8));
+        REPORTER_ASSERT(r, set->set[0].fAAFlags == SkCanvas::kAll_QuadAAFlags);
+    }
+    set = assert_type<SkRecords::DrawEdgeAAImageSet>(r, optimized, 1);
+    if (set) {
+        REPORTER_ASSERT(r, 2 == set->count);
+        REPORTER_ASSERT(r, !set->paint);
+        REPORTER_ASSERT(r, set->set[0].fAAFlags == SkCanvas::kNone_QuadAAFlags);
+    }
+    assert_type<SkRecords::DrawRect>(r, optimized, 2);
+    assert_type<SkRecords::DrawImageRect>(r, optimized, 3);
+    assert_type<SkRecords::DrawImageRect>(r, optimized, 4);
+    assert_type<SkRecords::DrawImageRect>(r, optimized, 5);
+
+    // The batched draws render exactly as the originals did.
+    SkBitmap expected = draw_record(record),
+             actual = draw_record(optimized);
+    REPORTER_ASSERT(r, !memcmp(expected.getPixels(), actual.getPixels(),
+                               expected.computeByteSize()));
+}
+
+DEF_TEST(RecordOpts_Compact, r) {
+    auto make_path = [](SkScalar size) {
+        SkPath path;
+        path.moveTo(0, 0);
+        path.quadTo(size, 0, size, size);
+        path.lineTo(0, size);
+        path.close();
+        return path;
+    };
+    auto make_paint = [](SkColor color) {
+        const SkPoint pts[] = {{0, 0}, {100, 100}};
+        const SkColor colors[] = {color, SK_ColorWHITE};
+        SkPaint paint;
+        paint.setShader(SkGradientShader::MakeLinear(pts, colors, nullptr, 2,
+                                                     SkTileMode::kClamp));
+        paint.setColorFilter(SkColorFilters::Blend(SK_ColorRED, SkBlendMode::kModulate));
+        return paint;
+    };
+
+    SkRecord record;
+    SkRecorder recorder(&record, 100, 100);
+    for (int i = 0; i < 10; i++) {
+        // Equal paths and effects, but each made anew, ...
+        recorder.drawPath(make_path(50), make_paint(SK_ColorBLUE));
+    }
+    // ... a different path and shader, ...
+    recorder.drawPath(make_path(60), make_paint(SK_ColorGREEN));
+    // ... and a volatile path.
+    SkPath volatilePath = make_path(50);
+    volatilePath.setIsVolatile(true);
+    recorder.drawPath(volatilePath, make_paint(SK_ColorBLUE));
+
+    SkRecord compacted;
+    SkRecorder copier(&compacted, 100, 100);
+    SkRecordDraw(record, &copier, nullptr, nullptr, 0, nullptr, nullptr);
+    SkRecordCompact(&compacted);
+
+    REPORTER_ASSERT(r, 12 == compacted.count());
+    REPORTER_ASSERT(r, compacted.bytesUsed() <= record.bytesUsed());
+    auto first = assert_type<SkRecords::DrawPath>(r, compacted, 0);
+    for (int i = 1; i < 12; i++) {
+        auto draw = assert_type<SkRecords::DrawPath>(r, compacted, i);
+        if (!first || !draw) {
+            continue;
+        }
+        // Every op shares the color filter, and all but the different ones the path and shader.
+        REPORTER_ASSERT(r, draw->paint.getColorFilter() == first->paint.getColorFilter());
+        REPORTER_ASSERT(r, (i != 10) == (draw->paint.getShader() == first->paint.getShader()));
+        REPORTER_ASSERT(r, (i < 10) == (draw->path.getGenerationID() ==
+                                        first->path.getGenerationID()));
+    }
+    if (auto draw = assert_type<SkRecords::DrawPath>(r, compacted, 11)) {
+        REPORTER_ASSERT(r, draw->path.isVolatile());
+    }
+
+    // The compacted ops render exactly as the originals did.
+    SkBitmap expected = draw_record(record),
+             actual = draw_record(compacted);
+    REPORTER_ASSERT(r, !memcmp(expected.getPixels(), actual.getPixels(),
+                               expected.computeByteSize()));
+
+    // The flag compacts pictures as they're finished.
+    SkPictureRecorder pictureRecorder;
+    SkCanvas* canvas = pictureRecorder.beginRecording(100, 100);
+    for (int i = 0; i < 10; i++) {
+        canvas->drawPath(make_path(50), make_paint(SK_ColorBLUE));
+    }
+    sk_sp<SkPicture> picture =
+            pictureRecorder.finishRecordingAsPicture(SkPictureRecorder::kCompact_FinishFlag);
+    REPORTER_ASSERT(r, picture->approximateOpCount() == 10);
+
+    // A path known to be an oval only shares with other such ovals, not with paths that have
+    // the same points but were built by hand.
+    SkPath oval;
+    oval.addOval(SkRect::MakeWH(50, 30));
+    SkPath handBuilt;
+    SkPath::RawIter iter(oval);
+    SkPoint pts[4];
+    for (SkPath::Verb verb; (verb = iter.next(pts)) != SkPath::kDone_Verb;) {
+        switch (verb) {
+            case SkPath::kMove_Verb:  handBuilt.moveTo(pts[0]); break;
+            case SkPath::kConic_Verb: handBuilt.conicTo(pts[1], pts[2], iter.conicWeight()); break;
+            case SkPath::kClose_Verb: handBuilt.close(); break;
+            default: SkASSERT(false); break;
+        }
+    }
+    REPORTER_ASSERT(r, handBuilt == oval && !handBuilt.isOval(nullptr));
+
+    SkRecord shapes;
+    SkRecorder shapeRecorder(&shapes, 100, 100);
+    shapeRecorder.drawPath(handBuilt, SkPaint());
+    shapeRecorder.drawPath(oval, SkPaint());
+    shapeRecorder.drawPath(SkPath(handBuilt), SkPaint());
+    shapeRecorder.drawPath(SkPath().addOval(SkRect::MakeWH(50, 30)), SkPaint());
+    SkRecordCompact(&shapes);
+
+    const SkRecords::DrawPath* draws[4];
+    for (int i = 0; i < 4; i++) {
+        draws[i] = assert_type<SkRecords::DrawPath>(r, shapes, i);
+        if (!draws[i]) {
+            return;
+        }
+    }
+    REPORTER_ASSERT(r, !draws[0]->path.isOval(nullptr) && !draws[2]->path.isOval(nullptr));
+    REPORTER_ASSERT(r, draws[1]->path.isOval(nullptr) && draws[3]->path.isOval(nullptr));
+    REPORTER_ASSERT(r, draws[0]->path.getGenerationID() == draws[2]->path.getGenerationID());
+    REPORTER_ASSERT(r, draws[1]->path.getGenerationID() == draws[3]->path.getGenerationID());
+    REPORTER_ASSERT(r, draws[0]->path.getGenerationID() != draws[1]->path.getGenerationID());
+}
+
+DEF_TEST(RecordOpts_TightenLayerBounds, r) {
+    SkPaint alpha;
+    alpha.setAlpha(0x80);
+    SkPaint blur;
+    blur.setImageFilter(SkImageFilters::Blur(3, 3, nullptr));
+
+    SkRecord record;
+    SkRecorder recorder(&record, 100, 100);
+    // A layer without bounds, ...
+    recorder.saveLayer(nullptr, &alpha);
+        recorder.drawRect(SkRect::MakeXYWH(10, 10, 10, 10), SkPaint());
+        recorder.drawRect(SkRect::MakeXYWH(30, 20, 10, 20), SkPaint());
+    recorder.restore();
+    // ... one whose bounds are too big, under a matrix, ...
+    recorder.save();
+    recorder.translate(50, 50);
+    recorder.scale(2, 2);
+    SkRect big = SkRect::MakeWH(40, 40);
+    recorder.saveLayer(&big, &alpha);
+        recorder.drawRect(SkRect::MakeXYWH(5, 5, 10, 10), SkPaint());
+    recorder.restore();
+    recorder.restore();
+    // ... and ones whose bounds can't be known from what's drawn inside them.
+    recorder.saveLayer(nullptr, &blur);
+        recorder.drawRect(SkRect::MakeXYWH(10, 60, 10, 10), SkPaint());
+    recorder.restore();
+    recorder.saveLayer({nullptr, &alpha, nullptr, SkCanvas::kInitWithPrevious_SaveLayerFlag});
+        recorder.drawRect(SkRect::MakeXYWH(30, 60, 10, 10), SkPaint());
+    recorder.restore();
+    // A layer inside one whose filter moves what it draws is left alone too.
+    SkPaint offset;
+    offset.setImageFilter(SkImageFilters::Offset(30, 0, nullptr));
+    recorder.saveLayer(nullptr, &offset);
+        recorder.saveLayer(nullptr, &alpha);
+            recorder.drawRect(SkRect::MakeXYWH(50, 60, 10, 10), SkPaint());
+        recorder.restore();
+    recorder.restore();
+    // So is one around a layer whose backdrop filter fills the whole clip.
+    sk_sp<SkImageFilter> fill = SkImageFilters::ColorFilter(
+            SkColorFilters::Blend(SK_ColorGREEN, SkBlendMode::kSrcOver), nullptr);
+    recorder.saveLayer(nullptr, nullptr);
+        recorder.drawRect(SkRect::MakeXYWH(70, 60, 10, 10), SkPaint());
+        recorder.saveLayer({nullptr, nullptr, fill.get(), 0});
+        recorder.restore();
+    recorder.restore();
+
+    SkRecord optimized;
+    SkRecorder copier(&optimized, 100, 100);
+    SkRecordDraw(record, &copier, nullptr, nullptr, 0, nullptr, nullptr);
+    SkRecordTightenLayerBounds(&optimized);
+
+    auto layer = assert_type<SkRecords::SaveLayer>(r, optimized, 0);
+    REPORTER_ASSERT(r, layer && layer->bounds &&
+                       *layer->bounds == SkRect::MakeLTRB(10, 10, 40, 40));
+    layer = assert_type<SkRecords::SaveLayer>(r, optimized, 7);
+    REPORTER_ASSERT(r, layer && layer->bounds && *layer->bounds == SkRect::MakeXYWH(5, 5, 10, 10));
+    layer = assert_type<SkRecords::SaveLayer>(r, optimized, 11);
+    REPORTER_ASSERT(r, layer && !layer->bounds);
+    layer = assert_type<SkRecords::SaveLayer>(r, optimized, 14);
+    REPORTER_ASSERT(r, layer && !layer->bounds);
+    layer = assert_type<SkRecords::SaveLayer>(r, optimized, 18);
+    REPORTER_ASSERT(r, layer && !layer->bounds);
+    layer = assert_type<SkRecords::SaveLayer>(r, optimized, 22);
+    REPORTER_ASSERT(r, layer && !layer->bounds);
+
+    // The tighter layers render exactly as the originals did.
+    SkBitmap expected = draw_record(record),
+             actual = draw_record(optimized);
+    REPORTER_ASSERT(r, !memcmp(expected.getPixels(), actual.getPixels(),
+                               expected.computeByteSize()));
+}
+
+DEF_TEST(RecordOpts_FoldLayerAlpha, r) {
+    SkPaint alpha;
+    alpha.setAlpha(0x80);
+    SkPaint red, blue;
+    red.setColor(SK_ColorRED);
+    blue.setColor(SK_ColorBLUE);
+
+    SkRecord record;
+    SkRecorder recorder(&record, 100, 100);
+    // An alpha layer around draws that don't touch, which takes nested saves, ...
+    recorder.saveLayer(nullptr, &alpha);
+        recorder.drawRect(SkRect::MakeXYWH(10, 10, 10, 10), red);
+        recorder.save();
+        recorder.translate(20, 0);
+        recorder.drawOval(SkRect::MakeXYWH(10, 10, 10, 10), blue);
+        recorder.restore();
+    recorder.restore();
+    // ... one around draws that do, ...
+    recorder.saveLayer(nullptr, &alpha);
+        recorder.drawRect(SkRect::MakeXYWH(10, 50, 20, 20), red);
+        recorder.drawRect(SkRect::MakeXYWH(20, 60, 20, 20), blue);
+    recorder.restore();
+    // ... a layer without a paint around draws that do, ...
+    recorder.saveLayer(nullptr, nullptr);
+        recorder.drawRect(SkRect::MakeXYWH(60, 50, 20, 20), red);
+        recorder.drawRect(SkRect::MakeXYWH(70, 60, 20, 20), blue);
+    recorder.restore();
+    // ... and an alpha layer around a single draw of points that overlap each other.
+    const SkPoint points[] = {{60, 10}, {66, 10}};
+    SkPaint fat = red;
+    fat.setStrokeWidth(10);
+    recorder.saveLayer(nullptr, &alpha);
+        recorder.drawPoints(SkCanvas::kPoints_PointMode, SK_ARRAY_COUNT(points), points, fat);
+    recorder.restore();
+
+    SkRecord optimized;
+    SkRecorder copier(&optimized, 100, 100);
+    SkRecordDraw(record, &copier, nullptr, nullptr, 0, nullptr, nullptr);
+    SkRecordFoldLayerAlpha(&optimized);
+
+    assert_type<SkRecords::NoOp>(r, optimized, 0);
+    auto rect = assert_type<SkRecords::DrawRect>(r, optimized, 1);
+    REPORTER_ASSERT(r, rect && rect->paint.getColor() == SkColorSetA(SK_ColorRED, 0x80));
+    auto oval = assert_type<SkRecords::DrawOval>(r, optimized, 4);
+    REPORTER_ASSERT(r, oval && oval->paint.getColor() == SkColorSetA(SK_ColorBLUE, 0x80));
+    assert_type<SkRecords::NoOp>(r, optimized, 6);
+    assert_type<SkRecords::SaveLayer>(r, optimized, 7);
+    assert_type<SkRecords::Restore>(r, optimized, 10);
+    assert_type<SkRecords::NoOp>(r, optimized, 11);
+    rect = assert_type<SkRecords::DrawRect>(r, optimized, 12);
+    REPORTER_ASSERT(r, rect && rect->paint.getColor() == SK_ColorRED);
+    assert_type<SkRecords::NoOp>(r, optimized, 14);
+    assert_type<SkRecords::SaveLayer>(r, optimized, 15);
+    auto pointsOp = assert_type<SkRecords::DrawPoints>(r, optimized, 16);
+    REPORTER_ASSERT(r, pointsOp && pointsOp->paint.getColor() == SK_ColorRED);
+    assert_type<SkRecords::Restore>(r, optimized, 17);
+
+    // The folded layers render as the originals did, give or take rounding the alpha once
+    // rather than twice.
+    SkBitmap expected = draw_record(record),
+             actual = draw_record(optimized);
+    for (int y = 0; y < expected.height(); y++) {
+        for (int x = 0; x < expected.width(); x++) {
+            SkColor e = expected.getColor(x, y),
+                    a = actual.getColor(x, y);
+            REPORTER_ASSERT(r, SkTAbs((int)SkColorGetR(e) - (int)SkColorGetR(a)) <= 1 &&
+                               SkTAbs((int)SkColorGetG(e) - (int)SkColorGetG(a)) <= 1 &&
+                               SkTAbs((int)SkColorGetB(e) - (int)SkColorGetB(a)) <= 1,
+                            "(%d, %d) %08x vs %08x", x, y, e, a);
+        }
+    }
+}
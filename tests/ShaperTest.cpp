@@ -15,8 +15,11 @@
 #include "modules/skshaper/include/SkShaper.h"
 #include "tools/Resources.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 namespace {
 struct RunHandler final : public SkShaper::RunHandler {
@@ -91,8 +94,131 @@ void cluster_test(skiatest::Reporter* reporter, const char* resource) {
     shaper_test(reporter, resource, data.get());
 }
 
+// Keeps every run a shaper gives it, placed at an offset like SkTextBlobBuilderRunHandler does.
+struct CollectingRunHandler final : public SkShaper::RunHandler {
+    struct Run {
+        SkShaper::RunHandler::Range fRange;
+        SkVector fAdvance;
+        SkScalar fFontSize;
+        std::vector<SkGlyphID> fGlyphs;
+        std::vector<SkPoint> fPositions;
+        std::vector<uint32_t> fClusters;
+    };
+    std::vector<Run> fRuns;
+    int fLines = 0;
+
+    void beginLine() override { fLines++; }
+    void runInfo(const RunInfo&) override {}
+    void commitRunInfo() override {}
+    Buffer runBuffer(const RunInfo& info) override {
+        fRuns.push_back({info.utf8Range, info.fAdvance, info.fFont.getSize(),
+                         std::vector<SkGlyphID>(info.glyphCount),
+                         std::vector<SkPoint>(info.glyphCount),
+                         std::vector<uint32_t>(info.glyphCount)});
+        Run& run = fRuns.back();
+        return {run.fGlyphs.data(), run.fPositions.data(), nullptr, run.fClusters.data(),
+                {10, 20.0f * fLines}};
+    }
+    void commitRunBuffer(const RunInfo&) override {}
+    void commitLine() override {}
+};
+
+void check_same_runs(skiatest::Reporter* reporter, const CollectingRunHandler& expected,
+                     const CollectingRunHandler& actual) {
+    REPORTER_ASSERT(reporter, expected.fLines == actual.fLines);
+    REPORTER_ASSERT(reporter, expected.fRuns.size() == actual.fRuns.size());
+    for (size_t i = 0; i < std::min(expected.fRuns.size(), actual.fRuns.size()); ++i) {
+        const auto& e = expected.fRuns[i];
+        const auto& a = actual.fRuns[i];
+        REPORTER_ASSERT(reporter, e.fRange.begin() == a.fRange.begin());
+        REPORTER_ASSERT(reporter, e.fRange.size() == a.fRange.size());
+        REPORTER_ASSERT(reporter, e.fAdvance == a.fAdvance);
+        REPORTER_ASSERT(reporter, e.fFontSize == a.fFontSize);
+        REPORTER_ASSERT(reporter, e.fGlyphs == a.fGlyphs);
+        REPORTER_ASSERT(reporter, e.fClusters == a.fClusters);
+        REPORTER_ASSERT(reporter, e.fPositions.size() == a.fPositions.size());
+        for (size_t j = 0; j < std::min(e.fPositions.size(), a.fPositions.size()); ++j) {
+            // Some shapers add up the advances from the buffer's point, others from zero.
+            REPORTER_ASSERT(reporter, SkScalarNearlyEqual(e.fPositions[j].fX, a.fPositions[j].fX));
+            REPORTER_ASSERT(reporter, e.fPositions[j].fY == a.fPositions[j].fY);
+        }
+    }
+}
+
 }  // namespace
 
+DEF_TEST(Shaper_Cache, reporter) {
+    sk_sp<SkShaperCache> cache = SkShaperCache::Make();
+    auto shaper = SkShaper::MakeCaching(SkShaper::Make(), cache);
+    auto uncached = SkShaper::Make();
+    if (!shaper || !uncached) {
+        ERRORF(reporter, "Could not create shaper.");
+        return;
+    }
+
+    SkFont font(SkTypeface::MakeDefault(), 14);
+    auto shape = [&](const char* text, const SkFont& font, SkScalar width) {
+        CollectingRunHandler expected, actual;
+        uncached->shape(text, strlen(text), font, true, width, &expected);
+        shaper->shape(text, strlen(text), font, true, width, &actual);
+        check_same_runs(reporter, expected, actual);
+    };
+    const char* labels[] = {"OK", "Cancel", "12345", "OK", "Cancel", "Open the file menu"};
+    for (const char* label : labels) {
+        shape(label, font, 400);
+    }
+    SkShaperCache::Stats stats = cache->getStats();
+    REPORTER_ASSERT(reporter, stats.fRequests == 6);
+    REPORTER_ASSERT(reporter, stats.fHits == 2);
+    REPORTER_ASSERT(reporter, stats.fMisses == 4);
+    REPORTER_ASSERT(reporter, stats.fAdded == 4);
+    REPORTER_ASSERT(reporter, stats.fCount == 4);
+    REPORTER_ASSERT(reporter, stats.fBytesUsed > 0 && stats.fBytesUsed <= stats.fByteLimit);
+
+    // A different font or width is shaped again.
+    shape("Open the file menu", SkFont(SkTypeface::MakeDefault(), 20), 400);
+    shape("Open the file menu", font, 30);
+    REPORTER_ASSERT(reporter, cache->getStats().fMisses == 6);
+
+    // The same through the run iterators.
+    const char* text = "Open the file menu";
+    size_t length = strlen(text);
+    for (int i = 0; i < 2; ++i) {
+        SkShaper::TrivialFontRunIterator fontRuns(font, length);
+        SkShaper::TrivialBiDiRunIterator bidiRuns(0, length);
+        SkShaper::TrivialScriptRunIterator scriptRuns(SkSetFourByteTag('l','a','t','n'), length);
+        SkShaper::TrivialLanguageRunIterator languageRuns("en-US", length);
+        CollectingRunHandler expected, actual;
+        uncached->shape(text, length, fontRuns, bidiRuns, scriptRuns, languageRuns, 400,
+                        &expected);
+        SkShaper::TrivialFontRunIterator fontRuns2(font, length);
+        SkShaper::TrivialBiDiRunIterator bidiRuns2(0, length);
+        SkShaper::TrivialScriptRunIterator scriptRuns2(SkSetFourByteTag('l','a','t','n'), length);
+        SkShaper::TrivialLanguageRunIterator languageRuns2("en-US", length);
+        shaper->shape(text, length, fontRuns2, bidiRuns2, scriptRuns2, languageRuns2, 400,
+                      &actual);
+        check_same_runs(reporter, expected, actual);
+    }
+    stats = cache->getStats();
+    REPORTER_ASSERT(reporter, stats.fMisses == 7);
+    REPORTER_ASSERT(reporter, stats.fHits == 3);
+    REPORTER_ASSERT(reporter, stats.fCount == 7);
+
+    // Nothing fits in no bytes.
+    cache->setByteLimit(0);
+    stats = cache->getStats();
+    REPORTER_ASSERT(reporter, stats.fCount == 0 && stats.fBytesUsed == 0);
+    REPORTER_ASSERT(reporter, stats.fEvicted == 7);
+    shape("OK", font, 400);
+    REPORTER_ASSERT(reporter, cache->getStats().fCount == 0);
+
+    cache->setByteLimit(SkShaperCache::kDefaultByteLimit);
+    shape("OK", font, 400);
+    REPORTER_ASSERT(reporter, cache->getStats().fCount == 1);
+    cache->purgeAll();
+    REPORTER_ASSERT(reporter, cache->getStats().fCount == 0);
+}
+
 DEF_TEST(Shaper_cluster_empty, r) { shaper_test(r, "empty", SkData::MakeEmpty().get()); }
 
 #define SHAPER_TEST(X) DEF_TEST(Shaper_cluster_ ## X, r) { cluster_test(r, "text/" #X ".txt"); }
@@ -1,12 +1,14 @@
 // Copyright 2019 Google LLC.
 #include <sstream>
 #include <thread>
+#include "include/core/SkExecutor.h"
 #include "modules/skparagraph/include/TypefaceFontProvider.h"
 #include "modules/skparagraph/src/ParagraphBuilderImpl.h"
 #include "modules/skparagraph/src/ParagraphImpl.h"
 #include "modules/skparagraph/utils/TestFontCollection.h"
 #include "src/core/SkFontMgrPriv.h"
 #include "src/core/SkOSFile.h"
+#include "src/core/SkTaskGroup.h"
 #include "src/utils/SkOSPath.h"
 #include "src/utils/SkShaperJSONWriter.h"
 #include "tests/CodecPriv.h"
@@ -4796,6 +4798,174 @@ DEF_TEST(SkParagraph_CacheStyles, reporter) {
     test(2, false);
 }
 
+DEF_TEST(SkParagraph_CacheStatsAndByteLimit, reporter) {
+    ParagraphCache cache;
+    cache.turnOn(true);
+    sk_sp<ResourceFontCollection> fontCollection = sk_make_sp<ResourceFontCollection>();
+    if (!fontCollection->fontsFound()) return;
+
+    ParagraphStyle paragraph_style;
+    paragraph_style.turnHintingOff();
+
+    TextStyle text_style;
+    text_style.setFontFamilies({SkString("Roboto")});
+    text_style.setColor(SK_ColorBLACK);
+
+    auto make = [&](int i) {
+        SkString text = SkStringPrintf("text%d", i);
+        ParagraphBuilderImpl builder(paragraph_style, fontCollection);
+        builder.pushStyle(text_style);
+        builder.addText(text.c_str(), text.size());
+        builder.pop();
+        return builder.Build();
+    };
+    auto find = [&](int i) {
+        auto paragraph = make(i);
+        return cache.findParagraph(static_cast<ParagraphImpl*>(paragraph.get()));
+    };
+
+    for (int i = 0; i < 10; ++i) {
+        auto paragraph = make(i);
+        REPORTER_ASSERT(reporter,
+                        cache.updateParagraph(static_cast<ParagraphImpl*>(paragraph.get())));
+    }
+    for (int i = 0; i < 11; ++i) {
+        REPORTER_ASSERT(reporter, find(i) == (i < 10));
+    }
+    ParagraphCache::Stats stats = cache.getStats();
+    REPORTER_ASSERT(reporter, stats.fRequests == 11);
+    REPORTER_ASSERT(reporter, stats.fHits == 10);
+    REPORTER_ASSERT(reporter, stats.fMisses == 1);
+    REPORTER_ASSERT(reporter, stats.fAdded == 10);
+    REPORTER_ASSERT(reporter, stats.fEvicted == 0);
+    REPORTER_ASSERT(reporter, stats.fCount == 10);
+    REPORTER_ASSERT(reporter, stats.fBytesUsed > 0);
+    REPORTER_ASSERT(reporter, stats.fByteLimit == cache.getByteLimit());
+
+    // The paragraphs are all the same size, so half the bytes hold the five used last.
+    cache.setByteLimit(stats.fBytesUsed / 2);
+    stats = cache.getStats();
+    REPORTER_ASSERT(reporter, stats.fCount == 5);
+    REPORTER_ASSERT(reporter, stats.fEvicted == 5);
+    REPORTER_ASSERT(reporter, stats.fBytesUsed <= stats.fByteLimit);
+    for (int i = 0; i < 10; ++i) {
+        REPORTER_ASSERT(reporter, find(i) == (i >= 5));
+    }
+
+    // Paragraphs that can't fit are not added.
+    cache.setByteLimit(0);
+    REPORTER_ASSERT(reporter, cache.count() == 0);
+    auto paragraph = make(0);
+    REPORTER_ASSERT(reporter, !cache.updateParagraph(static_cast<ParagraphImpl*>(paragraph.get())));
+    REPORTER_ASSERT(reporter, cache.count() == 0);
+
+    cache.reset();
+    stats = cache.getStats();
+    REPORTER_ASSERT(reporter, stats.fRequests == 0 && stats.fEvicted == 0 && stats.fBytesUsed == 0);
+    REPORTER_ASSERT(reporter, stats.fByteLimit == 0);
+}
+
+DEF_TEST(SkParagraph_CacheThreads, reporter) {
+    sk_sp<ResourceFontCollection> fontCollection = sk_make_sp<ResourceFontCollection>();
+    if (!fontCollection->fontsFound()) return;
+    ParagraphCache* cache = fontCollection->getParagraphCache();
+    cache->reset();
+
+    ParagraphStyle paragraph_style;
+    paragraph_style.turnHintingOff();
+    TextStyle text_style;
+    text_style.setFontFamilies({SkString("Roboto")});
+    text_style.setColor(SK_ColorBLACK);
+
+    constexpr int kTexts = 10;
+    auto layout = [&](int i) {
+        SkString text = SkStringPrintf("Paragraph number %d, laid out on any thread", i);
+        ParagraphBuilderImpl builder(paragraph_style, fontCollection);
+        builder.pushStyle(text_style);
+        builder.addText(text.c_str(), text.size());
+        builder.pop();
+        auto paragraph = builder.Build();
+        paragraph->layout(TestCanvasWidth);
+        return paragraph->getMaxIntrinsicWidth();
+    };
+    SkScalar expected[kTexts];
+    for (int i = 0; i < kTexts; ++i) {
+        expected[i] = layout(i);
+    }
+
+    // Lay the same texts out again on several threads at once, sharing the cache.
+    constexpr int kTasks = 8, kLayoutsPerTask = 30;
+    std::atomic<int> mismatches{0};
+    auto executor = SkExecutor::MakeFIFOThreadPool(4);
+    SkTaskGroup(*executor).batch(kTasks, [&](int task) {
+        for (int i = 0; i < kLayoutsPerTask; ++i) {
+            int text = (task + i) % kTexts;
+            if (layout(text) != expected[text]) {
+                mismatches++;
+            }
+        }
+    });
+    REPORTER_ASSERT(reporter, mismatches == 0);
+
+    ParagraphCache::Stats stats = cache->getStats();
+    REPORTER_ASSERT(reporter, stats.fRequests == kTexts + kTasks * kLayoutsPerTask);
+    REPORTER_ASSERT(reporter, stats.fHits + stats.fMisses == stats.fRequests);
+    REPORTER_ASSERT(reporter, stats.fMisses == kTexts);
+    REPORTER_ASSERT(reporter, stats.fCount == kTexts);
+}
+
+DEF_TEST(SkParagraph_IncrementalRelayout, reporter) {
+    sk_sp<ResourceFontCollection> fontCollection = sk_make_sp<ResourceFontCollection>();
+    if (!fontCollection->fontsFound()) return;
+    fontCollection->disableFontFallback();
+
+    const char* text =
+            "This is a very long sentence to test if the text will properly wrap "
+            "around and go to the next line. Sometimes, short sentence. Longer "
+            "sentences are okay too because they are necessary. Very short. ";
+    const size_t len = strlen(text);
+
+    ParagraphStyle paragraph_style;
+    paragraph_style.setTextAlign(TextAlign::kJustify);
+    paragraph_style.turnHintingOff();
+    TextStyle text_style;
+    text_style.setFontFamilies({SkString("Roboto")});
+    text_style.setFontSize(20);
+    text_style.setLetterSpacing(1);
+    text_style.setWordSpacing(5);
+    text_style.setColor(SK_ColorBLACK);
+
+    auto make = [&]() {
+        ParagraphBuilderImpl builder(paragraph_style, fontCollection);
+        builder.pushStyle(text_style);
+        builder.addText(text, len);
+        builder.pop();
+        return builder.Build();
+    };
+
+    // One paragraph laid out again and again must match new paragraphs laid out once.
+    auto resized = make();
+    for (SkScalar width : {500, 150, 300, 80, 300, 1000, 500}) {
+        resized->layout(width);
+        auto fresh = make();
+        fresh->layout(width);
+
+        REPORTER_ASSERT(reporter, resized->getHeight() == fresh->getHeight());
+        REPORTER_ASSERT(reporter, resized->getLongestLine() == fresh->getLongestLine());
+        REPORTER_ASSERT(reporter, resized->getMinIntrinsicWidth() == fresh->getMinIntrinsicWidth());
+        REPORTER_ASSERT(reporter, resized->lineNumber() == fresh->lineNumber());
+
+        auto resizedBoxes = resized->getRectsForRange(0, len, RectHeightStyle::kTight,
+                                                      RectWidthStyle::kTight);
+        auto freshBoxes = fresh->getRectsForRange(0, len, RectHeightStyle::kTight,
+                                                  RectWidthStyle::kTight);
+        REPORTER_ASSERT(reporter, resizedBoxes.size() == freshBoxes.size());
+        for (size_t i = 0; i < std::min(resizedBoxes.size(), freshBoxes.size()); ++i) {
+            REPORTER_ASSERT(reporter, resizedBoxes[i].rect == freshBoxes[i].rect);
+        }
+    }
+}
+
 DEF_TEST(SkParagraph_EmptyParagraphWithLineBreak, reporter) {
     sk_sp<ResourceFontCollection> fontCollection = sk_make_sp<ResourceFontCollection>();
     if (!fontCollection->fontsFound()) return;
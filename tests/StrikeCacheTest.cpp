@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "include/core/SkExecutor.h"
+#include "include/core/SkFont.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkSurfaceProps.h"
+#include "src/core/SkGlyphBuffer.h"
+#include "src/core/SkStrikeCache.h"
+#include "src/core/SkStrikeSpec.h"
+#include "src/core/SkTaskGroup.h"
+#include "tests/Test.h"
+#include "tools/Resources.h"
+#include "tools/ToolUtils.h"
+
+#include <atomic>
+#include <vector>
+
+static std::vector<SkStrikeSpec> make_strike_specs(
+        int count, sk_sp<SkTypeface> typeface = ToolUtils::create_portable_typeface()) {
+    std::vector<SkStrikeSpec> specs;
+    for (int i = 0; i < count; i++) {
+        SkFont font(typeface, 8 + i);
+        specs.push_back(SkStrikeSpec::MakeMask(
+                font, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+                SkScalerContextFlags::kNone, SkMatrix::I()));
+    }
+    return specs;
+}
+
+DEF_TEST(StrikeCache_FindAndPurge, reporter) {
+    SkStrikeCache cache;
+    std::vector<SkStrikeSpec> specs = make_strike_specs(8);
+
+    for (const SkStrikeSpec& spec : specs) {
+        SkStrike* strike = spec.findOrCreateExclusiveStrike(&cache).get();
+        REPORTER_ASSERT(reporter, cache.findStrikeExclusive(spec.descriptor()).get() == strike);
+        REPORTER_ASSERT(reporter, spec.findOrCreateExclusiveStrike(&cache).get() == strike);
+    }
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 8);
+
+    // Use the first four again, then purge three: the least recently used are 4, 5 and 6.
+    for (int i = 0; i < 4; i++) {
+        REPORTER_ASSERT(reporter, cache.findStrikeExclusive(specs[i].descriptor()).get());
+    }
+    cache.setCacheCountLimit(5);
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 5);
+    for (int i = 0; i < 8; i++) {
+        bool found = cache.findStrikeExclusive(specs[i].descriptor()).get() != nullptr;
+        REPORTER_ASSERT(reporter, found == (i < 4 || i == 7));
+    }
+
+    cache.purgeAll();
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 0);
+    REPORTER_ASSERT(reporter, cache.getTotalMemoryUsed() == 0);
+}
+
+DEF_TEST(StrikeCache_Threads, reporter) {
+    SkStrikeCache cache;
+    cache.setCacheCountLimit(12);
+    std::vector<SkStrikeSpec> specs = make_strike_specs(24);
+
+    // Finding, creating and purging all at once, so strikes come and go under the threads.
+    std::atomic<int> mismatches{0};
+    auto executor = SkExecutor::MakeFIFOThreadPool(8);
+    SkTaskGroup(*executor).batch(16, [&](int index) {
+        for (int i = 0; i < 200; i++) {
+            const SkStrikeSpec& spec = specs[(index * 5 + i) % specs.size()];
+            SkExclusiveStrikePtr strike = spec.findOrCreateExclusiveStrike(&cache);
+            if (!strike || strike->getDescriptor() != spec.descriptor()) {
+                mismatches++;
+            }
+        }
+    });
+    REPORTER_ASSERT(reporter, mismatches == 0);
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() <= 12 + 16);
+
+    cache.purgeAll();
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 0);
+    REPORTER_ASSERT(reporter, cache.getTotalMemoryUsed() == 0);
+}
+
+DEF_TEST(StrikeCache_ReplaceWhilePurging, reporter) {
+    SkStrikeCache cache;
+    cache.setCacheCountLimit(4);
+    sk_sp<SkTypeface> typeface = ToolUtils::create_portable_typeface();
+    std::vector<SkStrikeSpec> specs = make_strike_specs(8, typeface);
+
+    // Half the threads replace strikes, as the SkStrikeClient does, while the rest create more
+    // than the budget allows, so purges keep removing the strikes being replaced.
+    std::atomic<int> mismatches{0};
+    auto executor = SkExecutor::MakeFIFOThreadPool(8);
+    SkTaskGroup(*executor).batch(16, [&](int index) {
+        for (int i = 0; i < 200; i++) {
+            const SkStrikeSpec& spec = specs[(index * 3 + i) % specs.size()];
+            SkExclusiveStrikePtr strike;
+            if (index % 2) {
+                strike = cache.createStrikeExclusive(
+                        spec.descriptor(),
+                        typeface->createScalerContext(SkScalerContextEffects(),
+                                                      &spec.descriptor()));
+            } else {
+                strike = spec.findOrCreateExclusiveStrike(&cache);
+            }
+            if (!strike || strike->getDescriptor() != spec.descriptor()) {
+                mismatches++;
+            }
+        }
+    });
+    REPORTER_ASSERT(reporter, mismatches == 0);
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() <= 4 + 16);
+
+    // At least four strikes are left, since purges stop at the limit and replacing a strike
+    // keeps the count. Once nothing else is running, a purge must find exactly the strikes it
+    // counted, and so end at the limit.
+    cache.setCacheCountLimit(4);
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 4);
+
+    // Every strike was counted in and out once.
+    cache.purgeAll();
+    REPORTER_ASSERT(reporter, cache.getCacheCountUsed() == 0);
+    REPORTER_ASSERT(reporter, cache.getTotalMemoryUsed() == 0);
+}
+
+DEF_TEST(StrikeCache_ParallelRasterization, reporter) {
+    sk_sp<SkTypeface> typeface = MakeResourceAsTypeface("fonts/Roboto-Regular.ttf");
+    if (!typeface) {
+        return;
+    }
+    SkFont font(typeface, 17);
+    font.setEdging(SkFont::Edging::kAntiAlias);
+    SkStrikeSpec spec = SkStrikeSpec::MakeMask(
+            font, SkPaint(), SkSurfaceProps(0, kUnknown_SkPixelGeometry),
+            SkScalerContextFlags::kNone, SkMatrix::I());
+
+    // Enough glyphs to be split between threads, with some repeated.
+    constexpr int kGlyphCount = 120;
+    SkPackedGlyphID glyphIDs[kGlyphCount];
+    SkGlyphID ids[kGlyphCount];
+    SkPoint positions[kGlyphCount];
+    for (int i = 0; i < kGlyphCount; i++) {
+        ids[i] = SkTo<SkGlyphID>(i % 100);
+        glyphIDs[i] = SkPackedGlyphID{ids[i]};
+        positions[i] = {i * 10.0f, 20.0f};
+    }
+
+    SkStrikeCache serialCache;
+    SkExclusiveStrikePtr serialStrike = spec.findOrCreateExclusiveStrike(&serialCache);
+    const SkGlyph* expected[kGlyphCount];
+    serialStrike->prepareImages({glyphIDs, kGlyphCount}, expected);
+
+    auto executor = SkExecutor::MakeFIFOThreadPool(4);
+    auto check = [&](const SkGlyph* glyph, const SkGlyph* expected) {
+        REPORTER_ASSERT(reporter, glyph->getPackedID() == expected->getPackedID());
+        REPORTER_ASSERT(reporter, glyph->iRect() == expected->iRect());
+        REPORTER_ASSERT(reporter, (glyph->image() == nullptr) == (expected->image() == nullptr));
+        if (glyph->image() && expected->image()) {
+            REPORTER_ASSERT(reporter,
+                            !memcmp(glyph->image(), expected->image(), glyph->imageSize()));
+        }
+    };
+
+    {
+        SkStrikeCache cache;
+        cache.setRasterExecutor(executor.get());
+        SkExclusiveStrikePtr strike = spec.findOrCreateExclusiveStrike(&cache);
+        const SkGlyph* glyphs[kGlyphCount];
+        strike->prepareImages({glyphIDs, kGlyphCount}, glyphs);
+        for (int i = 0; i < kGlyphCount; i++) {
+            check(glyphs[i], expected[i]);
+            REPORTER_ASSERT(reporter, glyphs[i] == glyphs[i % 100]);
+        }
+        REPORTER_ASSERT(reporter, cache.getTotalMemoryUsed() == serialCache.getTotalMemoryUsed());
+    }
+
+    {
+        SkStrikeCache cache;
+        cache.setRasterExecutor(executor.get());
+        SkExclusiveStrikePtr strike = spec.findOrCreateExclusiveStrike(&cache);
+        positions[3].fX = SK_ScalarNaN;
+        SkDrawableGlyphBuffer drawables;
+        drawables.ensureSize(kGlyphCount);
+        drawables.startSource({kGlyphCount, ids, positions}, {0, 0});
+        strike->prepareForDrawingMasksCPU(&drawables);
+
+        // Only glyphs with images are drawn, and never the one with a bad position.
+        int expectedIndex = 0;
+        for (auto [glyph, pos] : drawables.drawable()) {
+            while (expectedIndex == 3 || expected[expectedIndex]->image() == nullptr) {
+                expectedIndex++;
+            }
+            check(glyph.glyph(), expected[expectedIndex]);
+            REPORTER_ASSERT(reporter, pos == positions[expectedIndex]);
+            expectedIndex++;
+        }
+    }
+}
@@ -7,6 +7,7 @@
 
 #include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
+#include "include/core/SkExecutor.h"
 #include "include/core/SkOverdrawCanvas.h"
 #include "include/core/SkPath.h"
 #include "include/core/SkRRect.h"
@@ -1181,3 +1182,80 @@ DEF_TEST(surface_image_unity, reporter) {
         }
     }
 }
+
+DEF_TEST(Surface_RasterDeferred, r) {
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(64, 64);
+    REPORTER_ASSERT(r, !SkSurface::MakeRasterDeferred(SkImageInfo::MakeN32Premul(0, 64)));
+
+    std::unique_ptr<SkExecutor> executor = SkExecutor::MakeFIFOThreadPool(1);
+    for (SkExecutor* e : {(SkExecutor*)nullptr, executor.get()}) {
+        sk_sp<SkSurface> deferred = SkSurface::MakeRasterDeferred(info, e),
+                         expected = SkSurface::MakeRaster(info);
+        REPORTER_ASSERT(r, deferred && deferred->imageInfo() == info);
+
+        auto same_pixels = [&](const char* when) {
+            SkBitmap a, b;
+            a.allocPixels(info);
+            b.allocPixels(info);
+            REPORTER_ASSERT(r, deferred->readPixels(a, 0, 0), "%s", when);
+            REPORTER_ASSERT(r, expected->readPixels(b, 0, 0), "%s", when);
+            REPORTER_ASSERT(r, ToolUtils::equal_pixels(a, b), "%s", when);
+        };
+
+        // The save, matrix and clip carry over from one flushed frame to the next.
+        for (SkSurface* surface : {deferred.get(), expected.get()}) {
+            SkCanvas* canvas = surface->getCanvas();
+            canvas->clear(SK_ColorWHITE);
+            canvas->save();
+            canvas->translate(10, 10);
+            canvas->clipRect(SkRect::MakeWH(30, 30));
+            SkPaint paint;
+            paint.setColor(SK_ColorRED);
+            canvas->drawRect(SkRect::MakeWH(20, 20), paint);
+        }
+        deferred->flush();
+        for (SkSurface* surface : {deferred.get(), expected.get()}) {
+            SkCanvas* canvas = surface->getCanvas();
+            SkPaint paint;
+            paint.setColor(SK_ColorBLUE);
+            canvas->drawRect(SkRect::MakeXYWH(15, 15, 40, 40), paint);
+            canvas->restore();
+            paint.setColor(SK_ColorGREEN);
+            paint.setAntiAlias(true);
+            canvas->drawCircle(50, 50, 10, paint);
+        }
+        same_pixels("after two frames");
+
+        // A snapshot holds on to the contents, while later draws go on to the surface.
+        sk_sp<SkImage> snapshot = deferred->makeImageSnapshot();
+        uint32_t genID = deferred->generationID();
+        for (SkSurface* surface : {deferred.get(), expected.get()}) {
+            surface->getCanvas()->drawColor(0x80FF00FF);
+        }
+        int finished = 0;
+        GrFlushInfo flushInfo;
+        flushInfo.fFlags = kSyncCpu_GrFlushFlag;
+        flushInfo.fFinishedProc = [](GrGpuFinishedContext context) { ++*(int*)context; };
+        flushInfo.fFinishedContext = &finished;
+        deferred->flush(SkSurface::BackendSurfaceAccess::kNoAccess, flushInfo);
+        REPORTER_ASSERT(r, finished == 1);
+        REPORTER_ASSERT(r, deferred->generationID() != genID);
+        same_pixels("after a snapshot");
+
+        SkBitmap before;
+        before.allocPixels(info);
+        REPORTER_ASSERT(r, snapshot->readPixels(before.pixmap(), 0, 0));
+        REPORTER_ASSERT(r, *before.getAddr32(50, 50) != *before.getAddr32(0, 0));
+        REPORTER_ASSERT(r, *before.getAddr32(0, 0) == SK_ColorWHITE);
+
+        // Draws not yet flushed are drawn before pixels are written or peeked.
+        for (SkSurface* surface : {deferred.get(), expected.get()}) {
+            surface->getCanvas()->drawColor(SK_ColorYELLOW);
+            surface->writePixels(before, 32, 32);
+        }
+        same_pixels("after writePixels");
+        SkPixmap pixmap;
+        REPORTER_ASSERT(r, deferred->peekPixels(&pixmap));
+        REPORTER_ASSERT(r, pixmap.getColor(0, 0) == SK_ColorYELLOW);
+    }
+}
@@ -167,8 +167,9 @@ public:
         procs.fImageProc = SkSharingDeserialContext::deserializeImage;
         procs.fImageCtx = deserialContext.get();
 
-        // The outer format of multi-frame skps is the multi-picture document, which is a
-        // skp file containing subpictures separated by annotations.
+        // The outer format of multi-frame skps is the multi-picture document, which holds an
+        // index of its pages, or for older files, a skp file containing subpictures separated
+        // by annotations.
         int page_count = SkMultiPictureDocumentReadPageCount(stream.get());
         if (!page_count) {
             return nullptr;